@@ -0,0 +1,1322 @@
+#include "BlockCompress.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Block rows below this many blocks are not worth a job each.
+	const uint32_t ParallelBlocksPerChunk = 256;
+	// Least-squares passes over the endpoints in quality mode.
+	const uint32_t RefineIterations = 2;
+	// BC7 mode 1 partitions fully encoded in quality mode: those closest to the block's own split.
+	const uint32_t Mode1Candidates = 2;
+
+	const float WeightsRGB[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	const float WeightsRGBA[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const float WeightsAlpha[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// BC7 interpolation weights, out of 64, for 3- and 4-bit indices.
+	const uint32_t BC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const uint32_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// BC7 two-subset partitions: bit i set when texel i is in subset 1.
+	const uint16_t BC7Partitions2[64] =
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+		0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+		0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+		0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+		0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+	};
+
+	// The texel of subset 1 whose index drops its top bit; subset 0's is always texel 0.
+	const uint8_t BC7Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+	};
+
+	// One 4x4 block: the texels, and each channel of them as floats for the fitting.
+	struct FBlock
+	{
+		alignas(16) float mChannels[4][16];
+		uint8_t mTexels[16][4];
+		bool mOpaque;            // Every alpha is 255.
+		uint32_t mOpaqueMask;    // Texels with alpha of at least 128, which BC1 keeps.
+	};
+
+	void LoadBlock(const uint8_t* src, uint32_t width, uint32_t height, uint32_t srcRowPitch,
+		uint32_t blockX, uint32_t blockY, bool simd, FBlock& block)
+	{
+		block.mOpaque = true;
+		block.mOpaqueMask = 0;
+#if BLOCK_COMPRESS_SSE2
+		// Blocks inside the image: a row of four texels at a time, split into channels.
+		if (simd && blockX * 4 + 4 <= width && blockY * 4 + 4 <= height)
+		{
+			const __m128i byteMask = _mm_set1_epi32(0xff);
+			int opaque = 0xf;
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint8_t* row = src + static_cast<size_t>(blockY * 4 + y) * srcRowPitch + blockX * 16;
+				__m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(block.mTexels[y * 4]), texels);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					__m128i channel = _mm_and_si128(_mm_srli_epi32(texels, c * 8), byteMask);
+					_mm_store_ps(&block.mChannels[c][y * 4], _mm_cvtepi32_ps(channel));
+				}
+				__m128i alpha = _mm_srli_epi32(texels, 24);
+				block.mOpaqueMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(alpha, _mm_set1_epi32(127))))) << (y * 4);
+				opaque &= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(alpha, byteMask)));
+			}
+			block.mOpaque = opaque == 0xf;
+			return;
+		}
+#else
+		(void)simd;
+#endif
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t x = std::min(blockX * 4 + (i & 3), width - 1);
+			uint32_t y = std::min(blockY * 4 + (i >> 2), height - 1);
+			const uint8_t* texel = src + static_cast<size_t>(y) * srcRowPitch + x * 4;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				block.mTexels[i][c] = texel[c];
+				block.mChannels[c][i] = texel[c];
+			}
+			block.mOpaque = block.mOpaque && texel[3] == 255;
+			block.mOpaqueMask |= texel[3] >= 128 ? 1u << i : 0u;
+		}
+	}
+
+	// For each texel, the palette entry nearest in sum of weights[c] * (texel - entry)^2, the
+	// lowest index on ties. Returns the error summed over the texels in mask; indices are
+	// written for all of them. Every value is a small integer, so float arithmetic is exact
+	// and the SIMD and scalar paths agree.
+	float SelectIndicesScalar(const FBlock& block, uint32_t mask, const float (*palette)[4], uint32_t count,
+		const float weights[4], uint8_t* indices)
+	{
+		float total = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float best = FLT_MAX;
+			uint32_t bestIndex = 0;
+			for (uint32_t p = 0; p < count; ++p)
+			{
+				float error = 0.0f;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					float d = block.mChannels[c][i] - palette[p][c];
+					error += d * d * weights[c];
+				}
+				if (error < best)
+				{
+					best = error;
+					bestIndex = p;
+				}
+			}
+			indices[i] = static_cast<uint8_t>(bestIndex);
+			total += mask & (1u << i) ? best : 0.0f;
+		}
+		return total;
+	}
+
+#if BLOCK_COMPRESS_SSE2
+	float SelectIndicesSSE2(const FBlock& block, uint32_t mask, const float (*palette)[4], uint32_t count,
+		const float weights[4], uint8_t* indices)
+	{
+		__m128 best[4];
+		__m128i bestIndex[4];
+		for (uint32_t g = 0; g < 4; ++g)
+		{
+			best[g] = _mm_set1_ps(FLT_MAX);
+			bestIndex[g] = _mm_setzero_si128();
+		}
+
+		const __m128 w0 = _mm_set1_ps(weights[0]);
+		const __m128 w1 = _mm_set1_ps(weights[1]);
+		const __m128 w2 = _mm_set1_ps(weights[2]);
+		const __m128 w3 = _mm_set1_ps(weights[3]);
+		for (uint32_t p = 0; p < count; ++p)
+		{
+			const __m128 p0 = _mm_set1_ps(palette[p][0]);
+			const __m128 p1 = _mm_set1_ps(palette[p][1]);
+			const __m128 p2 = _mm_set1_ps(palette[p][2]);
+			const __m128 p3 = _mm_set1_ps(palette[p][3]);
+			const __m128i index = _mm_set1_epi32(static_cast<int>(p));
+			for (uint32_t g = 0; g < 4; ++g)
+			{
+				__m128 d0 = _mm_sub_ps(_mm_load_ps(&block.mChannels[0][g * 4]), p0);
+				__m128 d1 = _mm_sub_ps(_mm_load_ps(&block.mChannels[1][g * 4]), p1);
+				__m128 d2 = _mm_sub_ps(_mm_load_ps(&block.mChannels[2][g * 4]), p2);
+				__m128 d3 = _mm_sub_ps(_mm_load_ps(&block.mChannels[3][g * 4]), p3);
+				__m128 error = _mm_mul_ps(_mm_mul_ps(d0, d0), w0);
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(d1, d1), w1));
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(d2, d2), w2));
+				error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(d3, d3), w3));
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best[g]));
+				best[g] = _mm_min_ps(error, best[g]);
+				bestIndex[g] = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex[g]));
+			}
+		}
+
+		// Texels outside the mask add nothing.
+		const __m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t g = 0; g < 4; ++g)
+		{
+			__m128i bits = _mm_set1_epi32(static_cast<int>((mask >> (g * 4)) & 0xf));
+			__m128i inMask = _mm_cmpeq_epi32(_mm_and_si128(bits, laneBits), laneBits);
+			sum = _mm_add_ps(sum, _mm_and_ps(best[g], _mm_castsi128_ps(inMask)));
+
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex[g]);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				indices[g * 4 + i] = static_cast<uint8_t>(lanes[i]);
+			}
+		}
+		alignas(16) float partial[4];
+		_mm_store_ps(partial, sum);
+		return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+	}
+#endif
+
+	float SelectIndices(const FBlock& block, uint32_t mask, const float (*palette)[4], uint32_t count,
+		const float weights[4], uint8_t* indices, bool simd)
+	{
+#if BLOCK_COMPRESS_SSE2
+		if (simd)
+		{
+			return SelectIndicesSSE2(block, mask, palette, count, weights, indices);
+		}
+#endif
+		return SelectIndicesScalar(block, mask, palette, count, weights, indices);
+	}
+
+	float Clamp255(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+	}
+
+	// Sums over the texels in mask: of each channel, of each product of two channels, and
+	// the range of each channel. All are sums of small integers, so exact, and the SIMD and
+	// scalar paths agree.
+	struct FMoments
+	{
+		float mCount;
+		float mSums[4];
+		float mProducts[4][4];    // Upper triangle.
+		float mLow[4];
+		float mHigh[4];
+	};
+
+	void ComputeMomentsScalar(const FBlock& block, uint32_t mask, FMoments& moments)
+	{
+		memset(&moments, 0, sizeof(moments));
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			moments.mLow[c] = 255.0f;
+		}
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask & (1u << i))
+			{
+				moments.mCount += 1.0f;
+				for (uint32_t a = 0; a < 4; ++a)
+				{
+					float value = block.mChannels[a][i];
+					moments.mSums[a] += value;
+					moments.mLow[a] = std::min(moments.mLow[a], value);
+					moments.mHigh[a] = std::max(moments.mHigh[a], value);
+					for (uint32_t b = a; b < 4; ++b)
+					{
+						moments.mProducts[a][b] += value * block.mChannels[b][i];
+					}
+				}
+			}
+		}
+	}
+
+#if BLOCK_COMPRESS_SSE2
+	float HorizontalSum(__m128 value)
+	{
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, value);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+
+	void ComputeMomentsSSE2(const FBlock& block, uint32_t mask, FMoments& moments)
+	{
+		const __m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+		const __m128 maximum = _mm_set1_ps(255.0f);
+		__m128 count = _mm_setzero_ps();
+		__m128 sums[4];
+		__m128 products[4][4];
+		__m128 low[4];
+		__m128 high[4];
+		for (uint32_t a = 0; a < 4; ++a)
+		{
+			sums[a] = _mm_setzero_ps();
+			low[a] = maximum;
+			high[a] = _mm_setzero_ps();
+			for (uint32_t b = a; b < 4; ++b)
+			{
+				products[a][b] = _mm_setzero_ps();
+			}
+		}
+
+		for (uint32_t g = 0; g < 4; ++g)
+		{
+			__m128i bits = _mm_set1_epi32(static_cast<int>((mask >> (g * 4)) & 0xf));
+			__m128 inMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, laneBits), laneBits));
+			count = _mm_add_ps(count, _mm_and_ps(inMask, _mm_set1_ps(1.0f)));
+
+			__m128 values[4];
+			for (uint32_t a = 0; a < 4; ++a)
+			{
+				__m128 value = _mm_load_ps(&block.mChannels[a][g * 4]);
+				values[a] = _mm_and_ps(value, inMask);
+				sums[a] = _mm_add_ps(sums[a], values[a]);
+				// Texels outside the mask count as 255 for the low end and 0 for the high.
+				low[a] = _mm_min_ps(low[a], _mm_or_ps(values[a], _mm_andnot_ps(inMask, maximum)));
+				high[a] = _mm_max_ps(high[a], values[a]);
+			}
+			for (uint32_t a = 0; a < 4; ++a)
+			{
+				for (uint32_t b = a; b < 4; ++b)
+				{
+					products[a][b] = _mm_add_ps(products[a][b], _mm_mul_ps(values[a], values[b]));
+				}
+			}
+		}
+
+		memset(&moments, 0, sizeof(moments));
+		moments.mCount = HorizontalSum(count);
+		for (uint32_t a = 0; a < 4; ++a)
+		{
+			alignas(16) float lanes[4];
+			moments.mSums[a] = HorizontalSum(sums[a]);
+			_mm_store_ps(lanes, low[a]);
+			moments.mLow[a] = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+			_mm_store_ps(lanes, high[a]);
+			moments.mHigh[a] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+			for (uint32_t b = a; b < 4; ++b)
+			{
+				moments.mProducts[a][b] = HorizontalSum(products[a][b]);
+			}
+		}
+	}
+#endif
+
+	void ComputeMoments(const FBlock& block, uint32_t mask, bool simd, FMoments& moments)
+	{
+#if BLOCK_COMPRESS_SSE2
+		if (simd)
+		{
+			ComputeMomentsSSE2(block, mask, moments);
+			return;
+		}
+#endif
+		ComputeMomentsScalar(block, mask, moments);
+	}
+
+	// Endpoints of a line through the texels in mask, over the first channelCount channels;
+	// the others are left at 255. Fast mode runs the line along the bounding box diagonal
+	// that follows the texels' correlation, quality mode along their principal axis; either
+	// way the endpoints are where the outermost texels project onto it.
+	void FitLine(const FBlock& block, uint32_t mask, uint32_t channelCount, EBlockCompressMode mode, bool simd,
+		float endpoint0[4], float endpoint1[4])
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			endpoint0[c] = endpoint1[c] = 255.0f;
+		}
+		FMoments moments;
+		ComputeMoments(block, mask, simd, moments);
+		if (moments.mCount == 0.0f)
+		{
+			return;
+		}
+
+		float mean[4];
+		float covariance[4][4];
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			mean[a] = moments.mSums[a] / moments.mCount;
+			for (uint32_t b = a; b < channelCount; ++b)
+			{
+				covariance[a][b] = covariance[b][a] = moments.mProducts[a][b] - moments.mSums[a] * moments.mSums[b] / moments.mCount;
+			}
+		}
+
+		// The diagonal: every channel's range, negated where it falls as the widest one rises.
+		float axis[4] = {};
+		uint32_t widest = 0;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] = moments.mHigh[c] - moments.mLow[c];
+			widest = axis[c] > axis[widest] ? c : widest;
+		}
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] = covariance[c][widest] < 0.0f ? -axis[c] : axis[c];
+		}
+
+		if (mode == EBlockCompressMode::Quality)
+		{
+			// Power iteration from the diagonal, which is usually close already.
+			for (uint32_t iteration = 0; iteration < 8; ++iteration)
+			{
+				float next[4] = {};
+				float length = 0.0f;
+				for (uint32_t a = 0; a < channelCount; ++a)
+				{
+					for (uint32_t b = 0; b < channelCount; ++b)
+					{
+						next[a] += covariance[a][b] * axis[b];
+					}
+					length = std::max(length, std::fabs(next[a]));
+				}
+				if (length == 0.0f)
+				{
+					break;
+				}
+				for (uint32_t c = 0; c < channelCount; ++c)
+				{
+					axis[c] = next[c] / length;
+				}
+			}
+		}
+
+		float lengthSquared = 0.0f;
+		float meanProjection = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			lengthSquared += axis[c] * axis[c];
+			meanProjection += mean[c] * axis[c];
+		}
+		if (lengthSquared == 0.0f)
+		{
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				endpoint0[c] = endpoint1[c] = mean[c];
+			}
+			return;
+		}
+
+		float lowest = FLT_MAX;
+		float highest = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask & (1u << i))
+			{
+				float t = 0.0f;
+				for (uint32_t c = 0; c < channelCount; ++c)
+				{
+					t += block.mChannels[c][i] * axis[c];
+				}
+				lowest = std::min(lowest, t);
+				highest = std::max(highest, t);
+			}
+		}
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			endpoint0[c] = Clamp255(mean[c] + axis[c] * (lowest - meanProjection) / lengthSquared);
+			endpoint1[c] = Clamp255(mean[c] + axis[c] * (highest - meanProjection) / lengthSquared);
+		}
+	}
+
+	// The endpoints, over channels [channelBegin, channelEnd), that best reproduce the texels
+	// in mask for the given indices, where index i sits fractions[i] of the way from endpoint0
+	// to endpoint1. False if the indices do not pin the endpoints down (all the same, say).
+	bool RefineEndpoints(const FBlock& block, uint32_t mask, const uint8_t* indices, const float* fractions,
+		uint32_t channelBegin, uint32_t channelEnd, float endpoint0[4], float endpoint1[4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask & (1u << i))
+			{
+				float b = fractions[indices[i]];
+				float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (uint32_t c = channelBegin; c < channelEnd; ++c)
+				{
+					ax[c] += a * block.mChannels[c][i];
+					bx[c] += b * block.mChannels[c][i];
+				}
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (uint32_t c = channelBegin; c < channelEnd; ++c)
+		{
+			endpoint0[c] = Clamp255((bb * ax[c] - ab * bx[c]) / determinant);
+			endpoint1[c] = Clamp255((aa * bx[c] - ab * ax[c]) / determinant);
+		}
+		return true;
+	}
+
+	// BC1 colours -----------------------------------------------------------------------
+
+	uint16_t To565(const float color[4])
+	{
+		uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+		uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+		uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	void From565(uint16_t value, uint32_t color[4])
+	{
+		uint32_t r = value >> 11;
+		uint32_t g = (value >> 5) & 63;
+		uint32_t b = value & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+		color[3] = 255;
+	}
+
+	// The four colours of a BC1 block, as a decoder makes them: interpolated when colour0 is
+	// greater, otherwise a midpoint and transparent black.
+	void MakeBC1Palette(uint16_t color0, uint16_t color1, bool alwaysFourColor, uint32_t palette[4][4])
+	{
+		From565(color0, palette[0]);
+		From565(color1, palette[1]);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			if (color0 > color1 || alwaysFourColor)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	void WriteBC1(uint16_t color0, uint16_t color1, const uint8_t* indices, uint8_t* out)
+	{
+		uint32_t bits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+		out[0] = static_cast<uint8_t>(color0);
+		out[1] = static_cast<uint8_t>(color0 >> 8);
+		out[2] = static_cast<uint8_t>(color1);
+		out[3] = static_cast<uint8_t>(color1 >> 8);
+		memcpy(out + 4, &bits, 4);
+	}
+
+	// BC1 colour block. threeColor encodes punch-through alpha: texels below 128 get the
+	// transparent index. The BC2/BC3 colour block is always four-colour.
+	void EncodeBC1Color(const FBlock& block, EBlockCompressMode mode, bool threeColor, bool simd, uint8_t* out)
+	{
+		static const float FourColorFractions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float ThreeColorFractions[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+		uint32_t mask = threeColor ? block.mOpaqueMask : 0xffff;
+		uint8_t bestIndices[16] = {};
+		if (mask == 0)
+		{
+			memset(bestIndices, 3, sizeof(bestIndices));
+			WriteBC1(0, 0, bestIndices, out);
+			return;
+		}
+
+		float endpoint0[4];
+		float endpoint1[4];
+		FitLine(block, mask, 3, mode, simd, endpoint0, endpoint1);
+
+		uint16_t bestColor0 = 0;
+		uint16_t bestColor1 = 0;
+		float bestError = FLT_MAX;
+		uint32_t iterations = mode == EBlockCompressMode::Quality ? RefineIterations + 1 : 1;
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			uint16_t color0 = To565(endpoint0);
+			uint16_t color1 = To565(endpoint1);
+			// Four-colour blocks need colour0 above colour1, three-colour ones the reverse.
+			if (threeColor ? color0 > color1 : color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+
+			uint32_t palette[4][4];
+			MakeBC1Palette(color0, color1, !threeColor, palette);
+			float paletteFloat[4][4];
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					paletteFloat[p][c] = static_cast<float>(palette[p][c]);
+				}
+			}
+
+			// Equal endpoints make even a four-colour block decode as three-colour, whose
+			// fourth entry is transparent; the first entry alone is as good.
+			uint8_t indices[16];
+			uint32_t count = color0 == color1 ? 1 : (threeColor ? 3 : 4);
+			float error = SelectIndices(block, mask, paletteFloat, count, WeightsRGB, indices, simd);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColor0 = color0;
+				bestColor1 = color1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f || iteration + 1 == iterations ||
+				!RefineEndpoints(block, mask, indices, threeColor ? ThreeColorFractions : FourColorFractions, 0, 3,
+					endpoint0, endpoint1))
+			{
+				break;
+			}
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			bestIndices[i] = mask & (1u << i) ? bestIndices[i] : 3;
+		}
+		WriteBC1(bestColor0, bestColor1, bestIndices, out);
+	}
+
+	// BC3 alpha -----------------------------------------------------------------------------
+
+	// The eight alphas of a BC3 alpha block: interpolated when alpha0 is greater, otherwise
+	// four interpolated ones then 0 and 255.
+	void MakeAlphaPalette(uint32_t alpha0, uint32_t alpha1, float palette[8][4])
+	{
+		uint32_t alphas[8] = { alpha0, alpha1 };
+		for (uint32_t i = 2; i < 8; ++i)
+		{
+			if (alpha0 > alpha1)
+			{
+				alphas[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+			}
+			else
+			{
+				alphas[i] = i < 6 ? ((6 - i) * alpha0 + (i - 1) * alpha1) / 5 : (i == 6 ? 0 : 255);
+			}
+		}
+		for (uint32_t p = 0; p < 8; ++p)
+		{
+			palette[p][0] = palette[p][1] = palette[p][2] = 0.0f;
+			palette[p][3] = static_cast<float>(alphas[p]);
+		}
+	}
+
+	float TryAlphaEndpoints(const FBlock& block, uint32_t alpha0, uint32_t alpha1, bool simd,
+		uint32_t& bestAlpha0, uint32_t& bestAlpha1, uint8_t* bestIndices, float bestError)
+	{
+		float palette[8][4];
+		MakeAlphaPalette(alpha0, alpha1, palette);
+		uint8_t indices[16];
+		float error = SelectIndices(block, 0xffff, palette, 8, WeightsAlpha, indices, simd);
+		if (error < bestError)
+		{
+			bestAlpha0 = alpha0;
+			bestAlpha1 = alpha1;
+			memcpy(bestIndices, indices, sizeof(indices));
+			return error;
+		}
+		return bestError;
+	}
+
+	void EncodeBC3Alpha(const FBlock& block, EBlockCompressMode mode, bool simd, uint8_t* out)
+	{
+		static const float EightAlphaFractions[8] =
+			{ 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+		uint32_t low = 255;
+		uint32_t high = 0;
+		uint32_t innerLow = 255;
+		uint32_t innerHigh = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t alpha = block.mTexels[i][3];
+			low = std::min(low, alpha);
+			high = std::max(high, alpha);
+			if (alpha != 0 && alpha != 255)
+			{
+				innerLow = std::min(innerLow, alpha);
+				innerHigh = std::max(innerHigh, alpha);
+			}
+		}
+
+		uint32_t bestAlpha0 = high;
+		uint32_t bestAlpha1 = low;
+		uint8_t bestIndices[16] = {};
+		float bestError = TryAlphaEndpoints(block, high, low, simd, bestAlpha0, bestAlpha1, bestIndices, FLT_MAX);
+
+		if (mode == EBlockCompressMode::Quality && bestError > 0.0f)
+		{
+			// Blocks with fully transparent or opaque texels may do better with the six-alpha
+			// mode, whose last two entries are exactly 0 and 255.
+			if (innerLow <= innerHigh)
+			{
+				bestError = TryAlphaEndpoints(block, innerLow, innerHigh, simd, bestAlpha0, bestAlpha1, bestIndices, bestError);
+			}
+
+			float endpoint0[4];
+			float endpoint1[4];
+			for (uint32_t iteration = 0; iteration < RefineIterations && bestAlpha0 > bestAlpha1; ++iteration)
+			{
+				if (!RefineEndpoints(block, 0xffff, bestIndices, EightAlphaFractions, 3, 4, endpoint0, endpoint1))
+				{
+					break;
+				}
+				uint32_t alpha0 = static_cast<uint32_t>(endpoint0[3] + 0.5f);
+				uint32_t alpha1 = static_cast<uint32_t>(endpoint1[3] + 0.5f);
+				if (alpha0 <= alpha1)
+				{
+					break;
+				}
+				float error = TryAlphaEndpoints(block, alpha0, alpha1, simd, bestAlpha0, bestAlpha1, bestIndices, bestError);
+				if (error >= bestError)
+				{
+					break;
+				}
+				bestError = error;
+			}
+		}
+
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			bits |= static_cast<uint64_t>(bestIndices[i]) << (i * 3);
+		}
+		out[0] = static_cast<uint8_t>(bestAlpha0);
+		out[1] = static_cast<uint8_t>(bestAlpha1);
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+		}
+	}
+
+	// BC7 -----------------------------------------------------------------------------------
+
+	class CBitWriter
+	{
+		uint8_t* mData;
+		uint32_t mPosition;
+
+	public:
+		explicit CBitWriter(uint8_t* data) : mData(data), mPosition(0) { memset(data, 0, 16); }
+
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; ++i, ++mPosition)
+			{
+				mData[mPosition >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (mPosition & 7));
+			}
+		}
+	};
+
+	class CBitReader
+	{
+		const uint8_t* mData;
+		uint32_t mPosition;
+
+	public:
+		explicit CBitReader(const uint8_t* data) : mData(data), mPosition(0) {}
+
+		uint32_t Read(uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; ++i, ++mPosition)
+			{
+				value |= static_cast<uint32_t>((mData[mPosition >> 3] >> (mPosition & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// A BC7 endpoint: colourBits per channel plus a p-bit, widened to 8 bits by repeating its
+	// top bits.
+	uint32_t ExpandBC7(uint32_t value, uint32_t pBit, uint32_t colorBits)
+	{
+		uint32_t withP = value << 1 | pBit;
+		uint32_t bits = colorBits + 1;
+		return bits == 8 ? withP : (withP << (8 - bits) | withP >> (2 * bits - 8));
+	}
+
+	// The colourBits value whose expansion with pBit is nearest to target.
+	uint32_t QuantizeBC7(float target, uint32_t pBit, uint32_t colorBits, float& error)
+	{
+		uint32_t maximum = (1u << colorBits) - 1;
+		float step = static_cast<float>(1u << (8 - colorBits));
+		int32_t guess = static_cast<int32_t>(target / step);
+		uint32_t best = 0;
+		error = FLT_MAX;
+		for (int32_t candidate = guess - 1; candidate <= guess + 1; ++candidate)
+		{
+			uint32_t value = static_cast<uint32_t>(std::min(std::max(candidate, 0), static_cast<int32_t>(maximum)));
+			float d = static_cast<float>(ExpandBC7(value, pBit, colorBits)) - target;
+			if (d * d < error)
+			{
+				error = d * d;
+				best = value;
+			}
+		}
+		return best;
+	}
+
+	struct FBC7Endpoint
+	{
+		uint32_t mValue[4];      // colourBits each.
+		uint32_t mExpanded[4];
+	};
+
+	// Quantizes the endpoints of one subset, either each with its own p-bit (mode 6) or with
+	// one shared by both (mode 1), choosing the p-bits that land closest.
+	void QuantizeBC7Endpoints(const float endpoint0[4], const float endpoint1[4], uint32_t colorBits,
+		uint32_t channelCount, bool sharedPBit, FBC7Endpoint& quantized0, FBC7Endpoint& quantized1,
+		uint32_t& pBit0, uint32_t& pBit1)
+	{
+		float bestErrors[2][2] = {};
+		FBC7Endpoint candidates[2][2];
+		for (uint32_t endpoint = 0; endpoint < 2; ++endpoint)
+		{
+			const float* target = endpoint == 0 ? endpoint0 : endpoint1;
+			for (uint32_t p = 0; p < 2; ++p)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					float error = 0.0f;
+					FBC7Endpoint& candidate = candidates[endpoint][p];
+					candidate.mValue[c] = c < channelCount ? QuantizeBC7(target[c], p, colorBits, error) : (1u << colorBits) - 1;
+					candidate.mExpanded[c] = c < channelCount ? ExpandBC7(candidate.mValue[c], p, colorBits) : 255;
+					bestErrors[endpoint][p] += error;
+				}
+			}
+		}
+
+		if (sharedPBit)
+		{
+			pBit0 = pBit1 = bestErrors[0][1] + bestErrors[1][1] < bestErrors[0][0] + bestErrors[1][0] ? 1 : 0;
+		}
+		else
+		{
+			pBit0 = bestErrors[0][1] < bestErrors[0][0] ? 1 : 0;
+			pBit1 = bestErrors[1][1] < bestErrors[1][0] ? 1 : 0;
+		}
+		quantized0 = candidates[0][pBit0];
+		quantized1 = candidates[1][pBit1];
+	}
+
+	void MakeBC7Palette(const FBC7Endpoint& endpoint0, const FBC7Endpoint& endpoint1, const uint32_t* weights,
+		uint32_t count, float palette[16][4])
+	{
+		for (uint32_t p = 0; p < count; ++p)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				uint32_t value = ((64 - weights[p]) * endpoint0.mExpanded[c] + weights[p] * endpoint1.mExpanded[c] + 32) >> 6;
+				palette[p][c] = static_cast<float>(value);
+			}
+		}
+	}
+
+	// The result of encoding one subset: its quantized endpoints and indices.
+	struct FBC7Subset
+	{
+		FBC7Endpoint mEndpoints[2];
+		uint32_t mPBits[2];
+		uint8_t mIndices[16];
+		float mError;
+	};
+
+	// Fits, quantizes and (in quality mode) refines one subset of a mode 1 or mode 6 block.
+	void EncodeBC7Subset(const FBlock& block, uint32_t mask, EBlockCompressMode mode, uint32_t colorBits,
+		uint32_t channelCount, bool sharedPBit, const uint32_t* weights, uint32_t indexCount, bool simd,
+		FBC7Subset& subset)
+	{
+		float fractions[16];
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			fractions[i] = weights[i] / 64.0f;
+		}
+
+		float endpoint0[4];
+		float endpoint1[4];
+		FitLine(block, mask, channelCount, mode, simd, endpoint0, endpoint1);
+
+		const float* channelWeights = channelCount == 4 ? WeightsRGBA : WeightsRGB;
+		subset.mError = FLT_MAX;
+		uint32_t iterations = mode == EBlockCompressMode::Quality ? RefineIterations + 1 : 1;
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			FBC7Endpoint quantized0;
+			FBC7Endpoint quantized1;
+			uint32_t pBit0;
+			uint32_t pBit1;
+			QuantizeBC7Endpoints(endpoint0, endpoint1, colorBits, channelCount, sharedPBit, quantized0, quantized1, pBit0, pBit1);
+
+			float palette[16][4];
+			MakeBC7Palette(quantized0, quantized1, weights, indexCount, palette);
+			uint8_t indices[16];
+			float error = SelectIndices(block, mask, palette, indexCount, channelWeights, indices, simd);
+			if (error < subset.mError)
+			{
+				subset.mError = error;
+				subset.mEndpoints[0] = quantized0;
+				subset.mEndpoints[1] = quantized1;
+				subset.mPBits[0] = pBit0;
+				subset.mPBits[1] = pBit1;
+				memcpy(subset.mIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f || iteration + 1 == iterations ||
+				!RefineEndpoints(block, mask, indices, fractions, 0, channelCount, endpoint0, endpoint1))
+			{
+				break;
+			}
+		}
+	}
+
+	// Anchor texels store their index without its top bit, so it must be clear: otherwise
+	// swap the subset's endpoints, which mirrors every index.
+	void FixBC7Anchor(FBC7Subset& subset, uint32_t mask, uint32_t anchor, uint32_t indexCount)
+	{
+		if (subset.mIndices[anchor] < indexCount / 2)
+		{
+			return;
+		}
+		std::swap(subset.mEndpoints[0], subset.mEndpoints[1]);
+		std::swap(subset.mPBits[0], subset.mPBits[1]);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask & (1u << i))
+			{
+				subset.mIndices[i] = static_cast<uint8_t>(indexCount - 1 - subset.mIndices[i]);
+			}
+		}
+	}
+
+	float EncodeBC7Mode6(const FBlock& block, EBlockCompressMode mode, bool simd, uint8_t* out)
+	{
+		FBC7Subset subset;
+		EncodeBC7Subset(block, 0xffff, mode, 7, 4, false, BC7Weights4, 16, simd, subset);
+		FixBC7Anchor(subset, 0xffff, 0, 16);
+
+		CBitWriter writer(out);
+		writer.Write(1 << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			writer.Write(subset.mEndpoints[0].mValue[c], 7);
+			writer.Write(subset.mEndpoints[1].mValue[c], 7);
+		}
+		writer.Write(subset.mPBits[0], 1);
+		writer.Write(subset.mPBits[1], 1);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			writer.Write(subset.mIndices[i], i == 0 ? 3 : 4);
+		}
+		return subset.mError;
+	}
+
+	uint32_t CountBits(uint32_t value)
+	{
+		value = value - ((value >> 1) & 0x55555555);
+		value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+		return (((value + (value >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+	}
+
+	// The block's own two-way split: texels past the middle of its principal axis.
+	uint32_t GetPrincipalSplit(const FBlock& block, bool simd)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		FitLine(block, 0xffff, 3, EBlockCompressMode::Quality, simd, endpoint0, endpoint1);
+		float middle = 0.0f;
+		float axis[3];
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			axis[c] = endpoint1[c] - endpoint0[c];
+			middle += (endpoint0[c] + endpoint1[c]) * 0.5f * axis[c];
+		}
+
+		uint32_t split = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = block.mChannels[0][i] * axis[0] + block.mChannels[1][i] * axis[1] + block.mChannels[2][i] * axis[2];
+			split |= t > middle ? 1u << i : 0u;
+		}
+		return split;
+	}
+
+	// Mode 1: two subsets of RGB, 6-bit endpoints with a p-bit per subset, 3-bit indices.
+	// Only for opaque blocks, since it has no alpha.
+	float EncodeBC7Mode1(const FBlock& block, bool simd, uint8_t* out)
+	{
+		// Rather than fit all 64, rank the partitions by how many texels they put on the other
+		// side from the block's own split, and encode the closest few.
+		uint32_t split = GetPrincipalSplit(block, simd);
+		uint32_t candidates[Mode1Candidates];
+		uint32_t distances[Mode1Candidates];
+		uint32_t candidateCount = 0;
+		for (uint32_t partition = 0; partition < 64; ++partition)
+		{
+			uint32_t distance = CountBits(split ^ BC7Partitions2[partition]);
+			distance = std::min(distance, 16 - distance);
+
+			// Keep the closest few, in order.
+			uint32_t slot = candidateCount;
+			while (slot > 0 && distances[slot - 1] > distance)
+			{
+				--slot;
+			}
+			if (slot < Mode1Candidates)
+			{
+				uint32_t last = std::min(candidateCount, Mode1Candidates - 1);
+				for (uint32_t i = last; i > slot; --i)
+				{
+					candidates[i] = candidates[i - 1];
+					distances[i] = distances[i - 1];
+				}
+				candidates[slot] = partition;
+				distances[slot] = distance;
+				candidateCount = std::min(candidateCount + 1, Mode1Candidates);
+			}
+		}
+
+		float bestError = FLT_MAX;
+		uint32_t bestPartition = 0;
+		FBC7Subset bestSubsets[2];
+		for (uint32_t i = 0; i < candidateCount; ++i)
+		{
+			uint32_t masks[2] = { ~static_cast<uint32_t>(BC7Partitions2[candidates[i]]) & 0xffff, BC7Partitions2[candidates[i]] };
+			FBC7Subset subsets[2];
+			for (uint32_t s = 0; s < 2; ++s)
+			{
+				EncodeBC7Subset(block, masks[s], EBlockCompressMode::Quality, 6, 3, true, BC7Weights3, 8, simd, subsets[s]);
+			}
+			if (subsets[0].mError + subsets[1].mError < bestError)
+			{
+				bestError = subsets[0].mError + subsets[1].mError;
+				bestPartition = candidates[i];
+				bestSubsets[0] = subsets[0];
+				bestSubsets[1] = subsets[1];
+			}
+		}
+
+		uint32_t masks[2] = { ~static_cast<uint32_t>(BC7Partitions2[bestPartition]) & 0xffff, BC7Partitions2[bestPartition] };
+		uint32_t anchors[2] = { 0, BC7Anchors2[bestPartition] };
+		FixBC7Anchor(bestSubsets[0], masks[0], anchors[0], 8);
+		FixBC7Anchor(bestSubsets[1], masks[1], anchors[1], 8);
+
+		CBitWriter writer(out);
+		writer.Write(1 << 1, 2);
+		writer.Write(bestPartition, 6);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			for (uint32_t s = 0; s < 2; ++s)
+			{
+				writer.Write(bestSubsets[s].mEndpoints[0].mValue[c], 6);
+				writer.Write(bestSubsets[s].mEndpoints[1].mValue[c], 6);
+			}
+		}
+		writer.Write(bestSubsets[0].mPBits[0], 1);
+		writer.Write(bestSubsets[1].mPBits[0], 1);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t s = masks[1] & (1u << i) ? 1 : 0;
+			writer.Write(bestSubsets[s].mIndices[i], i == anchors[s] ? 2 : 3);
+		}
+		return bestError;
+	}
+
+	void EncodeBC7(const FBlock& block, EBlockCompressMode mode, bool simd, uint8_t* out)
+	{
+		float error = EncodeBC7Mode6(block, mode, simd, out);
+		if (mode == EBlockCompressMode::Quality && block.mOpaque && error > 0.0f)
+		{
+			uint8_t mode1[16];
+			if (EncodeBC7Mode1(block, simd, mode1) < error)
+			{
+				memcpy(out, mode1, sizeof(mode1));
+			}
+		}
+	}
+
+	void DecodeBC7(const uint8_t* block, uint8_t texels[16][4])
+	{
+		CBitReader reader(block);
+		uint32_t mode = 0;
+		while (mode < 8 && reader.Read(1) == 0)
+		{
+			++mode;
+		}
+
+		if (mode == 6)
+		{
+			FBC7Endpoint endpoints[2];
+			uint32_t values[4][2];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				values[c][0] = reader.Read(7);
+				values[c][1] = reader.Read(7);
+			}
+			uint32_t pBits[2] = { reader.Read(1), reader.Read(1) };
+			for (uint32_t e = 0; e < 2; ++e)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					endpoints[e].mExpanded[c] = ExpandBC7(values[c][e], pBits[e], 7);
+				}
+			}
+			float palette[16][4];
+			MakeBC7Palette(endpoints[0], endpoints[1], BC7Weights4, 16, palette);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t index = reader.Read(i == 0 ? 3 : 4);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+				}
+			}
+		}
+		else if (mode == 1)
+		{
+			uint32_t partition = reader.Read(6);
+			uint32_t values[3][4];
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				for (uint32_t e = 0; e < 4; ++e)
+				{
+					values[c][e] = reader.Read(6);
+				}
+			}
+			uint32_t pBits[2] = { reader.Read(1), reader.Read(1) };
+			float palettes[2][16][4];
+			for (uint32_t s = 0; s < 2; ++s)
+			{
+				FBC7Endpoint endpoints[2];
+				for (uint32_t e = 0; e < 2; ++e)
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						endpoints[e].mExpanded[c] = ExpandBC7(values[c][s * 2 + e], pBits[s], 6);
+					}
+					endpoints[e].mExpanded[3] = 255;
+				}
+				MakeBC7Palette(endpoints[0], endpoints[1], BC7Weights3, 8, palettes[s]);
+			}
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t s = BC7Partitions2[partition] & (1u << i) ? 1 : 0;
+				bool anchor = i == 0 || i == BC7Anchors2[partition];
+				uint32_t index = reader.Read(anchor ? 2 : 3);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					texels[i][c] = static_cast<uint8_t>(palettes[s][index][c]);
+				}
+			}
+		}
+		else
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				texels[i][0] = 255;
+				texels[i][1] = 0;
+				texels[i][2] = 255;
+				texels[i][3] = 255;
+			}
+		}
+	}
+
+	void DecodeBC1Color(const uint8_t* block, bool alwaysFourColor, uint8_t texels[16][4])
+	{
+		uint16_t color0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+		uint16_t color1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+		uint32_t palette[4][4];
+		MakeBC1Palette(color0, color1, alwaysFourColor, palette);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+			}
+		}
+	}
+
+	void DecodeBC3Alpha(const uint8_t* block, uint8_t texels[16][4])
+	{
+		float palette[8][4];
+		MakeAlphaPalette(block[0], block[1], palette);
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			texels[i][3] = static_cast<uint8_t>(palette[(bits >> (i * 3)) & 7][3]);
+		}
+	}
+
+	uint32_t GetCompressedBlockBytes(ERenderFormat format)
+	{
+		return IsBlockCompressible(format) ? GetFormatBlockBytes(format) : 0;
+	}
+
+	void CompressRows(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+		uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, uint32_t blockRowBegin,
+		uint32_t blockRowEnd, bool simd)
+	{
+		uint32_t blockBytes = GetCompressedBlockBytes(format);
+		uint32_t blocksPerRow = (width + 3) / 4;
+		for (uint32_t blockY = blockRowBegin; blockY < blockRowEnd; ++blockY)
+		{
+			uint8_t* out = dst + static_cast<size_t>(blockY) * dstRowPitch;
+			for (uint32_t blockX = 0; blockX < blocksPerRow; ++blockX, out += blockBytes)
+			{
+				FBlock block;
+				LoadBlock(src, width, height, srcRowPitch, blockX, blockY, simd, block);
+				switch (format)
+				{
+				case ERenderFormat::BC1Unorm:
+				case ERenderFormat::BC1UnormSrgb:
+					EncodeBC1Color(block, mode, block.mOpaqueMask != 0xffff, simd, out);
+					break;
+				case ERenderFormat::BC3Unorm:
+				case ERenderFormat::BC3UnormSrgb:
+					EncodeBC3Alpha(block, mode, simd, out);
+					EncodeBC1Color(block, mode, false, simd, out + 8);
+					break;
+				default:
+					EncodeBC7(block, mode, simd, out);
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool IsBlockCompressible(ERenderFormat format)
+{
+	switch (format)
+	{
+	case ERenderFormat::BC1Unorm:
+	case ERenderFormat::BC1UnormSrgb:
+	case ERenderFormat::BC3Unorm:
+	case ERenderFormat::BC3UnormSrgb:
+	case ERenderFormat::BC7Unorm:
+	case ERenderFormat::BC7UnormSrgb:  return true;
+	default:                           return false;
+	}
+}
+
+void CompressTextureRows(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, uint32_t blockRowBegin, uint32_t blockRowEnd)
+{
+	CompressRows(format, mode, src, width, height, srcRowPitch, dst, dstRowPitch, blockRowBegin, blockRowEnd, true);
+}
+
+void CompressTextureRowsScalar(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, uint32_t blockRowBegin, uint32_t blockRowEnd)
+{
+	CompressRows(format, mode, src, width, height, srcRowPitch, dst, dstRowPitch, blockRowBegin, blockRowEnd, false);
+}
+
+void CompressTexture(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, CJobSystem* jobs)
+{
+	if (!IsBlockCompressible(format) || width == 0 || height == 0)
+	{
+		throw std::invalid_argument("CompressTexture needs a non-empty texture and a BC1, BC3 or BC7 format.");
+	}
+
+	uint32_t blockRows = (height + 3) / 4;
+	uint32_t rowsPerChunk = std::max(ParallelBlocksPerChunk / ((width + 3) / 4), 1u);
+	if (!jobs || rowsPerChunk >= blockRows)
+	{
+		CompressTextureRows(format, mode, src, width, height, srcRowPitch, dst, dstRowPitch, 0, blockRows);
+		return;
+	}
+
+	jobs->ParallelFor(blockRows, rowsPerChunk,
+		[&](uint32_t begin, uint32_t end)
+		{
+			CompressTextureRows(format, mode, src, width, height, srcRowPitch, dst, dstRowPitch, begin, end);
+		});
+}
+
+void DecompressTexture(ERenderFormat format, const uint8_t* src, uint32_t srcRowPitch, uint32_t width,
+	uint32_t height, uint8_t* dst, uint32_t dstRowPitch)
+{
+	uint32_t blockBytes = GetCompressedBlockBytes(format);
+	if (blockBytes == 0)
+	{
+		throw std::invalid_argument("DecompressTexture needs a BC1, BC3 or BC7 format.");
+	}
+
+	for (uint32_t blockY = 0; blockY < (height + 3) / 4; ++blockY)
+	{
+		const uint8_t* block = src + static_cast<size_t>(blockY) * srcRowPitch;
+		for (uint32_t blockX = 0; blockX < (width + 3) / 4; ++blockX, block += blockBytes)
+		{
+			uint8_t texels[16][4];
+			switch (format)
+			{
+			case ERenderFormat::BC1Unorm:
+			case ERenderFormat::BC1UnormSrgb:
+				DecodeBC1Color(block, false, texels);
+				break;
+			case ERenderFormat::BC3Unorm:
+			case ERenderFormat::BC3UnormSrgb:
+				DecodeBC1Color(block + 8, true, texels);
+				DecodeBC3Alpha(block, texels);
+				break;
+			default:
+				DecodeBC7(block, texels);
+				break;
+			}
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t x = blockX * 4 + (i & 3);
+				uint32_t y = blockY * 4 + (i >> 2);
+				if (x < width && y < height)
+				{
+					memcpy(dst + static_cast<size_t>(y) * dstRowPitch + x * 4, texels[i], 4);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include "RenderDevice.h"
+
+class CJobSystem;
+
+enum class EBlockCompressMode : uint8_t
+{
+	// Endpoints from the block's bounding box; BC7 uses mode 6 only.
+	Fast,
+	// Endpoints along the principal axis, refined by least squares; BC3 alpha also tries its
+	// six-value mode, and BC7 tries mode 1's two-subset partitions on opaque blocks.
+	Quality,
+};
+
+// BC1Unorm, BC3Unorm, BC7Unorm and their sRGB variants, which share the encoding; the
+// compressor treats the texels as given and does not convert between colour spaces.
+bool IsBlockCompressible(ERenderFormat format);
+
+// Compresses block rows [blockRowBegin, blockRowEnd) of an RGBA8 image into dst, one row of
+// 4x4 blocks every dstRowPitch bytes. Blocks over the right or bottom edge repeat the last
+// column or row. Loading blocks, their colour moments and picking palette indices are SSE2
+// where available, with a scalar fallback; the two produce identical blocks.
+void CompressTextureRows(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, uint32_t blockRowBegin, uint32_t blockRowEnd);
+
+// The same block rows through the scalar kernels only; the reference the SIMD path is
+// checked against.
+void CompressTextureRowsScalar(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, uint32_t blockRowBegin, uint32_t blockRowEnd);
+
+// Compresses the whole image, with block rows spread over the job system's threads when jobs
+// is not null. Throws std::invalid_argument for a format IsBlockCompressible refuses or a zero
+// size. The result does not depend on the thread count.
+void CompressTexture(ERenderFormat format, EBlockCompressMode mode, const uint8_t* src, uint32_t width,
+	uint32_t height, uint32_t srcRowPitch, uint8_t* dst, uint32_t dstRowPitch, CJobSystem* jobs);
+
+// Decodes an image CompressTexture wrote back to RGBA8, e.g. to measure its error. BC7 blocks
+// in modes other than the 1 and 6 the compressor writes decode as opaque magenta.
+void DecompressTexture(ERenderFormat format, const uint8_t* src, uint32_t srcRowPitch, uint32_t width,
+	uint32_t height, uint8_t* dst, uint32_t dstRowPitch);
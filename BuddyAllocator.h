@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FBuddyAllocatorStats
+{
+	uint64_t mAllocations = 0;      // Live allocations.
+	uint64_t mRequestedBytes = 0;   // What the live allocations asked for...
+	uint64_t mAllocatedBytes = 0;   // ...and the blocks they got, rounded up to a power of two.
+	uint64_t mFreeBytes = 0;
+	uint64_t mLargestFreeBlock = 0;
+
+	// Share of the allocated bytes lost to rounding up.
+	double GetInternalFragmentation() const
+	{
+		return mAllocatedBytes == 0 ? 0.0 : 1.0 - static_cast<double>(mRequestedBytes) / mAllocatedBytes;
+	}
+
+	// Share of the free bytes that the largest possible allocation cannot use.
+	double GetExternalFragmentation() const
+	{
+		return mFreeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(mLargestFreeBlock) / mFreeBytes;
+	}
+};
+
+// Binary buddy allocator over a power-of-two range of offsets, e.g. an ID3D12Heap.
+//
+// Blocks are powers of two from the minimum block size up to the whole range, and every block
+// starts at a multiple of its size, so any power-of-two alignment up to the block size comes
+// for free: a 4 KB small-resource texture takes a 4 KB block, a buffer asking for 64 KB
+// alignment takes (at least) a 64 KB block. A freed block merges with its buddy as long as
+// that is free too.
+//
+// Bookkeeping lives in arrays indexed by minimum-sized block, with the free lists threaded
+// through them, so Allocate and Free are O(log capacity) and never allocate.
+class CBuddyAllocator
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+private:
+	static const uint8_t NotFree = 0xFF;
+	static const uint32_t NoBlock = ~0u;
+
+	uint64_t mCapacity = 0;
+	uint32_t mMinBlockShift = 0;
+	uint32_t mOrderCount = 0;
+	// Per minimum-sized block. mFreeOrder is the order of the free block starting there, or
+	// NotFree; mAllocatedOrder the order of the allocated block starting there, or NotFree.
+	std::vector<uint8_t> mFreeOrder;
+	std::vector<uint8_t> mAllocatedOrder;
+	std::vector<uint64_t> mRequested;
+	std::vector<uint32_t> mNext;
+	std::vector<uint32_t> mPrev;
+	std::vector<uint32_t> mFreeHead;   // Per order.
+	FBuddyAllocatorStats mStats;
+
+	static uint32_t Log2(uint64_t value)
+	{
+		uint32_t shift = 0;
+		while ((1ull << shift) < value)
+		{
+			++shift;
+		}
+		return shift;
+	}
+
+	void PushFree(uint32_t block, uint32_t order)
+	{
+		mFreeOrder[block] = static_cast<uint8_t>(order);
+		mPrev[block] = NoBlock;
+		mNext[block] = mFreeHead[order];
+		if (mFreeHead[order] != NoBlock)
+		{
+			mPrev[mFreeHead[order]] = block;
+		}
+		mFreeHead[order] = block;
+	}
+
+	void RemoveFree(uint32_t block)
+	{
+		uint32_t order = mFreeOrder[block];
+		if (mPrev[block] != NoBlock)
+		{
+			mNext[mPrev[block]] = mNext[block];
+		}
+		else
+		{
+			mFreeHead[order] = mNext[block];
+		}
+		if (mNext[block] != NoBlock)
+		{
+			mPrev[mNext[block]] = mPrev[block];
+		}
+		mFreeOrder[block] = NotFree;
+	}
+
+	void UpdateLargestFree()
+	{
+		mStats.mLargestFreeBlock = 0;
+		for (uint32_t order = mOrderCount; order-- > 0;)
+		{
+			if (mFreeHead[order] != NoBlock)
+			{
+				mStats.mLargestFreeBlock = GetBlockSize(order);
+				break;
+			}
+		}
+	}
+
+	uint64_t GetBlockSize(uint32_t order) const { return 1ull << (mMinBlockShift + order); }
+
+public:
+	// capacity and minBlockSize must be powers of two, capacity >= minBlockSize.
+	void Initialize(uint64_t capacity, uint64_t minBlockSize)
+	{
+		assert(minBlockSize != 0 && (minBlockSize & (minBlockSize - 1)) == 0);
+		assert(capacity >= minBlockSize && (capacity & (capacity - 1)) == 0);
+
+		mCapacity = capacity;
+		mMinBlockShift = Log2(minBlockSize);
+		mOrderCount = Log2(capacity) - mMinBlockShift + 1;
+
+		size_t blockCount = static_cast<size_t>(capacity >> mMinBlockShift);
+		// Casts pass copies of the constants, which are declared but not defined.
+		mFreeOrder.assign(blockCount, static_cast<uint8_t>(NotFree));
+		mAllocatedOrder.assign(blockCount, static_cast<uint8_t>(NotFree));
+		mRequested.assign(blockCount, 0);
+		mNext.assign(blockCount, static_cast<uint32_t>(NoBlock));
+		mPrev.assign(blockCount, static_cast<uint32_t>(NoBlock));
+		mFreeHead.assign(mOrderCount, static_cast<uint32_t>(NoBlock));
+
+		PushFree(0, mOrderCount - 1);
+		mStats = FBuddyAllocatorStats();
+		mStats.mFreeBytes = capacity;
+		mStats.mLargestFreeBlock = capacity;
+	}
+
+	// Returns InvalidOffset when no free block is large enough. alignment must be a power of
+	// two; 0 means the minimum block size.
+	uint64_t Allocate(uint64_t size, uint64_t alignment)
+	{
+		assert((alignment & (alignment - 1)) == 0);
+
+		uint64_t blockSize = size > alignment ? size : alignment;
+		if (blockSize == 0 || blockSize > mCapacity)
+		{
+			return InvalidOffset;
+		}
+		uint32_t shift = Log2(blockSize);
+		uint32_t order = shift > mMinBlockShift ? shift - mMinBlockShift : 0;
+
+		uint32_t foundOrder = order;
+		while (foundOrder < mOrderCount && mFreeHead[foundOrder] == NoBlock)
+		{
+			++foundOrder;
+		}
+		if (foundOrder == mOrderCount)
+		{
+			return InvalidOffset;
+		}
+
+		// Split down to the requested order; the upper halves go back on the free lists.
+		uint32_t block = mFreeHead[foundOrder];
+		RemoveFree(block);
+		while (foundOrder > order)
+		{
+			--foundOrder;
+			PushFree(block + (1u << foundOrder), foundOrder);
+		}
+
+		mAllocatedOrder[block] = static_cast<uint8_t>(order);
+		mRequested[block] = size;
+
+		++mStats.mAllocations;
+		mStats.mRequestedBytes += size;
+		mStats.mAllocatedBytes += GetBlockSize(order);
+		mStats.mFreeBytes -= GetBlockSize(order);
+		UpdateLargestFree();
+		return static_cast<uint64_t>(block) << mMinBlockShift;
+	}
+
+	void Free(uint64_t offset)
+	{
+		uint32_t block = static_cast<uint32_t>(offset >> mMinBlockShift);
+		assert(block < mAllocatedOrder.size() && mAllocatedOrder[block] != NotFree && "Freeing an unallocated offset.");
+
+		uint32_t order = mAllocatedOrder[block];
+		mAllocatedOrder[block] = NotFree;
+
+		--mStats.mAllocations;
+		mStats.mRequestedBytes -= mRequested[block];
+		mStats.mAllocatedBytes -= GetBlockSize(order);
+		mStats.mFreeBytes += GetBlockSize(order);
+
+		while (order + 1 < mOrderCount)
+		{
+			uint32_t buddy = block ^ (1u << order);
+			if (mFreeOrder[buddy] != order)
+			{
+				break;
+			}
+			RemoveFree(buddy);
+			block = block < buddy ? block : buddy;
+			++order;
+		}
+		PushFree(block, order);
+		UpdateLargestFree();
+	}
+
+	bool IsEmpty() const                          { return mStats.mAllocations == 0; }
+	uint64_t GetCapacity() const                  { return mCapacity; }
+	const FBuddyAllocatorStats& GetStats() const  { return mStats; }
+};
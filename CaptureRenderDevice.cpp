@@ -0,0 +1,639 @@
+#include "CaptureRenderDevice.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+struct CCaptureRenderDevice::FObject
+{
+	ECommandStreamObjectKind mKind = ECommandStreamObjectKind::UploadBuffer;
+	ERenderFormat mFormat = ERenderFormat::Unknown;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mMipLevels = 1;
+	uint64_t mSize = 0;
+	// Upload buffers, read back at EndCapture.
+	std::weak_ptr<IRenderResource> mBuffer;
+	// Pipelines.
+	std::vector<uint8_t> mVertexShader;
+	std::vector<uint8_t> mPixelShader;
+	std::vector<std::string> mSemantics;
+	std::vector<FRenderVertexElement> mVertexElements;
+};
+
+namespace
+{
+	class CCaptureResource : public IRenderResource
+	{
+	public:
+		IRenderResource* mInner;
+		// Null for swap chain back buffers, which the inner swap chain owns.
+		std::shared_ptr<IRenderResource> mOwned;
+		uint32_t mId;
+
+		CCaptureResource(IRenderResource* inner, std::shared_ptr<IRenderResource> owned, uint32_t id) :
+			mInner(inner),
+			mOwned(std::move(owned)),
+			mId(id)
+		{
+		}
+
+		virtual void* GetCPUAddress()     { return mInner->GetCPUAddress(); }
+		virtual uint64_t GetGPUAddress()  { return mInner->GetGPUAddress(); }
+	};
+
+	class CCapturePipeline : public IRenderPipeline
+	{
+	public:
+		std::unique_ptr<IRenderPipeline> mInner;
+		uint32_t mId;
+
+		CCapturePipeline(std::unique_ptr<IRenderPipeline> inner, uint32_t id) :
+			mInner(std::move(inner)),
+			mId(id)
+		{
+		}
+	};
+
+	IRenderResource* Unwrap(IRenderResource* resource)
+	{
+		return resource ? static_cast<CCaptureResource*>(resource)->mInner : nullptr;
+	}
+
+	IRenderPipeline* Unwrap(IRenderPipeline* pipeline)
+	{
+		return pipeline ? static_cast<CCapturePipeline*>(pipeline)->mInner.get() : nullptr;
+	}
+
+	uint32_t GetId(IRenderResource* resource)
+	{
+		return resource ? static_cast<CCaptureResource*>(resource)->mId : CommandStreamNoObject;
+	}
+
+	uint32_t GetId(IRenderPipeline* pipeline)
+	{
+		return pipeline ? static_cast<CCapturePipeline*>(pipeline)->mId : CommandStreamNoObject;
+	}
+
+	class CCaptureCommandList : public IRenderCommandList
+	{
+	public:
+		std::unique_ptr<IRenderCommandList> mInner;
+		CCaptureRenderDevice& mDevice;
+		CCommandStreamWriter mWriter;
+		// Whether the last Reset happened while capturing.
+		bool mCaptured;
+
+		CCaptureCommandList(std::unique_ptr<IRenderCommandList> inner, CCaptureRenderDevice& device) :
+			mInner(std::move(inner)),
+			mDevice(device),
+			mCaptured(false)
+		{
+		}
+
+		virtual ERenderQueueType GetType() const
+		{
+			return mInner->GetType();
+		}
+
+		virtual void Reset(IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+		{
+			mInner->Reset(allocator, Unwrap(pipeline));
+
+			mWriter.Clear();
+			mCaptured = mDevice.IsCapturing();
+			if (mCaptured)
+			{
+				FCommandStreamBeginList payload = { static_cast<uint32_t>(mInner->GetType()), GetId(pipeline) };
+				mWriter.Write(ECommandStreamOp::BeginList, payload);
+			}
+		}
+
+		virtual void Close()
+		{
+			mInner->Close();
+			if (mCaptured)
+			{
+				mWriter.Write(ECommandStreamOp::EndList);
+			}
+		}
+
+		virtual void Transition(IRenderResource* resource, ERenderResourceState before, ERenderResourceState after)
+		{
+			mInner->Transition(Unwrap(resource), before, after);
+			if (mCaptured)
+			{
+				FCommandStreamTransition payload =
+					{ GetId(resource), static_cast<uint16_t>(before), static_cast<uint16_t>(after) };
+				mWriter.Write(ECommandStreamOp::Transition, payload);
+			}
+		}
+
+		virtual void ClearRenderTarget(IRenderResource* target, const float color[4])
+		{
+			mInner->ClearRenderTarget(Unwrap(target), color);
+			if (mCaptured)
+			{
+				FCommandStreamClear payload = { GetId(target), { color[0], color[1], color[2], color[3] } };
+				mWriter.Write(ECommandStreamOp::ClearRenderTarget, payload);
+			}
+		}
+
+		virtual void SetPipeline(IRenderPipeline* pipeline)
+		{
+			mInner->SetPipeline(Unwrap(pipeline));
+			if (mCaptured)
+			{
+				FCommandStreamObjectRef payload = { GetId(pipeline) };
+				mWriter.Write(ECommandStreamOp::SetPipeline, payload);
+			}
+		}
+
+		virtual void SetViewport(const FRenderViewport& viewport)
+		{
+			mInner->SetViewport(viewport);
+			if (mCaptured)
+			{
+				FCommandStreamViewport payload = { viewport };
+				mWriter.Write(ECommandStreamOp::SetViewport, payload);
+			}
+		}
+
+		virtual void SetScissor(const FRenderRect& rect)
+		{
+			mInner->SetScissor(rect);
+			if (mCaptured)
+			{
+				FCommandStreamScissor payload = { rect };
+				mWriter.Write(ECommandStreamOp::SetScissor, payload);
+			}
+		}
+
+		virtual void SetRenderTarget(IRenderResource* target)
+		{
+			mInner->SetRenderTarget(Unwrap(target));
+			if (mCaptured)
+			{
+				FCommandStreamObjectRef payload = { GetId(target) };
+				mWriter.Write(ECommandStreamOp::SetRenderTarget, payload);
+			}
+		}
+
+		virtual void SetVertexBuffer(IRenderResource* buffer, uint32_t stride, uint32_t size)
+		{
+			mInner->SetVertexBuffer(Unwrap(buffer), stride, size);
+			if (mCaptured)
+			{
+				FCommandStreamVertexBuffer payload = { GetId(buffer), stride, size };
+				mWriter.Write(ECommandStreamOp::SetVertexBuffer, payload);
+			}
+		}
+
+		virtual void SetIndexBuffer(IRenderResource* buffer, ERenderFormat format, uint32_t size)
+		{
+			mInner->SetIndexBuffer(Unwrap(buffer), format, size);
+			if (mCaptured)
+			{
+				FCommandStreamIndexBuffer payload = { GetId(buffer), static_cast<uint32_t>(format), size };
+				mWriter.Write(ECommandStreamOp::SetIndexBuffer, payload);
+			}
+		}
+
+		virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex)
+		{
+			mInner->DrawIndexed(indexCount, instanceCount, firstIndex, baseVertex);
+			if (mCaptured)
+			{
+				FCommandStreamDrawIndexed payload = { indexCount, instanceCount, firstIndex, baseVertex };
+				mWriter.Write(ECommandStreamOp::DrawIndexed, payload);
+			}
+		}
+
+		virtual void Dispatch(uint32_t x, uint32_t y, uint32_t z)
+		{
+			mInner->Dispatch(x, y, z);
+			if (mCaptured)
+			{
+				FCommandStreamDispatch payload = { x, y, z };
+				mWriter.Write(ECommandStreamOp::Dispatch, payload);
+			}
+		}
+	};
+
+	class CCaptureQueue : public IRenderQueue
+	{
+	public:
+		std::unique_ptr<IRenderQueue> mInner;
+		CCaptureRenderDevice& mDevice;
+		std::vector<IRenderCommandList*> mInnerLists;
+
+		CCaptureQueue(std::unique_ptr<IRenderQueue> inner, CCaptureRenderDevice& device) :
+			mInner(std::move(inner)),
+			mDevice(device)
+		{
+		}
+
+		virtual ERenderQueueType GetType() const
+		{
+			return mInner->GetType();
+		}
+
+		virtual void Execute(IRenderCommandList* const* lists, uint32_t count)
+		{
+			mInnerLists.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				mInnerLists[i] = static_cast<CCaptureCommandList*>(lists[i])->mInner.get();
+			}
+			mInner->Execute(mInnerLists.data(), count);
+			mDevice.OnExecute(mInner->GetType(), lists, count);
+		}
+
+		virtual void Signal(IRenderFence* fence, uint64_t value)
+		{
+			mInner->Signal(fence, value);
+		}
+
+		virtual void Wait(IRenderFence* fence, uint64_t value)
+		{
+			mInner->Wait(fence, value);
+		}
+	};
+
+	IRenderQueue* Unwrap(IRenderQueue* queue)
+	{
+		return queue ? static_cast<CCaptureQueue*>(queue)->mInner.get() : nullptr;
+	}
+
+	class CCaptureSwapChain : public IRenderSwapChain
+	{
+	public:
+		std::unique_ptr<IRenderSwapChain> mInner;
+		CCaptureRenderDevice& mDevice;
+		std::vector<std::unique_ptr<CCaptureResource>> mBackBuffers;
+
+		CCaptureSwapChain(std::unique_ptr<IRenderSwapChain> inner, CCaptureRenderDevice& device) :
+			mInner(std::move(inner)),
+			mDevice(device)
+		{
+		}
+
+		virtual uint32_t GetBufferCount() const                    { return mInner->GetBufferCount(); }
+		virtual uint32_t GetCurrentBackBufferIndex()               { return mInner->GetCurrentBackBufferIndex(); }
+		virtual IRenderResource* GetBackBuffer(uint32_t index)     { return mBackBuffers[index].get(); }
+		virtual void WaitForNextFrame()                            { mInner->WaitForNextFrame(); }
+
+		virtual void Present(uint32_t syncInterval)
+		{
+			mInner->Present(syncInterval);
+			mDevice.OnPresent(syncInterval);
+		}
+
+		virtual bool IsTearingSupported() const                    { return mInner->IsTearingSupported(); }
+		virtual bool GetPresentStats(FRenderPresentStats& stats)   { return mInner->GetPresentStats(stats); }
+	};
+
+	class CCaptureUploadQueue : public IRenderUploadQueue
+	{
+	public:
+		std::unique_ptr<IRenderUploadQueue> mInner;
+		std::vector<IRenderResource*> mInnerResources;
+
+		explicit CCaptureUploadQueue(std::unique_ptr<IRenderUploadQueue> inner) :
+			mInner(std::move(inner))
+		{
+		}
+
+		virtual void UploadSubresources(IRenderResource* dest, uint32_t firstSubresource, uint32_t numSubresources,
+			const FRenderSubresourceData* data)
+		{
+			mInner->UploadSubresources(Unwrap(dest), firstSubresource, numSubresources, data);
+		}
+
+		virtual uint64_t Submit()
+		{
+			return mInner->Submit();
+		}
+
+		virtual void WaitOnQueue(IRenderQueue* consumer, IRenderResource* const* resources, uint32_t count)
+		{
+			mInnerResources.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				mInnerResources[i] = Unwrap(resources[i]);
+			}
+			mInner->WaitOnQueue(Unwrap(consumer), mInnerResources.data(), count);
+		}
+
+		virtual void Retire()                       { mInner->Retire(); }
+		virtual IRenderFence* GetFence()            { return mInner->GetFence(); }
+		virtual uint64_t GetLastSignaledValue()     { return mInner->GetLastSignaledValue(); }
+	};
+
+	// Appends to the blob at an 8-byte boundary and returns the offset.
+	uint64_t AppendBlob(std::vector<uint8_t>& blob, const void* data, size_t size)
+	{
+		blob.resize((blob.size() + 7) & ~static_cast<size_t>(7));
+		uint64_t offset = blob.size();
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		blob.insert(blob.end(), bytes, bytes + size);
+		return offset;
+	}
+}
+
+CCaptureRenderDevice::CCaptureRenderDevice(IRenderDevice& inner) :
+	mInner(inner),
+	mCapturing(false),
+	mFrameCount(0),
+	mListCount(0),
+	mCommandCount(0),
+	mMaxListsPerExecute(0)
+{
+}
+
+CCaptureRenderDevice::~CCaptureRenderDevice()
+{
+}
+
+void CCaptureRenderDevice::BeginCapture()
+{
+	assert(!IsCapturing());
+
+	mFrames.Clear();
+	mFrameCount = 0;
+	mListCount = 0;
+	mCommandCount = 0;
+	mMaxListsPerExecute = 0;
+	mCapturing.store(true, std::memory_order_relaxed);
+}
+
+std::vector<uint8_t> CCaptureRenderDevice::EndCapture()
+{
+	assert(IsCapturing());
+	mCapturing.store(false, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(mObjectMutex);
+
+	std::vector<FCommandStreamObject> objects(mObjects.size());
+	std::vector<uint8_t> blob;
+	for (size_t i = 0; i < mObjects.size(); ++i)
+	{
+		const FObject& source = *mObjects[i];
+		FCommandStreamObject& object = objects[i];
+		memset(&object, 0, sizeof(object));
+		object.mKind = source.mKind;
+		object.mFormat = source.mFormat;
+		object.mWidth = source.mWidth;
+		object.mHeight = source.mHeight;
+		object.mMipLevels = source.mMipLevels;
+		object.mSize = source.mSize;
+
+		if (source.mKind == ECommandStreamObjectKind::UploadBuffer)
+		{
+			// Released buffers are replayed with zeroed contents.
+			std::shared_ptr<IRenderResource> buffer = source.mBuffer.lock();
+			if (buffer)
+			{
+				object.mDataOffset = AppendBlob(blob, buffer->GetCPUAddress(), static_cast<size_t>(source.mSize));
+				object.mDataSize = source.mSize;
+			}
+		}
+		else if (source.mKind == ECommandStreamObjectKind::Pipeline)
+		{
+			object.mDataOffset = AppendBlob(blob, source.mVertexShader.data(), source.mVertexShader.size());
+			object.mDataSize = source.mVertexShader.size();
+			object.mPixelShaderOffset = AppendBlob(blob, source.mPixelShader.data(), source.mPixelShader.size());
+			object.mPixelShaderSize = source.mPixelShader.size();
+
+			std::vector<FCommandStreamVertexElement> elements(source.mVertexElements.size());
+			for (size_t e = 0; e < elements.size(); ++e)
+			{
+				const std::string& semantic = source.mSemantics[e];
+				memset(&elements[e], 0, sizeof(elements[e]));
+				elements[e].mSemanticOffset = static_cast<uint32_t>(AppendBlob(blob, semantic.c_str(), semantic.size() + 1));
+				elements[e].mOffset = source.mVertexElements[e].mOffset;
+				elements[e].mFormat = source.mVertexElements[e].mFormat;
+			}
+			object.mVertexElementCount = static_cast<uint16_t>(elements.size());
+			object.mVertexElementOffset = AppendBlob(blob, elements.data(), elements.size() * sizeof(elements[0]));
+		}
+	}
+	blob.resize((blob.size() + 7) & ~static_cast<size_t>(7));
+
+	FCommandStreamHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mMagic = CommandStreamMagic;
+	header.mVersion = CommandStreamVersion;
+	header.mHeaderSize = sizeof(header);
+	header.mObjectCount = static_cast<uint32_t>(objects.size());
+	header.mFrameCount = mFrameCount;
+	header.mListCount = mListCount;
+	header.mCommandCount = mCommandCount;
+	header.mMaxListsPerExecute = mMaxListsPerExecute;
+	header.mObjectOffset = sizeof(header);
+	header.mBlobOffset = header.mObjectOffset + objects.size() * sizeof(FCommandStreamObject);
+	header.mBlobSize = blob.size();
+	header.mCommandOffset = header.mBlobOffset + blob.size();
+	header.mCommandSize = mFrames.GetBytes().size();
+
+	std::vector<uint8_t> stream(static_cast<size_t>(header.mCommandOffset + header.mCommandSize));
+	memcpy(stream.data(), &header, sizeof(header));
+	if (!objects.empty())
+	{
+		memcpy(stream.data() + header.mObjectOffset, objects.data(), objects.size() * sizeof(FCommandStreamObject));
+	}
+	if (!blob.empty())
+	{
+		memcpy(stream.data() + header.mBlobOffset, blob.data(), blob.size());
+	}
+	if (!mFrames.GetBytes().empty())
+	{
+		memcpy(stream.data() + header.mCommandOffset, mFrames.GetBytes().data(), mFrames.GetBytes().size());
+	}
+	return stream;
+}
+
+uint32_t CCaptureRenderDevice::AddObject(std::unique_ptr<FObject> object)
+{
+	std::lock_guard<std::mutex> lock(mObjectMutex);
+	mObjects.push_back(std::move(object));
+	return static_cast<uint32_t>(mObjects.size() - 1);
+}
+
+void CCaptureRenderDevice::OnExecute(ERenderQueueType queue, IRenderCommandList* const* lists, uint32_t count)
+{
+	if (!IsCapturing())
+	{
+		return;
+	}
+
+	// Lists reset before the capture began are left out.
+	uint32_t captured = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		captured += static_cast<CCaptureCommandList*>(lists[i])->mCaptured ? 1 : 0;
+	}
+	if (captured == 0)
+	{
+		return;
+	}
+
+	FCommandStreamExecute execute = { static_cast<uint32_t>(queue), captured };
+	mFrames.Write(ECommandStreamOp::Execute, execute);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const CCaptureCommandList* list = static_cast<CCaptureCommandList*>(lists[i]);
+		if (list->mCaptured)
+		{
+			mFrames.Append(list->mWriter);
+			// Less the BeginList and EndList markers.
+			mCommandCount += list->mWriter.GetCommandCount() - 2;
+		}
+	}
+	mListCount += captured;
+	mMaxListsPerExecute = std::max(mMaxListsPerExecute, captured);
+}
+
+void CCaptureRenderDevice::OnPresent(uint32_t syncInterval)
+{
+	if (!IsCapturing())
+	{
+		return;
+	}
+
+	FCommandStreamPresent present = { syncInterval };
+	mFrames.Write(ECommandStreamOp::Present, present);
+	++mFrameCount;
+}
+
+std::unique_ptr<IRenderQueue> CCaptureRenderDevice::CreateQueue(ERenderQueueType type)
+{
+	return std::unique_ptr<IRenderQueue>(new CCaptureQueue(mInner.CreateQueue(type), *this));
+}
+
+std::unique_ptr<IRenderFence> CCaptureRenderDevice::CreateFence()
+{
+	return mInner.CreateFence();
+}
+
+void CCaptureRenderDevice::WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count)
+{
+	mInner.WaitForFences(fences, values, count);
+}
+
+std::shared_ptr<IRenderCommandAllocator> CCaptureRenderDevice::CreateCommandAllocator(ERenderQueueType type)
+{
+	return mInner.CreateCommandAllocator(type);
+}
+
+std::unique_ptr<IRenderCommandList> CCaptureRenderDevice::CreateCommandList(ERenderQueueType type,
+	IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+{
+	// Created closed, so the first capture decision is made at the first Reset.
+	return std::unique_ptr<IRenderCommandList>(
+		new CCaptureCommandList(mInner.CreateCommandList(type, allocator, Unwrap(pipeline)), *this));
+}
+
+std::shared_ptr<IRenderResource> CCaptureRenderDevice::CreateUploadBuffer(uint64_t size)
+{
+	std::shared_ptr<IRenderResource> inner = mInner.CreateUploadBuffer(size);
+
+	std::unique_ptr<FObject> object(new FObject());
+	object->mKind = ECommandStreamObjectKind::UploadBuffer;
+	object->mSize = size;
+	object->mBuffer = inner;
+
+	IRenderResource* innerResource = inner.get();
+	return std::make_shared<CCaptureResource>(innerResource, std::move(inner), AddObject(std::move(object)));
+}
+
+std::shared_ptr<IRenderResource> CCaptureRenderDevice::CreateBuffer(uint64_t size)
+{
+	std::shared_ptr<IRenderResource> inner = mInner.CreateBuffer(size);
+
+	// Contents arrive through the upload queue and are not captured, as for textures.
+	std::unique_ptr<FObject> object(new FObject());
+	object->mKind = ECommandStreamObjectKind::Buffer;
+	object->mSize = size;
+
+	IRenderResource* innerResource = inner.get();
+	return std::make_shared<CCaptureResource>(innerResource, std::move(inner), AddObject(std::move(object)));
+}
+
+std::shared_ptr<IRenderResource> CCaptureRenderDevice::CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format)
+{
+	std::shared_ptr<IRenderResource> inner = mInner.CreateTexture2D(width, height, mipLevels, format);
+
+	std::unique_ptr<FObject> object(new FObject());
+	object->mKind = ECommandStreamObjectKind::Texture2D;
+	object->mFormat = format;
+	object->mWidth = width;
+	object->mHeight = height;
+	object->mMipLevels = mipLevels;
+
+	IRenderResource* innerResource = inner.get();
+	return std::make_shared<CCaptureResource>(innerResource, std::move(inner), AddObject(std::move(object)));
+}
+
+std::shared_ptr<IRenderResource> CCaptureRenderDevice::CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format)
+{
+	std::shared_ptr<IRenderResource> inner = mInner.CreateRenderTarget2D(width, height, format);
+
+	std::unique_ptr<FObject> object(new FObject());
+	object->mKind = ECommandStreamObjectKind::RenderTarget2D;
+	object->mFormat = format;
+	object->mWidth = width;
+	object->mHeight = height;
+
+	IRenderResource* innerResource = inner.get();
+	return std::make_shared<CCaptureResource>(innerResource, std::move(inner), AddObject(std::move(object)));
+}
+
+std::vector<uint8_t> CCaptureRenderDevice::CompileShader(const std::wstring& path, const char* target)
+{
+	return mInner.CompileShader(path, target);
+}
+
+std::unique_ptr<IRenderPipeline> CCaptureRenderDevice::CreatePipeline(const FRenderPipelineDesc& desc)
+{
+	std::unique_ptr<IRenderPipeline> inner = mInner.CreatePipeline(desc);
+
+	std::unique_ptr<FObject> object(new FObject());
+	object->mKind = ECommandStreamObjectKind::Pipeline;
+	object->mFormat = desc.mRenderTargetFormat;
+	object->mVertexShader = *desc.mVertexShader;
+	object->mPixelShader = *desc.mPixelShader;
+	object->mVertexElements.assign(desc.mVertexElements, desc.mVertexElements + desc.mVertexElementCount);
+	for (const FRenderVertexElement& element : object->mVertexElements)
+	{
+		object->mSemantics.push_back(element.mSemantic);
+	}
+
+	return std::unique_ptr<IRenderPipeline>(new CCapturePipeline(std::move(inner), AddObject(std::move(object))));
+}
+
+std::unique_ptr<IRenderSwapChain> CCaptureRenderDevice::CreateSwapChain(IRenderQueue* presentQueue, void* window,
+	uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency)
+{
+	std::unique_ptr<CCaptureSwapChain> swapChain(new CCaptureSwapChain(
+		mInner.CreateSwapChain(Unwrap(presentQueue), window, width, height, bufferCount, lowLatency), *this));
+
+	// Back buffers replay as render targets of the same size.
+	for (uint32_t i = 0; i < swapChain->mInner->GetBufferCount(); ++i)
+	{
+		std::unique_ptr<FObject> object(new FObject());
+		object->mKind = ECommandStreamObjectKind::RenderTarget2D;
+		object->mFormat = ERenderFormat::RGBA8Unorm;
+		object->mWidth = width;
+		object->mHeight = height;
+
+		swapChain->mBackBuffers.emplace_back(new CCaptureResource(swapChain->mInner->GetBackBuffer(i), nullptr,
+			AddObject(std::move(object))));
+	}
+	return std::unique_ptr<IRenderSwapChain>(swapChain.release());
+}
+
+std::unique_ptr<IRenderUploadQueue> CCaptureRenderDevice::CreateUploadQueue(CJobSystem* copyJobs)
+{
+	return std::unique_ptr<IRenderUploadQueue>(new CCaptureUploadQueue(mInner.CreateUploadQueue(copyJobs)));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "CommandStream.h"
+
+// Render device that forwards to another one and, between BeginCapture and EndCapture,
+// records what the frame submits into a command stream (see CommandStream.h).
+//
+// Every object is wrapped so it has an id in the stream; fences and allocators pass through.
+// A list is captured when it is Reset while capturing, into a writer of its own, so recording
+// threads never contend. Its commands join the stream in Execute order, and each Present ends
+// a frame. Upload buffer contents are snapshotted at EndCapture; texture contents and
+// queue-to-queue waits are not captured.
+//
+// When not capturing the wrappers only unwrap and forward.
+class CCaptureRenderDevice : public IRenderDevice
+{
+public:
+	struct FObject;
+
+private:
+	IRenderDevice& mInner;
+	std::atomic<bool> mCapturing;
+
+	// Creation records of every object, indexed by id.
+	std::mutex mObjectMutex;
+	std::vector<std::unique_ptr<FObject>> mObjects;
+
+	// Execute and Present come from one thread at a time, like the queues they record.
+	CCommandStreamWriter mFrames;
+	uint32_t mFrameCount;
+	uint32_t mListCount;
+	uint32_t mCommandCount;
+	uint32_t mMaxListsPerExecute;
+
+public:
+	explicit CCaptureRenderDevice(IRenderDevice& inner);
+	virtual ~CCaptureRenderDevice();
+
+	// Captures lists reset from now on; call between frames.
+	void BeginCapture();
+	// Stops capturing and returns the stream, ready to be written to a file.
+	std::vector<uint8_t> EndCapture();
+	bool IsCapturing() const { return mCapturing.load(std::memory_order_relaxed); }
+
+	// Called by the wrappers.
+	uint32_t AddObject(std::unique_ptr<FObject> object);
+	void OnExecute(ERenderQueueType queue, IRenderCommandList* const* lists, uint32_t count);
+	void OnPresent(uint32_t syncInterval);
+
+	virtual std::unique_ptr<IRenderQueue> CreateQueue(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderFence> CreateFence();
+	virtual void WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count);
+
+	virtual std::shared_ptr<IRenderCommandAllocator> CreateCommandAllocator(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderCommandList> CreateCommandList(ERenderQueueType type,
+		IRenderCommandAllocator* allocator, IRenderPipeline* pipeline);
+
+	virtual std::shared_ptr<IRenderResource> CreateUploadBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format);
+	virtual std::shared_ptr<IRenderResource> CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format);
+
+	virtual std::vector<uint8_t> CompileShader(const std::wstring& path, const char* target);
+	virtual std::unique_ptr<IRenderPipeline> CreatePipeline(const FRenderPipelineDesc& desc);
+
+	virtual std::unique_ptr<IRenderSwapChain> CreateSwapChain(IRenderQueue* presentQueue, void* window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency);
+
+	virtual std::unique_ptr<IRenderUploadQueue> CreateUploadQueue(CJobSystem* copyJobs);
+};
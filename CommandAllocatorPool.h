@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FCommandAllocatorPoolStats
+{
+	uint64_t mCreated = 0;
+	uint64_t mReused = 0;
+	uint64_t mTrimmed = 0;             // Destroyed for being oversized or surplus.
+	uint32_t mLive = 0;                // In use or waiting to retire.
+	uint64_t mHighWater = 0;           // Most commands recorded into any allocator between resets.
+	uint64_t mRetainedHighWater = 0;   // Sum of the high waters of allocators sitting in the pool.
+};
+
+// Pool of command allocators per command list type, recycled by fence completion.
+//
+// Acquire hands out an allocator whose last use has retired (resetting it), creating one only
+// when none is free. Release returns it with the fence value of its last submission and the
+// number of commands recorded into it, which D3D12 allocator memory grows with and never gives
+// back on Reset. So one whose high water exceeds the trim threshold is destroyed instead of
+// reused, and retired allocators beyond MaxIdle per type are dropped; memory stays bounded
+// after a burst.
+//
+// TBackend creates and resets allocators:
+//     typedef ... Allocator;
+//     typedef ... ListType;
+//     Allocator Create(ListType type);
+//     void Reset(Allocator& allocator);
+// TTimeline tells whether a fence value has completed (e.g. CFenceTimeline):
+//     bool IsComplete(uint64_t value);
+// Allocators of one type may retire on different timelines.
+template<typename TBackend, typename TTimeline>
+class CCommandAllocatorPool
+{
+public:
+	typedef typename TBackend::Allocator Allocator;
+	typedef typename TBackend::ListType ListType;
+
+	struct FHandle
+	{
+		Allocator mAllocator;
+		ListType mType;
+		uint64_t mHighWater;
+		bool mValid;
+
+		FHandle() : mType(), mHighWater(0), mValid(false) {}
+	};
+
+private:
+	struct FEntry
+	{
+		Allocator mAllocator;
+		TTimeline* mTimeline;
+		uint64_t mFenceValue;
+		uint64_t mHighWater;
+	};
+
+	struct FTypePool
+	{
+		ListType mType;
+		std::vector<FEntry> mEntries;   // Released, in release order.
+	};
+
+	TBackend mBackend;
+	std::vector<FTypePool> mPools;
+	uint64_t mTrimThreshold;
+	uint32_t mMaxIdle;
+	FCommandAllocatorPoolStats mStats;
+
+	FTypePool& GetPool(ListType type)
+	{
+		for (FTypePool& pool : mPools)
+		{
+			if (pool.mType == type)
+			{
+				return pool;
+			}
+		}
+
+		mPools.push_back(FTypePool());
+		mPools.back().mType = type;
+		return mPools.back();
+	}
+
+	void Destroy(FTypePool& pool, size_t index)
+	{
+		assert(mStats.mLive > 0);
+		--mStats.mLive;
+		mStats.mRetainedHighWater -= pool.mEntries[index].mHighWater;
+		++mStats.mTrimmed;
+		pool.mEntries.erase(pool.mEntries.begin() + index);
+	}
+
+	void TrimPool(FTypePool& pool)
+	{
+		uint32_t idle = 0;
+		for (size_t i = pool.mEntries.size(); i-- > 0;)
+		{
+			FEntry& entry = pool.mEntries[i];
+			if (!entry.mTimeline->IsComplete(entry.mFenceValue))
+			{
+				continue;
+			}
+
+			if (entry.mHighWater > mTrimThreshold || ++idle > mMaxIdle)
+			{
+				Destroy(pool, i);
+			}
+		}
+	}
+
+public:
+	static const uint32_t DefaultMaxIdle = 4;
+	// In recorded commands; a few MB of allocator memory.
+	static const uint64_t DefaultTrimThreshold = 64 * 1024;
+
+	explicit CCommandAllocatorPool(uint64_t trimThreshold = DefaultTrimThreshold, uint32_t maxIdle = DefaultMaxIdle) :
+		mTrimThreshold(trimThreshold),
+		mMaxIdle(maxIdle)
+	{
+	}
+
+	CCommandAllocatorPool(const CCommandAllocatorPool&) = delete;
+	CCommandAllocatorPool& operator=(const CCommandAllocatorPool&) = delete;
+
+	TBackend& GetBackend() { return mBackend; }
+
+	// Returns a reset allocator that no queue is using any more.
+	FHandle Acquire(ListType type)
+	{
+		FTypePool& pool = GetPool(type);
+
+		FHandle handle;
+		handle.mType = type;
+		handle.mValid = true;
+
+		// Oldest first: the earliest released is the most likely to have retired.
+		for (size_t i = 0; i < pool.mEntries.size(); ++i)
+		{
+			FEntry& entry = pool.mEntries[i];
+			if (!entry.mTimeline->IsComplete(entry.mFenceValue))
+			{
+				continue;
+			}
+
+			if (entry.mHighWater > mTrimThreshold)
+			{
+				Destroy(pool, i--);
+				continue;
+			}
+
+			handle.mAllocator = entry.mAllocator;
+			handle.mHighWater = entry.mHighWater;
+			mStats.mRetainedHighWater -= entry.mHighWater;
+			pool.mEntries.erase(pool.mEntries.begin() + i);
+
+			mBackend.Reset(handle.mAllocator);
+			++mStats.mReused;
+			return handle;
+		}
+
+		handle.mAllocator = mBackend.Create(type);
+		++mStats.mCreated;
+		++mStats.mLive;
+		return handle;
+	}
+
+	// fenceValue on timeline completes once the GPU is done with everything recorded into the
+	// allocator. commandCount is how many commands were recorded into it since Acquire.
+	void Release(FHandle& handle, TTimeline& timeline, uint64_t fenceValue, uint64_t commandCount)
+	{
+		assert(handle.mValid);
+
+		FEntry entry;
+		entry.mAllocator = handle.mAllocator;
+		entry.mTimeline = &timeline;
+		entry.mFenceValue = fenceValue;
+		entry.mHighWater = std::max(handle.mHighWater, commandCount);
+
+		mStats.mHighWater = std::max(mStats.mHighWater, entry.mHighWater);
+		mStats.mRetainedHighWater += entry.mHighWater;
+
+		GetPool(handle.mType).mEntries.push_back(entry);
+		handle = FHandle();
+	}
+
+	// Drops oversized and surplus retired allocators; call once per frame.
+	void Trim()
+	{
+		for (FTypePool& pool : mPools)
+		{
+			TrimPool(pool);
+		}
+	}
+
+	// For teardown, once every timeline is idle.
+	void Clear()
+	{
+		for (FTypePool& pool : mPools)
+		{
+			mStats.mLive -= static_cast<uint32_t>(pool.mEntries.size());
+			pool.mEntries.clear();
+		}
+		mStats.mRetainedHighWater = 0;
+	}
+
+	const FCommandAllocatorPoolStats& GetStats() const { return mStats; }
+};
+
+template<typename TBackend, typename TTimeline>
+const uint32_t CCommandAllocatorPool<TBackend, TTimeline>::DefaultMaxIdle;
+template<typename TBackend, typename TTimeline>
+const uint64_t CCommandAllocatorPool<TBackend, TTimeline>::DefaultTrimThreshold;
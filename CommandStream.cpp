@@ -0,0 +1,606 @@
+#include "CommandStream.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "RenderFence.h"
+#include "RenderCommandAllocatorPool.h"
+
+namespace
+{
+	const uint32_t QueueCount = 3;
+
+	template<typename TPayload>
+	TPayload ReadPayload(const uint8_t* command)
+	{
+		TPayload payload;
+		memcpy(&payload, command + sizeof(FCommandStreamCommand), sizeof(payload));
+		return payload;
+	}
+
+	FCommandStreamCommand ReadCommand(const uint8_t* command)
+	{
+		FCommandStreamCommand header;
+		memcpy(&header, command, sizeof(header));
+		return header;
+	}
+
+	// Payload size per op, indexed by ECommandStreamOp.
+	const uint16_t PayloadSizes[] =
+	{
+		sizeof(FCommandStreamExecute),
+		sizeof(FCommandStreamBeginList),
+		0,
+		sizeof(FCommandStreamPresent),
+		sizeof(FCommandStreamTransition),
+		sizeof(FCommandStreamClear),
+		sizeof(FCommandStreamObjectRef),
+		sizeof(FCommandStreamViewport),
+		sizeof(FCommandStreamScissor),
+		sizeof(FCommandStreamObjectRef),
+		sizeof(FCommandStreamVertexBuffer),
+		sizeof(FCommandStreamIndexBuffer),
+		sizeof(FCommandStreamDrawIndexed),
+		sizeof(FCommandStreamDispatch),
+	};
+	static_assert(sizeof(PayloadSizes) / sizeof(PayloadSizes[0]) == static_cast<size_t>(ECommandStreamOp::Count),
+		"One payload size per op.");
+
+	void Check(bool condition, const char* message)
+	{
+		if (!condition)
+		{
+			throw std::runtime_error(std::string("Malformed command stream: ") + message);
+		}
+	}
+
+	bool IsResource(const FCommandStreamObject& object)
+	{
+		return object.mKind != ECommandStreamObjectKind::Pipeline;
+	}
+
+	bool IsValidFormat(uint32_t format)
+	{
+		return format <= static_cast<uint32_t>(ERenderFormat::BC7UnormSrgb);
+	}
+
+	bool IsValidState(uint32_t state)
+	{
+		return state <= static_cast<uint32_t>(ERenderResourceState::GenericRead);
+	}
+
+	class CNullCommandStreamList : public IRenderCommandList
+	{
+	public:
+		virtual ERenderQueueType GetType() const { return ERenderQueueType::Direct; }
+		virtual void Reset(IRenderCommandAllocator*, IRenderPipeline*) {}
+		virtual void Close() {}
+		virtual void Transition(IRenderResource*, ERenderResourceState, ERenderResourceState) {}
+		virtual void ClearRenderTarget(IRenderResource*, const float*) {}
+		virtual void SetPipeline(IRenderPipeline*) {}
+		virtual void SetViewport(const FRenderViewport&) {}
+		virtual void SetScissor(const FRenderRect&) {}
+		virtual void SetRenderTarget(IRenderResource*) {}
+		virtual void SetVertexBuffer(IRenderResource*, uint32_t, uint32_t) {}
+		virtual void SetIndexBuffer(IRenderResource*, ERenderFormat, uint32_t) {}
+		virtual void DrawIndexed(uint32_t, uint32_t, uint32_t, int32_t) {}
+		virtual void Dispatch(uint32_t, uint32_t, uint32_t) {}
+	};
+}
+
+CCommandStreamReader::CCommandStreamReader(const void* data, size_t size) :
+	mData(static_cast<const uint8_t*>(data)),
+	mSize(size),
+	mHeader(nullptr)
+{
+	Validate();
+}
+
+const FCommandStreamObject& CCommandStreamReader::GetObjectDesc(uint32_t id) const
+{
+	assert(id < mHeader->mObjectCount);
+	return reinterpret_cast<const FCommandStreamObject*>(mData + mHeader->mObjectOffset)[id];
+}
+
+void CCommandStreamReader::Validate()
+{
+	Check(mSize >= sizeof(FCommandStreamHeader) && reinterpret_cast<uintptr_t>(mData) % 8 == 0,
+		"too small or misaligned");
+	mHeader = reinterpret_cast<const FCommandStreamHeader*>(mData);
+	Check(mHeader->mMagic == CommandStreamMagic, "bad magic");
+	Check(mHeader->mVersion == CommandStreamVersion, "unsupported version");
+	Check(mHeader->mHeaderSize == sizeof(FCommandStreamHeader), "bad header size");
+
+	const FCommandStreamHeader& header = *mHeader;
+	Check(header.mObjectOffset % 8 == 0 && header.mBlobOffset % 8 == 0 && header.mCommandOffset % 8 == 0,
+		"misaligned section");
+	Check(header.mObjectOffset <= mSize &&
+		header.mObjectCount <= (mSize - header.mObjectOffset) / sizeof(FCommandStreamObject), "object table out of range");
+	Check(header.mBlobOffset <= mSize && header.mBlobSize <= mSize - header.mBlobOffset, "blob out of range");
+	Check(header.mCommandOffset <= mSize && header.mCommandSize <= mSize - header.mCommandOffset, "commands out of range");
+
+	auto blobRange = [&](uint64_t offset, uint64_t size)
+	{
+		return offset <= header.mBlobSize && size <= header.mBlobSize - offset;
+	};
+
+	for (uint32_t i = 0; i < header.mObjectCount; ++i)
+	{
+		const FCommandStreamObject& object = GetObjectDesc(i);
+		Check(object.mKind <= ECommandStreamObjectKind::Buffer, "unknown object kind");
+		Check(IsValidFormat(static_cast<uint32_t>(object.mFormat)), "unknown object format");
+		Check(blobRange(object.mDataOffset, object.mDataSize), "object data out of range");
+
+		if (object.mKind == ECommandStreamObjectKind::UploadBuffer)
+		{
+			Check(object.mDataSize <= object.mSize, "buffer contents larger than the buffer");
+		}
+		else if (object.mKind == ECommandStreamObjectKind::Pipeline)
+		{
+			Check(blobRange(object.mPixelShaderOffset, object.mPixelShaderSize), "pixel shader out of range");
+			Check(object.mVertexElementOffset % 4 == 0 &&
+				blobRange(object.mVertexElementOffset, object.mVertexElementCount * sizeof(FCommandStreamVertexElement)),
+				"vertex layout out of range");
+
+			const FCommandStreamVertexElement* elements =
+				reinterpret_cast<const FCommandStreamVertexElement*>(GetBlob(object.mVertexElementOffset));
+			for (uint32_t e = 0; e < object.mVertexElementCount; ++e)
+			{
+				Check(IsValidFormat(static_cast<uint32_t>(elements[e].mFormat)), "unknown vertex format");
+				uint32_t semantic = elements[e].mSemanticOffset;
+				Check(semantic < header.mBlobSize &&
+					memchr(GetBlob(semantic), 0, static_cast<size_t>(header.mBlobSize - semantic)) != nullptr,
+					"vertex semantic out of range");
+			}
+		}
+	}
+
+	// Walk the commands once so replay can skip every check.
+	auto checkObject = [&](uint32_t id, bool resource)
+	{
+		if (id == CommandStreamNoObject)
+		{
+			return;
+		}
+		Check(id < header.mObjectCount && IsResource(GetObjectDesc(id)) == resource, "bad object reference");
+	};
+
+	const uint8_t* command = GetCommands();
+	const uint8_t* end = command + header.mCommandSize;
+	uint32_t frames = 0, lists = 0, commands = 0, listsLeft = 0;
+	uint32_t executeQueue = 0;
+	bool inList = false;
+	while (command < end)
+	{
+		Check(end - command >= static_cast<ptrdiff_t>(sizeof(FCommandStreamCommand)), "truncated command");
+		FCommandStreamCommand header = ReadCommand(command);
+		Check(header.mOp < ECommandStreamOp::Count, "unknown op");
+		Check(header.mSize == sizeof(FCommandStreamCommand) + PayloadSizes[static_cast<uint32_t>(header.mOp)] &&
+			header.mSize <= end - command, "bad command size");
+
+		switch (header.mOp)
+		{
+		case ECommandStreamOp::Execute:
+		{
+			FCommandStreamExecute execute = ReadPayload<FCommandStreamExecute>(command);
+			Check(!inList && listsLeft == 0, "Execute inside a list");
+			Check(execute.mQueue < QueueCount && execute.mListCount > 0 &&
+				execute.mListCount <= mHeader->mMaxListsPerExecute, "bad Execute");
+			listsLeft = execute.mListCount;
+			executeQueue = execute.mQueue;
+			break;
+		}
+		case ECommandStreamOp::BeginList:
+		{
+			FCommandStreamBeginList beginList = ReadPayload<FCommandStreamBeginList>(command);
+			Check(!inList && listsLeft > 0, "BeginList outside an Execute");
+			// Replay opens the list for this queue and executes it on the Execute's.
+			Check(beginList.mQueue == executeQueue, "list type does not match its Execute's queue");
+			checkObject(beginList.mInitialState, false);
+			inList = true;
+			break;
+		}
+		case ECommandStreamOp::EndList:
+			Check(inList, "EndList without BeginList");
+			inList = false;
+			--listsLeft;
+			++lists;
+			break;
+		case ECommandStreamOp::Present:
+			Check(!inList && listsLeft == 0, "Present inside an Execute");
+			++frames;
+			break;
+		default:
+		{
+			Check(inList, "list command outside a list");
+			switch (header.mOp)
+			{
+			case ECommandStreamOp::Transition:
+			{
+				FCommandStreamTransition transition = ReadPayload<FCommandStreamTransition>(command);
+				checkObject(transition.mResource, true);
+				Check(IsValidState(transition.mBefore) && IsValidState(transition.mAfter), "unknown resource state");
+				break;
+			}
+			case ECommandStreamOp::ClearRenderTarget:
+				checkObject(ReadPayload<FCommandStreamClear>(command).mTarget, true);
+				break;
+			case ECommandStreamOp::SetPipeline:
+				checkObject(ReadPayload<FCommandStreamObjectRef>(command).mObject, false);
+				break;
+			case ECommandStreamOp::SetRenderTarget:
+				checkObject(ReadPayload<FCommandStreamObjectRef>(command).mObject, true);
+				break;
+			case ECommandStreamOp::SetVertexBuffer:
+				checkObject(ReadPayload<FCommandStreamVertexBuffer>(command).mBuffer, true);
+				break;
+			case ECommandStreamOp::SetIndexBuffer:
+			{
+				FCommandStreamIndexBuffer indexBuffer = ReadPayload<FCommandStreamIndexBuffer>(command);
+				checkObject(indexBuffer.mBuffer, true);
+				Check(indexBuffer.mFormat == static_cast<uint32_t>(ERenderFormat::R16Uint), "bad index format");
+				break;
+			}
+			default:
+				break;
+			}
+			++commands;
+			break;
+		}
+		}
+
+		command += header.mSize;
+	}
+
+	Check(!inList && listsLeft == 0, "stream ends inside an Execute");
+	Check(frames == mHeader->mFrameCount && lists == mHeader->mListCount && commands == mHeader->mCommandCount,
+		"counts do not match the header");
+}
+
+CNullCommandStreamTarget::CNullCommandStreamTarget() :
+	mList(new CNullCommandStreamList())
+{
+}
+
+CNullCommandStreamTarget::~CNullCommandStreamTarget()
+{
+}
+
+void CNullCommandStreamTarget::CreateObjects(const CCommandStreamReader& reader,
+	std::vector<IRenderResource*>& resources, std::vector<IRenderPipeline*>& pipelines)
+{
+	resources.assign(reader.GetObjectCount(), nullptr);
+	pipelines.assign(reader.GetObjectCount(), nullptr);
+}
+
+IRenderCommandList* CNullCommandStreamTarget::BeginList(ERenderQueueType, IRenderPipeline*)
+{
+	return mList.get();
+}
+
+void CNullCommandStreamTarget::Execute(ERenderQueueType, IRenderCommandList* const*, uint32_t)
+{
+}
+
+void CNullCommandStreamTarget::Present(uint32_t)
+{
+}
+
+struct CDeviceCommandStreamTarget::FImpl
+{
+	struct FQueue
+	{
+		std::unique_ptr<IRenderQueue> mQueue;
+		CRenderFenceTimeline mTimeline;
+		// Lists are reset as soon as they have been executed; only allocators wait for the GPU.
+		std::vector<std::unique_ptr<IRenderCommandList>> mLists;
+		uint32_t mListsUsed = 0;
+		CRenderCommandAllocatorPool::FHandle mAllocator;
+	};
+
+	IRenderDevice& mDevice;
+	uint32_t mFramesInFlight;
+	CRenderCommandAllocatorPool mAllocatorPool;
+	FQueue mQueues[QueueCount];
+
+	// Fence value per queue of the last frames_in_flight frames.
+	std::vector<uint64_t> mFrameFenceValues;
+	uint32_t mFrameIndex = 0;
+
+	std::vector<std::shared_ptr<IRenderResource>> mResources;
+	std::vector<std::unique_ptr<IRenderPipeline>> mPipelines;
+
+	FImpl(IRenderDevice& device, uint32_t framesInFlight) :
+		mDevice(device),
+		mFramesInFlight(framesInFlight > 0 ? framesInFlight : 1),
+		mFrameFenceValues(mFramesInFlight * QueueCount, 0)
+	{
+		mAllocatorPool.GetBackend().mDevice = &mDevice;
+	}
+
+	FQueue& GetQueue(ERenderQueueType type)
+	{
+		FQueue& queue = mQueues[static_cast<uint32_t>(type)];
+		if (!queue.mQueue)
+		{
+			queue.mQueue = mDevice.CreateQueue(type);
+			queue.mTimeline.GetFence().Initialize(&mDevice, queue.mQueue.get());
+		}
+		return queue;
+	}
+};
+
+CDeviceCommandStreamTarget::CDeviceCommandStreamTarget(IRenderDevice& device, uint32_t framesInFlight) :
+	mImpl(new FImpl(device, framesInFlight))
+{
+}
+
+CDeviceCommandStreamTarget::~CDeviceCommandStreamTarget()
+{
+	Finish();
+}
+
+void CDeviceCommandStreamTarget::CreateObjects(const CCommandStreamReader& reader,
+	std::vector<IRenderResource*>& resources, std::vector<IRenderPipeline*>& pipelines)
+{
+	FImpl& impl = *mImpl;
+	uint32_t count = reader.GetObjectCount();
+	impl.mResources.assign(count, nullptr);
+	impl.mPipelines.clear();
+	impl.mPipelines.resize(count);
+	resources.assign(count, nullptr);
+	pipelines.assign(count, nullptr);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const FCommandStreamObject& object = reader.GetObjectDesc(i);
+		switch (object.mKind)
+		{
+		case ECommandStreamObjectKind::UploadBuffer:
+			impl.mResources[i] = impl.mDevice.CreateUploadBuffer(object.mSize);
+			memcpy(impl.mResources[i]->GetCPUAddress(), reader.GetBlob(object.mDataOffset), static_cast<size_t>(object.mDataSize));
+			break;
+		case ECommandStreamObjectKind::Buffer:
+			impl.mResources[i] = impl.mDevice.CreateBuffer(object.mSize);
+			break;
+		case ECommandStreamObjectKind::Texture2D:
+			impl.mResources[i] = impl.mDevice.CreateTexture2D(object.mWidth, object.mHeight,
+				object.mMipLevels != 0 ? object.mMipLevels : 1, object.mFormat);
+			break;
+		case ECommandStreamObjectKind::RenderTarget2D:
+			impl.mResources[i] = impl.mDevice.CreateRenderTarget2D(object.mWidth, object.mHeight, object.mFormat);
+			break;
+		case ECommandStreamObjectKind::Pipeline:
+		{
+			const uint8_t* vertexShader = reader.GetBlob(object.mDataOffset);
+			const uint8_t* pixelShader = reader.GetBlob(object.mPixelShaderOffset);
+			std::vector<uint8_t> vertexBytecode(vertexShader, vertexShader + object.mDataSize);
+			std::vector<uint8_t> pixelBytecode(pixelShader, pixelShader + object.mPixelShaderSize);
+
+			const FCommandStreamVertexElement* elements =
+				reinterpret_cast<const FCommandStreamVertexElement*>(reader.GetBlob(object.mVertexElementOffset));
+			std::vector<FRenderVertexElement> vertexElements(object.mVertexElementCount);
+			for (uint32_t e = 0; e < object.mVertexElementCount; ++e)
+			{
+				vertexElements[e].mSemantic = reinterpret_cast<const char*>(reader.GetBlob(elements[e].mSemanticOffset));
+				vertexElements[e].mFormat = elements[e].mFormat;
+				vertexElements[e].mOffset = elements[e].mOffset;
+			}
+
+			FRenderPipelineDesc desc = {};
+			desc.mVertexShader = &vertexBytecode;
+			desc.mPixelShader = &pixelBytecode;
+			desc.mVertexElements = vertexElements.data();
+			desc.mVertexElementCount = object.mVertexElementCount;
+			desc.mRenderTargetFormat = object.mFormat;
+			impl.mPipelines[i] = impl.mDevice.CreatePipeline(desc);
+			pipelines[i] = impl.mPipelines[i].get();
+			break;
+		}
+		}
+
+		resources[i] = impl.mResources[i].get();
+	}
+}
+
+IRenderCommandList* CDeviceCommandStreamTarget::BeginList(ERenderQueueType type, IRenderPipeline* initialState)
+{
+	FImpl& impl = *mImpl;
+	FImpl::FQueue& queue = impl.GetQueue(type);
+
+	if (!queue.mAllocator.mValid)
+	{
+		queue.mAllocator = impl.mAllocatorPool.Acquire(type);
+	}
+
+	// Only the first replayed frame creates lists.
+	if (queue.mListsUsed == queue.mLists.size())
+	{
+		queue.mLists.push_back(impl.mDevice.CreateCommandList(type, queue.mAllocator.mAllocator.get(), nullptr));
+	}
+
+	IRenderCommandList* list = queue.mLists[queue.mListsUsed++].get();
+	list->Reset(queue.mAllocator.mAllocator.get(), initialState);
+	return list;
+}
+
+void CDeviceCommandStreamTarget::Execute(ERenderQueueType type, IRenderCommandList* const* lists, uint32_t count)
+{
+	mImpl->GetQueue(type).mQueue->Execute(lists, count);
+}
+
+void CDeviceCommandStreamTarget::Present(uint32_t)
+{
+	FImpl& impl = *mImpl;
+
+	// There is no swap chain; the frame ends with a fence per queue it used.
+	uint64_t* frameValues = &impl.mFrameFenceValues[impl.mFrameIndex * QueueCount];
+	for (uint32_t i = 0; i < QueueCount; ++i)
+	{
+		FImpl::FQueue& queue = impl.mQueues[i];
+		if (!queue.mAllocator.mValid)
+		{
+			continue;
+		}
+
+		frameValues[i] = queue.mTimeline.Signal();
+		impl.mAllocatorPool.Release(queue.mAllocator, queue.mTimeline, frameValues[i],
+			queue.mAllocator.mAllocator->GetCommandCount());
+		queue.mListsUsed = 0;
+	}
+	impl.mAllocatorPool.Trim();
+
+	// Keep at most mFramesInFlight frames queued.
+	impl.mFrameIndex = (impl.mFrameIndex + 1) % impl.mFramesInFlight;
+	const uint64_t* nextValues = &impl.mFrameFenceValues[impl.mFrameIndex * QueueCount];
+	for (uint32_t i = 0; i < QueueCount; ++i)
+	{
+		if (nextValues[i] != 0)
+		{
+			impl.mQueues[i].mTimeline.WaitForValue(nextValues[i]);
+		}
+	}
+}
+
+void CDeviceCommandStreamTarget::Finish()
+{
+	for (FImpl::FQueue& queue : mImpl->mQueues)
+	{
+		if (queue.mQueue)
+		{
+			queue.mTimeline.WaitIdle();
+		}
+	}
+}
+
+CCommandStreamReplayer::CCommandStreamReplayer(const CCommandStreamReader& reader, ICommandStreamTarget& target) :
+	mReader(reader),
+	mTarget(target)
+{
+}
+
+void CCommandStreamReplayer::Prepare()
+{
+	mTarget.CreateObjects(mReader, mResources, mPipelines);
+	// CommandStreamNoObject maps to the extra null entry at the end.
+	mResources.push_back(nullptr);
+	mPipelines.push_back(nullptr);
+	mBatch.assign(mReader.GetHeader().mMaxListsPerExecute, nullptr);
+}
+
+const uint8_t* CCommandStreamReplayer::ReplayList(const uint8_t* command, IRenderCommandList* list)
+{
+	const uint32_t noObject = mReader.GetObjectCount();
+	auto resource = [&](uint32_t id) { return mResources[id == CommandStreamNoObject ? noObject : id]; };
+	auto pipeline = [&](uint32_t id) { return mPipelines[id == CommandStreamNoObject ? noObject : id]; };
+
+	for (;;)
+	{
+		FCommandStreamCommand header = ReadCommand(command);
+		switch (header.mOp)
+		{
+		case ECommandStreamOp::EndList:
+			return command + header.mSize;
+		case ECommandStreamOp::Transition:
+		{
+			FCommandStreamTransition payload = ReadPayload<FCommandStreamTransition>(command);
+			list->Transition(resource(payload.mResource),
+				static_cast<ERenderResourceState>(payload.mBefore), static_cast<ERenderResourceState>(payload.mAfter));
+			break;
+		}
+		case ECommandStreamOp::ClearRenderTarget:
+		{
+			FCommandStreamClear payload = ReadPayload<FCommandStreamClear>(command);
+			list->ClearRenderTarget(resource(payload.mTarget), payload.mColor);
+			break;
+		}
+		case ECommandStreamOp::SetPipeline:
+			list->SetPipeline(pipeline(ReadPayload<FCommandStreamObjectRef>(command).mObject));
+			break;
+		case ECommandStreamOp::SetViewport:
+			list->SetViewport(ReadPayload<FCommandStreamViewport>(command).mViewport);
+			break;
+		case ECommandStreamOp::SetScissor:
+			list->SetScissor(ReadPayload<FCommandStreamScissor>(command).mRect);
+			break;
+		case ECommandStreamOp::SetRenderTarget:
+			list->SetRenderTarget(resource(ReadPayload<FCommandStreamObjectRef>(command).mObject));
+			break;
+		case ECommandStreamOp::SetVertexBuffer:
+		{
+			FCommandStreamVertexBuffer payload = ReadPayload<FCommandStreamVertexBuffer>(command);
+			list->SetVertexBuffer(resource(payload.mBuffer), payload.mStride, payload.mSize);
+			break;
+		}
+		case ECommandStreamOp::SetIndexBuffer:
+		{
+			FCommandStreamIndexBuffer payload = ReadPayload<FCommandStreamIndexBuffer>(command);
+			list->SetIndexBuffer(resource(payload.mBuffer), static_cast<ERenderFormat>(payload.mFormat), payload.mSize);
+			break;
+		}
+		case ECommandStreamOp::DrawIndexed:
+		{
+			FCommandStreamDrawIndexed payload = ReadPayload<FCommandStreamDrawIndexed>(command);
+			list->DrawIndexed(payload.mIndexCount, payload.mInstanceCount, payload.mFirstIndex, payload.mBaseVertex);
+			break;
+		}
+		case ECommandStreamOp::Dispatch:
+		{
+			FCommandStreamDispatch payload = ReadPayload<FCommandStreamDispatch>(command);
+			list->Dispatch(payload.mX, payload.mY, payload.mZ);
+			break;
+		}
+		default:
+			assert(false && "Validated streams only hold list commands here.");
+			break;
+		}
+
+		command += header.mSize;
+	}
+}
+
+void CCommandStreamReplayer::Replay(uint32_t iterations)
+{
+	assert(!mBatch.empty() || mReader.GetHeader().mListCount == 0);
+
+	const uint8_t* begin = mReader.GetCommands();
+	const uint8_t* end = begin + mReader.GetCommandSize();
+	const uint32_t noObject = mReader.GetObjectCount();
+
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const uint8_t* command = begin;
+		while (command < end)
+		{
+			FCommandStreamCommand header = ReadCommand(command);
+			if (header.mOp == ECommandStreamOp::Present)
+			{
+				mTarget.Present(ReadPayload<FCommandStreamPresent>(command).mSyncInterval);
+				command += header.mSize;
+				continue;
+			}
+
+			FCommandStreamExecute execute = ReadPayload<FCommandStreamExecute>(command);
+			command += header.mSize;
+
+			for (uint32_t list = 0; list < execute.mListCount; ++list)
+			{
+				FCommandStreamCommand beginHeader = ReadCommand(command);
+				FCommandStreamBeginList beginList = ReadPayload<FCommandStreamBeginList>(command);
+				command += beginHeader.mSize;
+
+				IRenderPipeline* initialState =
+					mPipelines[beginList.mInitialState == CommandStreamNoObject ? noObject : beginList.mInitialState];
+				IRenderCommandList* commandList = mTarget.BeginList(static_cast<ERenderQueueType>(beginList.mQueue), initialState);
+				command = ReplayList(command, commandList);
+				commandList->Close();
+				mBatch[list] = commandList;
+			}
+
+			mTarget.Execute(static_cast<ERenderQueueType>(execute.mQueue), mBatch.data(), execute.mListCount);
+		}
+	}
+
+	mTarget.Finish();
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+
+// Binary command stream: what a frame recorded on its command lists, in submission order,
+// plus what is needed to recreate the objects it references. Captured by
+// CCaptureRenderDevice, replayed by CCommandStreamReplayer.
+//
+// Layout (little-endian, no pointers, every section 8-byte aligned, so a file can be mapped
+// and read in place):
+//     FCommandStreamHeader
+//     FCommandStreamObject[mObjectCount]       indexed by the object ids in commands
+//     blob                                     buffer contents, shader bytecode, vertex layouts
+//     commands                                 FCommandStreamCommand + payload, 4-byte aligned
+//
+// The command section is a sequence of frames:
+//     Execute { queue, listCount }, then listCount x (BeginList ... EndList)
+//     ...
+//     Present { syncInterval }                 ends the frame
+// Queue-to-queue fence signals and waits are not captured; each queue is replayed in order.
+
+const uint32_t CommandStreamMagic = 0x53434748;   // "HGCS"
+// Bumped whenever the layout changes; readers reject other versions.
+const uint16_t CommandStreamVersion = 1;
+const uint32_t CommandStreamNoObject = ~0u;
+
+enum class ECommandStreamObjectKind : uint8_t
+{
+	UploadBuffer,
+	Texture2D,
+	RenderTarget2D,
+	Pipeline,
+	Buffer,
+};
+
+enum class ECommandStreamOp : uint16_t
+{
+	Execute,
+	BeginList,
+	EndList,
+	Present,
+	Transition,
+	ClearRenderTarget,
+	SetPipeline,
+	SetViewport,
+	SetScissor,
+	SetRenderTarget,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	DrawIndexed,
+	Dispatch,
+	Count,
+};
+
+struct FCommandStreamHeader
+{
+	uint32_t mMagic;
+	uint16_t mVersion;
+	uint16_t mHeaderSize;
+	uint32_t mObjectCount;
+	uint32_t mFrameCount;
+	uint32_t mListCount;
+	uint32_t mCommandCount;       // Commands recorded on lists, not counting the markers.
+	uint32_t mMaxListsPerExecute;
+	uint32_t mReserved;
+	uint64_t mObjectOffset;
+	uint64_t mBlobOffset;
+	uint64_t mBlobSize;
+	uint64_t mCommandOffset;
+	uint64_t mCommandSize;
+};
+
+// Offsets are relative to the blob section.
+struct FCommandStreamObject
+{
+	ECommandStreamObjectKind mKind;
+	ERenderFormat mFormat;
+	uint16_t mVertexElementCount;           // Pipeline
+	uint32_t mWidth;                        // Textures and render targets
+	uint32_t mHeight;
+	uint32_t mMipLevels;                    // Textures; 0 (older streams) means 1
+	uint64_t mSize;                         // Buffers
+	uint64_t mDataOffset;                   // Upload buffer contents, or vertex shader
+	uint64_t mDataSize;
+	uint64_t mPixelShaderOffset;            // Pipeline
+	uint64_t mPixelShaderSize;
+	uint64_t mVertexElementOffset;          // Pipeline, FCommandStreamVertexElement[]
+};
+
+struct FCommandStreamVertexElement
+{
+	uint32_t mSemanticOffset;               // Null-terminated, in the blob.
+	uint32_t mOffset;
+	ERenderFormat mFormat;
+	uint8_t mReserved[3];
+};
+
+// Every command starts with this; mSize covers header and payload.
+struct FCommandStreamCommand
+{
+	ECommandStreamOp mOp;
+	uint16_t mSize;
+};
+
+// Payloads, following FCommandStreamCommand.
+struct FCommandStreamExecute        { uint32_t mQueue; uint32_t mListCount; };
+struct FCommandStreamBeginList      { uint32_t mQueue; uint32_t mInitialState; };
+struct FCommandStreamPresent        { uint32_t mSyncInterval; };
+struct FCommandStreamTransition     { uint32_t mResource; uint16_t mBefore; uint16_t mAfter; };
+struct FCommandStreamClear          { uint32_t mTarget; float mColor[4]; };
+struct FCommandStreamObjectRef      { uint32_t mObject; };
+struct FCommandStreamViewport       { FRenderViewport mViewport; };
+struct FCommandStreamScissor        { FRenderRect mRect; };
+struct FCommandStreamVertexBuffer   { uint32_t mBuffer; uint32_t mStride; uint32_t mSize; };
+struct FCommandStreamIndexBuffer    { uint32_t mBuffer; uint32_t mFormat; uint32_t mSize; };
+struct FCommandStreamDrawIndexed    { uint32_t mIndexCount; uint32_t mInstanceCount; uint32_t mFirstIndex; int32_t mBaseVertex; };
+struct FCommandStreamDispatch       { uint32_t mX; uint32_t mY; uint32_t mZ; };
+
+// Appends commands to a byte buffer. One writer per command list; no locking.
+class CCommandStreamWriter
+{
+	std::vector<uint8_t> mBytes;
+	uint32_t mCommandCount;
+
+public:
+	CCommandStreamWriter() :
+		mCommandCount(0)
+	{
+	}
+
+	template<typename TPayload>
+	void Write(ECommandStreamOp op, const TPayload& payload)
+	{
+		static_assert(sizeof(TPayload) % 4 == 0, "Command payloads keep the stream 4-byte aligned.");
+
+		FCommandStreamCommand command = { op, static_cast<uint16_t>(sizeof(command) + sizeof(TPayload)) };
+		const uint8_t* header = reinterpret_cast<const uint8_t*>(&command);
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(&payload);
+		mBytes.insert(mBytes.end(), header, header + sizeof(command));
+		mBytes.insert(mBytes.end(), data, data + sizeof(TPayload));
+		++mCommandCount;
+	}
+
+	void Write(ECommandStreamOp op)
+	{
+		FCommandStreamCommand command = { op, static_cast<uint16_t>(sizeof(command)) };
+		const uint8_t* header = reinterpret_cast<const uint8_t*>(&command);
+		mBytes.insert(mBytes.end(), header, header + sizeof(command));
+		++mCommandCount;
+	}
+
+	void Append(const CCommandStreamWriter& other)
+	{
+		mBytes.insert(mBytes.end(), other.mBytes.begin(), other.mBytes.end());
+		mCommandCount += other.mCommandCount;
+	}
+
+	// Keeps the capacity, so a writer reused every frame stops allocating.
+	void Clear()
+	{
+		mBytes.clear();
+		mCommandCount = 0;
+	}
+
+	const std::vector<uint8_t>& GetBytes() const { return mBytes; }
+	uint32_t GetCommandCount() const            { return mCommandCount; }
+};
+
+// A validated view of a stream in memory (a loaded or mapped file). Does not copy; the data
+// must outlive the reader. Throws std::runtime_error on a malformed stream, so the replay loop
+// can trust every offset, id, size and enum value.
+class CCommandStreamReader
+{
+	const uint8_t* mData;
+	size_t mSize;
+	const FCommandStreamHeader* mHeader;
+
+	void Validate();
+
+public:
+	CCommandStreamReader(const void* data, size_t size);
+
+	const FCommandStreamHeader& GetHeader() const  { return *mHeader; }
+	uint32_t GetObjectCount() const                 { return mHeader->mObjectCount; }
+	const FCommandStreamObject& GetObjectDesc(uint32_t id) const;
+	const uint8_t* GetBlob(uint64_t offset) const   { return mData + mHeader->mBlobOffset + offset; }
+	const uint8_t* GetCommands() const              { return mData + mHeader->mCommandOffset; }
+	uint64_t GetCommandSize() const                 { return mHeader->mCommandSize; }
+};
+
+// Where a replay goes: hands out open lists to replay into, and executes and presents them.
+class ICommandStreamTarget
+{
+public:
+	virtual ~ICommandStreamTarget() {}
+
+	// Creates (or looks up) the objects of the stream; called once before replaying.
+	virtual void CreateObjects(const CCommandStreamReader& reader,
+		std::vector<IRenderResource*>& resources, std::vector<IRenderPipeline*>& pipelines) = 0;
+
+	// Returns an open list of the given type for the next captured list.
+	virtual IRenderCommandList* BeginList(ERenderQueueType queue, IRenderPipeline* initialState) = 0;
+	virtual void Execute(ERenderQueueType queue, IRenderCommandList* const* lists, uint32_t count) = 0;
+	virtual void Present(uint32_t syncInterval) = 0;
+
+	// Waits for everything submitted; called once after replaying.
+	virtual void Finish() {}
+};
+
+// No-op sink: the replay goes through the full decode and dispatch but every command is
+// dropped, which isolates the cost of the stream itself.
+class CNullCommandStreamTarget : public ICommandStreamTarget
+{
+	std::unique_ptr<IRenderCommandList> mList;
+
+public:
+	CNullCommandStreamTarget();
+	virtual ~CNullCommandStreamTarget();
+
+	virtual void CreateObjects(const CCommandStreamReader& reader,
+		std::vector<IRenderResource*>& resources, std::vector<IRenderPipeline*>& pipelines);
+	virtual IRenderCommandList* BeginList(ERenderQueueType queue, IRenderPipeline* initialState);
+	virtual void Execute(ERenderQueueType queue, IRenderCommandList* const* lists, uint32_t count);
+	virtual void Present(uint32_t syncInterval);
+};
+
+// Replays onto a render device: recreates the stream's objects (upload buffers with their
+// captured contents, GPU buffers, textures and render targets uninitialized, pipelines from
+// the captured bytecode), records each captured list into a pooled list and executes it on a
+// queue of the same type. Up to framesInFlight replayed frames are in flight on the device.
+class CDeviceCommandStreamTarget : public ICommandStreamTarget
+{
+	struct FImpl;
+	std::unique_ptr<FImpl> mImpl;
+
+public:
+	CDeviceCommandStreamTarget(IRenderDevice& device, uint32_t framesInFlight = 2);
+	virtual ~CDeviceCommandStreamTarget();
+
+	virtual void CreateObjects(const CCommandStreamReader& reader,
+		std::vector<IRenderResource*>& resources, std::vector<IRenderPipeline*>& pipelines);
+	virtual IRenderCommandList* BeginList(ERenderQueueType queue, IRenderPipeline* initialState);
+	virtual void Execute(ERenderQueueType queue, IRenderCommandList* const* lists, uint32_t count);
+	virtual void Present(uint32_t syncInterval);
+	virtual void Finish();
+};
+
+// Re-issues a stream against a target. Object lookups go through tables built once by
+// Prepare, and the list batch is sized from the header, so replaying does not allocate.
+class CCommandStreamReplayer
+{
+	const CCommandStreamReader& mReader;
+	ICommandStreamTarget& mTarget;
+	std::vector<IRenderResource*> mResources;
+	std::vector<IRenderPipeline*> mPipelines;
+	std::vector<IRenderCommandList*> mBatch;
+
+	const uint8_t* ReplayList(const uint8_t* command, IRenderCommandList* list);
+
+public:
+	CCommandStreamReplayer(const CCommandStreamReader& reader, ICommandStreamTarget& target);
+
+	// Creates the target's objects.
+	void Prepare();
+
+	// Replays every frame of the stream iterations times.
+	void Replay(uint32_t iterations);
+};
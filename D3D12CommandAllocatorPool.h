@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "DXSampleHelper.h"
+#include "CommandAllocatorPool.h"
+#include "D3D12Fence.h"
+
+struct FD3D12AllocatorBackend
+{
+	typedef ComPtr<ID3D12CommandAllocator> Allocator;
+	typedef D3D12_COMMAND_LIST_TYPE ListType;
+
+	ID3D12Device* mDevice = nullptr;
+
+	Allocator Create(ListType type)
+	{
+		Allocator allocator;
+		ThrowIfFailed(mDevice->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
+		return allocator;
+	}
+
+	void Reset(Allocator& allocator)
+	{
+		ThrowIfFailed(allocator->Reset());
+	}
+};
+
+typedef CCommandAllocatorPool<FD3D12AllocatorBackend, CD3D12FenceTimeline> CD3D12CommandAllocatorPool;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "DXSampleHelper.h"
+#include "FenceTimeline.h"
+
+// ID3D12Fence signalled from one queue, with its own event for CPU waits. Used as the fence of
+// a CFenceTimeline; waits never time out, a hung GPU shows up as a hang rather than as a frame
+// that silently started early.
+struct FD3D12Fence
+{
+	ComPtr<ID3D12Fence> mFence;
+	ID3D12CommandQueue* mQueue = nullptr;
+	HANDLE mEvent = nullptr;
+
+	FD3D12Fence() {}
+	FD3D12Fence(const FD3D12Fence&) = delete;
+	FD3D12Fence& operator=(const FD3D12Fence&) = delete;
+
+	~FD3D12Fence()
+	{
+		if (mEvent)
+		{
+			::CloseHandle(mEvent);
+		}
+	}
+
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* queue)
+	{
+		ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+		mQueue = queue;
+
+		mEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (!mEvent)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+	}
+
+	uint64_t GetCompletedValue()
+	{
+		return mFence->GetCompletedValue();
+	}
+
+	void Signal(uint64_t value)
+	{
+		ThrowIfFailed(mQueue->Signal(mFence.Get(), value));
+	}
+
+	void WaitForValue(uint64_t value)
+	{
+		ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvent));
+		::WaitForSingleObject(mEvent, INFINITE);
+	}
+
+	// One blocking call for several fences, each with its own event.
+	static void WaitForValues(FD3D12Fence* const* fences, const uint64_t* values, uint32_t count)
+	{
+		HANDLE events[MAXIMUM_WAIT_OBJECTS];
+		assert(count <= MAXIMUM_WAIT_OBJECTS);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			ThrowIfFailed(fences[i]->mFence->SetEventOnCompletion(values[i], fences[i]->mEvent));
+			events[i] = fences[i]->mEvent;
+		}
+		::WaitForMultipleObjects(count, events, TRUE, INFINITE);
+	}
+};
+
+typedef CFenceTimeline<FD3D12Fence> CD3D12FenceTimeline;
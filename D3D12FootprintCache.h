@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DXSampleHelper.h"
+#include "FootprintCache.h"
+
+struct FD3D12FootprintBackend
+{
+	typedef D3D12_RESOURCE_DESC Desc;
+	typedef D3D12_PLACED_SUBRESOURCE_FOOTPRINT Layout;
+
+	ID3D12Device* mDevice = nullptr;
+
+	// Field by field: the struct has padding after Dimension.
+	static uint64_t HashDesc(const Desc& desc)
+	{
+		uint64_t hash = FootprintHashSeed;
+		hash = HashFootprintField(hash, desc.Dimension);
+		hash = HashFootprintField(hash, desc.Alignment);
+		hash = HashFootprintField(hash, desc.Width);
+		hash = HashFootprintField(hash, desc.Height);
+		hash = HashFootprintField(hash, desc.DepthOrArraySize);
+		hash = HashFootprintField(hash, desc.MipLevels);
+		hash = HashFootprintField(hash, desc.Format);
+		hash = HashFootprintField(hash, desc.SampleDesc.Count);
+		hash = HashFootprintField(hash, desc.SampleDesc.Quality);
+		hash = HashFootprintField(hash, desc.Layout);
+		hash = HashFootprintField(hash, desc.Flags);
+		return hash;
+	}
+
+	static bool EqualDesc(const Desc& a, const Desc& b)
+	{
+		return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width &&
+			a.Height == b.Height && a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels &&
+			a.Format == b.Format && a.SampleDesc.Count == b.SampleDesc.Count &&
+			a.SampleDesc.Quality == b.SampleDesc.Quality && a.Layout == b.Layout && a.Flags == b.Flags;
+	}
+
+	void GetFootprints(const Desc& desc, uint32_t first, uint32_t count,
+		Layout* layouts, uint32_t* numRows, uint64_t* rowSizes, uint64_t* totalSize)
+	{
+		mDevice->GetCopyableFootprints(&desc, first, count, 0, layouts, numRows, rowSizes, totalSize);
+	}
+};
+
+typedef CFootprintCache<FD3D12FootprintBackend> CD3D12FootprintCache;
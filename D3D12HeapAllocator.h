@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "DXSampleHelper.h"
+#include "GPUHeapAllocator.h"
+
+// Heap type plus the resource classes the heap may hold. Resource heap tier 1 hardware keeps
+// buffers, render targets and other textures in separate heaps; tier 2 mixes them.
+struct FD3D12HeapKind
+{
+	D3D12_HEAP_TYPE mType;
+	D3D12_HEAP_FLAGS mFlags;
+
+	bool operator==(const FD3D12HeapKind& other) const
+	{
+		return mType == other.mType && mFlags == other.mFlags;
+	}
+};
+
+struct FD3D12HeapBackend
+{
+	typedef ComPtr<ID3D12Heap> Heap;
+	typedef FD3D12HeapKind Kind;
+
+	// Heaps for placed resources; a resource larger than this gets a committed resource.
+	static const uint64_t HeapSize = 64 * 1024 * 1024;
+
+	ID3D12Device* mDevice = nullptr;
+
+	Heap CreateHeap(const Kind& kind, uint64_t size)
+	{
+		CD3DX12_HEAP_DESC heapDesc(size, kind.mType, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, kind.mFlags);
+
+		Heap heap;
+		ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+		return heap;
+	}
+};
+
+typedef CGPUHeapAllocator<FD3D12HeapBackend> CD3D12HeapAllocator;
@@ -0,0 +1,947 @@
+#include <windows.h>
+
+#include <wrl.h>
+#include "D3D12RenderDevice.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "D3D12Fence.h"
+#include "D3D12CommandAllocatorPool.h"
+#include "UploadQueue.h"
+
+static_assert(sizeof(FRenderSubresourceData) == sizeof(D3D12_SUBRESOURCE_DATA) &&
+	offsetof(FRenderSubresourceData, mRowPitch) == offsetof(D3D12_SUBRESOURCE_DATA, RowPitch) &&
+	offsetof(FRenderSubresourceData, mSlicePitch) == offsetof(D3D12_SUBRESOURCE_DATA, SlicePitch),
+	"FRenderSubresourceData must match D3D12_SUBRESOURCE_DATA.");
+
+namespace
+{
+	DXGI_FORMAT ToDXGIFormat(ERenderFormat format)
+	{
+		switch (format)
+		{
+		case ERenderFormat::RGBA8Unorm:      return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case ERenderFormat::RGB32Float:      return DXGI_FORMAT_R32G32B32_FLOAT;
+		case ERenderFormat::RGBA32Float:     return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case ERenderFormat::R16Uint:         return DXGI_FORMAT_R16_UINT;
+		case ERenderFormat::RGBA8UnormSrgb:  return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		case ERenderFormat::BC1Unorm:        return DXGI_FORMAT_BC1_UNORM;
+		case ERenderFormat::BC1UnormSrgb:    return DXGI_FORMAT_BC1_UNORM_SRGB;
+		case ERenderFormat::BC2Unorm:        return DXGI_FORMAT_BC2_UNORM;
+		case ERenderFormat::BC2UnormSrgb:    return DXGI_FORMAT_BC2_UNORM_SRGB;
+		case ERenderFormat::BC3Unorm:        return DXGI_FORMAT_BC3_UNORM;
+		case ERenderFormat::BC3UnormSrgb:    return DXGI_FORMAT_BC3_UNORM_SRGB;
+		case ERenderFormat::BC4Unorm:        return DXGI_FORMAT_BC4_UNORM;
+		case ERenderFormat::BC4Snorm:        return DXGI_FORMAT_BC4_SNORM;
+		case ERenderFormat::BC5Unorm:        return DXGI_FORMAT_BC5_UNORM;
+		case ERenderFormat::BC5Snorm:        return DXGI_FORMAT_BC5_SNORM;
+		case ERenderFormat::BC6HUfloat:      return DXGI_FORMAT_BC6H_UF16;
+		case ERenderFormat::BC6HSfloat:      return DXGI_FORMAT_BC6H_SF16;
+		case ERenderFormat::BC7Unorm:        return DXGI_FORMAT_BC7_UNORM;
+		case ERenderFormat::BC7UnormSrgb:    return DXGI_FORMAT_BC7_UNORM_SRGB;
+		default:                            return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	D3D12_RESOURCE_STATES ToD3D12State(ERenderResourceState state)
+	{
+		switch (state)
+		{
+		case ERenderResourceState::Present:              return D3D12_RESOURCE_STATE_PRESENT;
+		case ERenderResourceState::RenderTarget:         return D3D12_RESOURCE_STATE_RENDER_TARGET;
+		case ERenderResourceState::PixelShaderResource:  return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		case ERenderResourceState::CopyDest:             return D3D12_RESOURCE_STATE_COPY_DEST;
+		case ERenderResourceState::GenericRead:          return D3D12_RESOURCE_STATE_GENERIC_READ;
+		default:                                         return D3D12_RESOURCE_STATE_COMMON;
+		}
+	}
+
+	D3D12_COMMAND_LIST_TYPE ToD3D12ListType(ERenderQueueType type)
+	{
+		switch (type)
+		{
+		case ERenderQueueType::Compute:  return D3D12_COMMAND_LIST_TYPE_COMPUTE;
+		case ERenderQueueType::Copy:     return D3D12_COMMAND_LIST_TYPE_COPY;
+		default:                         return D3D12_COMMAND_LIST_TYPE_DIRECT;
+		}
+	}
+
+	class CD3D12Resource : public IRenderResource
+	{
+	public:
+		ComPtr<ID3D12Resource> mResource;
+		void* mCPU = nullptr;
+		// Only for swap chain back buffers and render targets; render targets own their heap.
+		D3D12_CPU_DESCRIPTOR_HANDLE mRTV = {};
+		ComPtr<ID3D12DescriptorHeap> mRTVHeap;
+		// Where a placed resource lives; the block is retired once the resource is gone.
+		CD3D12HeapAllocator* mHeapAllocator = nullptr;
+		CD3D12HeapAllocator::FAllocation mAllocation;
+		// Placed render targets start with whatever the heap held before; D3D12 requires a
+		// clear, copy or discard before anything else uses them.
+		std::atomic<bool> mNeedsDiscard{ false };
+
+		virtual ~CD3D12Resource()
+		{
+			mResource.Reset();
+			if (mHeapAllocator)
+			{
+				mHeapAllocator->Retire(mAllocation);
+			}
+		}
+
+		virtual void* GetCPUAddress()     { return mCPU; }
+		virtual uint64_t GetGPUAddress()  { return mResource->GetGPUVirtualAddress(); }
+	};
+
+	class CD3D12Pipeline : public IRenderPipeline
+	{
+	public:
+		ComPtr<ID3D12RootSignature> mRootSignature;
+		ComPtr<ID3D12PipelineState> mPipelineState;
+	};
+
+	class CD3D12CommandAllocator : public IRenderCommandAllocator
+	{
+	public:
+		ComPtr<ID3D12CommandAllocator> mAllocator;
+		uint64_t mCommandCount = 0;
+
+		virtual void Reset()
+		{
+			ThrowIfFailed(mAllocator->Reset());
+			mCommandCount = 0;
+		}
+
+		virtual uint64_t GetCommandCount() const { return mCommandCount; }
+	};
+
+	class CD3D12CommandList : public IRenderCommandList
+	{
+	public:
+		ComPtr<ID3D12GraphicsCommandList> mList;
+		ERenderQueueType mType;
+		// The allocator of the current recording, which counts the D3D12 calls made into it.
+		CD3D12CommandAllocator* mAllocator = nullptr;
+
+		virtual ERenderQueueType GetType() const { return mType; }
+
+		virtual void Reset(IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+		{
+			mAllocator = static_cast<CD3D12CommandAllocator*>(allocator);
+			ID3D12PipelineState* initialState = pipeline ? static_cast<CD3D12Pipeline*>(pipeline)->mPipelineState.Get() : nullptr;
+			ThrowIfFailed(mList->Reset(mAllocator->mAllocator.Get(), initialState));
+		}
+
+		virtual void Close()
+		{
+			ThrowIfFailed(mList->Close());
+		}
+
+		virtual void Transition(IRenderResource* resource, ERenderResourceState before, ERenderResourceState after)
+		{
+			CD3D12Resource* d3d12Resource = static_cast<CD3D12Resource*>(resource);
+
+			// A placed render target is initialized on its first transition, by discarding it
+			// as a render target on the way.
+			if (d3d12Resource->mNeedsDiscard.exchange(false, std::memory_order_relaxed))
+			{
+				if (before != ERenderResourceState::RenderTarget)
+				{
+					CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+						d3d12Resource->mResource.Get(), ToD3D12State(before), D3D12_RESOURCE_STATE_RENDER_TARGET);
+					mList->ResourceBarrier(1, &barrier);
+					++mAllocator->mCommandCount;
+				}
+				mList->DiscardResource(d3d12Resource->mResource.Get(), nullptr);
+				++mAllocator->mCommandCount;
+
+				before = ERenderResourceState::RenderTarget;
+				if (after == before)
+				{
+					return;
+				}
+			}
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+				d3d12Resource->mResource.Get(),
+				ToD3D12State(before),
+				ToD3D12State(after));
+			mList->ResourceBarrier(1, &barrier);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void ClearRenderTarget(IRenderResource* target, const float color[4])
+		{
+			mList->ClearRenderTargetView(static_cast<CD3D12Resource*>(target)->mRTV, color, 0, nullptr);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void SetPipeline(IRenderPipeline* pipeline)
+		{
+			CD3D12Pipeline* d3d12Pipeline = static_cast<CD3D12Pipeline*>(pipeline);
+			mList->SetGraphicsRootSignature(d3d12Pipeline->mRootSignature.Get());
+			mList->SetPipelineState(d3d12Pipeline->mPipelineState.Get());
+			mList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			mAllocator->mCommandCount += 3;
+		}
+
+		virtual void SetViewport(const FRenderViewport& viewport)
+		{
+			CD3DX12_VIEWPORT d3d12Viewport(viewport.mX, viewport.mY, viewport.mWidth, viewport.mHeight);
+			mList->RSSetViewports(1, &d3d12Viewport);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void SetScissor(const FRenderRect& rect)
+		{
+			CD3DX12_RECT scissorRect(rect.mLeft, rect.mTop, rect.mRight, rect.mBottom);
+			mList->RSSetScissorRects(1, &scissorRect);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void SetRenderTarget(IRenderResource* target)
+		{
+			const D3D12_CPU_DESCRIPTOR_HANDLE& rtv = static_cast<CD3D12Resource*>(target)->mRTV;
+			mList->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void SetVertexBuffer(IRenderResource* buffer, uint32_t stride, uint32_t size)
+		{
+			D3D12_VERTEX_BUFFER_VIEW view;
+			view.BufferLocation = buffer->GetGPUAddress();
+			view.StrideInBytes = stride;
+			view.SizeInBytes = size;
+			mList->IASetVertexBuffers(0, 1, &view);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void SetIndexBuffer(IRenderResource* buffer, ERenderFormat format, uint32_t size)
+		{
+			D3D12_INDEX_BUFFER_VIEW view;
+			view.BufferLocation = buffer->GetGPUAddress();
+			view.Format = ToDXGIFormat(format);
+			view.SizeInBytes = size;
+			mList->IASetIndexBuffer(&view);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex)
+		{
+			mList->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, 0);
+			++mAllocator->mCommandCount;
+		}
+
+		virtual void Dispatch(uint32_t x, uint32_t y, uint32_t z)
+		{
+			mList->Dispatch(x, y, z);
+			++mAllocator->mCommandCount;
+		}
+	};
+
+	// Owns its FD3D12Fence, or wraps the fence of another object (the upload queue's timeline).
+	class CD3D12Fence : public IRenderFence
+	{
+	public:
+		std::unique_ptr<FD3D12Fence> mOwnedFence;
+		FD3D12Fence* mFence = nullptr;
+
+		virtual uint64_t GetCompletedValue()
+		{
+			return mFence->GetCompletedValue();
+		}
+
+		virtual void WaitForValue(uint64_t value)
+		{
+			mFence->WaitForValue(value);
+		}
+	};
+
+	class CD3D12Queue : public IRenderQueue
+	{
+	public:
+		ComPtr<ID3D12CommandQueue> mQueue;
+		ERenderQueueType mType;
+		std::vector<ID3D12CommandList*> mBatch;   // Reused across Execute calls.
+
+		virtual ERenderQueueType GetType() const { return mType; }
+
+		virtual void Execute(IRenderCommandList* const* lists, uint32_t count)
+		{
+			mBatch.clear();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				mBatch.push_back(static_cast<CD3D12CommandList*>(lists[i])->mList.Get());
+			}
+			mQueue->ExecuteCommandLists(count, mBatch.data());
+		}
+
+		virtual void Signal(IRenderFence* fence, uint64_t value)
+		{
+			ThrowIfFailed(mQueue->Signal(static_cast<CD3D12Fence*>(fence)->mFence->mFence.Get(), value));
+		}
+
+		virtual void Wait(IRenderFence* fence, uint64_t value)
+		{
+			ThrowIfFailed(mQueue->Wait(static_cast<CD3D12Fence*>(fence)->mFence->mFence.Get(), value));
+		}
+	};
+
+	class CD3D12SwapChain : public IRenderSwapChain
+	{
+	public:
+		ComPtr<IDXGISwapChain4> mSwapChain;
+		CD3D12RenderDevice* mDevice = nullptr;
+		ID3D12CommandQueue* mPresentQueue = nullptr;
+		ComPtr<ID3D12DescriptorHeap> mRTVDescriptorHeap;
+		std::vector<std::unique_ptr<CD3D12Resource>> mBackBuffers;
+		bool mTearingSupported = false;
+
+		// Low-latency mode: the swap chain hands out a waitable that is signalled when it can
+		// accept another frame, so we block before recording rather than queueing behind Present.
+		HANDLE mFrameLatencyWaitable = nullptr;
+
+		virtual ~CD3D12SwapChain()
+		{
+			if (mFrameLatencyWaitable)
+			{
+				::CloseHandle(mFrameLatencyWaitable);
+			}
+		}
+
+		virtual uint32_t GetBufferCount() const            { return static_cast<uint32_t>(mBackBuffers.size()); }
+		virtual uint32_t GetCurrentBackBufferIndex()       { return mSwapChain->GetCurrentBackBufferIndex(); }
+		virtual IRenderResource* GetBackBuffer(uint32_t i) { return mBackBuffers[i].get(); }
+
+		virtual void WaitForNextFrame()
+		{
+			if (mFrameLatencyWaitable)
+			{
+				::WaitForSingleObjectEx(mFrameLatencyWaitable, 1000, TRUE);
+			}
+		}
+
+		virtual void Present(uint32_t syncInterval)
+		{
+			UINT presentFlags = mTearingSupported && syncInterval == 0 ? DXGI_PRESENT_ALLOW_TEARING : 0;
+			ThrowIfFailed(mSwapChain->Present(syncInterval, presentFlags));
+			mDevice->RetireFrame(mPresentQueue);
+		}
+
+		virtual bool IsTearingSupported() const { return mTearingSupported; }
+
+		virtual bool GetPresentStats(FRenderPresentStats& stats)
+		{
+			// Fails with DXGI_ERROR_FRAME_STATISTICS_DISJOINT after a mode change, among others.
+			DXGI_FRAME_STATISTICS frameStats = {};
+			UINT presentCount = 0;
+			if (FAILED(mSwapChain->GetFrameStatistics(&frameStats)) ||
+				FAILED(mSwapChain->GetLastPresentCount(&presentCount)))
+			{
+				return false;
+			}
+
+			LARGE_INTEGER frequency;
+			::QueryPerformanceFrequency(&frequency);
+			LONGLONG ticks = frameStats.SyncQPCTime.QuadPart;
+			stats.mPresentCount = presentCount;
+			stats.mDisplayedPresentCount = frameStats.PresentCount;
+			stats.mPresentRefreshCount = frameStats.PresentRefreshCount;
+			stats.mSyncRefreshCount = frameStats.SyncRefreshCount;
+			stats.mSyncTimeNs = ticks / frequency.QuadPart * 1000000000 +
+				ticks % frequency.QuadPart * 1000000000 / frequency.QuadPart;
+			return true;
+		}
+	};
+
+	// CUploadQueue with COPY allocators from a pool of its own.
+	class CD3D12UploadQueue : public IRenderUploadQueue
+	{
+	public:
+		CD3D12CommandAllocatorPool mAllocatorPool;
+		CUploadQueue mUploadQueue;
+		CD3D12Fence mFence;
+		std::vector<ID3D12Resource*> mResources;   // Reused across WaitOnQueue calls.
+
+		void Initialize(ComPtr<ID3D12Device2> device, CD3D12FootprintCache& footprintCache, CJobSystem* copyJobs)
+		{
+			mAllocatorPool.GetBackend().mDevice = device.Get();
+			mUploadQueue.Initialize(device, mAllocatorPool, footprintCache, copyJobs);
+			mFence.mFence = &mUploadQueue.GetTimeline().GetFence();
+		}
+
+		virtual void UploadSubresources(IRenderResource* dest, uint32_t firstSubresource, uint32_t numSubresources,
+			const FRenderSubresourceData* data)
+		{
+			mUploadQueue.UploadSubresources(static_cast<CD3D12Resource*>(dest)->mResource.Get(),
+				firstSubresource, numSubresources, reinterpret_cast<const D3D12_SUBRESOURCE_DATA*>(data));
+		}
+
+		virtual uint64_t Submit()
+		{
+			return mUploadQueue.Submit();
+		}
+
+		virtual void WaitOnQueue(IRenderQueue* consumer, IRenderResource* const* resources, uint32_t count)
+		{
+			mResources.clear();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				mResources.push_back(static_cast<CD3D12Resource*>(resources[i])->mResource.Get());
+			}
+			mUploadQueue.WaitOnQueue(static_cast<CD3D12Queue*>(consumer)->mQueue.Get(), mResources.data(), count);
+		}
+
+		virtual void Retire()
+		{
+			mUploadQueue.Retire();
+		}
+
+		virtual IRenderFence* GetFence()       { return &mFence; }
+		virtual uint64_t GetLastSignaledValue() { return mUploadQueue.GetTimeline().GetLastSignaledValue(); }
+	};
+}
+
+CD3D12RenderDevice::CD3D12RenderDevice(bool useWarp) :
+	mRetireValue(0)
+{
+	mTearingSupported = CheckTearingSupport();
+	ComPtr<IDXGIAdapter4> adapter = GetAdapter(useWarp);
+	mDevice = CreateDevice(adapter);
+
+	D3D12_FEATURE_DATA_ARCHITECTURE stArchitecture = {};
+	mDevice->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &stArchitecture, sizeof(stArchitecture));
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	mResourceHeapTier = D3D12_RESOURCE_HEAP_TIER_1;
+	if (SUCCEEDED(mDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+	{
+		mResourceHeapTier = options.ResourceHeapTier;
+	}
+
+	FD3D12HeapBackend heapBackend;
+	heapBackend.mDevice = mDevice.Get();
+	mHeapAllocator.reset(new CD3D12HeapAllocator(heapBackend, FD3D12HeapBackend::HeapSize,
+		D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT));
+
+	mFootprintCache.reset(new CD3D12FootprintCache());
+	mFootprintCache->GetBackend().mDevice = mDevice.Get();
+
+	// Signalled on the present queue, passed to RetireFrame.
+	mRetireFence.Initialize(mDevice.Get(), nullptr);
+
+	CreateRootSignature();
+}
+
+CD3D12RenderDevice::~CD3D12RenderDevice()
+{
+	// Blocks retired since are released with the heap allocator; the renderer has drained
+	// its queues by now.
+	if (mRetireValue != 0)
+	{
+		mRetireFence.WaitForValue(mRetireValue);
+	}
+}
+
+void CD3D12RenderDevice::RetireFrame(ID3D12CommandQueue* presentQueue)
+{
+	ThrowIfFailed(presentQueue->Signal(mRetireFence.mFence.Get(), ++mRetireValue));
+	mHeapAllocator->OnSignal(mRetireValue);
+	mHeapAllocator->Collect(mRetireFence.GetCompletedValue());
+}
+
+bool CD3D12RenderDevice::CheckTearingSupport()
+{
+	BOOL allowTearing = FALSE;
+
+	// Rather than create the DXGI 1.5 factory interface directly, we create the
+	// DXGI 1.4 interface and query for the 1.5 interface. This is to enable the 
+	// graphics debugging tools which will not support the 1.5 factory interface 
+	// until a future update.
+	ComPtr<IDXGIFactory4> factory4;
+	if (SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(&factory4))))
+	{
+		ComPtr<IDXGIFactory5> factory5;
+		if (SUCCEEDED(factory4.As(&factory5)))
+		{
+			if (FAILED(factory5->CheckFeatureSupport(
+				DXGI_FEATURE_PRESENT_ALLOW_TEARING,
+				&allowTearing, sizeof(allowTearing))))
+			{
+				allowTearing = FALSE;
+			}
+		}
+	}
+
+	return allowTearing == TRUE;
+}
+
+ComPtr<IDXGIAdapter4> CD3D12RenderDevice::GetAdapter(bool useWarp)
+{
+	ComPtr<IDXGIFactory4> dxgiFactory;
+	UINT createFactoryFlags = 0;
+#if defined(_DEBUG)
+	createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
+#endif
+
+	ThrowIfFailed(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)));
+
+	ComPtr<IDXGIAdapter1> dxgiAdapter1;
+	ComPtr<IDXGIAdapter4> dxgiAdapter4;
+
+	if (useWarp)
+	{
+		ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&dxgiAdapter1)));
+		ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+	}
+	else
+	{
+		SIZE_T maxDedicatedVideoMemory = 0;
+		for (UINT i = 0; dxgiFactory->EnumAdapters1(i, &dxgiAdapter1) != DXGI_ERROR_NOT_FOUND; ++i)
+		{
+			DXGI_ADAPTER_DESC1 dxgiAdapterDesc1;
+			dxgiAdapter1->GetDesc1(&dxgiAdapterDesc1);
+
+			// Check to see if the adapter can create a D3D12 device without actually 
+			// creating it. The adapter with the largest dedicated video memory
+			// is favored.
+			if ((dxgiAdapterDesc1.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0 &&
+				SUCCEEDED(D3D12CreateDevice(dxgiAdapter1.Get(),
+					D3D_FEATURE_LEVEL_11_0, __uuidof(ID3D12Device), nullptr)) &&
+				dxgiAdapterDesc1.DedicatedVideoMemory > maxDedicatedVideoMemory)
+			{
+				maxDedicatedVideoMemory = dxgiAdapterDesc1.DedicatedVideoMemory;
+				ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+
+				TCHAR szDebug[512];
+
+				::wsprintfW(szDebug, L"Կ[%d]-\"%s\":ռԴ[%dMB]ռڴ[%dMB]ڴ[%dMB]\n"
+					, i
+					, dxgiAdapterDesc1.Description
+					, dxgiAdapterDesc1.DedicatedVideoMemory / (1024 * 1024)
+					, dxgiAdapterDesc1.DedicatedSystemMemory / (1024 * 1024)
+					, dxgiAdapterDesc1.SharedSystemMemory / (1024 * 1024));
+
+				D3D12_FEATURE_DATA_ARCHITECTURE stArchitecture = {};
+
+
+				::OutputDebugStringW(szDebug);
+			}
+		}
+	}
+
+	return dxgiAdapter4;
+}
+
+ComPtr<ID3D12Device2> CD3D12RenderDevice::CreateDevice(ComPtr<IDXGIAdapter4> adapter)
+{
+	ComPtr<ID3D12Device2> d3d12Device2;
+	ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)));
+
+#if defined(_DEBUG)
+	ComPtr<ID3D12InfoQueue> pInfoQueue;
+	if (SUCCEEDED(d3d12Device2.As(&pInfoQueue)))
+	{
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, TRUE);
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, TRUE);
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, TRUE);
+
+		// Suppress whole categories of messages
+ //D3D12_MESSAGE_CATEGORY Categories[] = {};
+
+ // Suppress messages based on their severity level
+		D3D12_MESSAGE_SEVERITY Severities[] =
+		{
+			D3D12_MESSAGE_SEVERITY_INFO
+		};
+
+		// Suppress individual messages by their ID
+		D3D12_MESSAGE_ID DenyIds[] = {
+			D3D12_MESSAGE_ID_CLEARRENDERTARGETVIEW_MISMATCHINGCLEARVALUE,   // I'm really not sure how to avoid this message.
+			D3D12_MESSAGE_ID_MAP_INVALID_NULLRANGE,                         // This warning occurs when using capture frame while graphics debugging.
+			D3D12_MESSAGE_ID_UNMAP_INVALID_NULLRANGE,                       // This warning occurs when using capture frame while graphics debugging.
+		};
+
+		D3D12_INFO_QUEUE_FILTER NewFilter = {};
+		//NewFilter.DenyList.NumCategories = _countof(Categories);
+		//NewFilter.DenyList.pCategoryList = Categories;
+		NewFilter.DenyList.NumSeverities = _countof(Severities);
+		NewFilter.DenyList.pSeverityList = Severities;
+		NewFilter.DenyList.NumIDs = _countof(DenyIds);
+		NewFilter.DenyList.pIDList = DenyIds;
+
+		ThrowIfFailed(pInfoQueue->PushStorageFilter(&NewFilter));
+	}
+#endif
+
+	return d3d12Device2;
+}
+
+void CD3D12RenderDevice::CreateRootSignature()
+{
+	CD3DX12_DESCRIPTOR_RANGE1 ranges[1];
+	ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+
+	CD3DX12_ROOT_PARAMETER1 rootParameters[1];
+	rootParameters[0].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_PIXEL);
+
+	D3D12_STATIC_SAMPLER_DESC sampler = {};
+	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+	sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+	sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+	sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+	sampler.MipLODBias = 0;
+	sampler.MaxAnisotropy = 0;
+	sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+	sampler.MinLOD = 0.0f;
+	sampler.MaxLOD = D3D12_FLOAT32_MAX;
+	sampler.ShaderRegister = 0;
+	sampler.RegisterSpace = 0;
+	sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(1, (const D3D12_ROOT_PARAMETER *)&rootParameters[0], 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	ComPtr<ID3DBlob> signature;
+	ComPtr<ID3DBlob> error;
+	ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
+	ThrowIfFailed(mDevice->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&mRootSignature)));
+}
+
+std::unique_ptr<IRenderQueue> CD3D12RenderDevice::CreateQueue(ERenderQueueType type)
+{
+	std::unique_ptr<CD3D12Queue> queue(new CD3D12Queue());
+	queue->mType = type;
+
+	D3D12_COMMAND_QUEUE_DESC desc = {};
+	desc.Type = ToD3D12ListType(type);
+	desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	desc.NodeMask = 0;
+
+	ThrowIfFailed(mDevice->CreateCommandQueue(&desc, IID_PPV_ARGS(&queue->mQueue)));
+
+	return queue;
+}
+
+std::unique_ptr<IRenderFence> CD3D12RenderDevice::CreateFence()
+{
+	std::unique_ptr<CD3D12Fence> fence(new CD3D12Fence());
+	fence->mOwnedFence.reset(new FD3D12Fence());
+	// Only used through IRenderQueue, which signals it on its own queue.
+	fence->mOwnedFence->Initialize(mDevice.Get(), nullptr);
+	fence->mFence = fence->mOwnedFence.get();
+	return fence;
+}
+
+void CD3D12RenderDevice::WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count)
+{
+	FD3D12Fence* d3d12Fences[MAXIMUM_WAIT_OBJECTS];
+	assert(count <= MAXIMUM_WAIT_OBJECTS);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		d3d12Fences[i] = static_cast<CD3D12Fence*>(fences[i])->mFence;
+	}
+	FD3D12Fence::WaitForValues(d3d12Fences, values, count);
+}
+
+std::shared_ptr<IRenderCommandAllocator> CD3D12RenderDevice::CreateCommandAllocator(ERenderQueueType type)
+{
+	std::shared_ptr<CD3D12CommandAllocator> allocator = std::make_shared<CD3D12CommandAllocator>();
+	ThrowIfFailed(mDevice->CreateCommandAllocator(ToD3D12ListType(type), IID_PPV_ARGS(&allocator->mAllocator)));
+	return allocator;
+}
+
+std::unique_ptr<IRenderCommandList> CD3D12RenderDevice::CreateCommandList(ERenderQueueType type,
+	IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+{
+	std::unique_ptr<CD3D12CommandList> commandList(new CD3D12CommandList());
+	commandList->mType = type;
+
+	ID3D12PipelineState* initialState = pipeline ? static_cast<CD3D12Pipeline*>(pipeline)->mPipelineState.Get() : nullptr;
+	ThrowIfFailed(mDevice->CreateCommandList(0, ToD3D12ListType(type),
+		static_cast<CD3D12CommandAllocator*>(allocator)->mAllocator.Get(), initialState, IID_PPV_ARGS(&commandList->mList)));
+
+	ThrowIfFailed(commandList->mList->Close());
+
+	return commandList;
+}
+
+ComPtr<ID3D12Resource> CD3D12RenderDevice::CreateResource(D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType,
+	D3D12_RESOURCE_STATES state, CD3D12HeapAllocator::FAllocation& allocation)
+{
+	FD3D12HeapKind kind = { heapType, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES };
+	bool renderTarget = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+	if (heapType != D3D12_HEAP_TYPE_DEFAULT)
+	{
+		// CPU-visible heaps only ever hold buffers here.
+		kind.mFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	}
+	else if (mResourceHeapTier == D3D12_RESOURCE_HEAP_TIER_1)
+	{
+		kind.mFlags = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS :
+			renderTarget ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	}
+
+	// Small textures may take 4 KB instead of 64 KB; the runtime says whether this one can.
+	D3D12_RESOURCE_ALLOCATION_INFO info = {};
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && !renderTarget && desc.SampleDesc.Count == 1)
+	{
+		desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+		if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			desc.Alignment = 0;
+			info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+		}
+	}
+	else
+	{
+		info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+	}
+
+	ComPtr<ID3D12Resource> resource;
+	allocation = CD3D12HeapAllocator::FAllocation();
+	if (info.Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+	{
+		allocation = mHeapAllocator->Allocate(kind, info.SizeInBytes, info.Alignment);
+	}
+
+	if (!allocation.IsValid())
+	{
+		desc.Alignment = 0;
+		CD3DX12_HEAP_PROPERTIES heapProperties(heapType);
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			state,
+			nullptr,
+			IID_PPV_ARGS(&resource)));
+		return resource;
+	}
+
+	HRESULT hr = mDevice->CreatePlacedResource(allocation.mHeap->mHeap.Get(), allocation.mOffset, &desc, state,
+		nullptr, IID_PPV_ARGS(&resource));
+	if (FAILED(hr))
+	{
+		mHeapAllocator->Free(allocation);
+		ThrowIfFailed(hr);
+	}
+	return resource;
+}
+
+std::shared_ptr<IRenderResource> CD3D12RenderDevice::CreateUploadBuffer(uint64_t size)
+{
+	std::shared_ptr<CD3D12Resource> buffer = std::make_shared<CD3D12Resource>();
+
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	buffer->mResource = CreateResource(bufferDesc, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ,
+		buffer->mAllocation);
+	buffer->mHeapAllocator = mHeapAllocator.get();
+
+	// Upload heaps may stay mapped for their whole lifetime.
+	CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
+	ThrowIfFailed(buffer->mResource->Map(0, &readRange, &buffer->mCPU));
+	return buffer;
+}
+
+std::shared_ptr<IRenderResource> CD3D12RenderDevice::CreateBuffer(uint64_t size)
+{
+	std::shared_ptr<CD3D12Resource> buffer = std::make_shared<CD3D12Resource>();
+
+	// Buffers are promoted implicitly, so Common serves both the copy and the draws.
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	buffer->mResource = CreateResource(bufferDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON,
+		buffer->mAllocation);
+	buffer->mHeapAllocator = mHeapAllocator.get();
+	return buffer;
+}
+
+std::shared_ptr<IRenderResource> CD3D12RenderDevice::CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format)
+{
+	std::shared_ptr<CD3D12Resource> texture = std::make_shared<CD3D12Resource>();
+
+	// Describe and create a Texture2D.
+	D3D12_RESOURCE_DESC textureDesc = {};
+	textureDesc.MipLevels = static_cast<UINT16>(mipLevels);
+	textureDesc.Format = ToDXGIFormat(format);
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	textureDesc.DepthOrArraySize = 1;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+	texture->mResource = CreateResource(textureDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON,
+		texture->mAllocation);
+	texture->mHeapAllocator = mHeapAllocator.get();
+	return texture;
+}
+
+std::shared_ptr<IRenderResource> CD3D12RenderDevice::CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format)
+{
+	std::shared_ptr<CD3D12Resource> target = std::make_shared<CD3D12Resource>();
+
+	CD3DX12_RESOURCE_DESC targetDesc = CD3DX12_RESOURCE_DESC::Tex2D(ToDXGIFormat(format), width, height, 1, 1, 1, 0,
+		D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+	target->mResource = CreateResource(targetDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON,
+		target->mAllocation);
+	target->mHeapAllocator = mHeapAllocator.get();
+	target->mNeedsDiscard = target->mAllocation.IsValid();
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = 1;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	ThrowIfFailed(mDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&target->mRTVHeap)));
+
+	target->mRTV = target->mRTVHeap->GetCPUDescriptorHandleForHeapStart();
+	mDevice->CreateRenderTargetView(target->mResource.Get(), nullptr, target->mRTV);
+	return target;
+}
+
+std::vector<uint8_t> CD3D12RenderDevice::CompileShader(const std::wstring& path, const char* target)
+{
+#if defined(_DEBUG)
+	// Enable better shader debugging with the graphics debugging tools.
+	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT compileFlags = 0;
+#endif
+
+	ComPtr<ID3DBlob> blob;
+	ThrowIfFailed(D3DCompileFromFile(path.c_str(), nullptr, nullptr, "main", target, compileFlags, 0, &blob, nullptr));
+
+	const uint8_t* bytecode = static_cast<const uint8_t*>(blob->GetBufferPointer());
+	return std::vector<uint8_t>(bytecode, bytecode + blob->GetBufferSize());
+}
+
+std::unique_ptr<IRenderPipeline> CD3D12RenderDevice::CreatePipeline(const FRenderPipelineDesc& desc)
+{
+	std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs(desc.mVertexElementCount);
+	for (uint32_t i = 0; i < desc.mVertexElementCount; ++i)
+	{
+		const FRenderVertexElement& element = desc.mVertexElements[i];
+		D3D12_INPUT_ELEMENT_DESC inputElementDesc = { element.mSemantic, 0, ToDXGIFormat(element.mFormat), 0, element.mOffset,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+		inputElementDescs[i] = inputElementDesc;
+	}
+
+	std::unique_ptr<CD3D12Pipeline> pipeline(new CD3D12Pipeline());
+	pipeline->mRootSignature = mRootSignature;
+
+	// Describe and create the graphics pipeline state object (PSO).
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.InputLayout = { inputElementDescs.data(), desc.mVertexElementCount };
+	psoDesc.pRootSignature = mRootSignature.Get();
+	psoDesc.VS = { desc.mVertexShader->data(), desc.mVertexShader->size() };
+	psoDesc.PS = { desc.mPixelShader->data(), desc.mPixelShader->size() };
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.DepthStencilState.DepthEnable = FALSE;
+	psoDesc.DepthStencilState.StencilEnable = FALSE;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = ToDXGIFormat(desc.mRenderTargetFormat);
+	psoDesc.SampleDesc.Count = 1;
+
+	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline->mPipelineState)));
+	return pipeline;
+}
+
+std::unique_ptr<IRenderSwapChain> CD3D12RenderDevice::CreateSwapChain(IRenderQueue* presentQueue, void* window,
+	uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	std::unique_ptr<CD3D12SwapChain> swapChain(new CD3D12SwapChain());
+	swapChain->mTearingSupported = mTearingSupported;
+	swapChain->mDevice = this;
+	swapChain->mPresentQueue = static_cast<CD3D12Queue*>(presentQueue)->mQueue.Get();
+
+	ComPtr<IDXGIFactory4> dxgiFactory4;
+	UINT createFactoryFlags = 0;
+#if defined(_DEBUG)
+	createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
+#endif
+
+	ThrowIfFailed(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory4)));
+
+	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+	swapChainDesc.Width = width;
+	swapChainDesc.Height = height;
+	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	swapChainDesc.Stereo = FALSE;
+	swapChainDesc.SampleDesc = { 1, 0 };
+	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	swapChainDesc.BufferCount = bufferCount;
+	swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
+	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	// It is recommended to always allow tearing if tearing support is available.
+	swapChainDesc.Flags = mTearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+	if (lowLatency)
+	{
+		swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	}
+
+	ComPtr<IDXGISwapChain1> swapChain1;
+	ThrowIfFailed(dxgiFactory4->CreateSwapChainForHwnd(
+		static_cast<CD3D12Queue*>(presentQueue)->mQueue.Get(),
+		hWnd,
+		&swapChainDesc,
+		nullptr,
+		nullptr,
+		&swapChain1));
+
+	// Disable the Alt+Enter fullscreen toggle feature. Switching to fullscreen
+	// will be handled manually.
+	ThrowIfFailed(dxgiFactory4->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER));
+
+	ThrowIfFailed(swapChain1.As(&swapChain->mSwapChain));
+
+	if (lowLatency)
+	{
+		// Allow a single queued frame; the waitable starts signalled once per allowed frame.
+		ThrowIfFailed(swapChain->mSwapChain->SetMaximumFrameLatency(1));
+		swapChain->mFrameLatencyWaitable = swapChain->mSwapChain->GetFrameLatencyWaitableObject();
+	}
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = bufferCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	ThrowIfFailed(mDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&swapChain->mRTVDescriptorHeap)));
+
+	UINT rtvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(swapChain->mRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+
+	for (uint32_t i = 0; i < bufferCount; ++i)
+	{
+		std::unique_ptr<CD3D12Resource> backBuffer(new CD3D12Resource());
+		ThrowIfFailed(swapChain->mSwapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer->mResource)));
+
+		mDevice->CreateRenderTargetView(backBuffer->mResource.Get(), nullptr, rtvHandle);
+		backBuffer->mRTV = rtvHandle;
+
+		swapChain->mBackBuffers.push_back(std::move(backBuffer));
+
+		rtvHandle.Offset(rtvDescriptorSize);
+	}
+
+	return swapChain;
+}
+
+std::unique_ptr<IRenderUploadQueue> CD3D12RenderDevice::CreateUploadQueue(CJobSystem* copyJobs)
+{
+	std::unique_ptr<CD3D12UploadQueue> uploadQueue(new CD3D12UploadQueue());
+	uploadQueue->Initialize(mDevice, *mFootprintCache, copyJobs);
+	return uploadQueue;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "DXSampleHelper.h"
+#include "RenderDevice.h"
+#include "D3D12Fence.h"
+#include "D3D12FootprintCache.h"
+#include "D3D12HeapAllocator.h"
+
+// IRenderDevice on a D3D12 device. Every pipeline shares one root signature (a pixel-shader
+// SRV table and a static point sampler); swap chain back buffers carry their own RTVs.
+//
+// Resources are placed into heaps shared through mHeapAllocator; only those too large for a
+// heap become committed resources. A destroyed resource's block is retired until the end of
+// the frame it was destroyed in has passed on the GPU (see RetireFrame), so without presents
+// blocks only come back when the device is destroyed.
+class CD3D12RenderDevice : public IRenderDevice
+{
+	ComPtr<ID3D12Device2> mDevice;
+	ComPtr<ID3D12RootSignature> mRootSignature;
+	bool mTearingSupported;
+	D3D12_RESOURCE_HEAP_TIER mResourceHeapTier;
+	std::unique_ptr<CD3D12HeapAllocator> mHeapAllocator;
+	// Signalled at every present; retired heap blocks wait for its next value.
+	FD3D12Fence mRetireFence;
+	uint64_t mRetireValue;
+	// Shared by every upload queue of the device.
+	std::unique_ptr<CD3D12FootprintCache> mFootprintCache;
+
+	bool CheckTearingSupport();
+	ComPtr<IDXGIAdapter4> GetAdapter(bool useWarp);
+	ComPtr<ID3D12Device2> CreateDevice(ComPtr<IDXGIAdapter4> adapter);
+	void CreateRootSignature();
+	// Places the resource in a shared heap, or commits it when it does not fit one;
+	// allocation is left invalid then.
+	ComPtr<ID3D12Resource> CreateResource(D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType,
+		D3D12_RESOURCE_STATES state, CD3D12HeapAllocator::FAllocation& allocation);
+
+public:
+	// useWarp picks the WARP software adapter instead of the hardware one with the most memory.
+	explicit CD3D12RenderDevice(bool useWarp);
+	virtual ~CD3D12RenderDevice();
+
+	// Swap chains call this after each present: signals the retire fence on presentQueue and
+	// returns the heap blocks whose frames have completed.
+	void RetireFrame(ID3D12CommandQueue* presentQueue);
+
+	virtual std::unique_ptr<IRenderQueue> CreateQueue(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderFence> CreateFence();
+	virtual void WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count);
+
+	virtual std::shared_ptr<IRenderCommandAllocator> CreateCommandAllocator(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderCommandList> CreateCommandList(ERenderQueueType type,
+		IRenderCommandAllocator* allocator, IRenderPipeline* pipeline);
+
+	virtual std::shared_ptr<IRenderResource> CreateUploadBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format);
+	virtual std::shared_ptr<IRenderResource> CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format);
+
+	virtual std::vector<uint8_t> CompileShader(const std::wstring& path, const char* target);
+	virtual std::unique_ptr<IRenderPipeline> CreatePipeline(const FRenderPipelineDesc& desc);
+
+	virtual std::unique_ptr<IRenderSwapChain> CreateSwapChain(IRenderQueue* presentQueue, void* window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency);
+
+	virtual std::unique_ptr<IRenderUploadQueue> CreateUploadQueue(CJobSystem* copyJobs);
+
+	ID3D12Device2* GetDevice() const { return mDevice.Get(); }
+	FGPUHeapAllocatorStats GetHeapStats() const { return mHeapAllocator->GetStats(); }
+};
@@ -0,0 +1,257 @@
+#include "DDSTexture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	// Byte offsets of the fields used, from the start of the file (after the "DDS " magic
+	// comes DDS_HEADER, then DDS_HEADER_DXT10 when the four-character code is DX10).
+	const size_t HeaderSizeOffset = 4;
+	const size_t HeaderFlagsOffset = 8;
+	const size_t HeightOffset = 12;
+	const size_t WidthOffset = 16;
+	const size_t MipCountOffset = 28;
+	const size_t PixelFormatSizeOffset = 76;
+	const size_t PixelFormatFlagsOffset = 80;
+	const size_t FourCCOffset = 84;
+	const size_t RGBBitCountOffset = 88;
+	const size_t RedMaskOffset = 92;
+	const size_t GreenMaskOffset = 96;
+	const size_t BlueMaskOffset = 100;
+	const size_t AlphaMaskOffset = 104;
+	const size_t Caps2Offset = 112;
+	const size_t HeaderEnd = 128;
+
+	const size_t DXGIFormatOffset = 128;
+	const size_t ResourceDimensionOffset = 132;
+	const size_t MiscFlagOffset = 136;
+	const size_t ArraySizeOffset = 140;
+	const size_t DX10HeaderEnd = 148;
+
+	const uint32_t Magic = 0x20534444;              // "DDS "
+	const uint32_t HeaderMipCount = 0x20000;        // DDSD_MIPMAPCOUNT
+	const uint32_t PixelFormatFourCC = 0x4;         // DDPF_FOURCC
+	const uint32_t PixelFormatRGB = 0x40;           // DDPF_RGB
+	const uint32_t Caps2CubeMap = 0x200;
+	const uint32_t Caps2AllFaces = 0xfc00;
+	const uint32_t Caps2Volume = 0x200000;
+	const uint32_t ResourceDimensionTexture1D = 2;  // D3D10_RESOURCE_DIMENSION
+	const uint32_t ResourceDimensionTexture2D = 3;
+	const uint32_t MiscFlagTextureCube = 0x4;
+
+	// D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION and D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION.
+	const uint32_t MaxDimension = 16384;
+	const uint32_t MaxArraySize = 2048;
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a)) | static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24;
+	}
+
+	// DDS is little-endian, as is every target of the sample.
+	uint32_t ReadUint32(const uint8_t* data, size_t offset)
+	{
+		uint32_t value;
+		memcpy(&value, data + offset, sizeof(value));
+		return value;
+	}
+
+	ERenderFormat FromDXGIFormat(uint32_t format)
+	{
+		switch (format)
+		{
+		case 28:  return ERenderFormat::RGBA8Unorm;       // DXGI_FORMAT_R8G8B8A8_UNORM
+		case 29:  return ERenderFormat::RGBA8UnormSrgb;
+		case 71:  return ERenderFormat::BC1Unorm;         // DXGI_FORMAT_BC1_UNORM
+		case 72:  return ERenderFormat::BC1UnormSrgb;
+		case 74:  return ERenderFormat::BC2Unorm;
+		case 75:  return ERenderFormat::BC2UnormSrgb;
+		case 77:  return ERenderFormat::BC3Unorm;
+		case 78:  return ERenderFormat::BC3UnormSrgb;
+		case 80:  return ERenderFormat::BC4Unorm;
+		case 81:  return ERenderFormat::BC4Snorm;
+		case 83:  return ERenderFormat::BC5Unorm;
+		case 84:  return ERenderFormat::BC5Snorm;
+		case 95:  return ERenderFormat::BC6HUfloat;
+		case 96:  return ERenderFormat::BC6HSfloat;
+		case 98:  return ERenderFormat::BC7Unorm;
+		case 99:  return ERenderFormat::BC7UnormSrgb;
+		default:  return ERenderFormat::Unknown;
+		}
+	}
+
+	ERenderFormat FromFourCC(uint32_t fourCC)
+	{
+		switch (fourCC)
+		{
+		case MakeFourCC('D', 'X', 'T', '1'):  return ERenderFormat::BC1Unorm;
+		// Premultiplied alpha is not tracked; DXT2 and DXT4 load as DXT3 and DXT5.
+		case MakeFourCC('D', 'X', 'T', '2'):
+		case MakeFourCC('D', 'X', 'T', '3'):  return ERenderFormat::BC2Unorm;
+		case MakeFourCC('D', 'X', 'T', '4'):
+		case MakeFourCC('D', 'X', 'T', '5'):  return ERenderFormat::BC3Unorm;
+		case MakeFourCC('A', 'T', 'I', '1'):
+		case MakeFourCC('B', 'C', '4', 'U'):  return ERenderFormat::BC4Unorm;
+		case MakeFourCC('B', 'C', '4', 'S'):  return ERenderFormat::BC4Snorm;
+		case MakeFourCC('A', 'T', 'I', '2'):
+		case MakeFourCC('B', 'C', '5', 'U'):  return ERenderFormat::BC5Unorm;
+		case MakeFourCC('B', 'C', '5', 'S'):  return ERenderFormat::BC5Snorm;
+		default:                              return ERenderFormat::Unknown;
+		}
+	}
+
+	uint32_t GetLevelSize(uint32_t size, uint32_t mip)
+	{
+		return std::max(size >> mip, 1u);
+	}
+}
+
+void ParseDDS(const uint8_t* data, size_t size, FDDSTexture& texture)
+{
+	if (size < HeaderEnd || ReadUint32(data, 0) != Magic || ReadUint32(data, HeaderSizeOffset) != 124 ||
+		ReadUint32(data, PixelFormatSizeOffset) != 32)
+	{
+		throw std::runtime_error("Not a DDS file");
+	}
+
+	texture = FDDSTexture();
+	texture.mWidth = ReadUint32(data, WidthOffset);
+	texture.mHeight = ReadUint32(data, HeightOffset);
+	texture.mMipLevels = ReadUint32(data, HeaderFlagsOffset) & HeaderMipCount ? ReadUint32(data, MipCountOffset) : 1;
+	texture.mMipLevels = std::max(texture.mMipLevels, 1u);
+	texture.mArraySize = 1;
+
+	uint32_t pixelFormatFlags = ReadUint32(data, PixelFormatFlagsOffset);
+	uint32_t fourCC = ReadUint32(data, FourCCOffset);
+	uint32_t caps2 = ReadUint32(data, Caps2Offset);
+	size_t dataOffset = HeaderEnd;
+
+	if (pixelFormatFlags & PixelFormatFourCC && fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < DX10HeaderEnd)
+		{
+			throw std::runtime_error("DDS file truncated");
+		}
+		uint32_t dimension = ReadUint32(data, ResourceDimensionOffset);
+		if (dimension != ResourceDimensionTexture1D && dimension != ResourceDimensionTexture2D)
+		{
+			throw std::runtime_error("DDS volume textures are not supported");
+		}
+		texture.mFormat = FromDXGIFormat(ReadUint32(data, DXGIFormatOffset));
+		texture.mArraySize = ReadUint32(data, ArraySizeOffset);
+		texture.mCubeMap = (ReadUint32(data, MiscFlagOffset) & MiscFlagTextureCube) != 0;
+		if (dimension == ResourceDimensionTexture1D)
+		{
+			texture.mHeight = 1;
+		}
+		dataOffset = DX10HeaderEnd;
+	}
+	else
+	{
+		if (caps2 & Caps2Volume)
+		{
+			throw std::runtime_error("DDS volume textures are not supported");
+		}
+		if (caps2 & Caps2CubeMap)
+		{
+			// Cube maps missing faces have no D3D12 equivalent.
+			if ((caps2 & Caps2AllFaces) != Caps2AllFaces)
+			{
+				throw std::runtime_error("DDS cube map without all six faces");
+			}
+			texture.mCubeMap = true;
+		}
+
+		if (pixelFormatFlags & PixelFormatFourCC)
+		{
+			texture.mFormat = FromFourCC(fourCC);
+		}
+		else if (pixelFormatFlags & PixelFormatRGB && ReadUint32(data, RGBBitCountOffset) == 32 &&
+			ReadUint32(data, RedMaskOffset) == 0x000000ff && ReadUint32(data, GreenMaskOffset) == 0x0000ff00 &&
+			ReadUint32(data, BlueMaskOffset) == 0x00ff0000 && ReadUint32(data, AlphaMaskOffset) == 0xff000000)
+		{
+			texture.mFormat = ERenderFormat::RGBA8Unorm;
+		}
+	}
+
+	if (texture.mFormat == ERenderFormat::Unknown)
+	{
+		throw std::runtime_error("DDS format not supported");
+	}
+	if (texture.mWidth == 0 || texture.mHeight == 0 || texture.mWidth > MaxDimension || texture.mHeight > MaxDimension ||
+		texture.mArraySize == 0 || texture.mArraySize > MaxArraySize)
+	{
+		throw std::runtime_error("DDS size not supported");
+	}
+	uint32_t fullChain = 1;
+	while ((std::max(texture.mWidth, texture.mHeight) >> fullChain) != 0)
+	{
+		++fullChain;
+	}
+	if (texture.mMipLevels > fullChain)
+	{
+		throw std::runtime_error("DDS has more mip levels than its size allows");
+	}
+	if (texture.mCubeMap)
+	{
+		if (texture.mArraySize > MaxArraySize / 6)
+		{
+			throw std::runtime_error("DDS size not supported");
+		}
+		texture.mArraySize *= 6;
+	}
+
+	// Slice after slice, each with its full chain: the same order as D3D12 subresources.
+	uint64_t offset = dataOffset;
+	texture.mSubresources.resize(static_cast<size_t>(texture.mArraySize) * texture.mMipLevels);
+	for (uint32_t slice = 0; slice < texture.mArraySize; ++slice)
+	{
+		for (uint32_t mip = 0; mip < texture.mMipLevels; ++mip)
+		{
+			FDDSSubresource& subresource = texture.mSubresources[mip + slice * texture.mMipLevels];
+			subresource.mOffset = offset;
+			subresource.mWidth = GetLevelSize(texture.mWidth, mip);
+			subresource.mHeight = GetLevelSize(texture.mHeight, mip);
+			subresource.mRowPitch = static_cast<uint32_t>(GetFormatRowBytes(texture.mFormat, subresource.mWidth));
+			subresource.mNumRows = GetFormatRowCount(texture.mFormat, subresource.mHeight);
+			subresource.mSlicePitch = static_cast<uint64_t>(subresource.mRowPitch) * subresource.mNumRows;
+			offset += subresource.mSlicePitch;
+		}
+	}
+	if (offset > size)
+	{
+		throw std::runtime_error("DDS file truncated");
+	}
+}
+
+uint64_t GetTextureFootprints(ERenderFormat format, uint32_t width, uint32_t height, uint32_t mipLevels,
+	uint32_t first, uint32_t count, FTextureFootprint* footprints)
+{
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+	const uint64_t PlacementAlignment = 512;
+	const uint64_t PitchAlignment = 256;
+	uint32_t blockSize = IsBlockCompressed(format) ? 4 : 1;
+
+	uint64_t offset = 0;
+	uint64_t totalSize = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t mip = (first + i) % mipLevels;
+		FTextureFootprint& footprint = footprints[i];
+		offset = (offset + PlacementAlignment - 1) & ~(PlacementAlignment - 1);
+		footprint.mOffset = offset;
+		footprint.mWidth = (GetLevelSize(width, mip) + blockSize - 1) / blockSize * blockSize;
+		footprint.mHeight = (GetLevelSize(height, mip) + blockSize - 1) / blockSize * blockSize;
+		footprint.mRowSize = GetFormatRowBytes(format, footprint.mWidth);
+		footprint.mRowPitch = static_cast<uint32_t>((footprint.mRowSize + PitchAlignment - 1) & ~(PitchAlignment - 1));
+		footprint.mNumRows = GetFormatRowCount(format, footprint.mHeight);
+
+		// The last row carries no padding.
+		totalSize = offset + static_cast<uint64_t>(footprint.mRowPitch) * (footprint.mNumRows - 1) + footprint.mRowSize;
+		offset += static_cast<uint64_t>(footprint.mRowPitch) * footprint.mNumRows;
+	}
+	return totalSize;
+}
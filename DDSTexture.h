@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+// Where one subresource's texels sit in the file, tightly packed: mNumRows rows (of 4x4
+// blocks, when block-compressed) of mRowPitch bytes.
+struct FDDSSubresource
+{
+	uint64_t mOffset;       // From the start of the file.
+	uint32_t mWidth;        // In texels.
+	uint32_t mHeight;
+	uint32_t mRowPitch;
+	uint32_t mNumRows;
+	uint64_t mSlicePitch;   // mRowPitch * mNumRows.
+};
+
+// A 2D texture, texture array or cube map described by a DDS file. Subresources are in D3D12
+// order, mip + slice * mMipLevels, which is also the order of the file; a cube map is an
+// array of six faces per cube.
+struct FDDSTexture
+{
+	ERenderFormat mFormat = ERenderFormat::Unknown;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mMipLevels = 0;
+	uint32_t mArraySize = 0;
+	bool mCubeMap = false;
+	std::vector<FDDSSubresource> mSubresources;
+};
+
+// Reads the headers of the DDS file in data and lays out its subresources; the texels are
+// not touched, so data can be a mapping of the file (see CMappedFile). Understands the DX10
+// header with BC1-BC7 and RGBA8 formats, the legacy DXT1-5, ATI1/2 and BC4/5 four-character
+// codes, and legacy 32-bit RGBA. Throws std::runtime_error for anything else (volume
+// textures, typeless or other formats, sizes beyond the D3D12 limits) or when the file is too
+// short for what the header describes.
+void ParseDDS(const uint8_t* data, size_t size, FDDSTexture& texture);
+
+// One subresource as it is placed in an upload buffer.
+struct FTextureFootprint
+{
+	uint64_t mOffset;       // From the start of the first subresource.
+	uint32_t mWidth;        // Rounded up to whole blocks when block-compressed.
+	uint32_t mHeight;
+	uint32_t mRowPitch;     // Aligned to 256 bytes.
+	uint32_t mNumRows;
+	uint64_t mRowSize;      // Bytes of texels in each row, without the padding.
+};
+
+// The layouts GetCopyableFootprints gives for subresources [first, first + count) of a 2D
+// texture (array): subresources 512-byte aligned one after the other, rows 256-byte aligned.
+// Returns the total size as GetCopyableFootprints does: up to the end of the last row.
+uint64_t GetTextureFootprints(ERenderFormat format, uint32_t width, uint32_t height, uint32_t mipLevels,
+	uint32_t first, uint32_t count, FTextureFootprint* footprints);
@@ -20,7 +20,14 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name) :
     m_width(width),
     m_height(height),
     m_title(name),
-    m_useWarpDevice(false)
+    m_useWarpDevice(false),
+    m_framesInFlight(3),
+    m_pacingMode(EFramePacingMode::VSync),
+    m_targetFrameRate(60.0),
+    m_lowLatency(false),
+    m_recordThreads(1),
+    m_pipelined(false),
+    m_adaptivePresent(true)
 {
     WCHAR assetsPath[512];
     GetAssetsPath(assetsPath, _countof(assetsPath));
@@ -89,5 +96,66 @@ void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
             m_useWarpDevice = true;
             m_title = m_title + L" (WARP)";
         }
+        else if ((_wcsnicmp(argv[i], L"-frames", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/frames", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            int frames = _wtoi(argv[++i]);
+            m_framesInFlight = frames > 0 ? static_cast<UINT>(frames) : 1;
+        }
+        else if ((_wcsnicmp(argv[i], L"-fps", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/fps", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            double fps = _wtof(argv[++i]);
+            m_pacingMode = fps > 0.0 ? EFramePacingMode::FixedRate : EFramePacingMode::Uncapped;
+            m_targetFrameRate = fps;
+        }
+        else if (_wcsnicmp(argv[i], L"-uncapped", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/uncapped", wcslen(argv[i])) == 0)
+        {
+            m_pacingMode = EFramePacingMode::Uncapped;
+        }
+        else if (_wcsnicmp(argv[i], L"-lowlatency", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/lowlatency", wcslen(argv[i])) == 0)
+        {
+            m_lowLatency = true;
+        }
+        else if ((_wcsnicmp(argv[i], L"-recordthreads", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/recordthreads", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            int threads = _wtoi(argv[++i]);
+            m_recordThreads = threads > 0 ? static_cast<UINT>(threads) : 1;
+        }
+        else if (_wcsnicmp(argv[i], L"-pipelined", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/pipelined", wcslen(argv[i])) == 0)
+        {
+            m_pipelined = true;
+        }
+        else if (_wcsnicmp(argv[i], L"-fixedvsync", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/fixedvsync", wcslen(argv[i])) == 0)
+        {
+            m_adaptivePresent = false;
+        }
+        else if ((_wcsnicmp(argv[i], L"-fencewait", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/fencewait", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            ++i;
+            if (_wcsicmp(argv[i], L"adaptive") == 0)
+            {
+                m_fenceWaitPolicy = FFenceWaitPolicy::Adaptive();
+            }
+            else if (_wcsicmp(argv[i], L"block") == 0)
+            {
+                m_fenceWaitPolicy = FFenceWaitPolicy::Block();
+            }
+            else
+            {
+                m_fenceWaitPolicy = FFenceWaitPolicy::Spin(_wtoi(argv[i]) * 1000ll);
+            }
+        }
+        else if ((_wcsnicmp(argv[i], L"-capture", wcslen(argv[i])) == 0 ||
+            _wcsnicmp(argv[i], L"/capture", wcslen(argv[i])) == 0) && i + 1 < argc)
+        {
+            m_capturePath = argv[++i];
+        }
     }
 }
@@ -13,6 +13,8 @@
 
 #include "DXSampleHelper.h"
 #include "Win32Application.h"
+#include "FramePacer.h"
+#include "FenceWaitPolicy.h"
 
 class DXSample
 {
@@ -21,6 +23,9 @@ public:
     virtual ~DXSample();
 
     virtual void OnInit() = 0;
+    // Called by the frame loop before OnUpdate. Samples block here until the GPU can
+    // accept another frame, so that input is sampled as late as possible.
+    virtual void OnBeginFrame()     {}
     virtual void OnUpdate() = 0;
     virtual void OnRender() = 0;
     virtual void OnDestroy() = 0;
@@ -33,6 +38,16 @@ public:
     UINT GetWidth() const           { return m_width; }
     UINT GetHeight() const          { return m_height; }
     const WCHAR* GetTitle() const   { return m_title.c_str(); }
+    bool UseWarpDevice() const      { return m_useWarpDevice; }
+    UINT GetFramesInFlight() const  { return m_framesInFlight; }
+    EFramePacingMode GetPacingMode() const { return m_pacingMode; }
+    double GetTargetFrameRate() const { return m_targetFrameRate; }
+    bool IsLowLatency() const       { return m_lowLatency; }
+    UINT GetRecordThreadCount() const { return m_recordThreads; }
+    const std::wstring& GetCapturePath() const { return m_capturePath; }
+    bool IsPipelined() const        { return m_pipelined; }
+    const FFenceWaitPolicy& GetFenceWaitPolicy() const { return m_fenceWaitPolicy; }
+    bool IsAdaptivePresent() const  { return m_adaptivePresent; }
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
 
@@ -49,6 +64,31 @@ protected:
     // Adapter info.
     bool m_useWarpDevice;
 
+    // Number of frames the CPU may record ahead of the GPU ("-frames N").
+    UINT m_framesInFlight;
+
+    // Frame loop cadence: vsync by default, "-fps N" for a fixed rate, "-uncapped" for neither.
+    EFramePacingMode m_pacingMode;
+    double m_targetFrameRate;
+
+    // Use a frame-latency waitable swap chain ("-lowlatency").
+    bool m_lowLatency;
+
+    // Threads recording the scene's command lists ("-recordthreads N").
+    UINT m_recordThreads;
+
+    // Step the simulation on a thread of its own, pipelined with rendering ("-pipelined").
+    bool m_pipelined;
+
+    // Let vsync pacing fall back to tearing or half rate when frames miss vblanks; "-fixedvsync" keeps vsync.
+    bool m_adaptivePresent;
+
+    // CPU fence waits: "-fencewait block", "-fencewait adaptive" or "-fencewait <spin us>".
+    FFenceWaitPolicy m_fenceWaitPolicy;
+
+    // Command stream file to capture a frame into ("-capture file"); empty to not capture.
+    std::wstring m_capturePath;
+
 private:
     // Root assets path.
     std::wstring m_assetsPath;
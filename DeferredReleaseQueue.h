@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Keeps objects alive until the fence value of their last GPU use has completed, then drops
+// them a whole batch at a time. TObject is whatever owns the reference (ComPtr<...> for D3D12
+// objects); releasing is just destroying it.
+//
+// Objects can be retired against a value that was already signalled (Defer), or against the
+// next signal of the timeline when the work that uses them is still being recorded
+// (DeferToNextSignal, then OnSignal with the value once it is known).
+template<typename TObject>
+class CDeferredReleaseQueue
+{
+	struct FBatch
+	{
+		uint64_t mFenceValue;
+		std::vector<TObject> mObjects;
+	};
+
+	// Sorted by fence value. Only a few frames deep, so erasing from the front is cheap, and
+	// unlike a deque a vector stops allocating once it has grown.
+	std::vector<FBatch> mBatches;
+	std::vector<TObject> mPending;            // Waiting for OnSignal.
+	std::vector<std::vector<TObject>> mFreeLists;
+	size_t mObjectCount;
+	uint64_t mReleasedCount;
+
+	std::vector<TObject> AcquireList()
+	{
+		if (mFreeLists.empty())
+		{
+			return std::vector<TObject>();
+		}
+
+		std::vector<TObject> list = std::move(mFreeLists.back());
+		mFreeLists.pop_back();
+		return list;
+	}
+
+	FBatch& GetBatch(uint64_t fenceValue)
+	{
+		if (!mBatches.empty() && mBatches.back().mFenceValue == fenceValue)
+		{
+			return mBatches.back();
+		}
+
+		FBatch batch;
+		batch.mFenceValue = fenceValue;
+		batch.mObjects = AcquireList();
+
+		if (mBatches.empty() || mBatches.back().mFenceValue < fenceValue)
+		{
+			mBatches.push_back(std::move(batch));
+			return mBatches.back();
+		}
+
+		// Out of order (an older value retired late); keep the batches sorted.
+		auto it = mBatches.begin();
+		while (it->mFenceValue < fenceValue)
+		{
+			++it;
+		}
+		if (it->mFenceValue == fenceValue)
+		{
+			mFreeLists.push_back(std::move(batch.mObjects));
+			return *it;
+		}
+		return *mBatches.insert(it, std::move(batch));
+	}
+
+public:
+	CDeferredReleaseQueue() :
+		mObjectCount(0),
+		mReleasedCount(0)
+	{
+	}
+
+	~CDeferredReleaseQueue()
+	{
+		assert(mPending.empty() && "Objects deferred to a signal that never happened.");
+	}
+
+	CDeferredReleaseQueue(const CDeferredReleaseQueue&) = delete;
+	CDeferredReleaseQueue& operator=(const CDeferredReleaseQueue&) = delete;
+
+	// object is released once fenceValue has completed.
+	void Defer(TObject object, uint64_t fenceValue)
+	{
+		GetBatch(fenceValue).mObjects.push_back(std::move(object));
+		++mObjectCount;
+	}
+
+	// object is released once the next value passed to OnSignal has completed.
+	void DeferToNextSignal(TObject object)
+	{
+		mPending.push_back(std::move(object));
+		++mObjectCount;
+	}
+
+	// Call right after signalling; stamps everything deferred to this signal with its value.
+	void OnSignal(uint64_t fenceValue)
+	{
+		if (mPending.empty())
+		{
+			return;
+		}
+
+		FBatch& batch = GetBatch(fenceValue);
+		if (batch.mObjects.empty())
+		{
+			std::swap(batch.mObjects, mPending);
+		}
+		else
+		{
+			for (TObject& object : mPending)
+			{
+				batch.mObjects.push_back(std::move(object));
+			}
+			mPending.clear();
+		}
+	}
+
+	// Releases every batch whose value has completed. Returns how many objects went.
+	size_t Collect(uint64_t completedValue)
+	{
+		size_t released = 0;
+		size_t completed = 0;
+		while (completed < mBatches.size() && mBatches[completed].mFenceValue <= completedValue)
+		{
+			std::vector<TObject>& objects = mBatches[completed].mObjects;
+			released += objects.size();
+			objects.clear();
+			mFreeLists.push_back(std::move(objects));
+			++completed;
+		}
+		mBatches.erase(mBatches.begin(), mBatches.begin() + completed);
+
+		mObjectCount -= released;
+		mReleasedCount += released;
+		return released;
+	}
+
+	// For teardown, once the GPU is known to be idle.
+	void ReleaseAll()
+	{
+		Collect(UINT64_MAX);
+		mObjectCount -= mPending.size();
+		mReleasedCount += mPending.size();
+		mPending.clear();
+	}
+
+	size_t GetObjectCount() const      { return mObjectCount; }
+	size_t GetBatchCount() const       { return mBatches.size(); }
+	uint64_t GetReleasedCount() const  { return mReleasedCount; }
+	// Lowest fence value still holding objects, 0 when nothing is waiting on the GPU.
+	uint64_t GetOldestFenceValue() const
+	{
+		return mBatches.empty() ? 0 : mBatches.front().mFenceValue;
+	}
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "FenceWaitPolicy.h"
+
+struct FFenceTimelineStats
+{
+	uint64_t mSignalCount = 0;
+	uint64_t mCompletedQueries = 0;   // Round trips to the fence to read its completed value.
+	uint64_t mWaitCount = 0;          // Waits that found the value still pending.
+	int64_t mStallNs = 0;             // Time spent stalled in those waits.
+	int64_t mMaxStallNs = 0;
+	uint64_t mCallbacksRun = 0;
+	// Which phase of the wait policy saw each of those waits complete.
+	uint64_t mSpinWaits = 0;
+	uint64_t mYieldWaits = 0;
+	uint64_t mBlockingWaits = 0;
+	FStallHistogram mStallHistogram;
+};
+
+// Most distinct timelines one CFenceTimeline::WaitForAll covers: one per queue (direct,
+// compute, copy), with room to spare.
+const uint32_t MaxTimelinesPerWait = 8;
+
+// A monotonically increasing fence timeline: hands out signal values, caches the completed
+// value so repeated queries cost nothing once the GPU has caught up, runs callbacks registered
+// against a value when it retires, and accounts for the time the CPU spends stalled on it.
+//
+// Callbacks run on the thread that observes the completion (Poll, GetCompletedValue,
+// WaitForValue) and may register further callbacks. The timeline itself is not thread-safe.
+//
+// CPU waits follow an FFenceWaitPolicy (block by default) and land in the stall histogram.
+//
+// TFence is the GPU fence, e.g. an ID3D12Fence and its queue:
+//     uint64_t GetCompletedValue();
+//     void Signal(uint64_t value);       // queue-side signal
+//     void WaitForValue(uint64_t value); // blocks the calling thread
+//     static void WaitForValues(TFence* const* fences, const uint64_t* values, uint32_t count);
+//
+// Also satisfies the fence interface of CFrameContextRing.
+template<typename TFence>
+class CFenceTimeline
+{
+	struct FCallback
+	{
+		uint64_t mValue;
+		std::function<void()> mFunction;
+	};
+
+	TFence mFence;
+	uint64_t mLastSignaled;
+	uint64_t mCompleted;
+	std::deque<FCallback> mCallbacks;   // Sorted by value.
+	FFenceTimelineStats mStats;
+
+	FFenceWaitPolicy mWaitPolicy;
+	// Recent stalls for the adaptive policy; unlike the stats, never reset, only decayed.
+	FStallHistogram mRecentStalls;
+	static const uint64_t AdaptiveWindow = 256;
+
+	static int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void RunCallbacks()
+	{
+		while (!mCallbacks.empty() && mCallbacks.front().mValue <= mCompleted)
+		{
+			std::function<void()> function = std::move(mCallbacks.front().mFunction);
+			mCallbacks.pop_front();
+			function();
+			++mStats.mCallbacksRun;
+		}
+	}
+
+	void AddStall(int64_t stallNs, EFenceWaitPhase phase)
+	{
+		++mStats.mWaitCount;
+		mStats.mStallNs += stallNs;
+		mStats.mMaxStallNs = std::max(mStats.mMaxStallNs, stallNs);
+		mStats.mStallHistogram.Add(stallNs);
+
+		switch (phase)
+		{
+		case EFenceWaitPhase::Spin:     ++mStats.mSpinWaits; break;
+		case EFenceWaitPhase::Yield:    ++mStats.mYieldWaits; break;
+		case EFenceWaitPhase::Block:    ++mStats.mBlockingWaits; break;
+		}
+
+		if (mWaitPolicy.mAdaptive)
+		{
+			mRecentStalls.Add(stallNs);
+			if (mRecentStalls.mCount >= AdaptiveWindow)
+			{
+				mRecentStalls.Decay();
+			}
+
+			int64_t budgetNs = mRecentStalls.GetPercentileNs(mWaitPolicy.mAdaptivePercentile);
+			mWaitPolicy.mSpinNs = budgetNs <= mWaitPolicy.mMaxSpinNs ? budgetNs : 0;
+		}
+	}
+
+public:
+	CFenceTimeline() :
+		mLastSignaled(0),
+		mCompleted(0)
+	{
+	}
+
+	CFenceTimeline(const CFenceTimeline&) = delete;
+	CFenceTimeline& operator=(const CFenceTimeline&) = delete;
+
+	TFence& GetFence() { return mFence; }
+
+	void SetWaitPolicy(const FFenceWaitPolicy& policy)
+	{
+		mWaitPolicy = policy;
+		mRecentStalls = FStallHistogram();
+	}
+
+	// With an adaptive policy, mSpinNs is the current budget.
+	const FFenceWaitPolicy& GetWaitPolicy() const { return mWaitPolicy; }
+
+	// Signals the next value on the fence's queue and returns it.
+	uint64_t Signal()
+	{
+		uint64_t value = ++mLastSignaled;
+		mFence.Signal(value);
+		++mStats.mSignalCount;
+		return value;
+	}
+
+	uint64_t GetLastSignaledValue() const { return mLastSignaled; }
+
+	// Reads the fence and runs callbacks that became due. Free when nothing is outstanding.
+	uint64_t Poll()
+	{
+		if (mCompleted < mLastSignaled)
+		{
+			mCompleted = std::max(mCompleted, mFence.GetCompletedValue());
+			++mStats.mCompletedQueries;
+			RunCallbacks();
+		}
+		return mCompleted;
+	}
+
+	uint64_t GetCompletedValue()
+	{
+		return Poll();
+	}
+
+	// Only touches the fence if the cached value does not already answer the question.
+	bool IsComplete(uint64_t value)
+	{
+		return value <= mCompleted || value <= Poll();
+	}
+
+	// Runs function once value has completed; immediately if it already has.
+	void OnCompleted(uint64_t value, std::function<void()> function)
+	{
+		assert(value <= mLastSignaled && "Callback registered for a value that was never signalled.");
+
+		if (IsComplete(value))
+		{
+			function();
+			++mStats.mCallbacksRun;
+			return;
+		}
+
+		FCallback callback = { value, std::move(function) };
+		auto it = std::upper_bound(mCallbacks.begin(), mCallbacks.end(), value,
+			[](uint64_t v, const FCallback& c) { return v < c.mValue; });
+		mCallbacks.insert(it, std::move(callback));
+	}
+
+	void WaitForValue(uint64_t value)
+	{
+		assert(value <= mLastSignaled && "Waiting for a value that was never signalled.");
+
+		if (IsComplete(value))
+		{
+			return;
+		}
+
+		int64_t start = NowNs();
+		EFenceWaitPhase phase = WaitWithPolicy(mWaitPolicy,
+			[&]()
+			{
+				++mStats.mCompletedQueries;
+				return mFence.GetCompletedValue() >= value;
+			},
+			[&]() { mFence.WaitForValue(value); });
+		AddStall(NowNs() - start, phase);
+
+		mCompleted = std::max(mCompleted, value);
+		RunCallbacks();
+	}
+
+	void WaitIdle()
+	{
+		WaitForValue(mLastSignaled);
+	}
+
+	// Blocks once until every timeline has reached its value, instead of waiting on them one
+	// after another. A timeline may appear more than once; its largest value is used. The wait
+	// follows the policy of the first timeline still pending. At most MaxTimelinesPerWait
+	// distinct timelines; nothing is allocated.
+	static void WaitForAll(CFenceTimeline* const* timelines, const uint64_t* values, uint32_t count)
+	{
+		CFenceTimeline* pending[MaxTimelinesPerWait];
+		uint64_t pendingValues[MaxTimelinesPerWait];
+		TFence* fences[MaxTimelinesPerWait];
+		uint32_t pendingCount = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (timelines[i]->IsComplete(values[i]))
+			{
+				continue;
+			}
+
+			CFenceTimeline** it = std::find(pending, pending + pendingCount, timelines[i]);
+			if (it == pending + pendingCount)
+			{
+				assert(pendingCount < MaxTimelinesPerWait && "Too many timelines for one wait.");
+				pending[pendingCount] = timelines[i];
+				pendingValues[pendingCount] = values[i];
+				fences[pendingCount] = &timelines[i]->mFence;
+				++pendingCount;
+			}
+			else
+			{
+				uint64_t& value = pendingValues[it - pending];
+				value = std::max(value, values[i]);
+			}
+		}
+
+		if (pendingCount == 0)
+		{
+			return;
+		}
+
+		int64_t start = NowNs();
+		EFenceWaitPhase phase = WaitWithPolicy(pending[0]->mWaitPolicy,
+			[&]()
+			{
+				for (uint32_t i = 0; i < pendingCount; ++i)
+				{
+					++pending[i]->mStats.mCompletedQueries;
+					if (fences[i]->GetCompletedValue() < pendingValues[i])
+					{
+						return false;
+					}
+				}
+				return true;
+			},
+			[&]() { TFence::WaitForValues(fences, pendingValues, pendingCount); });
+		int64_t stallNs = NowNs() - start;
+
+		for (uint32_t i = 0; i < pendingCount; ++i)
+		{
+			pending[i]->AddStall(stallNs, phase);
+			pending[i]->mCompleted = std::max(pending[i]->mCompleted, pendingValues[i]);
+			pending[i]->RunCallbacks();
+		}
+	}
+
+	const FFenceTimelineStats& GetStats() const { return mStats; }
+	void ResetStats()                          { mStats = FFenceTimelineStats(); }
+};
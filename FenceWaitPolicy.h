@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// How a CPU wait on a fence spends its time before the value completes: poll in a busy loop
+// (lowest wake-up latency, burns a core), then poll yielding the thread between polls, then
+// block in the OS (cheapest, but the wake-up costs a reschedule). The default only blocks.
+struct FFenceWaitPolicy
+{
+	int64_t mSpinNs = 0;
+	int64_t mYieldNs = 0;
+
+	// Adaptive: after every wait, mSpinNs is set to the stall that mAdaptivePercentile of the
+	// recent waits finished within, or to 0 when that is over mMaxSpinNs and spinning would
+	// mostly burn the budget for nothing.
+	bool mAdaptive = false;
+	double mAdaptivePercentile = 0.75;
+	int64_t mMaxSpinNs = 200000;
+
+	static FFenceWaitPolicy Block()
+	{
+		return FFenceWaitPolicy();
+	}
+
+	static FFenceWaitPolicy Spin(int64_t spinNs, int64_t yieldNs = 0)
+	{
+		FFenceWaitPolicy policy;
+		policy.mSpinNs = spinNs;
+		policy.mYieldNs = yieldNs;
+		return policy;
+	}
+
+	static FFenceWaitPolicy Adaptive(int64_t maxSpinNs = 200000, int64_t yieldNs = 0)
+	{
+		FFenceWaitPolicy policy;
+		policy.mYieldNs = yieldNs;
+		policy.mAdaptive = true;
+		policy.mMaxSpinNs = maxSpinNs;
+		return policy;
+	}
+};
+
+enum class EFenceWaitPhase
+{
+	Spin,
+	Yield,
+	Block,
+};
+
+// Stall durations in power-of-two buckets: bucket 0 holds stalls under 1024ns, bucket i
+// those in [2^(i+9), 2^(i+10)) ns, the last one everything longer.
+struct FStallHistogram
+{
+	static const uint32_t BucketCount = 32;
+	static const uint32_t FirstBucketShift = 10;
+
+	uint64_t mBuckets[BucketCount] = {};
+	uint64_t mCount = 0;
+
+	static uint32_t GetBucket(int64_t ns)
+	{
+		uint32_t bucket = 0;
+		for (uint64_t bound = 1ull << FirstBucketShift; bucket + 1 < BucketCount && static_cast<uint64_t>(ns) >= bound; bound <<= 1)
+		{
+			++bucket;
+		}
+		return bucket;
+	}
+
+	// Exclusive upper bound of a bucket.
+	static int64_t GetBucketLimitNs(uint32_t bucket)
+	{
+		return static_cast<int64_t>(1ull << (FirstBucketShift + bucket));
+	}
+
+	void Add(int64_t ns)
+	{
+		++mBuckets[GetBucket(std::max<int64_t>(ns, 0))];
+		++mCount;
+	}
+
+	// Upper bound of the bucket holding the given fraction of stalls, 0 when empty.
+	int64_t GetPercentileNs(double percentile) const
+	{
+		if (mCount == 0)
+		{
+			return 0;
+		}
+
+		uint64_t target = static_cast<uint64_t>(percentile * mCount + 0.5);
+		target = std::min(std::max<uint64_t>(target, 1), mCount);
+
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < BucketCount; ++i)
+		{
+			seen += mBuckets[i];
+			if (seen >= target)
+			{
+				return GetBucketLimitNs(i);
+			}
+		}
+		return GetBucketLimitNs(BucketCount - 1);
+	}
+
+	// Halves every count, so older stalls weigh less than recent ones.
+	void Decay()
+	{
+		mCount = 0;
+		for (uint64_t& bucket : mBuckets)
+		{
+			bucket /= 2;
+			mCount += bucket;
+		}
+	}
+};
+
+inline void SpinPause()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#endif
+}
+
+// Waits under policy until isComplete() returns true, calling block() (which must not return
+// before completion) once spinning and yielding have run out. Returns the phase that saw the
+// value complete.
+template<typename TIsComplete, typename TBlock>
+EFenceWaitPhase WaitWithPolicy(const FFenceWaitPolicy& policy, const TIsComplete& isComplete, const TBlock& block)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	if (policy.mSpinNs > 0 || policy.mYieldNs > 0)
+	{
+		const Clock::time_point start = Clock::now();
+		const Clock::time_point spinEnd = start + std::chrono::nanoseconds(policy.mSpinNs);
+		const Clock::time_point yieldEnd = spinEnd + std::chrono::nanoseconds(policy.mYieldNs);
+
+		while (Clock::now() < spinEnd)
+		{
+			if (isComplete())
+			{
+				return EFenceWaitPhase::Spin;
+			}
+			SpinPause();
+		}
+
+		while (Clock::now() < yieldEnd)
+		{
+			if (isComplete())
+			{
+				return EFenceWaitPhase::Yield;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	block();
+	return EFenceWaitPhase::Block;
+}
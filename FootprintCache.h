@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct FFootprintCacheStats
+{
+	// Lookups that asked the backend; hits are not counted, since a shared counter would put
+	// every reader back on one cache line.
+	uint64_t mMisses = 0;
+	uint64_t mEntries = 0;
+};
+
+// Folds one field into a footprint key hash (FNV-1a over 64-bit words).
+inline uint64_t HashFootprintField(uint64_t hash, uint64_t value)
+{
+	return (hash ^ value) * 0x100000001b3ull;
+}
+
+const uint64_t FootprintHashSeed = 0xcbf29ce484222325ull;
+
+// Remembers the copyable footprints of a resource shape, so that uploading a texture the same
+// shape as an earlier one costs a hash lookup instead of a trip through the device.
+//
+// Keyed by the resource description and the subresource range. Entries are never evicted: an
+// application uploads a handful of distinct shapes, and the references Get returns stay valid
+// for the life of the cache. Footprints are placed from offset 0; callers add their own base.
+//
+// TBackend provides:
+//     typedef ... Desc;                             // e.g. D3D12_RESOURCE_DESC
+//     typedef ... Layout;                           // e.g. D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+//     static uint64_t HashDesc(const Desc& desc);   // HashFootprintField over every field
+//     static bool EqualDesc(const Desc& a, const Desc& b);
+//     void GetFootprints(const Desc& desc, uint32_t first, uint32_t count,
+//         Layout* layouts, uint32_t* numRows, uint64_t* rowSizes, uint64_t* totalSize);
+//
+// Thread-safe and read-mostly: a hit only reads, probing a published open-addressed table
+// without any lock or shared write. A miss asks the backend without a lock held, then takes
+// the mutex to insert; slots are only ever filled, and a table about to pass half full is
+// replaced by a larger copy. Replaced tables are kept until the cache goes, since readers may
+// still be probing them.
+template <typename TBackend>
+class CFootprintCache
+{
+public:
+	typedef typename TBackend::Desc Desc;
+	typedef typename TBackend::Layout Layout;
+
+	struct FFootprints
+	{
+		uint64_t mTotalSize = 0;
+		std::vector<Layout> mLayouts;
+		std::vector<uint32_t> mNumRows;
+		std::vector<uint64_t> mRowSizes;
+	};
+
+private:
+	struct FKey
+	{
+		Desc mDesc;
+		uint32_t mFirst;
+		uint32_t mCount;
+		uint64_t mHash;
+	};
+
+	struct FEntry
+	{
+		FKey mKey;
+		FFootprints mFootprints;
+	};
+
+	struct FTable
+	{
+		uint32_t mMask;
+		std::unique_ptr<std::atomic<const FEntry*>[]> mSlots;
+	};
+
+	static const uint32_t InitialSlots = 16;
+
+	TBackend mBackend;
+	std::atomic<const FTable*> mTable;
+	mutable std::mutex mMutex;                      // Held to insert.
+	std::vector<std::unique_ptr<FEntry>> mEntries;
+	std::vector<std::unique_ptr<FTable>> mTables;   // Every table so far; the last is published.
+	uint64_t mMisses;
+
+	static bool Equal(const FKey& a, const FKey& b)
+	{
+		return a.mHash == b.mHash && a.mFirst == b.mFirst && a.mCount == b.mCount &&
+			TBackend::EqualDesc(a.mDesc, b.mDesc);
+	}
+
+	// Never more than half full, so the probe always reaches an empty slot.
+	static const FEntry* Find(const FTable& table, const FKey& key)
+	{
+		for (uint32_t i = static_cast<uint32_t>(key.mHash) & table.mMask; ; i = (i + 1) & table.mMask)
+		{
+			const FEntry* entry = table.mSlots[i].load(std::memory_order_acquire);
+			if (!entry || Equal(entry->mKey, key))
+			{
+				return entry;
+			}
+		}
+	}
+
+	// Publishes entry in the table; readers see it whole once they see it at all.
+	static void Insert(FTable& table, const FEntry* entry)
+	{
+		uint32_t i = static_cast<uint32_t>(entry->mKey.mHash) & table.mMask;
+		while (table.mSlots[i].load(std::memory_order_relaxed))
+		{
+			i = (i + 1) & table.mMask;
+		}
+		table.mSlots[i].store(entry, std::memory_order_release);
+	}
+
+	FTable& AddTable(uint32_t slotCount)
+	{
+		std::unique_ptr<FTable> table(new FTable());
+		table->mMask = slotCount - 1;
+		table->mSlots.reset(new std::atomic<const FEntry*>[slotCount]);
+		for (uint32_t i = 0; i < slotCount; ++i)
+		{
+			table->mSlots[i].store(nullptr, std::memory_order_relaxed);
+		}
+		for (const std::unique_ptr<FEntry>& entry : mEntries)
+		{
+			Insert(*table, entry.get());
+		}
+		mTables.push_back(std::move(table));
+		return *mTables.back();
+	}
+
+public:
+	CFootprintCache() :
+		mMisses(0)
+	{
+		mTable.store(&AddTable(InitialSlots), std::memory_order_release);
+	}
+
+	CFootprintCache(const CFootprintCache&) = delete;
+	CFootprintCache& operator=(const CFootprintCache&) = delete;
+
+	TBackend& GetBackend() { return mBackend; }
+
+	// Footprints of subresources [first, first + count) of a resource described by desc.
+	const FFootprints& Get(const Desc& desc, uint32_t first, uint32_t count)
+	{
+		FKey key;
+		key.mDesc = desc;
+		key.mFirst = first;
+		key.mCount = count;
+		key.mHash = HashFootprintField(HashFootprintField(TBackend::HashDesc(desc), first), count);
+
+		if (const FEntry* entry = Find(*mTable.load(std::memory_order_acquire), key))
+		{
+			return entry->mFootprints;
+		}
+
+		std::unique_ptr<FEntry> entry(new FEntry());
+		entry->mKey = key;
+		FFootprints& footprints = entry->mFootprints;
+		footprints.mLayouts.resize(count);
+		footprints.mNumRows.resize(count);
+		footprints.mRowSizes.resize(count);
+		mBackend.GetFootprints(desc, first, count, footprints.mLayouts.data(), footprints.mNumRows.data(),
+			footprints.mRowSizes.data(), &footprints.mTotalSize);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		++mMisses;
+
+		// Another thread may have inserted the same shape meanwhile; theirs wins.
+		FTable* table = mTables.back().get();
+		if (const FEntry* existing = Find(*table, key))
+		{
+			return existing->mFootprints;
+		}
+
+		if ((mEntries.size() + 1) * 2 > table->mMask + 1)
+		{
+			table = &AddTable((table->mMask + 1) * 2);
+			mTable.store(table, std::memory_order_release);
+		}
+		Insert(*table, entry.get());
+		mEntries.push_back(std::move(entry));
+		return mEntries.back()->mFootprints;
+	}
+
+	FFootprintCacheStats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		FFootprintCacheStats stats;
+		stats.mMisses = mMisses;
+		stats.mEntries = mEntries.size();
+		return stats;
+	}
+};
@@ -0,0 +1,98 @@
+#include "FrameArena.h"
+
+#include <atomic>
+
+const size_t CFrameArena::DefaultBlockSize;
+
+namespace
+{
+	std::atomic<uint64_t> gFrameArenaEpoch(1);
+	thread_local CFrameArena tFrameArena;
+}
+
+CFrameArena::CFrameArena() :
+	mBlock(0),
+	mOffset(0),
+	mUsed(0),
+	mEpoch(0)
+{
+}
+
+void CFrameArena::AddBlock(size_t minSize)
+{
+	FBlock block;
+	block.mSize = minSize > DefaultBlockSize ? minSize : DefaultBlockSize;
+	block.mMemory.reset(new uint8_t[block.mSize]);
+	mBlocks.push_back(std::move(block));
+
+	++mStats.mBlocksAllocated;
+	mStats.mCapacity += mBlocks.back().mSize;
+}
+
+void* CFrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (mBlocks.empty())
+	{
+		AddBlock(size + alignment);
+	}
+
+	for (;;)
+	{
+		FBlock& block = mBlocks[mBlock];
+		uintptr_t base = reinterpret_cast<uintptr_t>(block.mMemory.get());
+		uintptr_t aligned = (base + mOffset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		size_t end = static_cast<size_t>(aligned - base) + size;
+		if (end <= block.mSize)
+		{
+			mUsed += end - mOffset;
+			mOffset = end;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		// Whatever is left of this block is wasted until Reset.
+		mUsed += block.mSize - mOffset;
+		if (mBlock + 1 == mBlocks.size())
+		{
+			AddBlock(size + alignment);
+		}
+		++mBlock;
+		mOffset = 0;
+	}
+}
+
+void CFrameArena::Reset()
+{
+	// The frame needed more than one block: replace them with one that holds it all.
+	if (mBlocks.size() > 1 && mBlock > 0)
+	{
+		size_t total = 0;
+		for (const FBlock& block : mBlocks)
+		{
+			total += block.mSize;
+		}
+		mBlocks.clear();
+		mStats.mCapacity = 0;
+		AddBlock(total);
+	}
+
+	mStats.mBytesLastFrame = mUsed;
+	mBlock = 0;
+	mOffset = 0;
+	mUsed = 0;
+}
+
+CFrameArena& GetFrameArena()
+{
+	uint64_t epoch = gFrameArenaEpoch.load(std::memory_order_acquire);
+	if (tFrameArena.mEpoch != epoch)
+	{
+		tFrameArena.Reset();
+		tFrameArena.mEpoch = epoch;
+	}
+	return tFrameArena;
+}
+
+void BeginFrameArenas()
+{
+	gFrameArenaEpoch.fetch_add(1, std::memory_order_release);
+}
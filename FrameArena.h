@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct FFrameArenaStats
+{
+	uint64_t mBytesLastFrame = 0;    // Used between the last two resets, including alignment.
+	uint64_t mCapacity = 0;
+	uint64_t mBlocksAllocated = 0;    // Heap allocations made by the arena, ever.
+};
+
+// Linear scratch memory for work that does not outlive a frame: Allocate bumps a pointer and
+// nothing is freed individually. Memory comes from blocks taken from the heap as needed;
+// Reset keeps them, and folds several blocks into one large enough for the whole frame, so
+// once the arena has seen its busiest frame it stops touching the heap.
+//
+// One arena per thread through GetFrameArena; an arena is not thread-safe.
+class CFrameArena
+{
+public:
+	static const size_t DefaultBlockSize = 64 * 1024;
+
+private:
+	struct FBlock
+	{
+		std::unique_ptr<uint8_t[]> mMemory;
+		size_t mSize;
+	};
+
+	std::vector<FBlock> mBlocks;
+	size_t mBlock;       // Block being allocated from.
+	size_t mOffset;      // Into it.
+	uint64_t mUsed;      // Bytes handed out since Reset, including alignment.
+	uint64_t mEpoch;     // Frame of GetFrameArena the arena was last reset for.
+	FFrameArenaStats mStats;
+
+	void AddBlock(size_t minSize);
+
+	friend CFrameArena& GetFrameArena();
+
+public:
+	CFrameArena();
+
+	CFrameArena(const CFrameArena&) = delete;
+	CFrameArena& operator=(const CFrameArena&) = delete;
+
+	// alignment must be a power of two.
+	void* Allocate(size_t size, size_t alignment);
+
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Invalidates everything allocated so far.
+	void Reset();
+
+	const FFrameArenaStats& GetStats() const { return mStats; }
+};
+
+// The calling thread's arena. It is reset the first time it is used after BeginFrameArenas, so
+// scratch taken from it must not be held across that call.
+CFrameArena& GetFrameArena();
+
+// Starts a new frame for every thread's arena. Call it at the top of the frame, once whatever
+// holds scratch from the previous one (e.g. a CPassSchedule) has been reset.
+void BeginFrameArenas();
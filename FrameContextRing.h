@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Ring of per-frame contexts (command allocators and the like) whose depth is the number of
+// frames the CPU may record ahead of the GPU. The depth is chosen at startup and is independent
+// of the swap chain buffer count.
+//
+// A slot is only handed out again once the fence value signalled when it was last submitted has
+// completed. The fence is a template parameter so the ring can be driven by a real ID3D12Fence
+// wrapper or a fake one; TFence must provide:
+//     uint64_t GetCompletedValue();
+//     void WaitForValue(uint64_t value);
+template<typename TContext>
+class CFrameContextRing
+{
+	struct FSlot
+	{
+		TContext mContext;
+		uint64_t mFenceValue = 0;
+	};
+
+	std::vector<FSlot> mSlots;
+	uint32_t mCurrent = 0;
+	uint64_t mFrameNumber = 0;
+	uint64_t mStallCount = 0;
+	bool mInFrame = false;
+
+public:
+	void Initialize(uint32_t depth)
+	{
+		assert(depth > 0);
+
+		mSlots.clear();
+		mSlots.resize(depth);
+		mCurrent = 0;
+		mFrameNumber = 0;
+		mStallCount = 0;
+		mInFrame = false;
+	}
+
+	// Blocks until the GPU has finished with the next slot, then returns its context for recording.
+	template<typename TFence>
+	TContext& BeginFrame(TFence& fence)
+	{
+		assert(!mSlots.empty() && !mInFrame);
+
+		FSlot& slot = mSlots[mCurrent];
+		if (fence.GetCompletedValue() < slot.mFenceValue)
+		{
+			++mStallCount;
+			fence.WaitForValue(slot.mFenceValue);
+		}
+
+		mInFrame = true;
+		return slot.mContext;
+	}
+
+	// Records the fence value that retires the current slot and advances the ring.
+	void EndFrame(uint64_t fenceValue)
+	{
+		assert(mInFrame);
+
+		mSlots[mCurrent].mFenceValue = fenceValue;
+		mCurrent = (mCurrent + 1) % GetDepth();
+		++mFrameNumber;
+		mInFrame = false;
+	}
+
+	// Waits for every slot, e.g. before tearing down or resizing.
+	template<typename TFence>
+	void WaitIdle(TFence& fence)
+	{
+		uint64_t lastValue = 0;
+		for (const FSlot& slot : mSlots)
+		{
+			if (slot.mFenceValue > lastValue)
+			{
+				lastValue = slot.mFenceValue;
+			}
+		}
+
+		if (fence.GetCompletedValue() < lastValue)
+		{
+			fence.WaitForValue(lastValue);
+		}
+	}
+
+	uint32_t GetDepth() const                  { return static_cast<uint32_t>(mSlots.size()); }
+	uint32_t GetCurrentIndex() const           { return mCurrent; }
+	uint64_t GetFrameNumber() const            { return mFrameNumber; }
+	uint64_t GetStallCount() const             { return mStallCount; }
+	uint64_t GetFenceValue(uint32_t i) const   { return mSlots[i].mFenceValue; }
+	TContext& GetContext(uint32_t i)           { return mSlots[i].mContext; }
+	TContext& GetCurrentContext()              { return mSlots[mCurrent].mContext; }
+};
@@ -0,0 +1,125 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+const int64_t CFramePacer::MinSpinNs;
+
+CFramePacer::CFramePacer(IFrameClock& clock) :
+	mClock(clock),
+	mMode(EFramePacingMode::VSync),
+	mPeriodNs(0),
+	mDeadlineNs(0),
+	mLastFrameStartNs(-1),
+	mFirstFrameStartNs(-1),
+	mSleepOvershootNs(MinSpinNs)
+{
+}
+
+void CFramePacer::SetMode(EFramePacingMode mode, double targetHz)
+{
+	mMode = mode;
+	mPeriodNs = (mode == EFramePacingMode::FixedRate && targetHz > 0.0)
+		? static_cast<int64_t>(1e9 / targetHz)
+		: 0;
+
+	// Restart the cadence from the next frame.
+	mDeadlineNs = 0;
+	mLastFrameStartNs = -1;
+}
+
+void CFramePacer::ResetStats()
+{
+	mStats = FFramePacerStats();
+	mFirstFrameStartNs = mLastFrameStartNs;
+}
+
+void CFramePacer::WaitUntil(int64_t deadlineNs)
+{
+	int64_t now = mClock.NowNs();
+
+	// Sleep for the bulk of the wait, leaving enough headroom to absorb the scheduler's wake-up error.
+	int64_t sleepNs = deadlineNs - now - mSleepOvershootNs;
+	if (sleepNs > 0)
+	{
+		mClock.SleepNs(sleepNs);
+		int64_t woke = mClock.NowNs();
+		mStats.mSleepNs += woke - now;
+
+		// Track the overshoot: jump up immediately, decay slowly (1/8 per sample).
+		int64_t overshoot = (woke - now) - sleepNs;
+		if (overshoot > mSleepOvershootNs)
+		{
+			mSleepOvershootNs = overshoot;
+		}
+		else
+		{
+			mSleepOvershootNs = std::max(MinSpinNs, mSleepOvershootNs - (mSleepOvershootNs - overshoot) / 8);
+		}
+		now = woke;
+	}
+
+	// Spin out the remainder for sub-millisecond precision.
+	int64_t spinStart = now;
+	while (now < deadlineNs)
+	{
+		mClock.Spin();
+		now = mClock.NowNs();
+	}
+	mStats.mSpinNs += now - spinStart;
+}
+
+void CFramePacer::RecordFrameStart(int64_t nowNs)
+{
+	if (mLastFrameStartNs >= 0)
+	{
+		int64_t interval = nowNs - mLastFrameStartNs;
+		uint64_t n = ++mStats.mFrameCount;
+
+		mStats.mLastIntervalNs = interval;
+		mStats.mMeanIntervalNs += (interval - mStats.mMeanIntervalNs) / n;
+
+		double reference = mPeriodNs > 0 ? static_cast<double>(mPeriodNs) : mStats.mMeanIntervalNs;
+		mStats.mJitterNs += (std::abs(interval - reference) - mStats.mJitterNs) / n;
+	}
+
+	if (mFirstFrameStartNs < 0)
+	{
+		mFirstFrameStartNs = nowNs;
+	}
+	mStats.mElapsedNs = nowNs - mFirstFrameStartNs;
+	mLastFrameStartNs = nowNs;
+}
+
+void CFramePacer::WaitForNextFrame()
+{
+	if (mMode != EFramePacingMode::FixedRate || mPeriodNs <= 0)
+	{
+		RecordFrameStart(mClock.NowNs());
+		return;
+	}
+
+	if (mLastFrameStartNs < 0)
+	{
+		// First paced frame runs immediately and anchors the cadence.
+		int64_t now = mClock.NowNs();
+		mDeadlineNs = now + mPeriodNs;
+		RecordFrameStart(now);
+		return;
+	}
+
+	WaitUntil(mDeadlineNs);
+
+	int64_t now = mClock.NowNs();
+	mStats.mMaxLatenessNs = std::max(mStats.mMaxLatenessNs, now - mDeadlineNs);
+	RecordFrameStart(now);
+
+	// Keep the cadence anchored to the deadlines rather than to when we woke up, but if we
+	// fell more than a whole period behind, resync instead of bursting frames to catch up.
+	mDeadlineNs += mPeriodNs;
+	if (now - mDeadlineNs > mPeriodNs)
+	{
+		mDeadlineNs = now + mPeriodNs;
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+
+// Time source used by the pacer. The Win32 build wraps QueryPerformanceCounter and a
+// high-resolution waitable timer; anything else (e.g. a simulated clock) can be plugged in.
+class IFrameClock
+{
+public:
+	virtual ~IFrameClock() {}
+
+	virtual int64_t NowNs() = 0;
+
+	// Coarse OS sleep; may overshoot by up to the scheduler quantum.
+	virtual void SleepNs(int64_t ns) = 0;
+
+	// One iteration of a busy wait (a pause instruction on real hardware).
+	virtual void Spin() = 0;
+};
+
+// Clock on which time only passes when someone sleeps, spins or calls Advance, so the pacer
+// runs without a window or real waits, e.g. in HeadlessHello. Each sleep wakes up
+// sleepOvershootNs late plus a pseudo-random part of up to sleepJitterNs, the way an OS
+// scheduler does; each spin costs spinNs.
+class CSimulatedFrameClock : public IFrameClock
+{
+	int64_t mNowNs;
+	int64_t mSleepOvershootNs;
+	int64_t mSleepJitterNs;
+	int64_t mSpinNs;
+	uint32_t mRandom;
+
+public:
+	CSimulatedFrameClock(int64_t sleepOvershootNs, int64_t sleepJitterNs, int64_t spinNs) :
+		mNowNs(0),
+		mSleepOvershootNs(sleepOvershootNs),
+		mSleepJitterNs(sleepJitterNs),
+		mSpinNs(spinNs),
+		mRandom(1)
+	{
+	}
+
+	virtual int64_t NowNs()
+	{
+		return mNowNs;
+	}
+
+	virtual void SleepNs(int64_t ns)
+	{
+		// xorshift32: the same wake-ups on every run.
+		mRandom ^= mRandom << 13;
+		mRandom ^= mRandom >> 17;
+		mRandom ^= mRandom << 5;
+		int64_t jitterNs = mSleepJitterNs > 0 ? static_cast<int64_t>(mRandom % static_cast<uint64_t>(mSleepJitterNs + 1)) : 0;
+		mNowNs += ns + mSleepOvershootNs + jitterNs;
+	}
+
+	virtual void Spin()
+	{
+		mNowNs += mSpinNs;
+	}
+
+	// Time the caller spends working, e.g. on a frame.
+	void Advance(int64_t ns)
+	{
+		mNowNs += ns;
+	}
+};
+
+enum class EFramePacingMode
+{
+	Uncapped,   // Run frames back to back, present without vsync.
+	FixedRate,  // Sleep/spin so frames start on a fixed cadence.
+	VSync,      // Let the vsync'd Present throttle the loop; the pacer only measures.
+};
+
+struct FFramePacerStats
+{
+	uint64_t mFrameCount = 0;
+	int64_t mLastIntervalNs = 0;
+	double mMeanIntervalNs = 0.0;
+	// Mean absolute deviation of the frame interval from the target (or from the mean when uncapped).
+	double mJitterNs = 0.0;
+	// Largest amount a frame started after its deadline.
+	int64_t mMaxLatenessNs = 0;
+	// Time spent inside the pacer, split into OS sleep and busy wait.
+	int64_t mSleepNs = 0;
+	int64_t mSpinNs = 0;
+	int64_t mElapsedNs = 0;
+
+	// Fraction of wall time burnt busy-waiting in the pacer.
+	double GetSpinFraction() const
+	{
+		return mElapsedNs > 0 ? static_cast<double>(mSpinNs) / static_cast<double>(mElapsedNs) : 0.0;
+	}
+};
+
+class CFramePacer
+{
+	IFrameClock& mClock;
+	EFramePacingMode mMode;
+	int64_t mPeriodNs;
+
+	int64_t mDeadlineNs;
+	int64_t mLastFrameStartNs;
+	int64_t mFirstFrameStartNs;
+
+	// Running estimate of how late SleepNs wakes up; we spin for at least this long.
+	int64_t mSleepOvershootNs;
+
+	FFramePacerStats mStats;
+
+	void WaitUntil(int64_t deadlineNs);
+	void RecordFrameStart(int64_t nowNs);
+
+public:
+	// Never sleep for less than this; below it a spin is always cheaper than a reschedule.
+	static const int64_t MinSpinNs = 200000;
+
+	explicit CFramePacer(IFrameClock& clock);
+
+	// targetHz is only used by FixedRate.
+	void SetMode(EFramePacingMode mode, double targetHz = 60.0);
+	EFramePacingMode GetMode() const { return mMode; }
+	int64_t GetPeriodNs() const { return mPeriodNs; }
+
+	// Blocks until the next frame is due, then returns. Call once per loop iteration
+	// after pending window messages have been drained.
+	void WaitForNextFrame();
+
+	const FFramePacerStats& GetStats() const { return mStats; }
+	void ResetStats();
+};
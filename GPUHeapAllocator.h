@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BuddyAllocator.h"
+#include "DeferredReleaseQueue.h"
+
+struct FGPUHeapAllocatorStats
+{
+	uint64_t mHeaps = 0;
+	uint64_t mHeapBytes = 0;
+	uint64_t mHeapsCreated = 0;
+	uint64_t mHeapsReleased = 0;
+	uint64_t mRetiredBlocks = 0;   // Freed by their resource, waiting for the GPU to finish.
+	// Over every heap; mLargestFreeBlock is the largest in any one heap.
+	FBuddyAllocatorStats mBlocks;
+};
+
+// Places resources into a few large heaps instead of giving each one an implicit heap.
+//
+// Heaps are grouped in pools by kind (what TBackend::Kind describes: heap type and the
+// resource classes the heap may hold) and each heap is carved up by a CBuddyAllocator. A pool
+// grows by one heap when no heap in it can take a request, and a heap that empties is released
+// unless it is the last one of its pool. Requests larger than a heap are refused; the caller
+// falls back to a dedicated allocation.
+//
+// A block whose resource is gone may still be in use by the GPU, so it is retired rather than
+// freed: it stays allocated until the value of the owner's next fence signal (OnSignal) has
+// completed (Collect). Nothing is placed over memory the GPU may still touch, and a heap is
+// only released once its last retired block has come back.
+//
+// TBackend provides:
+//     typedef ... Heap;                             // e.g. ComPtr<ID3D12Heap>
+//     typedef ... Kind;                             // comparable with ==
+//     Heap CreateHeap(const Kind& kind, uint64_t size);
+//
+// Thread-safe; resources may be created and destroyed from any thread.
+template <typename TBackend>
+class CGPUHeapAllocator
+{
+public:
+	typedef typename TBackend::Heap Heap;
+	typedef typename TBackend::Kind Kind;
+
+	struct FHeap
+	{
+		Heap mHeap;
+		CBuddyAllocator mAllocator;
+		uint32_t mPool;
+	};
+
+	struct FAllocation
+	{
+		FHeap* mHeap = nullptr;     // Null when the request was refused.
+		uint64_t mOffset = 0;
+
+		bool IsValid() const { return mHeap != nullptr; }
+	};
+
+private:
+	struct FPool
+	{
+		Kind mKind;
+		std::vector<std::unique_ptr<FHeap>> mHeaps;
+	};
+
+	// A retired block, freed when the release queue drops it (with mMutex held).
+	class CRetiredBlock
+	{
+		CGPUHeapAllocator* mOwner;
+		FAllocation mAllocation;
+
+	public:
+		CRetiredBlock(CGPUHeapAllocator* owner, const FAllocation& allocation) :
+			mOwner(owner),
+			mAllocation(allocation)
+		{
+		}
+
+		CRetiredBlock(CRetiredBlock&& other) noexcept :
+			mOwner(other.mOwner),
+			mAllocation(other.mAllocation)
+		{
+			other.mOwner = nullptr;
+		}
+
+		CRetiredBlock& operator=(CRetiredBlock&& other) noexcept
+		{
+			std::swap(mOwner, other.mOwner);
+			std::swap(mAllocation, other.mAllocation);
+			return *this;
+		}
+
+		~CRetiredBlock()
+		{
+			if (mOwner)
+			{
+				mOwner->FreeLocked(mAllocation);
+			}
+		}
+	};
+
+	TBackend mBackend;
+	uint64_t mHeapSize;
+	uint64_t mMinBlockSize;
+	std::vector<FPool> mPools;
+	CDeferredReleaseQueue<CRetiredBlock> mRetired;
+	FGPUHeapAllocatorStats mStats;
+	mutable std::mutex mMutex;
+
+	uint32_t FindPool(const Kind& kind)
+	{
+		for (uint32_t i = 0; i < mPools.size(); ++i)
+		{
+			if (mPools[i].mKind == kind)
+			{
+				return i;
+			}
+		}
+
+		FPool pool;
+		pool.mKind = kind;
+		mPools.push_back(std::move(pool));
+		return static_cast<uint32_t>(mPools.size() - 1);
+	}
+
+	void FreeLocked(const FAllocation& allocation)
+	{
+		FHeap* heap = allocation.mHeap;
+		heap->mAllocator.Free(allocation.mOffset);
+
+		FPool& pool = mPools[heap->mPool];
+		if (heap->mAllocator.IsEmpty() && pool.mHeaps.size() > 1)
+		{
+			for (size_t i = 0; i < pool.mHeaps.size(); ++i)
+			{
+				if (pool.mHeaps[i].get() == heap)
+				{
+					pool.mHeaps.erase(pool.mHeaps.begin() + i);
+					break;
+				}
+			}
+
+			--mStats.mHeaps;
+			++mStats.mHeapsReleased;
+			mStats.mHeapBytes -= mHeapSize;
+		}
+	}
+
+public:
+	// heapSize and minBlockSize must be powers of two.
+	CGPUHeapAllocator(const TBackend& backend, uint64_t heapSize, uint64_t minBlockSize) :
+		mBackend(backend),
+		mHeapSize(heapSize),
+		mMinBlockSize(minBlockSize)
+	{
+	}
+
+	// The GPU must be done with every retired block by now.
+	~CGPUHeapAllocator()
+	{
+		mRetired.ReleaseAll();
+	}
+
+	CGPUHeapAllocator(const CGPUHeapAllocator&) = delete;
+	CGPUHeapAllocator& operator=(const CGPUHeapAllocator&) = delete;
+
+	FAllocation Allocate(const Kind& kind, uint64_t size, uint64_t alignment)
+	{
+		FAllocation allocation;
+		if (size > mHeapSize || alignment > mHeapSize)
+		{
+			return allocation;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		uint32_t poolIndex = FindPool(kind);
+		FPool& pool = mPools[poolIndex];
+		for (const std::unique_ptr<FHeap>& heap : pool.mHeaps)
+		{
+			uint64_t offset = heap->mAllocator.Allocate(size, alignment);
+			if (offset != CBuddyAllocator::InvalidOffset)
+			{
+				allocation.mHeap = heap.get();
+				allocation.mOffset = offset;
+				break;
+			}
+		}
+
+		if (!allocation.IsValid())
+		{
+			std::unique_ptr<FHeap> heap(new FHeap());
+			heap->mHeap = mBackend.CreateHeap(kind, mHeapSize);
+			heap->mAllocator.Initialize(mHeapSize, mMinBlockSize);
+			heap->mPool = poolIndex;
+
+			allocation.mHeap = heap.get();
+			allocation.mOffset = heap->mAllocator.Allocate(size, alignment);
+			assert(allocation.mOffset != CBuddyAllocator::InvalidOffset);
+			pool.mHeaps.push_back(std::move(heap));
+
+			++mStats.mHeaps;
+			++mStats.mHeapsCreated;
+			mStats.mHeapBytes += mHeapSize;
+		}
+		return allocation;
+	}
+
+	// Returns a block at once; only for one the GPU has never used (e.g. placing failed).
+	void Free(const FAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		FreeLocked(allocation);
+	}
+
+	// Returns a block once the value passed to the next OnSignal has completed.
+	void Retire(const FAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRetired.DeferToNextSignal(CRetiredBlock(this, allocation));
+	}
+
+	// Call right after signalling; stamps the blocks retired since the last signal.
+	void OnSignal(uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRetired.OnSignal(fenceValue);
+	}
+
+	// Frees the retired blocks whose value has completed. Returns how many.
+	size_t Collect(uint64_t completedValue)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mRetired.Collect(completedValue);
+	}
+
+	FGPUHeapAllocatorStats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		FGPUHeapAllocatorStats stats = mStats;
+		stats.mRetiredBlocks = mRetired.GetObjectCount();
+		for (const FPool& pool : mPools)
+		{
+			for (const std::unique_ptr<FHeap>& heap : pool.mHeaps)
+			{
+				const FBuddyAllocatorStats& blocks = heap->mAllocator.GetStats();
+				stats.mBlocks.mAllocations += blocks.mAllocations;
+				stats.mBlocks.mRequestedBytes += blocks.mRequestedBytes;
+				stats.mBlocks.mAllocatedBytes += blocks.mAllocatedBytes;
+				stats.mBlocks.mFreeBytes += blocks.mFreeBytes;
+				if (blocks.mLargestFreeBlock > stats.mBlocks.mLargestFreeBlock)
+				{
+					stats.mBlocks.mLargestFreeBlock = blocks.mLargestFreeBlock;
+				}
+			}
+		}
+		return stats;
+	}
+
+	uint64_t GetHeapSize() const { return mHeapSize; }
+};
@@ -0,0 +1,1454 @@
+// Runs the sample's frame loop on the null render device, without a window or GPU, and
+// reports the CPU cost of a frame. Built outside the Visual Studio project, e.g. on Linux:
+//
+//     g++ -std=c++14 -O2 -pthread -o HeadlessHello HeadlessMain.cpp HelloRenderer.cpp
+//         NullRenderDevice.cpp JobSystem.cpp PassSchedule.cpp CommandStream.cpp
+//         CaptureRenderDevice.cpp PresentController.cpp StaticGeometry.cpp MipChain.cpp
+//         ProceduralTexture.cpp SubresourceCopy.cpp FrameArena.cpp MappedFile.cpp DDSTexture.cpp
+//         BlockCompress.cpp FramePacer.cpp HeadlessTests.cpp
+//
+// Usage: HeadlessHello [-frames N] [-inflight N] [-recordthreads N] [-workers N]
+//                      [-pipelined] [-updatecost us] [-rendercost us] [-compare]
+//                      [-gpulatency us] [-fencewait block|adaptive|<spin us>] [-vsync]
+//                      [-texturesize N | -texture file.dds] [-textureformat rgba8|bc1|bc3|bc7]
+//                      [-texturequality fast|quality] [-checkallocs]
+//                      [-capture file [-captureframes N]]
+//        HeadlessHello -replay file [-iterations N] [-sink null|device]
+//        HeadlessHello -jobbench [-workers N]
+//        HeadlessHello -recordbench N [-frames N] [-workers N]
+//        HeadlessHello -texturebench N [-workers N]
+//        HeadlessHello -copybench N [-workers N]
+//        HeadlessHello -compressbench N [-workers N]
+//        HeadlessHello -footprintbench [-iterations N] [-workers N]
+//        HeadlessHello -ddsinfo file.dds
+//        HeadlessHello -pacersim [-frames N] [-updatecost us]
+//        HeadlessHello -heapbench [-frames N]
+//        HeadlessHello -selftest [name]
+//
+// -pipelined steps the scene on a simulation thread while the main thread renders;
+// -updatecost and -rendercost add synthetic CPU work to each side, and -compare runs the
+// serial and the pipelined loop back to back and reports the throughput of each.
+//
+// -gpulatency makes the null device's fences complete that long after they are signalled, so
+// frame waits stall; -fencewait picks how those waits spend their time (see FFenceWaitPolicy).
+//
+// -vsync runs with the vsync pacing mode and CPresentController picking the sync interval. The
+// null swap chain neither blocks nor has statistics, so frames over a 60Hz refresh count as
+// missed vblanks; -updatecost makes them that long.
+//
+// Every run reports the heap allocations made after the first 100 frames (or half the run, if
+// shorter), counted through the global operator new; -checkallocs fails the run if there
+// were any, since the frame loop is meant to allocate nothing once warmed up.
+//
+// -capture writes the last frames of the run to a command stream; -replay re-issues a stream
+// (from this program or from the sample's -capture) and reports the cost per replayed command.
+//
+// -jobbench runs batches of small jobs, and single jobs one at a time, through CJobSystem and
+// through a naive scheduler with one locked queue, and reports the throughput and the
+// submit-to-done latency of each.
+//
+// -recordbench records frames of N draws through CParallelCommandRecorder on the null device,
+// which keeps every command in memory the way a D3D12 list does, split over 1, 2, 4, 8 and 16
+// lists recorded in parallel, and reports the recording rate of each.
+//
+// -texturebench generates NxN procedural textures on one thread and on the job system and
+// reports the write rate of each.
+//
+// -copybench copies an NxN RGBA8 texture, packed and with 256-byte aligned staging rows, and
+// a 32-slice volume of (N/4)x(N/4), with MemcpySubresource's row loop and with CopySubresource
+// on one thread and on the job system, and reports the copy rate of each.
+//
+// -textureformat compresses the texture (generated, or an RGBA8 DDS) on the CPU before it is
+// uploaded. -compressbench compresses an NxN noise texture to BC1, BC3 and BC7 in each mode,
+// with scalar index selection, on one thread and on the job system, and reports the rate of
+// each in MPix/s and the PSNR of the result.
+//
+// -footprintbench looks up the copyable footprints of a few texture shapes through a stub
+// device, the way d3dx12's heap-allocating UpdateSubresources does and through
+// CFootprintCache, -iterations times on one thread and on every job system thread, and reports
+// the cost per upload.
+//
+// -texture renders with a DDS file in place of the generated texture; -ddsinfo prints how a
+// DDS file's subresources are laid out in the file and in an upload buffer.
+//
+// -pacersim runs CFramePacer at 60 and 144Hz on simulated clocks whose sleeps wake up late by
+// different amounts, with -updatecost of work per frame, and reports the frame interval,
+// jitter, lateness and share of the time spent spinning for each.
+//
+// -heapbench places a churn of buffers and textures, each living a random number of frames,
+// into CGPUHeapAllocator's heaps through a stub backend, retiring blocks two frames after
+// their resource goes, and reports the cost of an allocation and a retire, the peak heap
+// memory against what the same resources would take committed one by one, and the
+// fragmentation left at the end.
+//
+// -selftest runs the checks in HeadlessTests.cpp, or those whose name contains name, and fails
+// if any does not hold. The dds checks read the sample files in TestData, so run it from the
+// repository root.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HelloRenderer.h"
+#include "BlockCompress.h"
+#include "NullRenderDevice.h"
+#include "CaptureRenderDevice.h"
+#include "CommandStream.h"
+#include "DDSTexture.h"
+#include "FootprintCache.h"
+#include "GPUHeapAllocator.h"
+#include "HeadlessTests.h"
+#include "MappedFile.h"
+#include "PipelinedFrameLoop.h"
+#include "ProceduralTexture.h"
+#include "SubresourceCopy.h"
+
+namespace
+{
+	std::atomic<uint64_t> gHeapAllocations(0);
+
+	// Frames the renderer gets to grow its containers and arenas before allocations count.
+	const uint32_t AllocationWarmupFrames = 100;
+}
+
+// Counts every allocation made through new, including the standard containers'.
+void* operator new(size_t size)
+{
+	gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+uint64_t GetHeapAllocationCount()
+{
+	return gHeapAllocations.load(std::memory_order_relaxed);
+}
+
+// GCC sees through inlined deletes to the free of what operator new returned, and takes the
+// pair for a mismatch.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+	int64_t GetTimeNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double GetPercentileMs(const std::vector<int64_t>& sorted, double percentile)
+	{
+		size_t index = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+		return sorted[index] * 1e-6;
+	}
+
+	// Synthetic CPU load standing in for game update or render work.
+	void BusyWaitNs(int64_t ns)
+	{
+		if (ns <= 0)
+		{
+			return;
+		}
+		int64_t end = GetTimeNs() + ns;
+		while (GetTimeNs() < end)
+		{
+		}
+	}
+
+	struct FLoopOptions
+	{
+		bool mPipelined = false;
+		int64_t mUpdateCostNs = 0;
+		int64_t mRenderCostNs = 0;
+	};
+
+	// Runs frameCount frames and returns how long each took on the render thread, waits for
+	// the simulation included. beforeFrame, if set, is called before each frame starts.
+	std::vector<int64_t> RunFrames(CHelloRenderer& renderer, uint32_t frameCount, const FLoopOptions& options,
+		const std::function<void(uint32_t)>& beforeFrame)
+	{
+		CPipelinedFrameLoop<FSceneState> simulation;
+		if (options.mPipelined)
+		{
+			int64_t updateCostNs = options.mUpdateCostNs;
+			simulation.Start(FSceneState(),
+				[updateCostNs](FSceneState& scene, int64_t deltaNs)
+				{
+					CHelloRenderer::Simulate(scene, deltaNs);
+					BusyWaitNs(updateCostNs);
+				});
+		}
+
+		std::vector<int64_t> frameNs(frameCount);
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			if (beforeFrame)
+			{
+				beforeFrame(i);
+			}
+
+			int64_t frameStart = GetTimeNs();
+			renderer.OnBeginFrame();
+			if (options.mPipelined)
+			{
+				renderer.OnRender(simulation.AcquireNext());
+			}
+			else
+			{
+				renderer.OnUpdate();
+				BusyWaitNs(options.mUpdateCostNs);
+				renderer.OnRender();
+			}
+			BusyWaitNs(options.mRenderCostNs);
+			frameNs[i] = GetTimeNs() - frameStart;
+		}
+		return frameNs;
+	}
+
+	int64_t GetTotalNs(const std::vector<int64_t>& frameNs)
+	{
+		int64_t totalNs = 0;
+		for (int64_t ns : frameNs)
+		{
+			totalNs += ns;
+		}
+		return totalNs;
+	}
+
+	// Runs the serial and the pipelined loop with the same load and reports the throughput of each.
+	int ComparePipelining(const FRendererConfig& config, uint32_t frameCount, FLoopOptions options)
+	{
+		double framesPerSecond[2];
+		for (int pipelined = 0; pipelined < 2; ++pipelined)
+		{
+			CNullRenderDevice device;
+			CHelloRenderer renderer(device, config);
+			renderer.OnInit();
+
+			options.mPipelined = pipelined != 0;
+			std::vector<int64_t> frameNs = RunFrames(renderer, frameCount, options, nullptr);
+			renderer.OnDestroy();
+
+			framesPerSecond[pipelined] = frameCount * 1e9 / GetTotalNs(frameNs);
+			std::sort(frameNs.begin(), frameNs.end());
+			printf("%s: %.1f frames/s, cpu frame: p50 %.4fms, p99 %.4fms\n", pipelined ? "pipelined" : "serial",
+				framesPerSecond[pipelined], GetPercentileMs(frameNs, 0.5), GetPercentileMs(frameNs, 0.99));
+		}
+
+		// The overlap needs a second core; on one the two threads just take turns.
+		printf("update %.3fms, render %.3fms, %u hardware threads: pipelined throughput %.2fx serial\n",
+			options.mUpdateCostNs * 1e-6, options.mRenderCostNs * 1e-6, std::thread::hardware_concurrency(),
+			framesPerSecond[1] / framesPerSecond[0]);
+		return 0;
+	}
+
+	int Replay(const char* path, uint32_t iterations, bool deviceSink)
+	{
+		CMappedFile file(path);
+		CCommandStreamReader reader(file.GetData(), file.GetSize());
+		const FCommandStreamHeader& header = reader.GetHeader();
+
+		CNullRenderDevice device;
+		CNullCommandStreamTarget nullTarget;
+		CDeviceCommandStreamTarget deviceTarget(device);
+		ICommandStreamTarget& target = deviceSink ? static_cast<ICommandStreamTarget&>(deviceTarget) : nullTarget;
+
+		CCommandStreamReplayer replayer(reader, target);
+		replayer.Prepare();
+		// Warm up: the device target creates its lists and allocators on the first pass.
+		replayer.Replay(1);
+
+		int64_t start = GetTimeNs();
+		replayer.Replay(iterations);
+		int64_t totalNs = GetTimeNs() - start;
+
+		double commands = static_cast<double>(header.mCommandCount) * iterations;
+		printf("stream: %u objects, %u frames, %u lists, %u commands, %llu bytes\n",
+			header.mObjectCount, header.mFrameCount, header.mListCount, header.mCommandCount,
+			static_cast<unsigned long long>(file.GetSize()));
+		printf("replay (%s sink): %u iterations, %.1fns per iteration, %.2fns per command\n",
+			deviceSink ? "device" : "null", iterations, static_cast<double>(totalNs) / iterations,
+			commands > 0 ? totalNs / commands : 0.0);
+		return 0;
+	}
+
+	// The scheduler -jobbench measures CJobSystem against: one locked FIFO that every thread
+	// pops from, with idle workers asleep on a condition variable. The waiting thread helps,
+	// as in CJobSystem::Wait. FJob::mCounter is not used.
+	class CMutexJobQueue
+	{
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::deque<FJob*> mQueue;
+		std::atomic<uint32_t> mPending;
+		bool mExit;
+		std::vector<std::thread> mThreads;
+
+		FJob* TryPop()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mQueue.empty())
+			{
+				return nullptr;
+			}
+			FJob* job = mQueue.front();
+			mQueue.pop_front();
+			return job;
+		}
+
+		void Execute(FJob* job)
+		{
+			job->mFunction(job->mData);
+			mPending.fetch_sub(1);
+		}
+
+		void WorkerMain()
+		{
+			for (;;)
+			{
+				FJob* job;
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mWake.wait(lock, [this] { return mExit || !mQueue.empty(); });
+					if (mExit)
+					{
+						return;
+					}
+					job = mQueue.front();
+					mQueue.pop_front();
+				}
+				Execute(job);
+			}
+		}
+
+	public:
+		explicit CMutexJobQueue(uint32_t workerThreads) :
+			mPending(0),
+			mExit(false)
+		{
+			for (uint32_t i = 0; i < workerThreads; ++i)
+			{
+				mThreads.emplace_back(&CMutexJobQueue::WorkerMain, this);
+			}
+		}
+
+		~CMutexJobQueue()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mExit = true;
+			}
+			mWake.notify_all();
+			for (std::thread& thread : mThreads)
+			{
+				thread.join();
+			}
+		}
+
+		void Run(FJob* jobs, uint32_t count)
+		{
+			mPending.fetch_add(count);
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					mQueue.push_back(&jobs[i]);
+				}
+			}
+			if (count == 1)
+			{
+				mWake.notify_one();
+			}
+			else
+			{
+				mWake.notify_all();
+			}
+		}
+
+		void Wait()
+		{
+			while (mPending.load() != 0)
+			{
+				if (FJob* job = TryPop())
+				{
+					Execute(job);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+	};
+
+	// A job of mIterations steps of xorshift, standing in for a small piece of frame work.
+	struct FBenchJob
+	{
+		uint32_t mIterations;
+		uint32_t mResult;
+
+		static void Run(void* data)
+		{
+			FBenchJob* job = static_cast<FBenchJob*>(data);
+			uint32_t x = job->mIterations | 1;
+			for (uint32_t i = 0; i < job->mIterations; ++i)
+			{
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+			}
+			job->mResult = x;
+		}
+	};
+
+	int JobBench(uint32_t workerThreads)
+	{
+		CJobSystem jobSystem(workerThreads);
+		CMutexJobQueue mutexQueue(jobSystem.GetThreadCount() - 1);
+		const char* names[] = { "job system", "mutex queue" };
+		auto run = [&](uint32_t scheduler, FJob* jobs, uint32_t count)
+		{
+			if (scheduler == 0)
+			{
+				CJobCounter counter;
+				jobSystem.Run(jobs, count, counter);
+				jobSystem.Wait(counter);
+			}
+			else
+			{
+				mutexQueue.Run(jobs, count);
+				mutexQueue.Wait();
+			}
+		};
+
+		// Throughput: batches of jobs from about 20ns to a few microseconds each.
+		const uint32_t batchSize = 1024;
+		const uint32_t totalJobs = 1 << 18;
+		const uint32_t iterationCounts[] = { 0, 16, 1024 };
+		std::vector<FBenchJob> jobData(batchSize);
+		std::vector<FJob> jobs(batchSize);
+		for (uint32_t i = 0; i < batchSize; ++i)
+		{
+			jobs[i].mFunction = &FBenchJob::Run;
+			jobs[i].mData = &jobData[i];
+		}
+		for (uint32_t iterations : iterationCounts)
+		{
+			for (FBenchJob& job : jobData)
+			{
+				job.mIterations = iterations;
+			}
+			printf("batches of %u jobs of %u steps:", batchSize, iterations);
+			for (uint32_t scheduler = 0; scheduler < 2; ++scheduler)
+			{
+				run(scheduler, jobs.data(), batchSize);
+				int64_t start = GetTimeNs();
+				for (uint32_t done = 0; done < totalJobs; done += batchSize)
+				{
+					run(scheduler, jobs.data(), batchSize);
+				}
+				double jobsPerSecond = totalJobs * 1e9 / (GetTimeNs() - start);
+				printf("%s %s %.2f M jobs/s", scheduler == 0 ? "" : ",", names[scheduler], jobsPerSecond * 1e-6);
+			}
+			printf("\n");
+		}
+
+		// Latency: one job at a time, from Run to the return of Wait.
+		const uint32_t samples = 20000;
+		std::vector<int64_t> latencyNs(samples);
+		jobData[0].mIterations = 16;
+		for (uint32_t scheduler = 0; scheduler < 2; ++scheduler)
+		{
+			for (uint32_t i = 0; i < samples; ++i)
+			{
+				int64_t start = GetTimeNs();
+				run(scheduler, jobs.data(), 1);
+				latencyNs[i] = GetTimeNs() - start;
+			}
+			std::sort(latencyNs.begin(), latencyNs.end());
+			printf("single job, %s: p50 %.2fus, p99 %.2fus, max %.2fus\n", names[scheduler],
+				GetPercentileMs(latencyNs, 0.5) * 1e3, GetPercentileMs(latencyNs, 0.99) * 1e3, latencyNs.back() * 1e-3);
+		}
+		printf("%u threads, %u hardware threads\n", jobSystem.GetThreadCount(), std::thread::hardware_concurrency());
+		return 0;
+	}
+
+	int RecordBench(uint32_t drawCount, uint32_t frameCount, uint32_t workerThreads)
+	{
+		CNullRenderDevice device;
+		std::unique_ptr<IRenderQueue> queue = device.CreateQueue(ERenderQueueType::Direct);
+		FRenderRecordingBackend backend;
+		backend.mDevice = &device;
+		backend.mQueue = queue.get();
+		backend.mInitialState = nullptr;
+
+		// Two frame contexts, as with two frames in flight.
+		const uint32_t frameContexts = 2;
+		const FRenderViewport viewport = { 0.0f, 0.0f, 1280.0f, 720.0f };
+		const FRenderRect scissorRect = { 0, 0, 1280, 720 };
+
+		CJobSystem jobs(workerThreads);
+		double singleListNs = 0.0;
+		for (uint32_t threads = 1; threads <= 16; threads *= 2)
+		{
+			typedef CParallelCommandRecorder<FRenderRecordingBackend> CRecorder;
+			CRecorder recorder(backend, jobs, threads, frameContexts);
+			auto recordFrame = [&](uint32_t frame)
+			{
+				uint32_t frameIndex = frame % frameContexts;
+				recorder.Record(frameIndex,
+					[&](uint32_t threadIndex, FRenderRecordingBackend::CommandList& list)
+					{
+						uint32_t begin, end;
+						recorder.GetThreadRange(threadIndex, drawCount, begin, end);
+						list->SetViewport(viewport);
+						list->SetScissor(scissorRect);
+						for (uint32_t i = begin; i < end; ++i)
+						{
+							list->DrawIndexed(6, 1, 0, static_cast<int32_t>(i * 4));
+						}
+					});
+				recorder.Submit(frameIndex, nullptr, 0, nullptr, 0);
+			};
+
+			// Lets every list grow to its steady-state size.
+			for (uint32_t frame = 0; frame < frameContexts; ++frame)
+			{
+				recordFrame(frame);
+			}
+
+			int64_t start = GetTimeNs();
+			for (uint32_t frame = 0; frame < frameCount; ++frame)
+			{
+				recordFrame(frame);
+			}
+			double frameNs = static_cast<double>(GetTimeNs() - start) / frameCount;
+			if (threads == 1)
+			{
+				singleListNs = frameNs;
+			}
+
+			printf("%2u lists: %.3fms per frame, %.1f M draws/s, %.2fx one list\n", threads, frameNs * 1e-6,
+				drawCount * 1e3 / frameNs, singleListNs / frameNs);
+		}
+		printf("%u draws per frame, %u job system threads, %u hardware threads\n", drawCount, jobs.GetThreadCount(),
+			std::thread::hardware_concurrency());
+		return 0;
+	}
+
+	int TextureBench(uint32_t size, uint32_t workerThreads)
+	{
+		const EProceduralPattern patterns[] =
+		{
+			EProceduralPattern::Checker,
+			EProceduralPattern::HorizontalGradient,
+			EProceduralPattern::RadialGradient,
+			EProceduralPattern::PerlinNoise,
+		};
+		const char* patternNames[] = { "checker", "gradient", "radial", "perlin" };
+		const ERenderFormat formats[] = { ERenderFormat::RGBA8Unorm, ERenderFormat::RGBA32Float };
+		const char* formatNames[] = { "rgba8", "rgba32f" };
+
+		CJobSystem jobs(workerThreads);
+		std::vector<uint8_t> texture;
+		for (uint32_t f = 0; f < 2; ++f)
+		{
+			for (uint32_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p)
+			{
+				FProceduralTextureDesc desc;
+				desc.mPattern = patterns[p];
+				desc.mWidth = size;
+				desc.mHeight = size;
+				desc.mFormat = formats[f];
+				desc.mCellSize = std::max(size / 8, 1u);
+
+				uint32_t rowPitch = size * GetProceduralTexelSize(desc.mFormat);
+				double bytes = static_cast<double>(rowPitch) * size;
+				texture.resize(static_cast<size_t>(bytes));
+
+				int64_t start = GetTimeNs();
+				GenerateProceduralTexture(desc, texture.data(), rowPitch, nullptr);
+				int64_t serialNs = GetTimeNs() - start;
+
+				start = GetTimeNs();
+				GenerateProceduralTexture(desc, texture.data(), rowPitch, &jobs);
+				int64_t parallelNs = GetTimeNs() - start;
+
+				printf("%s %s %ux%u: 1 thread %.2f GB/s, %u threads %.2f GB/s\n", patternNames[p], formatNames[f],
+					size, size, bytes / serialNs, jobs.GetThreadCount(), bytes / parallelNs);
+			}
+		}
+		return 0;
+	}
+
+	// Best of a few runs, after one that faults the pages in.
+	double MeasureCopyGBs(const std::function<void()>& copy, double bytes)
+	{
+		copy();
+		int64_t bestNs = INT64_MAX;
+		for (int run = 0; run < 5; ++run)
+		{
+			int64_t start = GetTimeNs();
+			copy();
+			bestNs = std::min(bestNs, GetTimeNs() - start);
+		}
+		return bytes / bestNs;
+	}
+
+	// Footprints of RGBA8 2D textures laid out the way D3D12 does: rows 256-byte aligned,
+	// subresources 512-byte aligned. mDeviceRefs stands in for GetDevice/Release.
+	struct FStubFootprintBackend
+	{
+		struct Desc
+		{
+			uint32_t mWidth;
+			uint32_t mHeight;
+			uint32_t mMipLevels;
+		};
+
+		struct Layout
+		{
+			uint64_t mOffset;
+			uint32_t mWidth;
+			uint32_t mHeight;
+			uint32_t mRowPitch;
+		};
+
+		std::atomic<uint32_t> mDeviceRefs{ 0 };
+
+		static uint64_t HashDesc(const Desc& desc)
+		{
+			uint64_t hash = FootprintHashSeed;
+			hash = HashFootprintField(hash, desc.mWidth);
+			hash = HashFootprintField(hash, desc.mHeight);
+			return HashFootprintField(hash, desc.mMipLevels);
+		}
+
+		static bool EqualDesc(const Desc& a, const Desc& b)
+		{
+			return a.mWidth == b.mWidth && a.mHeight == b.mHeight && a.mMipLevels == b.mMipLevels;
+		}
+
+		void GetFootprints(const Desc& desc, uint32_t first, uint32_t count,
+			Layout* layouts, uint32_t* numRows, uint64_t* rowSizes, uint64_t* totalSize)
+		{
+			mDeviceRefs.fetch_add(1, std::memory_order_relaxed);
+			uint64_t offset = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t mip = first + i;
+				Layout& layout = layouts[i];
+				offset = (offset + 511) & ~uint64_t(511);
+				layout.mOffset = offset;
+				layout.mWidth = std::max(desc.mWidth >> mip, 1u);
+				layout.mHeight = std::max(desc.mHeight >> mip, 1u);
+				layout.mRowPitch = (layout.mWidth * 4 + 255) & ~255u;
+				numRows[i] = layout.mHeight;
+				rowSizes[i] = layout.mWidth * 4ull;
+				offset += static_cast<uint64_t>(layout.mRowPitch) * layout.mHeight;
+			}
+			*totalSize = offset;
+			mDeviceRefs.fetch_sub(1, std::memory_order_relaxed);
+		}
+	};
+
+	int FootprintBench(uint32_t iterations, uint32_t workerThreads)
+	{
+		typedef CFootprintCache<FStubFootprintBackend> CStubFootprintCache;
+		const FStubFootprintBackend::Desc shapes[] =
+		{
+			{ 256, 256, 9 }, { 512, 512, 10 }, { 1024, 1024, 11 }, { 2048, 1024, 12 },
+			{ 128, 128, 8 }, { 64, 64, 7 }, { 4096, 4096, 13 }, { 1024, 512, 11 },
+		};
+		const uint32_t shapeCount = sizeof(shapes) / sizeof(shapes[0]);
+
+		CStubFootprintCache cache;
+		CJobSystem jobs(workerThreads);
+		volatile uint64_t sink = 0;
+
+		// What the heap-allocating UpdateSubresources does per call.
+		auto uncached = [&](uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const FStubFootprintBackend::Desc& desc = shapes[i % shapeCount];
+				size_t bytes = (sizeof(FStubFootprintBackend::Layout) + sizeof(uint32_t) + sizeof(uint64_t)) * desc.mMipLevels;
+				void* memory = malloc(bytes);
+				FStubFootprintBackend::Layout* layouts = static_cast<FStubFootprintBackend::Layout*>(memory);
+				uint64_t* rowSizes = reinterpret_cast<uint64_t*>(layouts + desc.mMipLevels);
+				uint32_t* numRows = reinterpret_cast<uint32_t*>(rowSizes + desc.mMipLevels);
+				uint64_t totalSize = 0;
+				cache.GetBackend().GetFootprints(desc, 0, desc.mMipLevels, layouts, numRows, rowSizes, &totalSize);
+				sink = sink + totalSize;
+				free(memory);
+			}
+		};
+		auto cached = [&](uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const FStubFootprintBackend::Desc& desc = shapes[i % shapeCount];
+				sink = sink + cache.Get(desc, 0, desc.mMipLevels).mTotalSize;
+			}
+		};
+
+		const char* names[] = { "uncached", "cached" };
+		uint64_t cachedLookups = 0;
+		for (uint32_t pass = 0; pass < 2; ++pass)
+		{
+			std::function<void(uint32_t)> lookup = pass == 0 ? std::function<void(uint32_t)>(uncached) : std::function<void(uint32_t)>(cached);
+
+			int64_t start = GetTimeNs();
+			lookup(iterations);
+			double serialNs = static_cast<double>(GetTimeNs() - start) / iterations;
+
+			uint32_t threads = jobs.GetThreadCount();
+			start = GetTimeNs();
+			jobs.ParallelFor(threads, 1, [&](uint32_t, uint32_t) { lookup(iterations); });
+			double parallelNs = static_cast<double>(GetTimeNs() - start) / iterations;
+
+			printf("%s: 1 thread %.1fns per upload, %u threads %.1fns per upload per thread\n",
+				names[pass], serialNs, threads, parallelNs);
+			cachedLookups = static_cast<uint64_t>(iterations) * (1 + threads);
+		}
+
+		// The cache does not count its hits; every lookup that did not miss was one.
+		FFootprintCacheStats stats = cache.GetStats();
+		printf("footprint cache: %llu hits, %llu misses, %llu entries\n",
+			static_cast<unsigned long long>(cachedLookups - stats.mMisses),
+			static_cast<unsigned long long>(stats.mMisses), static_cast<unsigned long long>(stats.mEntries));
+		return 0;
+	}
+
+	int CopyBench(uint32_t size, uint32_t workerThreads)
+	{
+		const uint32_t volumeSize = std::max(size / 4, 1u);
+		const uint32_t volumeDepth = 32;
+		struct FCase
+		{
+			const char* mName;
+			uint32_t mWidth;
+			uint32_t mHeight;
+			uint32_t mDepth;
+			bool mAlignedPitch;
+		};
+		const FCase cases[] =
+		{
+			{ "packed 2D", size, size, 1, false },
+			{ "pitched 2D", size - 1, size, 1, true },
+			{ "pitched volume", volumeSize - 1, volumeSize, volumeDepth, true },
+		};
+
+		CJobSystem jobs(workerThreads);
+		for (const FCase& c : cases)
+		{
+			size_t rowSize = static_cast<size_t>(std::max(c.mWidth, 1u)) * 4;
+			size_t dstRowPitch = c.mAlignedPitch ? (rowSize + 255) & ~size_t(255) : rowSize;
+			std::vector<uint8_t> src(rowSize * c.mHeight * c.mDepth, 0x5a);
+			std::vector<uint8_t> dst(dstRowPitch * c.mHeight * c.mDepth);
+
+			FSubresourceCopy copy;
+			copy.mSrc = src.data();
+			copy.mSrcRowPitch = rowSize;
+			copy.mSrcSlicePitch = rowSize * c.mHeight;
+			copy.mDst = dst.data();
+			copy.mDstRowPitch = dstRowPitch;
+			copy.mDstSlicePitch = dstRowPitch * c.mHeight;
+			copy.mRowSize = rowSize;
+			copy.mNumRows = c.mHeight;
+			copy.mNumSlices = c.mDepth;
+
+			double bytes = static_cast<double>(src.size());
+			double rowsGBs = MeasureCopyGBs([&]() { CopySubresourceRows(copy); }, bytes);
+			double cachedGBs = MeasureCopyGBs([&]() { CopySubresource(copy, ESubresourceCopyTarget::Cached, nullptr); }, bytes);
+			double streamGBs = MeasureCopyGBs([&]() { CopySubresource(copy, ESubresourceCopyTarget::WriteCombined, nullptr); }, bytes);
+			double parallelGBs = MeasureCopyGBs([&]() { CopySubresource(copy, ESubresourceCopyTarget::WriteCombined, &jobs); }, bytes);
+
+			printf("%s %ux%ux%u (%.1f MB): rows %.2f GB/s, cached %.2f GB/s, streaming %.2f GB/s, %u threads %.2f GB/s\n",
+				c.mName, c.mWidth, c.mHeight, c.mDepth, bytes / (1024.0 * 1024.0), rowsGBs, cachedGBs, streamGBs,
+				jobs.GetThreadCount(), parallelGBs);
+		}
+		return 0;
+	}
+
+	const char* GetFormatName(ERenderFormat format)
+	{
+		static const char* const names[] =
+		{
+			"Unknown", "RGBA8Unorm", "RGB32Float", "RGBA32Float", "R16Uint", "RGBA8UnormSrgb",
+			"BC1Unorm", "BC1UnormSrgb", "BC2Unorm", "BC2UnormSrgb", "BC3Unorm", "BC3UnormSrgb",
+			"BC4Unorm", "BC4Snorm", "BC5Unorm", "BC5Snorm", "BC6HUfloat", "BC6HSfloat", "BC7Unorm", "BC7UnormSrgb",
+		};
+		size_t index = static_cast<size_t>(format);
+		return index < sizeof(names) / sizeof(names[0]) ? names[index] : "?";
+	}
+
+	// PSNR over the channels [channelBegin, channelEnd) of two RGBA8 images of texelCount texels.
+	double MeasurePSNR(const uint8_t* a, const uint8_t* b, size_t texelCount, uint32_t channelBegin, uint32_t channelEnd)
+	{
+		double squaredError = 0.0;
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			for (uint32_t c = channelBegin; c < channelEnd; ++c)
+			{
+				double d = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+				squaredError += d * d;
+			}
+		}
+		double meanSquaredError = squaredError / (static_cast<double>(texelCount) * (channelEnd - channelBegin));
+		return meanSquaredError == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+	}
+
+	int CompressBench(uint32_t size, uint32_t workerThreads)
+	{
+		// Perlin colours, with alpha from value noise for the formats that keep it.
+		FProceduralTextureDesc desc;
+		desc.mPattern = EProceduralPattern::PerlinNoise;
+		desc.mWidth = size;
+		desc.mHeight = size;
+		desc.mCellSize = std::max(size / 8, 4u);
+		const float color0[4] = { 0.9f, 0.3f, 0.1f, 1.0f };
+		const float color1[4] = { 0.1f, 0.5f, 0.95f, 1.0f };
+		memcpy(desc.mColor0, color0, sizeof(color0));
+		memcpy(desc.mColor1, color1, sizeof(color1));
+		std::vector<uint8_t> opaque(static_cast<size_t>(size) * size * 4);
+		GenerateProceduralTexture(desc, opaque.data(), size * 4, nullptr);
+
+		desc.mPattern = EProceduralPattern::ValueNoise;
+		desc.mSeed = 1;
+		std::vector<uint8_t> alpha(opaque.size());
+		GenerateProceduralTexture(desc, alpha.data(), size * 4, nullptr);
+		std::vector<uint8_t> translucent(opaque);
+		for (size_t i = 0; i < translucent.size(); i += 4)
+		{
+			translucent[i + 3] = alpha[i];
+		}
+
+		const ERenderFormat formats[] = { ERenderFormat::BC1Unorm, ERenderFormat::BC3Unorm, ERenderFormat::BC7Unorm };
+		const EBlockCompressMode modes[] = { EBlockCompressMode::Fast, EBlockCompressMode::Quality };
+		const char* modeNames[] = { "fast", "quality" };
+
+		CJobSystem jobs(workerThreads);
+		const double pixels = static_cast<double>(size) * size;
+		std::vector<uint8_t> decoded(opaque.size());
+		for (ERenderFormat format : formats)
+		{
+			const std::vector<uint8_t>& src = format == ERenderFormat::BC1Unorm ? opaque : translucent;
+			uint32_t rowPitch = static_cast<uint32_t>(GetFormatRowBytes(format, size));
+			uint32_t blockRows = GetFormatRowCount(format, size);
+			std::vector<uint8_t> blocks(static_cast<size_t>(rowPitch) * blockRows);
+
+			for (uint32_t m = 0; m < 2; ++m)
+			{
+				auto measure = [&](const std::function<void()>& compress)
+				{
+					int64_t start = GetTimeNs();
+					compress();
+					return pixels / ((GetTimeNs() - start) * 1e-3);
+				};
+				double scalarRate = measure([&]() { CompressTextureRowsScalar(format, modes[m], src.data(), size, size, size * 4, blocks.data(), rowPitch, 0, blockRows); });
+				double serialRate = measure([&]() { CompressTexture(format, modes[m], src.data(), size, size, size * 4, blocks.data(), rowPitch, nullptr); });
+				double parallelRate = measure([&]() { CompressTexture(format, modes[m], src.data(), size, size, size * 4, blocks.data(), rowPitch, &jobs); });
+
+				DecompressTexture(format, blocks.data(), rowPitch, size, size, decoded.data(), size * 4);
+				double colorPSNR = MeasurePSNR(src.data(), decoded.data(), opaque.size() / 4, 0, 3);
+				double alphaPSNR = MeasurePSNR(src.data(), decoded.data(), opaque.size() / 4, 3, 4);
+
+				printf("%s %s %ux%u: scalar %.1f MPix/s, 1 thread %.1f MPix/s, %u threads %.1f MPix/s, PSNR RGB %.2f dB",
+					GetFormatName(format), modeNames[m], size, size, scalarRate, serialRate, jobs.GetThreadCount(),
+					parallelRate, colorPSNR);
+				if (format != ERenderFormat::BC1Unorm)
+				{
+					printf(", alpha %.2f dB", alphaPSNR);
+				}
+				printf("\n");
+			}
+		}
+		return 0;
+	}
+
+	int PacerSim(uint32_t frameCount, int64_t frameCostNs)
+	{
+		struct FSleepProfile
+		{
+			const char* mName;
+			int64_t mOvershootNs;
+			int64_t mJitterNs;
+		};
+		const FSleepProfile profiles[] =
+		{
+			{ "exact", 0, 0 },
+			{ "high-resolution timer", 50000, 450000 },
+			{ "1ms timer", 500000, 1000000 },
+			{ "15.6ms tick", 0, 15600000 },
+		};
+		const double rates[] = { 60.0, 144.0 };
+
+		for (double rate : rates)
+		{
+			for (const FSleepProfile& profile : profiles)
+			{
+				CSimulatedFrameClock clock(profile.mOvershootNs, profile.mJitterNs, 50);
+				CFramePacer pacer(clock);
+				pacer.SetMode(EFramePacingMode::FixedRate, rate);
+				for (uint32_t i = 0; i < frameCount; ++i)
+				{
+					pacer.WaitForNextFrame();
+					clock.Advance(frameCostNs);
+				}
+
+				const FFramePacerStats& stats = pacer.GetStats();
+				printf("%.0fHz, %s sleeps: interval %.3fms, jitter %.1fus, max lateness %.1fus, sleeping %.1f%%, spinning %.1f%%\n",
+					rate, profile.mName, stats.mMeanIntervalNs * 1e-6, stats.mJitterNs * 1e-3, stats.mMaxLatenessNs * 1e-3,
+					100.0 * stats.mSleepNs / std::max(stats.mElapsedNs, int64_t(1)), 100.0 * stats.GetSpinFraction());
+			}
+		}
+		return 0;
+	}
+
+	// Heaps cost nothing; only the placement is measured.
+	struct FBenchHeapBackend
+	{
+		typedef uint32_t Heap;
+		typedef int Kind;
+
+		Heap CreateHeap(const Kind&, uint64_t)
+		{
+			return 0;
+		}
+	};
+
+	int HeapBench(uint32_t frameCount)
+	{
+		typedef CGPUHeapAllocator<FBenchHeapBackend> CAllocator;
+		const uint64_t heapSize = 64 * 1024 * 1024;
+		const uint64_t committedAlignment = 64 * 1024;
+		const uint32_t allocationsPerFrame = 8;
+		const uint32_t framesInFlight = 2;
+
+		struct FResource
+		{
+			CAllocator::FAllocation mAllocation;
+			uint64_t mSize;
+			uint32_t mLastFrame;
+		};
+
+		CAllocator allocator(FBenchHeapBackend(), heapSize, 4096);
+		std::vector<FResource> resources;
+		uint32_t random = 0x9E3779B9u;
+		auto next = [&random]()
+		{
+			random ^= random << 13;
+			random ^= random >> 17;
+			random ^= random << 5;
+			return random;
+		};
+
+		int64_t allocateNs = 0;
+		int64_t retireNs = 0;
+		uint64_t allocations = 0;
+		uint64_t committedBytes = 0;
+		uint64_t peakCommittedBytes = 0;
+		uint64_t peakHeapBytes = 0;
+		for (uint32_t frame = 1; frame <= frameCount; ++frame)
+		{
+			for (uint32_t i = 0; i < allocationsPerFrame; ++i)
+			{
+				// Half small textures (4-64 KB), a third buffers (64 KB-1 MB), the rest large
+				// textures (1-16 MB); sizes are not powers of two.
+				uint32_t kind = next() % 6;
+				uint64_t size;
+				uint64_t alignment;
+				if (kind < 3)
+				{
+					size = 4096 + next() % (60 * 1024);
+					alignment = 4096;
+				}
+				else if (kind < 5)
+				{
+					size = 64 * 1024 + next() % (960 * 1024);
+					alignment = committedAlignment;
+				}
+				else
+				{
+					size = 1024 * 1024 + next() % (15 * 1024 * 1024);
+					alignment = committedAlignment;
+				}
+
+				int64_t start = GetTimeNs();
+				FResource resource;
+				resource.mAllocation = allocator.Allocate(0, size, alignment);
+				allocateNs += GetTimeNs() - start;
+				resource.mSize = size;
+				resource.mLastFrame = frame + 1 + next() % 256;
+				resources.push_back(resource);
+
+				++allocations;
+				committedBytes += (size + committedAlignment - 1) & ~(committedAlignment - 1);
+			}
+
+			int64_t start = GetTimeNs();
+			for (size_t i = 0; i < resources.size();)
+			{
+				if (resources[i].mLastFrame == frame)
+				{
+					allocator.Retire(resources[i].mAllocation);
+					committedBytes -= (resources[i].mSize + committedAlignment - 1) & ~(committedAlignment - 1);
+					resources[i] = resources.back();
+					resources.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+			allocator.OnSignal(frame);
+			if (frame > framesInFlight)
+			{
+				allocator.Collect(frame - framesInFlight);
+			}
+			retireNs += GetTimeNs() - start;
+
+			peakCommittedBytes = std::max(peakCommittedBytes, committedBytes);
+			peakHeapBytes = std::max(peakHeapBytes, allocator.GetStats().mHeapBytes);
+		}
+
+		const FGPUHeapAllocatorStats stats = allocator.GetStats();
+		printf("%llu allocations over %u frames, %zu live at the end\n",
+			static_cast<unsigned long long>(allocations), frameCount, resources.size());
+		printf("allocate %.0fns, retire and collect %.0fns per allocation\n",
+			static_cast<double>(allocateNs) / allocations, static_cast<double>(retireNs) / allocations);
+		printf("peak memory: heaps %.1f MB (%llu created, %llu released), committed %.1f MB\n",
+			peakHeapBytes / (1024.0 * 1024.0), static_cast<unsigned long long>(stats.mHeapsCreated),
+			static_cast<unsigned long long>(stats.mHeapsReleased), peakCommittedBytes / (1024.0 * 1024.0));
+		printf("fragmentation: internal %.1f%%, external %.1f%%, %llu blocks retired\n",
+			100.0 * stats.mBlocks.GetInternalFragmentation(), 100.0 * stats.mBlocks.GetExternalFragmentation(),
+			static_cast<unsigned long long>(stats.mRetiredBlocks));
+
+		for (FResource& resource : resources)
+		{
+			allocator.Free(resource.mAllocation);
+		}
+		return 0;
+	}
+
+	int DDSInfo(const char* path)
+	{
+		CMappedFile file(path);
+		FDDSTexture texture;
+		ParseDDS(file.GetData(), file.GetSize(), texture);
+
+		uint32_t count = static_cast<uint32_t>(texture.mSubresources.size());
+		std::vector<FTextureFootprint> footprints(count);
+		uint64_t uploadSize = GetTextureFootprints(texture.mFormat, texture.mWidth, texture.mHeight, texture.mMipLevels,
+			0, count, footprints.data());
+
+		printf("%s: %s %ux%u, %u mips, %u slices%s, %zu bytes, upload buffer %llu bytes\n", path,
+			GetFormatName(texture.mFormat), texture.mWidth, texture.mHeight, texture.mMipLevels, texture.mArraySize,
+			texture.mCubeMap ? " (cube map)" : "", file.GetSize(), static_cast<unsigned long long>(uploadSize));
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const FDDSSubresource& subresource = texture.mSubresources[i];
+			const FTextureFootprint& footprint = footprints[i];
+			printf("  %3u: %ux%u file offset %llu pitch %u rows %u, upload offset %llu pitch %u rows %u\n",
+				i, subresource.mWidth, subresource.mHeight, static_cast<unsigned long long>(subresource.mOffset),
+				subresource.mRowPitch, subresource.mNumRows, static_cast<unsigned long long>(footprint.mOffset),
+				footprint.mRowPitch, footprint.mNumRows);
+		}
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t frameCount = 1000;
+	const char* capturePath = nullptr;
+	uint32_t captureFrames = 1;
+	const char* replayPath = nullptr;
+	uint32_t iterations = 10000;
+	bool deviceSink = false;
+	bool jobBench = false;
+	uint32_t recordBenchDraws = 0;
+	uint32_t textureBenchSize = 0;
+	uint32_t copyBenchSize = 0;
+	uint32_t compressBenchSize = 0;
+	bool footprintBench = false;
+	const char* ddsInfoPath = nullptr;
+	bool pacerSim = false;
+	bool heapBench = false;
+	bool selfTest = false;
+	const char* selfTestFilter = nullptr;
+	bool checkAllocations = false;
+	FLoopOptions loopOptions;
+	bool compare = false;
+	int64_t gpuLatencyNs = 0;
+
+	FRendererConfig config;
+	// No Present to throttle the loop.
+	config.mPacingMode = EFramePacingMode::Uncapped;
+	config.mLog = [](const char* line) { fputs(line, stdout); };
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+		{
+			frameCount = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-inflight") == 0 && i + 1 < argc)
+		{
+			config.mFramesInFlight = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-recordthreads") == 0 && i + 1 < argc)
+		{
+			config.mRecordThreads = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-workers") == 0 && i + 1 < argc)
+		{
+			config.mWorkerThreads = std::max(atoi(argv[++i]), 0);
+		}
+		else if (strcmp(argv[i], "-pipelined") == 0)
+		{
+			loopOptions.mPipelined = true;
+		}
+		else if (strcmp(argv[i], "-updatecost") == 0 && i + 1 < argc)
+		{
+			loopOptions.mUpdateCostNs = std::max(atoi(argv[++i]), 0) * 1000ll;
+		}
+		else if (strcmp(argv[i], "-rendercost") == 0 && i + 1 < argc)
+		{
+			loopOptions.mRenderCostNs = std::max(atoi(argv[++i]), 0) * 1000ll;
+		}
+		else if (strcmp(argv[i], "-compare") == 0)
+		{
+			compare = true;
+		}
+		else if (strcmp(argv[i], "-gpulatency") == 0 && i + 1 < argc)
+		{
+			gpuLatencyNs = std::max(atoi(argv[++i]), 0) * 1000ll;
+		}
+		else if (strcmp(argv[i], "-fencewait") == 0 && i + 1 < argc)
+		{
+			++i;
+			if (strcmp(argv[i], "adaptive") == 0)
+			{
+				config.mFenceWaitPolicy = FFenceWaitPolicy::Adaptive();
+			}
+			else if (strcmp(argv[i], "block") == 0)
+			{
+				config.mFenceWaitPolicy = FFenceWaitPolicy::Block();
+			}
+			else
+			{
+				config.mFenceWaitPolicy = FFenceWaitPolicy::Spin(std::max(atoi(argv[i]), 0) * 1000ll);
+			}
+		}
+		else if (strcmp(argv[i], "-vsync") == 0)
+		{
+			config.mPacingMode = EFramePacingMode::VSync;
+		}
+		else if (strcmp(argv[i], "-capture") == 0 && i + 1 < argc)
+		{
+			capturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-captureframes") == 0 && i + 1 < argc)
+		{
+			captureFrames = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+		{
+			iterations = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-sink") == 0 && i + 1 < argc)
+		{
+			deviceSink = strcmp(argv[++i], "device") == 0;
+		}
+		else if (strcmp(argv[i], "-texturesize") == 0 && i + 1 < argc)
+		{
+			config.mTextureSize = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-texture") == 0 && i + 1 < argc)
+		{
+			config.mTexturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-textureformat") == 0 && i + 1 < argc)
+		{
+			++i;
+			config.mTextureFormat = strcmp(argv[i], "bc1") == 0 ? ERenderFormat::BC1Unorm :
+				strcmp(argv[i], "bc3") == 0 ? ERenderFormat::BC3Unorm :
+				strcmp(argv[i], "bc7") == 0 ? ERenderFormat::BC7Unorm : ERenderFormat::RGBA8Unorm;
+		}
+		else if (strcmp(argv[i], "-texturequality") == 0 && i + 1 < argc)
+		{
+			config.mTextureCompression = strcmp(argv[++i], "quality") == 0 ? EBlockCompressMode::Quality : EBlockCompressMode::Fast;
+		}
+		else if (strcmp(argv[i], "-jobbench") == 0)
+		{
+			jobBench = true;
+		}
+		else if (strcmp(argv[i], "-recordbench") == 0 && i + 1 < argc)
+		{
+			recordBenchDraws = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-texturebench") == 0 && i + 1 < argc)
+		{
+			textureBenchSize = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "-copybench") == 0 && i + 1 < argc)
+		{
+			copyBenchSize = std::max(atoi(argv[++i]), 8);
+		}
+		else if (strcmp(argv[i], "-compressbench") == 0 && i + 1 < argc)
+		{
+			compressBenchSize = std::max(atoi(argv[++i]), 4);
+		}
+		else if (strcmp(argv[i], "-footprintbench") == 0)
+		{
+			footprintBench = true;
+		}
+		else if (strcmp(argv[i], "-ddsinfo") == 0 && i + 1 < argc)
+		{
+			ddsInfoPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-pacersim") == 0)
+		{
+			pacerSim = true;
+		}
+		else if (strcmp(argv[i], "-heapbench") == 0)
+		{
+			heapBench = true;
+		}
+		else if (strcmp(argv[i], "-selftest") == 0)
+		{
+			selfTest = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				selfTestFilter = argv[++i];
+			}
+		}
+		else if (strcmp(argv[i], "-checkallocs") == 0)
+		{
+			checkAllocations = true;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	try
+	{
+		if (replayPath)
+		{
+			return Replay(replayPath, iterations, deviceSink);
+		}
+		if (jobBench)
+		{
+			return JobBench(config.mWorkerThreads);
+		}
+		if (recordBenchDraws)
+		{
+			return RecordBench(recordBenchDraws, frameCount, config.mWorkerThreads);
+		}
+		if (textureBenchSize)
+		{
+			return TextureBench(textureBenchSize, config.mWorkerThreads);
+		}
+		if (copyBenchSize)
+		{
+			return CopyBench(copyBenchSize, config.mWorkerThreads);
+		}
+		if (compressBenchSize)
+		{
+			return CompressBench(compressBenchSize, config.mWorkerThreads);
+		}
+		if (footprintBench)
+		{
+			return FootprintBench(iterations, config.mWorkerThreads);
+		}
+		if (ddsInfoPath)
+		{
+			return DDSInfo(ddsInfoPath);
+		}
+		if (pacerSim)
+		{
+			return PacerSim(frameCount, loopOptions.mUpdateCostNs);
+		}
+		if (heapBench)
+		{
+			return HeapBench(frameCount);
+		}
+		if (selfTest)
+		{
+			return RunHeadlessTests(selfTestFilter) == 0 ? 0 : 1;
+		}
+		if (compare)
+		{
+			return ComparePipelining(config, frameCount, loopOptions);
+		}
+
+		CNullRenderDevice device;
+		device.SetGPULatency(gpuLatencyNs);
+		CCaptureRenderDevice captureDevice(device);
+		CHelloRenderer renderer(capturePath ? static_cast<IRenderDevice&>(captureDevice) : device, config);
+		captureFrames = std::min(captureFrames, frameCount);
+
+		int64_t initStart = GetTimeNs();
+		renderer.OnInit();
+		int64_t initNs = GetTimeNs() - initStart;
+		device.ResetStats();
+
+		const uint32_t warmupFrames = std::min(AllocationWarmupFrames, frameCount / 2);
+		uint64_t allocationsAtWarmup = 0;
+		std::vector<int64_t> frameNs = RunFrames(renderer, frameCount, loopOptions,
+			[&](uint32_t frame)
+			{
+				if (frame == warmupFrames)
+				{
+					allocationsAtWarmup = gHeapAllocations.load(std::memory_order_relaxed);
+				}
+				if (capturePath && frame == frameCount - captureFrames)
+				{
+					captureDevice.BeginCapture();
+				}
+			});
+		const uint64_t frameAllocations = gHeapAllocations.load(std::memory_order_relaxed) - allocationsAtWarmup;
+
+		if (capturePath)
+		{
+			std::vector<uint8_t> stream = captureDevice.EndCapture();
+			FILE* file = fopen(capturePath, "wb");
+			if (!file || fwrite(stream.data(), 1, stream.size(), file) != stream.size())
+			{
+				throw std::runtime_error(std::string("Cannot write ") + capturePath);
+			}
+			fclose(file);
+			printf("captured %u frames to %s (%zu bytes)\n", captureFrames, capturePath, stream.size());
+		}
+
+		const FNullRenderStats stats = device.GetStats();
+		// Since the renderer's last once-a-second reset.
+		const FFenceTimelineStats fenceStats = renderer.GetFrameTimeline().GetStats();
+		const int64_t spinBudgetNs = renderer.GetFrameTimeline().GetWaitPolicy().mSpinNs;
+		const CPresentController& presentController = renderer.GetPresentController();
+		const FPresentControllerStats presentStats = presentController.GetStats();
+		const FUploadRingStats uploadStats = renderer.GetUploadRingStats();
+		renderer.OnDestroy();
+
+		int64_t totalNs = GetTotalNs(frameNs);
+		std::sort(frameNs.begin(), frameNs.end());
+
+		printf("init: %.3fms\n", initNs * 1e-6);
+		printf("frames: %u, cpu frame: mean %.4fms, p50 %.4fms, p99 %.4fms, max %.4fms\n",
+			frameCount, totalNs * 1e-6 / frameCount,
+			GetPercentileMs(frameNs, 0.5), GetPercentileMs(frameNs, 0.99), frameNs.back() * 1e-6);
+		printf("per frame: %.1f lists, %.1f commands, %.1f draws, %.1f barriers, %.1f signals, %.1f waits\n",
+			static_cast<double>(stats.mListsExecuted) / frameCount,
+			static_cast<double>(stats.mCommandsExecuted) / frameCount,
+			static_cast<double>(stats.mDraws) / frameCount,
+			static_cast<double>(stats.mBarriers) / frameCount,
+			static_cast<double>(stats.mSignals) / frameCount,
+			static_cast<double>(stats.mWaits) / frameCount);
+		printf("presents: %llu, allocators created: %llu, lists created: %llu\n",
+			static_cast<unsigned long long>(stats.mPresents),
+			static_cast<unsigned long long>(stats.mAllocatorsCreated),
+			static_cast<unsigned long long>(stats.mListsCreated));
+		printf("upload ring: %llu allocations, %llu bytes, high water %llu bytes, %llu full\n",
+			static_cast<unsigned long long>(uploadStats.mAllocations),
+			static_cast<unsigned long long>(uploadStats.mBytesAllocated),
+			static_cast<unsigned long long>(uploadStats.mHighWater),
+			static_cast<unsigned long long>(uploadStats.mFullCount));
+		printf("frame fence: %llu stalls, %.3fms stalled, spin/yield/block %llu/%llu/%llu, spin budget %.1fus\n",
+			static_cast<unsigned long long>(fenceStats.mWaitCount), fenceStats.mStallNs * 1e-6,
+			static_cast<unsigned long long>(fenceStats.mSpinWaits), static_cast<unsigned long long>(fenceStats.mYieldWaits),
+			static_cast<unsigned long long>(fenceStats.mBlockingWaits), spinBudgetNs * 1e-3);
+		for (uint32_t i = 0; i < FStallHistogram::BucketCount; ++i)
+		{
+			if (fenceStats.mStallHistogram.mBuckets[i] != 0)
+			{
+				printf("    stalls < %9.1fus: %llu\n", FStallHistogram::GetBucketLimitNs(i) * 1e-3,
+					static_cast<unsigned long long>(fenceStats.mStallHistogram.mBuckets[i]));
+			}
+		}
+		if (config.mPacingMode == EFramePacingMode::VSync)
+		{
+			printf("present: %s at the end, %llu switches, %llu missed vblanks, frames vsync/tearing/half rate %llu/%llu/%llu\n",
+				GetPresentModeName(presentController.GetMode()),
+				static_cast<unsigned long long>(presentStats.mModeSwitches),
+				static_cast<unsigned long long>(presentStats.mMissedVBlanks),
+				static_cast<unsigned long long>(presentStats.mFramesInMode[0]),
+				static_cast<unsigned long long>(presentStats.mFramesInMode[1]),
+				static_cast<unsigned long long>(presentStats.mFramesInMode[2]));
+		}
+		printf("heap allocations: %llu in the last %u frames\n",
+			static_cast<unsigned long long>(frameAllocations), frameCount - warmupFrames);
+		if (checkAllocations && frameAllocations != 0)
+		{
+			fprintf(stderr, "The frame loop allocated after warming up.\n");
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "Headless run failed: %s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,2222 @@
+#include "HeadlessTests.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BlockCompress.h"
+#include "BuddyAllocator.h"
+#include "CaptureRenderDevice.h"
+#include "CommandAllocatorPool.h"
+#include "CommandStream.h"
+#include "DDSTexture.h"
+#include "DeferredReleaseQueue.h"
+#include "FenceTimeline.h"
+#include "FenceWaitPolicy.h"
+#include "FootprintCache.h"
+#include "FrameArena.h"
+#include "FrameContextRing.h"
+#include "FramePacer.h"
+#include "GPUHeapAllocator.h"
+#include "HelloRenderer.h"
+#include "JobSystem.h"
+#include "LatencyTracker.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "NullRenderDevice.h"
+#include "PassSchedule.h"
+#include "PresentController.h"
+#include "ProceduralTexture.h"
+#include "RenderCommandAllocatorPool.h"
+#include "SubresourceCopy.h"
+#include "UploadRing.h"
+#include "UploadTracker.h"
+
+namespace
+{
+	uint32_t gChecks = 0;
+	uint32_t gFailures = 0;
+
+	void Check(bool passed, const char* expression, const char* file, int line)
+	{
+		++gChecks;
+		if (!passed)
+		{
+			++gFailures;
+			printf("    %s:%d: check failed: %s\n", file, line, expression);
+		}
+	}
+
+#define HEADLESS_CHECK(expression) Check((expression), #expression, __FILE__, __LINE__)
+
+	// Fence whose GPU is only as far along as the test says; a CPU wait catches it up.
+	struct FFakeFence
+	{
+		uint64_t mCompleted = 0;
+		uint64_t mWaitCount = 0;
+		uint64_t mLastWait = 0;
+
+		// Calls to WaitForValues, and the fences in the last one.
+		static uint32_t sBatchedWaits;
+		static uint32_t sLastBatchSize;
+
+		uint64_t GetCompletedValue()
+		{
+			return mCompleted;
+		}
+
+		void Signal(uint64_t)
+		{
+		}
+
+		void WaitForValue(uint64_t value)
+		{
+			++mWaitCount;
+			mLastWait = value;
+			if (mCompleted < value)
+			{
+				mCompleted = value;
+			}
+		}
+
+		static void WaitForValues(FFakeFence* const* fences, const uint64_t* values, uint32_t count)
+		{
+			++sBatchedWaits;
+			sLastBatchSize = count;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				fences[i]->WaitForValue(values[i]);
+			}
+		}
+	};
+
+	uint32_t FFakeFence::sBatchedWaits = 0;
+	uint32_t FFakeFence::sLastBatchSize = 0;
+
+	void TestFrameContextRing()
+	{
+		CFrameContextRing<uint32_t> ring;
+		ring.Initialize(3);
+		FFakeFence fence;
+
+		// The first lap finds every slot free, however far behind the GPU is.
+		for (uint32_t frame = 0; frame < 3; ++frame)
+		{
+			HEADLESS_CHECK(ring.GetCurrentIndex() == frame);
+			ring.BeginFrame(fence) = frame;
+			ring.EndFrame(frame + 1);
+		}
+		HEADLESS_CHECK(fence.mWaitCount == 0);
+		HEADLESS_CHECK(ring.GetFrameNumber() == 3);
+
+		// Then the ring wraps, and each frame waits for the oldest one, whose slot it reuses.
+		HEADLESS_CHECK(ring.GetCurrentIndex() == 0);
+		HEADLESS_CHECK(ring.BeginFrame(fence) == 0);
+		HEADLESS_CHECK(fence.mWaitCount == 1 && fence.mLastWait == 1);
+		ring.EndFrame(4);
+		HEADLESS_CHECK(ring.GetStallCount() == 1);
+
+		// No wait for a slot whose frame the GPU has already finished.
+		fence.mCompleted = 3;
+		ring.BeginFrame(fence);
+		ring.EndFrame(5);
+		ring.BeginFrame(fence);
+		ring.EndFrame(6);
+		HEADLESS_CHECK(fence.mWaitCount == 1);
+		HEADLESS_CHECK(ring.GetFenceValue(0) == 4 && ring.GetFenceValue(1) == 5 && ring.GetFenceValue(2) == 6);
+		HEADLESS_CHECK(ring.GetFrameNumber() == 6 && ring.GetCurrentIndex() == 0);
+
+		// WaitIdle waits once, for the newest frame.
+		ring.WaitIdle(fence);
+		HEADLESS_CHECK(fence.mWaitCount == 2 && fence.mLastWait == 6);
+
+		// One frame in flight: every frame waits for the one before.
+		ring.Initialize(1);
+		fence = FFakeFence();
+		for (uint32_t frame = 0; frame < 4; ++frame)
+		{
+			ring.BeginFrame(fence);
+			HEADLESS_CHECK(fence.mCompleted == frame);
+			ring.EndFrame(frame + 1);
+		}
+		HEADLESS_CHECK(fence.mWaitCount == 3 && ring.GetStallCount() == 3);
+		HEADLESS_CHECK(ring.GetCurrentIndex() == 0 && ring.GetFrameNumber() == 4);
+	}
+
+	// frameCount frames of frameNs work each through a pacer on clock.
+	void RunPacedFrames(CFramePacer& pacer, CSimulatedFrameClock& clock, uint32_t frameCount, int64_t frameNs)
+	{
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			pacer.WaitForNextFrame();
+			clock.Advance(frameNs);
+		}
+	}
+
+	void TestFramePacer()
+	{
+		const int64_t periodNs = static_cast<int64_t>(1e9 / 60.0);
+
+		// Sleeps that always wake 1ms late: the pacer learns to sleep that much short and hits
+		// every deadline without spinning.
+		{
+			CSimulatedFrameClock clock(1000000, 0, 100);
+			CFramePacer pacer(clock);
+			pacer.SetMode(EFramePacingMode::FixedRate, 60.0);
+			RunPacedFrames(pacer, clock, 10, 4000000);
+			pacer.ResetStats();
+			RunPacedFrames(pacer, clock, 600, 4000000);
+
+			const FFramePacerStats& stats = pacer.GetStats();
+			HEADLESS_CHECK(stats.mFrameCount == 600);
+			HEADLESS_CHECK(std::abs(stats.mMeanIntervalNs - periodNs) < 1.0);
+			HEADLESS_CHECK(stats.mJitterNs < 1.0 && stats.mMaxLatenessNs == 0);
+			HEADLESS_CHECK(stats.mSpinNs == 0);
+		}
+
+		// Sleeps that wake 1-2ms late: the pacer sleeps short by its running estimate of the
+		// overshoot and spins out the rest. It still sleeps most of the wait, and frames start
+		// far closer to their deadlines than the sleeps' own spread.
+		{
+			CSimulatedFrameClock clock(1000000, 1000000, 100);
+			CFramePacer pacer(clock);
+			pacer.SetMode(EFramePacingMode::FixedRate, 60.0);
+			RunPacedFrames(pacer, clock, 10, 4000000);
+			pacer.ResetStats();
+			RunPacedFrames(pacer, clock, 600, 4000000);
+
+			const FFramePacerStats& stats = pacer.GetStats();
+			HEADLESS_CHECK(std::abs(stats.mMeanIntervalNs - periodNs) < 1000.0);
+			HEADLESS_CHECK(stats.mJitterNs < 100000.0);
+			HEADLESS_CHECK(stats.mMaxLatenessNs < 1000000);
+			HEADLESS_CHECK(stats.mSleepNs > 10 * stats.mSpinNs);
+			HEADLESS_CHECK(stats.GetSpinFraction() < 0.05);
+		}
+
+		// Frames longer than the period run back to back, without bursts to catch up.
+		{
+			CSimulatedFrameClock clock(0, 0, 100);
+			CFramePacer pacer(clock);
+			pacer.SetMode(EFramePacingMode::FixedRate, 60.0);
+			RunPacedFrames(pacer, clock, 10, 40000000);
+			const FFramePacerStats& stats = pacer.GetStats();
+			HEADLESS_CHECK(stats.mLastIntervalNs == 40000000);
+			HEADLESS_CHECK(stats.mSleepNs == 0 && stats.mSpinNs == 0);
+
+			// And once they are short again, the cadence resumes from there.
+			pacer.ResetStats();
+			RunPacedFrames(pacer, clock, 10, 1000000);
+			HEADLESS_CHECK(std::abs(pacer.GetStats().mLastIntervalNs - periodNs) <= 100);
+		}
+
+		// Uncapped and vsync'd loops are only measured.
+		{
+			CSimulatedFrameClock clock(0, 0, 100);
+			CFramePacer pacer(clock);
+			pacer.SetMode(EFramePacingMode::Uncapped);
+			RunPacedFrames(pacer, clock, 11, 3000000);
+			const FFramePacerStats& stats = pacer.GetStats();
+			HEADLESS_CHECK(stats.mFrameCount == 10 && stats.mMeanIntervalNs == 3000000.0);
+			HEADLESS_CHECK(stats.mJitterNs == 0.0 && stats.mSleepNs == 0 && stats.mSpinNs == 0);
+			HEADLESS_CHECK(stats.mElapsedNs == 30000000);
+		}
+	}
+
+	// Swap chain on a simulated timeline. Present queues a frame and every vblank shows the
+	// oldest queued one, which is when the tracker closes it. WaitForFrameLatency blocks, like
+	// the frame-latency waitable object, until fewer than maxLatency frames are queued.
+	class CFakePresenter
+	{
+		static const uint32_t MaxQueued = 8;
+
+		CLatencyTracker& mTracker;
+		int64_t mPeriodNs;
+		uint32_t mMaxLatency;
+		int64_t mNextVBlankNs;
+		uint64_t mQueue[MaxQueued];
+		uint32_t mQueueBegin = 0;
+		uint32_t mQueued = 0;
+
+		void Flip()
+		{
+			if (mQueued != 0)
+			{
+				mTracker.OnPresented(mQueue[mQueueBegin], mNextVBlankNs);
+				mQueueBegin = (mQueueBegin + 1) % MaxQueued;
+				--mQueued;
+			}
+			mNextVBlankNs += mPeriodNs;
+		}
+
+	public:
+		CFakePresenter(CLatencyTracker& tracker, int64_t periodNs, uint32_t maxLatency) :
+			mTracker(tracker),
+			mPeriodNs(periodNs),
+			mMaxLatency(maxLatency),
+			mNextVBlankNs(periodNs)
+		{
+		}
+
+		// Shows whatever is due by nowNs.
+		void AdvanceTo(int64_t nowNs)
+		{
+			while (mNextVBlankNs <= nowNs)
+			{
+				Flip();
+			}
+		}
+
+		// Returns when the frame may start, no earlier than nowNs.
+		int64_t WaitForFrameLatency(int64_t nowNs)
+		{
+			AdvanceTo(nowNs);
+			while (mQueued >= mMaxLatency)
+			{
+				nowNs = mNextVBlankNs;
+				Flip();
+			}
+			return nowNs;
+		}
+
+		void Present(uint64_t frameId, int64_t nowNs)
+		{
+			AdvanceTo(nowNs);
+			mQueue[(mQueueBegin + mQueued) % MaxQueued] = frameId;
+			++mQueued;
+		}
+	};
+
+	// Input-to-display latency of frames that take cpuNs to record, with at most maxLatency
+	// frames queued for display.
+	FLatencyStats MeasurePresentLatency(int64_t periodNs, uint32_t maxLatency, int64_t cpuNs)
+	{
+		CLatencyTracker tracker;
+		CFakePresenter presenter(tracker, periodNs, maxLatency);
+		int64_t nowNs = 0;
+		for (uint64_t frame = 0; frame < 200; ++frame)
+		{
+			if (frame == 20)
+			{
+				tracker.ResetStats();
+			}
+
+			int64_t waitStartNs = nowNs;
+			nowNs = presenter.WaitForFrameLatency(nowNs);
+			tracker.OnInputSampled(frame, nowNs, nowNs - waitStartNs);
+			nowNs += cpuNs;
+			presenter.Present(frame, nowNs);
+		}
+		return tracker.GetStats();
+	}
+
+	void TestLatencyTracker()
+	{
+		CLatencyTracker tracker;
+		HEADLESS_CHECK(tracker.OnPresented(0, 100) == -1);
+
+		tracker.OnInputSampled(1, 1000, 0);
+		tracker.OnInputSampled(2, 2000, 500);
+		HEADLESS_CHECK(tracker.OnPresented(2, 5000) == 3000);
+		HEADLESS_CHECK(tracker.OnPresented(1, 5000) == 4000);
+		// A frame closes once.
+		HEADLESS_CHECK(tracker.OnPresented(1, 6000) == -1);
+		FLatencyStats stats = tracker.GetStats();
+		HEADLESS_CHECK(stats.mSamples == 2 && stats.mMeanNs == 3500.0);
+		HEADLESS_CHECK(stats.mMinNs == 3000 && stats.mMaxNs == 4000 && stats.mMeanWaitNs == 250.0);
+
+		// A frame still open MaxFramesTracked frames later has been overwritten.
+		tracker.OnInputSampled(3, 0, 0);
+		tracker.OnInputSampled(3 + CLatencyTracker::MaxFramesTracked, 10, 0);
+		HEADLESS_CHECK(tracker.OnPresented(3, 100) == -1);
+		HEADLESS_CHECK(tracker.OnPresented(3 + CLatencyTracker::MaxFramesTracked, 100) == 90);
+
+		// A CPU well ahead of a 60Hz display: every queued frame adds a refresh of latency,
+		// and with a latency of one, input is sampled right after a vblank and shown at the
+		// next one.
+		const int64_t periodNs = 16666667;
+		for (uint32_t maxLatency = 1; maxLatency <= 3; ++maxLatency)
+		{
+			FLatencyStats queued = MeasurePresentLatency(periodNs, maxLatency, 2000000);
+			HEADLESS_CHECK(queued.mSamples > 150);
+			HEADLESS_CHECK(queued.mMinNs == maxLatency * periodNs && queued.mMaxNs == maxLatency * periodNs);
+			HEADLESS_CHECK(std::abs(queued.mMeanWaitNs - (periodNs - 2000000)) < 1.0);
+		}
+
+		// A CPU slower than the display, allowed one frame queued behind the one on its way to
+		// the screen, never waits, and its frames show at the next vblank.
+		FLatencyStats slow = MeasurePresentLatency(periodNs, 2, 20000000);
+		HEADLESS_CHECK(slow.mMeanWaitNs == 0.0);
+		HEADLESS_CHECK(slow.mMinNs >= 20000000 && slow.mMaxNs < 20000000 + periodNs);
+	}
+
+	void TestWorkStealingDeque()
+	{
+		const uint32_t capacity = 16;
+		FJob jobs[capacity + 1];
+
+		// The owner works LIFO, thieves FIFO, and a full deque refuses more.
+		{
+			CWorkStealingDeque deque(capacity);
+			HEADLESS_CHECK(deque.Pop() == nullptr && deque.Steal() == nullptr);
+			for (uint32_t i = 0; i < capacity; ++i)
+			{
+				HEADLESS_CHECK(deque.Push(&jobs[i]));
+			}
+			HEADLESS_CHECK(!deque.Push(&jobs[capacity]));
+			HEADLESS_CHECK(deque.Pop() == &jobs[capacity - 1]);
+			HEADLESS_CHECK(deque.Steal() == &jobs[0]);
+			HEADLESS_CHECK(deque.Steal() == &jobs[1]);
+			HEADLESS_CHECK(deque.Push(&jobs[capacity]));
+			HEADLESS_CHECK(deque.Pop() == &jobs[capacity]);
+			uint32_t remaining = 0;
+			while (deque.Pop())
+			{
+				++remaining;
+			}
+			HEADLESS_CHECK(remaining == capacity - 3);
+			HEADLESS_CHECK(deque.Steal() == nullptr);
+		}
+
+		// The owner pushing and popping while three thieves steal: every job is taken exactly
+		// once, across many wraps of the buffer.
+		{
+			const uint32_t jobCount = 200000;
+			std::vector<FJob> manyJobs(jobCount);
+			std::vector<std::atomic<uint32_t>> taken(jobCount);
+			for (std::atomic<uint32_t>& count : taken)
+			{
+				count.store(0);
+			}
+
+			CWorkStealingDeque deque(capacity);
+			std::atomic<bool> done(false);
+			auto take = [&](FJob* job)
+			{
+				taken[static_cast<size_t>(job - manyJobs.data())].fetch_add(1);
+			};
+
+			std::vector<std::thread> thieves;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				thieves.emplace_back([&]()
+				{
+					while (!done.load())
+					{
+						if (FJob* job = deque.Steal())
+						{
+							take(job);
+						}
+					}
+				});
+			}
+
+			for (uint32_t i = 0; i < jobCount; ++i)
+			{
+				while (!deque.Push(&manyJobs[i]))
+				{
+					if (FJob* job = deque.Pop())
+					{
+						take(job);
+					}
+				}
+				if (i % 3 == 0)
+				{
+					if (FJob* job = deque.Pop())
+					{
+						take(job);
+					}
+				}
+			}
+			while (FJob* job = deque.Pop())
+			{
+				take(job);
+			}
+			done.store(true);
+			for (std::thread& thief : thieves)
+			{
+				thief.join();
+			}
+
+			uint32_t wrong = 0;
+			for (const std::atomic<uint32_t>& count : taken)
+			{
+				wrong += count.load() != 1 ? 1 : 0;
+			}
+			HEADLESS_CHECK(wrong == 0);
+		}
+	}
+
+	// Job data for the job system tests: bumps a count and, if set, records how far another
+	// count had got when it ran.
+	struct FCountJob
+	{
+		std::atomic<uint32_t>* mCount;
+		const std::atomic<uint32_t>* mObserved;
+		uint32_t mObservedValue;
+
+		static void Run(void* data)
+		{
+			FCountJob* job = static_cast<FCountJob*>(data);
+			if (job->mObserved)
+			{
+				job->mObservedValue = job->mObserved->load();
+			}
+			job->mCount->fetch_add(1);
+		}
+	};
+
+	void SetupCountJobs(FJob* jobs, FCountJob* data, uint32_t count, std::atomic<uint32_t>& counted,
+		const std::atomic<uint32_t>* observed)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			data[i].mCount = &counted;
+			data[i].mObserved = observed;
+			data[i].mObservedValue = 0;
+			jobs[i].mFunction = &FCountJob::Run;
+			jobs[i].mData = &data[i];
+		}
+	}
+
+	void TestJobSystem()
+	{
+		CJobSystem jobs(3);
+		HEADLESS_CHECK(jobs.GetThreadCount() == 4);
+
+		// More jobs than a deque holds; the overflow runs inline.
+		{
+			const uint32_t count = CJobSystem::DequeCapacity + 1000;
+			std::vector<FJob> batch(count);
+			std::vector<FCountJob> data(count);
+			std::atomic<uint32_t> counted(0);
+			SetupCountJobs(batch.data(), data.data(), count, counted, nullptr);
+
+			CJobCounter counter;
+			jobs.Run(batch.data(), count, counter);
+			jobs.Wait(counter);
+			HEADLESS_CHECK(counter.IsDone() && counted.load() == count);
+		}
+
+		// A chain of RunAfter batches: each job sees the whole batch before it finished.
+		{
+			const uint32_t count = 64;
+			FJob batches[3][count];
+			FCountJob data[3][count];
+			std::atomic<uint32_t> counted[3];
+			CJobCounter counters[3];
+			for (uint32_t b = 0; b < 3; ++b)
+			{
+				counted[b].store(0);
+				SetupCountJobs(batches[b], data[b], count, counted[b], b > 0 ? &counted[b - 1] : nullptr);
+			}
+
+			// Submitted last-first, so the dependencies are pending when they are registered.
+			CJobCounter gate;
+			FJob gateJob;
+			std::atomic<uint32_t> gateCounted(0);
+			FCountJob gateData;
+			SetupCountJobs(&gateJob, &gateData, 1, gateCounted, nullptr);
+			jobs.RunAfter(counters[1], batches[2], count, counters[2]);
+			jobs.RunAfter(counters[0], batches[1], count, counters[1]);
+			jobs.RunAfter(gate, batches[0], count, counters[0]);
+			HEADLESS_CHECK(counters[2].GetValue() == count && counted[0].load() == 0);
+			jobs.Run(&gateJob, 1, gate);
+			jobs.Wait(counters[2]);
+
+			uint32_t early = 0;
+			for (uint32_t b = 1; b < 3; ++b)
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					early += data[b][i].mObservedValue != count ? 1 : 0;
+				}
+			}
+			HEADLESS_CHECK(early == 0);
+			HEADLESS_CHECK(counted[2].load() == count && counters[0].IsDone() && counters[1].IsDone());
+
+			// A dependency that is already done releases the jobs at once.
+			CJobCounter after;
+			jobs.RunAfter(counters[2], batches[0], count, after);
+			jobs.Wait(after);
+			HEADLESS_CHECK(counted[0].load() == 2 * count);
+		}
+
+		// Jobs submitted by a thread that is not a worker go through the injection queue.
+		{
+			const uint32_t count = 100;
+			FJob batch[count];
+			FCountJob data[count];
+			std::atomic<uint32_t> counted(0);
+			SetupCountJobs(batch, data, count, counted, nullptr);
+			CJobCounter counter;
+			std::thread outsider([&]()
+			{
+				jobs.Run(batch, count, counter);
+				jobs.Wait(counter);
+			});
+			outsider.join();
+			HEADLESS_CHECK(counted.load() == count);
+		}
+
+		// ParallelFor covers every index exactly once, whatever the grain, also from inside a job.
+		const uint32_t sizes[] = { 0, 1, 7, 1000, 100003 };
+		const uint32_t grains[] = { 0, 1, 16, 5000 };
+		uint32_t wrong = 0;
+		for (uint32_t size : sizes)
+		{
+			for (uint32_t grain : grains)
+			{
+				std::vector<std::atomic<uint8_t>> hits(size);
+				for (std::atomic<uint8_t>& hit : hits)
+				{
+					hit.store(0);
+				}
+				jobs.ParallelFor(size, grain, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						hits[i].fetch_add(1);
+					}
+				});
+				for (const std::atomic<uint8_t>& hit : hits)
+				{
+					wrong += hit.load() != 1 ? 1 : 0;
+				}
+			}
+		}
+		HEADLESS_CHECK(wrong == 0);
+
+		std::atomic<uint32_t> nestedSum(0);
+		jobs.ParallelFor(8, 1, [&](uint32_t, uint32_t)
+		{
+			jobs.ParallelFor(100, 10, [&](uint32_t begin, uint32_t end)
+			{
+				nestedSum.fetch_add(end - begin);
+			});
+		});
+		HEADLESS_CHECK(nestedSum.load() == 800);
+	}
+
+	void TestUploadRing()
+	{
+		const uint64_t full = CUploadRing::InvalidOffset;
+		CUploadRing ring;
+		ring.Initialize(1024, 3);
+
+		// Alignment pads from the head, and the padding counts as used.
+		HEADLESS_CHECK(ring.Allocate(100, 4) == 0);
+		HEADLESS_CHECK(ring.Allocate(100, 256) == 256);
+		HEADLESS_CHECK(ring.GetUsed() == 356);
+		ring.CloseRegion(1);
+		HEADLESS_CHECK(ring.Allocate(300, 256) == 512);
+		ring.CloseRegion(2);
+
+		// 300 bytes do not fit before the end, and the start is still in use.
+		HEADLESS_CHECK(ring.Allocate(300, 16) == full && ring.GetStats().mFullCount == 1);
+		HEADLESS_CHECK(ring.Allocate(2048, 16) == full);
+
+		// Regions retire in order, each once its value has completed.
+		ring.Retire(0);
+		HEADLESS_CHECK(ring.GetUsed() == 812 && ring.GetOldestFenceValue() == 1);
+		ring.Retire(1);
+		HEADLESS_CHECK(ring.GetUsed() == 456 && ring.GetOldestFenceValue() == 2);
+
+		// Now the allocation wraps to the start; the bytes skipped at the end are used until
+		// it retires.
+		HEADLESS_CHECK(ring.Allocate(300, 16) == 0);
+		HEADLESS_CHECK(ring.GetStats().mBytesWrapped == 212 && ring.GetUsed() == 968);
+		ring.CloseRegion(3);
+		ring.Retire(2);
+		HEADLESS_CHECK(ring.GetUsed() == 512 && ring.GetPendingRegionCount() == 1);
+		ring.Retire(3);
+		HEADLESS_CHECK(ring.GetUsed() == 0 && ring.GetOldestFenceValue() == 0);
+
+		// With every region slot taken, the next region is folded into the newest one.
+		for (uint64_t value = 4; value <= 7; ++value)
+		{
+			HEADLESS_CHECK(ring.Allocate(16, 16) != full);
+			ring.CloseRegion(value);
+		}
+		HEADLESS_CHECK(ring.GetPendingRegionCount() == 3 && ring.GetStats().mMergedRegions == 1);
+		ring.Retire(6);
+		HEADLESS_CHECK(ring.GetUsed() == 32 && ring.GetOldestFenceValue() == 7);
+		ring.Retire(7);
+		HEADLESS_CHECK(ring.GetUsed() == 0);
+
+		// A frame's worth at a time, wrapping over and over, without touching the heap.
+		const uint64_t wrappedBefore = ring.GetStats().mBytesWrapped;
+		const uint64_t allocations = GetHeapAllocationCount();
+		uint32_t failed = 0;
+		for (uint64_t frame = 8; frame < 1008; ++frame)
+		{
+			ring.Retire(frame - 2);
+			failed += ring.Allocate(300, 64) == full;
+			ring.CloseRegion(frame);
+		}
+		HEADLESS_CHECK(GetHeapAllocationCount() == allocations);
+		HEADLESS_CHECK(failed == 0 && ring.GetStats().mBytesWrapped > wrappedBefore);
+	}
+
+	// A consumer queue as the upload tracker sees it: whatever waits it has been told to issue.
+	struct FFakeQueue
+	{
+		uint64_t mWaitedValue = 0;
+		uint32_t mWaitCount = 0;
+
+		void Acquire(CUploadTracker& tracker, const int* const* resources, uint32_t count)
+		{
+			uint64_t value = tracker.AcquireForConsumer(this, resources, count);
+			if (value != 0)
+			{
+				mWaitedValue = value;
+				++mWaitCount;
+			}
+		}
+	};
+
+	void TestUploadTracker()
+	{
+		int textures[4];
+		const int* first[] = { &textures[0], &textures[1] };
+		const int* second[] = { &textures[2] };
+		const int* all[] = { &textures[0], &textures[1], &textures[2], &textures[3] };
+
+		CUploadTracker tracker;
+		FFakeQueue direct;
+		FFakeQueue compute;
+
+		// Two batches on the copy queue, signalled 1 and 2.
+		tracker.AddToBatch(first[0]);
+		tracker.AddToBatch(first[1]);
+		HEADLESS_CHECK(tracker.HasOpenBatch());
+		tracker.OnBatchSubmitted(1);
+		tracker.AddToBatch(second[0]);
+		tracker.OnBatchSubmitted(2);
+		HEADLESS_CHECK(!tracker.HasOpenBatch() && tracker.GetLastSubmittedValue() == 2);
+
+		// The direct queue waits for the batch it uses, once.
+		direct.Acquire(tracker, first, 2);
+		HEADLESS_CHECK(direct.mWaitCount == 1 && direct.mWaitedValue == 1);
+		direct.Acquire(tracker, first, 2);
+		HEADLESS_CHECK(direct.mWaitCount == 1);
+
+		// The compute queue is not ordered by the direct queue's wait and waits for itself.
+		compute.Acquire(tracker, first, 1);
+		HEADLESS_CHECK(compute.mWaitCount == 1 && compute.mWaitedValue == 1);
+
+		// A wait for the later batch orders the queue after the earlier one too.
+		compute.Acquire(tracker, all, 4);
+		HEADLESS_CHECK(compute.mWaitCount == 2 && compute.mWaitedValue == 2);
+		compute.Acquire(tracker, first, 2);
+		HEADLESS_CHECK(compute.mWaitCount == 2);
+		direct.Acquire(tracker, second, 1);
+		HEADLESS_CHECK(direct.mWaitCount == 2 && direct.mWaitedValue == 2);
+
+		// Resources never uploaded need no wait.
+		const int* untracked[] = { &textures[3] };
+		FFakeQueue other;
+		other.Acquire(tracker, untracked, 1);
+		HEADLESS_CHECK(other.mWaitCount == 0);
+
+		// Once the copy queue has finished a batch, nobody waits for it, including queues
+		// that first show up afterwards.
+		tracker.AddToBatch(&textures[3]);
+		tracker.OnBatchSubmitted(3);
+		tracker.Retire(3);
+		FFakeQueue late;
+		late.Acquire(tracker, all, 4);
+		direct.Acquire(tracker, all, 4);
+		HEADLESS_CHECK(late.mWaitCount == 0 && direct.mWaitCount == 2);
+
+		// A batch submitted after the retire is waited for by every queue again.
+		tracker.AddToBatch(&textures[0]);
+		tracker.OnBatchSubmitted(4);
+		late.Acquire(tracker, first, 1);
+		direct.Acquire(tracker, first, 1);
+		HEADLESS_CHECK(late.mWaitedValue == 4 && direct.mWaitedValue == 4);
+	}
+
+	// Queues as CPassSchedule drives them, writing what happens to a log such as
+	// "update, signal c1, g waits c1, draw".
+	struct FFakeScheduleBackend
+	{
+		std::string mLog;
+		uint64_t mValues[QueueTypeCount] = {};
+
+		static char GetQueueLetter(EQueueType queue)
+		{
+			return queue == EQueueType::Graphics ? 'g' : 'c';
+		}
+
+		void Append(const std::string& event)
+		{
+			mLog += mLog.empty() ? event : ", " + event;
+		}
+
+		uint64_t Signal(EQueueType queue)
+		{
+			uint64_t value = ++mValues[static_cast<uint32_t>(queue)];
+			Append(std::string("signal ") + GetQueueLetter(queue) + std::to_string(value));
+			return value;
+		}
+
+		void Wait(EQueueType queue, EQueueType onQueue, uint64_t value)
+		{
+			Append(std::string(1, GetQueueLetter(queue)) + " waits " + GetQueueLetter(onQueue) + std::to_string(value));
+		}
+	};
+
+	// Adds a pass that logs its name when it runs.
+	void AddLoggedPass(CPassSchedule& schedule, FFakeScheduleBackend& backend, const char* name, EQueueType queue,
+		std::initializer_list<const void*> reads, std::initializer_list<const void*> writes)
+	{
+		schedule.AddPass(name, queue, reads, writes, [&backend, name]() { backend.Append(name); });
+	}
+
+	std::string ExecuteSchedule(CPassSchedule& schedule, FFakeScheduleBackend& backend)
+	{
+		backend.mLog.clear();
+		schedule.Execute(backend);
+		return backend.mLog;
+	}
+
+	void TestPassSchedule()
+	{
+		const EQueueType graphics = EQueueType::Graphics;
+		const EQueueType compute = EQueueType::Compute;
+		int texture, buffer, target, other;
+		CPassSchedule schedule;
+		FFakeScheduleBackend backend;
+
+		// Read after write: graphics waits for the compute batch, which then needs no join.
+		AddLoggedPass(schedule, backend, "generate", compute, {}, { &texture });
+		AddLoggedPass(schedule, backend, "draw", graphics, { &texture }, { &target });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "generate, signal c1, g waits c1, draw");
+		HEADLESS_CHECK(schedule.GetWaitCount() == 1 && schedule.GetJoinBatch(compute) == -1);
+
+		// Write after read: compute waits until graphics is done reading; the frame then joins
+		// the compute work back into graphics.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "draw", graphics, { &buffer }, { &target });
+		AddLoggedPass(schedule, backend, "update", compute, {}, { &buffer });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "draw, signal g1, c waits g1, update, signal c2, g waits c2");
+		HEADLESS_CHECK(schedule.GetWaitCount() == 2 && schedule.GetJoinBatch(compute) == 1);
+
+		// Write after write.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "clear", compute, {}, { &texture });
+		AddLoggedPass(schedule, backend, "overwrite", graphics, {}, { &texture });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "clear, signal c3, g waits c3, overwrite");
+
+		// Independent work needs no waits but the join, and passes on one queue share a batch.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "simulate", compute, { &buffer }, { &other });
+		AddLoggedPass(schedule, backend, "integrate", compute, { &other }, { &other });
+		AddLoggedPass(schedule, backend, "draw", graphics, { &texture }, { &target });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "simulate, integrate, signal c4, draw, g waits c4");
+		HEADLESS_CHECK(schedule.GetBatches().size() == 2 && schedule.GetWaitCount() == 1);
+
+		// One wait covers everything the batch waited for produced.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "generate", compute, {}, { &texture });
+		AddLoggedPass(schedule, backend, "skin", compute, {}, { &buffer });
+		AddLoggedPass(schedule, backend, "draw", graphics, { &texture }, { &target });
+		AddLoggedPass(schedule, backend, "draw skinned", graphics, { &buffer }, { &target });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "generate, skin, signal c5, g waits c5, draw, draw skinned");
+		HEADLESS_CHECK(schedule.GetWaitCount() == 1);
+
+		// A pass that needs a wait starts a new batch, so the passes before it are not held back.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "shadows", graphics, {}, { &other });
+		AddLoggedPass(schedule, backend, "generate", compute, {}, { &texture });
+		AddLoggedPass(schedule, backend, "draw", graphics, { &texture, &other }, { &target });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) == "shadows, generate, signal c6, g waits c6, draw");
+		HEADLESS_CHECK(schedule.GetBatches().size() == 3 && schedule.GetBatchOfPass(2) == 2);
+
+		// Readers on both queues: a later write waits for the readers on the other queue only.
+		schedule.Reset();
+		AddLoggedPass(schedule, backend, "produce", graphics, {}, { &buffer });
+		AddLoggedPass(schedule, backend, "read compute", compute, { &buffer }, { &other });
+		AddLoggedPass(schedule, backend, "read graphics", graphics, { &buffer }, { &target });
+		AddLoggedPass(schedule, backend, "rewrite", graphics, {}, { &buffer });
+		HEADLESS_CHECK(ExecuteSchedule(schedule, backend) ==
+			"produce, signal g2, c waits g2, read compute, signal c7, read graphics, g waits c7, rewrite");
+		HEADLESS_CHECK(schedule.GetJoinBatch(compute) == -1);
+		schedule.Reset();
+
+		// Rebuilt every frame over resources that come and go, the schedule stops allocating
+		// once it has seen its busiest frame and keeps nothing about resources that are gone.
+		int resources[256];
+		uint64_t allocations = 0;
+		for (uint32_t frame = 0; frame < 200; ++frame)
+		{
+			if (frame == 8)
+			{
+				allocations = GetHeapAllocationCount();
+			}
+			schedule.Reset();
+			BeginFrameArenas();
+			const int* first = &resources[frame % 192];
+			for (uint32_t i = 0; i < 32; i += 2)
+			{
+				schedule.AddPass("produce", compute, { &first[i] }, { &first[i + 1] }, []() {});
+				schedule.AddPass("consume", graphics, { &first[i + 1] }, { &first[i] }, []() {});
+			}
+			schedule.Compile();
+		}
+		HEADLESS_CHECK(GetHeapAllocationCount() == allocations);
+		schedule.Reset();
+	}
+
+	// What CCommandStreamReader throws for stream, empty when it validates.
+	std::string GetCommandStreamError(const std::vector<uint8_t>& stream)
+	{
+		try
+		{
+			CCommandStreamReader reader(stream.data(), stream.size());
+		}
+		catch (const std::runtime_error& error)
+		{
+			return error.what();
+		}
+		return std::string();
+	}
+
+	// A copy of stream with the payload of its first op command rewritten by patch.
+	template<typename TPayload, typename TPatch>
+	std::vector<uint8_t> PatchCommand(const std::vector<uint8_t>& stream, ECommandStreamOp op, const TPatch& patch)
+	{
+		std::vector<uint8_t> patched = stream;
+		FCommandStreamHeader header;
+		memcpy(&header, patched.data(), sizeof(header));
+		for (uint64_t offset = header.mCommandOffset; offset < header.mCommandOffset + header.mCommandSize; )
+		{
+			FCommandStreamCommand command;
+			memcpy(&command, &patched[offset], sizeof(command));
+			if (command.mOp == op)
+			{
+				TPayload payload;
+				memcpy(&payload, &patched[offset + sizeof(command)], sizeof(payload));
+				patch(payload);
+				memcpy(&patched[offset + sizeof(command)], &payload, sizeof(payload));
+				break;
+			}
+			offset += command.mSize;
+		}
+		return patched;
+	}
+
+	// Frames captured from the renderer replay to the same work, and streams that would make
+	// the replay misbehave are refused up front.
+	void TestCommandStream()
+	{
+		const uint32_t frameCount = 8;
+		const uint32_t captureFrames = 3;
+		CNullRenderDevice device;
+		CCaptureRenderDevice captureDevice(device);
+		FRendererConfig config;
+		config.mPacingMode = EFramePacingMode::Uncapped;
+		config.mWorkerThreads = 2;
+		config.mRecordThreads = 2;
+		CHelloRenderer renderer(captureDevice, config);
+		renderer.OnInit();
+
+		FNullRenderStats captured;
+		std::vector<uint8_t> stream;
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			if (frame == frameCount - captureFrames)
+			{
+				renderer.GetFrameTimeline().WaitIdle();
+				captured = device.GetStats();
+				captureDevice.BeginCapture();
+			}
+			renderer.OnBeginFrame();
+			renderer.OnUpdate();
+			renderer.OnRender();
+		}
+		stream = captureDevice.EndCapture();
+		renderer.GetFrameTimeline().WaitIdle();
+		const FNullRenderStats after = device.GetStats();
+		renderer.OnDestroy();
+
+		CCommandStreamReader reader(stream.data(), stream.size());
+		HEADLESS_CHECK(reader.GetHeader().mFrameCount == captureFrames);
+		HEADLESS_CHECK(reader.GetHeader().mListCount == after.mListsExecuted - captured.mListsExecuted);
+
+		// Replayed onto a fresh device, the stream draws what the renderer drew.
+		{
+			CNullRenderDevice replayDevice;
+			CDeviceCommandStreamTarget target(replayDevice);
+			CCommandStreamReplayer replayer(reader, target);
+			replayer.Prepare();
+			replayer.Replay(2);
+			target.Finish();
+			const FNullRenderStats replayed = replayDevice.GetStats();
+			HEADLESS_CHECK(replayed.mDraws == 2 * (after.mDraws - captured.mDraws) && replayed.mDraws > 0);
+			HEADLESS_CHECK(replayed.mBarriers == 2 * (after.mBarriers - captured.mBarriers));
+			HEADLESS_CHECK(replayed.mListsExecuted == 2 * reader.GetHeader().mListCount);
+		}
+
+		// Truncated anywhere, the stream is refused.
+		HEADLESS_CHECK(GetCommandStreamError(stream).empty());
+		for (size_t cut : { stream.size() - 4, stream.size() / 2, sizeof(FCommandStreamHeader) - 1 })
+		{
+			HEADLESS_CHECK(!GetCommandStreamError(std::vector<uint8_t>(stream.begin(), stream.begin() + cut)).empty());
+		}
+
+		// Object ids past the table, or of the wrong kind.
+		const uint32_t objectCount = reader.GetObjectCount();
+		HEADLESS_CHECK(GetCommandStreamError(PatchCommand<FCommandStreamObjectRef>(stream, ECommandStreamOp::SetRenderTarget,
+			[objectCount](FCommandStreamObjectRef& ref) { ref.mObject = objectCount; })) ==
+			"Malformed command stream: bad object reference");
+		HEADLESS_CHECK(GetCommandStreamError(PatchCommand<FCommandStreamObjectRef>(stream, ECommandStreamOp::SetPipeline,
+			[](FCommandStreamObjectRef& ref) { ref.mObject = 0; })) == "Malformed command stream: bad object reference");
+
+		// A list whose type is not the queue it is executed on.
+		HEADLESS_CHECK(GetCommandStreamError(PatchCommand<FCommandStreamBeginList>(stream, ECommandStreamOp::BeginList,
+			[](FCommandStreamBeginList& list) { list.mQueue = static_cast<uint32_t>(ERenderQueueType::Copy); })) ==
+			"Malformed command stream: list type does not match its Execute's queue");
+
+		// Values that do not name a state or index format.
+		HEADLESS_CHECK(GetCommandStreamError(PatchCommand<FCommandStreamTransition>(stream, ECommandStreamOp::Transition,
+			[](FCommandStreamTransition& transition) { transition.mAfter = 200; })) ==
+			"Malformed command stream: unknown resource state");
+		HEADLESS_CHECK(GetCommandStreamError(PatchCommand<FCommandStreamIndexBuffer>(stream, ECommandStreamOp::SetIndexBuffer,
+			[](FCommandStreamIndexBuffer& indexBuffer) { indexBuffer.mFormat = 255; })) ==
+			"Malformed command stream: bad index format");
+	}
+
+	// Compute passes added to the renderer run on the compute queue each frame, and the
+	// captured state travels in the frame arena rather than the heap.
+	void TestComputePass()
+	{
+		CNullRenderDevice device;
+		FRendererConfig config;
+		config.mPacingMode = EFramePacingMode::Uncapped;
+		config.mWorkerThreads = 2;
+		CHelloRenderer renderer(device, config);
+		renderer.OnInit();
+		device.ResetStats();
+
+		const uint32_t frameCount = 150;
+		const uint32_t warmupFrames = 100;
+		int particles;
+		uint32_t recorded = 0;
+		uint64_t checksum = 0;
+		uint64_t allocations = 0;
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			if (frame == warmupFrames)
+			{
+				allocations = GetHeapAllocationCount();
+			}
+			renderer.OnBeginFrame();
+			renderer.OnUpdate();
+			// Constants for the pass, from the frame's slice of the upload ring.
+			renderer.AllocateTransient(256);
+
+			// Bigger than any small-buffer optimisation a std::function might have.
+			uint64_t payload[8] = { frame, 1, 2, 3, 4, 5, 6, 7 };
+			renderer.AddComputePass("simulate", {}, { &particles },
+				[&recorded, &checksum, payload](IRenderCommandList* commandList)
+				{
+					commandList->Dispatch(1, 1, 1);
+					++recorded;
+					checksum += payload[0] + payload[7];
+				});
+			renderer.OnRender();
+		}
+		const uint64_t frameAllocations = GetHeapAllocationCount() - allocations;
+		const uint64_t dispatches = device.GetStats().mDispatches;
+		const FUploadRingStats uploadStats = renderer.GetUploadRingStats();
+		renderer.OnDestroy();
+
+		HEADLESS_CHECK(recorded == frameCount && dispatches == frameCount);
+		HEADLESS_CHECK(checksum == frameCount * (frameCount - 1) / 2 + 7 * frameCount);
+		HEADLESS_CHECK(uploadStats.mAllocations == frameCount && uploadStats.mFullCount == 0);
+		HEADLESS_CHECK(frameAllocations == 0);
+	}
+
+	void TestFenceTimeline()
+	{
+		typedef CFenceTimeline<FFakeFence> CFakeTimeline;
+		CFakeTimeline timelines[3];
+		for (CFakeTimeline& timeline : timelines)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				timeline.Signal();
+			}
+		}
+
+		// Callbacks run in value order as values retire, and no sooner.
+		uint32_t retired = 0;
+		timelines[0].OnCompleted(3, [&retired]() { retired = retired * 10 + 3; });
+		timelines[0].OnCompleted(1, [&retired]() { retired = retired * 10 + 1; });
+		timelines[0].GetFence().mCompleted = 1;
+		HEADLESS_CHECK(timelines[0].Poll() == 1 && retired == 1);
+
+		// One batched wait over the pending timelines, each at its largest value; timelines
+		// already there are left out.
+		timelines[2].GetFence().mCompleted = 3;
+		CFakeTimeline* waitOn[] = { &timelines[0], &timelines[1], &timelines[0], &timelines[2], &timelines[1] };
+		const uint64_t values[] = { 2, 1, 3, 3, 2 };
+		FFakeFence::sBatchedWaits = 0;
+		uint64_t allocations = GetHeapAllocationCount();
+		CFakeTimeline::WaitForAll(waitOn, values, 5);
+		HEADLESS_CHECK(GetHeapAllocationCount() == allocations);
+		HEADLESS_CHECK(FFakeFence::sBatchedWaits == 1 && FFakeFence::sLastBatchSize == 2);
+		HEADLESS_CHECK(timelines[0].GetFence().mLastWait == 3 && timelines[1].GetFence().mLastWait == 2);
+		HEADLESS_CHECK(timelines[0].IsComplete(3) && timelines[1].IsComplete(2) && !timelines[1].IsComplete(3));
+		HEADLESS_CHECK(retired == 13);
+		HEADLESS_CHECK(timelines[0].GetStats().mWaitCount == 1 && timelines[2].GetStats().mWaitCount == 0);
+
+		// Nothing pending, nothing waited on.
+		CFakeTimeline::WaitForAll(waitOn, values, 5);
+		HEADLESS_CHECK(FFakeFence::sBatchedWaits == 1);
+
+		// WaitForValue only touches the fence for values the cache cannot answer.
+		uint64_t queries = timelines[1].GetStats().mCompletedQueries;
+		HEADLESS_CHECK(timelines[1].IsComplete(1));
+		HEADLESS_CHECK(timelines[1].GetStats().mCompletedQueries == queries);
+		timelines[1].WaitIdle();
+		HEADLESS_CHECK(timelines[1].GetFence().mLastWait == 3 && timelines[1].GetStats().mWaitCount == 2);
+	}
+
+	// Fence whose GPU finishes each signal a fixed time after it, checked against the clock.
+	struct FTimedFence
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		int64_t mDelayNs = 0;
+		uint64_t mSignaled = 0;
+		Clock::time_point mDeadline;
+
+		uint64_t GetCompletedValue()
+		{
+			return Clock::now() >= mDeadline ? mSignaled : mSignaled - 1;
+		}
+
+		void Signal(uint64_t value)
+		{
+			mSignaled = value;
+			mDeadline = Clock::now() + std::chrono::nanoseconds(mDelayNs);
+		}
+
+		void WaitForValue(uint64_t)
+		{
+			while (Clock::now() < mDeadline)
+			{
+			}
+		}
+	};
+
+	// Signals and waits for stalls of about delayNs, waitCount times.
+	void RunTimedWaits(CFenceTimeline<FTimedFence>& timeline, int64_t delayNs, uint32_t waitCount)
+	{
+		timeline.GetFence().mDelayNs = delayNs;
+		for (uint32_t i = 0; i < waitCount; ++i)
+		{
+			timeline.WaitForValue(timeline.Signal());
+		}
+	}
+
+	// Footprints made up from the shape; counts the calls, and can hold them until several
+	// threads have missed at once.
+	struct FFakeFootprintBackend
+	{
+		struct Desc
+		{
+			uint32_t mWidth;
+			uint32_t mHeight;
+		};
+
+		typedef uint64_t Layout;
+
+		std::atomic<uint32_t> mCalls{ 0 };
+		uint32_t mHoldUntilCalls = 0;
+
+		static uint64_t HashDesc(const Desc& desc)
+		{
+			return HashFootprintField(HashFootprintField(FootprintHashSeed, desc.mWidth), desc.mHeight);
+		}
+
+		static bool EqualDesc(const Desc& a, const Desc& b)
+		{
+			return a.mWidth == b.mWidth && a.mHeight == b.mHeight;
+		}
+
+		void GetFootprints(const Desc& desc, uint32_t first, uint32_t count,
+			Layout* layouts, uint32_t* numRows, uint64_t* rowSizes, uint64_t* totalSize)
+		{
+			mCalls.fetch_add(1);
+			const std::chrono::steady_clock::time_point giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+			while (mCalls.load() < mHoldUntilCalls && std::chrono::steady_clock::now() < giveUp)
+			{
+				std::this_thread::yield();
+			}
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				layouts[i] = first + i;
+				numRows[i] = desc.mHeight;
+				rowSizes[i] = desc.mWidth;
+			}
+			*totalSize = static_cast<uint64_t>(desc.mWidth) * desc.mHeight * 1000 + first * 10 + count;
+		}
+	};
+
+	void TestFootprintCache()
+	{
+		typedef CFootprintCache<FFakeFootprintBackend> CCache;
+		CCache cache;
+		FFakeFootprintBackend& backend = cache.GetBackend();
+
+		// Distinct shapes and distinct ranges of one shape get entries of their own.
+		const FFakeFootprintBackend::Desc shape = { 64, 32 };
+		const FFakeFootprintBackend::Desc other = { 32, 64 };
+		const CCache::FFootprints& whole = cache.Get(shape, 0, 4);
+		const CCache::FFootprints& tail = cache.Get(shape, 1, 3);
+		const CCache::FFootprints& fewer = cache.Get(shape, 0, 3);
+		const CCache::FFootprints& transposed = cache.Get(other, 0, 4);
+		HEADLESS_CHECK(&whole != &tail && &whole != &fewer && &tail != &fewer && &whole != &transposed);
+		HEADLESS_CHECK(whole.mTotalSize == 64 * 32 * 1000 + 4 && tail.mTotalSize == 64 * 32 * 1000 + 13);
+		HEADLESS_CHECK(transposed.mNumRows[0] == 64 && tail.mLayouts[0] == 1 && fewer.mLayouts.size() == 3);
+		HEADLESS_CHECK(backend.mCalls.load() == 4 && cache.GetStats().mEntries == 4);
+
+		// Equal keys hit, without asking the backend or touching the heap.
+		const FFakeFootprintBackend::Desc sameShape = { 64, 32 };
+		const uint64_t allocations = GetHeapAllocationCount();
+		HEADLESS_CHECK(&cache.Get(sameShape, 0, 4) == &whole && &cache.Get(shape, 1, 3) == &tail);
+		HEADLESS_CHECK(GetHeapAllocationCount() == allocations);
+		HEADLESS_CHECK(backend.mCalls.load() == 4 && cache.GetStats().mMisses == 4);
+
+		// Growing the table keeps every entry where it was.
+		bool kept = true;
+		for (uint32_t width = 1; width <= 100; ++width)
+		{
+			const FFakeFootprintBackend::Desc desc = { width, 1 };
+			kept &= cache.Get(desc, 0, 1).mTotalSize == width * 1000 + 1;
+		}
+		for (uint32_t width = 1; width <= 100; ++width)
+		{
+			const FFakeFootprintBackend::Desc desc = { width, 1 };
+			kept &= cache.Get(desc, 0, 1).mTotalSize == width * 1000 + 1;
+		}
+		HEADLESS_CHECK(kept && &cache.Get(shape, 0, 4) == &whole && cache.GetStats().mEntries == 104);
+
+		// Threads that all miss the same key at once all get the one entry that was kept.
+		const uint32_t threadCount = 4;
+		const FFakeFootprintBackend::Desc contended = { 256, 256 };
+		const CCache::FFootprints* results[threadCount] = {};
+		backend.mCalls = 0;
+		backend.mHoldUntilCalls = threadCount;
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			threads.emplace_back([&, i]() { results[i] = &cache.Get(contended, 0, 9); });
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		HEADLESS_CHECK(backend.mCalls.load() == threadCount);
+		HEADLESS_CHECK(results[0] == results[1] && results[0] == results[2] && results[0] == results[3]);
+		HEADLESS_CHECK(results[0] == &cache.Get(contended, 0, 9) && cache.GetStats().mEntries == 105);
+	}
+
+	void TestFenceWaitPolicy()
+	{
+		// Bucket 0 is under 1024ns, then powers of two up to the last bucket.
+		HEADLESS_CHECK(FStallHistogram::GetBucket(0) == 0 && FStallHistogram::GetBucket(1023) == 0);
+		HEADLESS_CHECK(FStallHistogram::GetBucket(1024) == 1 && FStallHistogram::GetBucket(2047) == 1);
+		HEADLESS_CHECK(FStallHistogram::GetBucket(2048) == 2 && FStallHistogram::GetBucket(INT64_MAX) == 31);
+		HEADLESS_CHECK(FStallHistogram::GetBucketLimitNs(0) == 1024 && FStallHistogram::GetBucketLimitNs(2) == 4096);
+
+		// Percentiles answer with the upper bound of the bucket they fall in.
+		FStallHistogram histogram;
+		HEADLESS_CHECK(histogram.GetPercentileNs(0.5) == 0);
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			histogram.Add(i == 0 ? -5 : 500);
+		}
+		histogram.Add(1500);
+		histogram.Add(1500);
+		histogram.Add(1500);
+		histogram.Add(3000);
+		HEADLESS_CHECK(histogram.mCount == 10 && histogram.mBuckets[0] == 6);
+		HEADLESS_CHECK(histogram.GetPercentileNs(0.5) == 1024 && histogram.GetPercentileNs(0.75) == 2048);
+		HEADLESS_CHECK(histogram.GetPercentileNs(0.95) == 4096 && histogram.GetPercentileNs(1.0) == 4096);
+
+		// Decay halves every bucket, rounding down, and recounts.
+		histogram.Decay();
+		HEADLESS_CHECK(histogram.mBuckets[0] == 3 && histogram.mBuckets[1] == 1 && histogram.mBuckets[2] == 0);
+		HEADLESS_CHECK(histogram.mCount == 4);
+
+		// A fence that completes on the fifth poll is seen by whichever phase is still going.
+		uint32_t polls = 0;
+		uint32_t blocks = 0;
+		auto isComplete = [&polls]() { return ++polls >= 5; };
+		auto block = [&blocks]() { ++blocks; };
+		const int64_t second = 1000000000;
+		HEADLESS_CHECK(WaitWithPolicy(FFenceWaitPolicy::Spin(second), isComplete, block) == EFenceWaitPhase::Spin);
+		HEADLESS_CHECK(polls == 5 && blocks == 0);
+		polls = 0;
+		HEADLESS_CHECK(WaitWithPolicy(FFenceWaitPolicy::Spin(0, second), isComplete, block) == EFenceWaitPhase::Yield);
+		HEADLESS_CHECK(polls == 5 && blocks == 0);
+		polls = 0;
+		HEADLESS_CHECK(WaitWithPolicy(FFenceWaitPolicy::Block(), isComplete, block) == EFenceWaitPhase::Block);
+		HEADLESS_CHECK(polls == 0 && blocks == 1);
+
+		// Once both budgets run out, the wait blocks.
+		auto never = []() { return false; };
+		HEADLESS_CHECK(WaitWithPolicy(FFenceWaitPolicy::Spin(20000, 20000), never, block) == EFenceWaitPhase::Block);
+		HEADLESS_CHECK(blocks == 2);
+
+		// Short stalls: the adaptive budget settles on one that covers them, under the cap, and
+		// the waits then finish spinning.
+		CFenceTimeline<FTimedFence> fast;
+		fast.SetWaitPolicy(FFenceWaitPolicy::Adaptive(200000));
+		RunTimedWaits(fast, 20000, 64);
+		const int64_t fastBudgetNs = fast.GetWaitPolicy().mSpinNs;
+		HEADLESS_CHECK(fastBudgetNs >= 20000 && fastBudgetNs <= 200000);
+		HEADLESS_CHECK(fast.GetStats().mSpinWaits > fast.GetStats().mBlockingWaits);
+
+		// Stalls longer than the cap are not worth spinning for: every wait blocks.
+		CFenceTimeline<FTimedFence> slow;
+		slow.SetWaitPolicy(FFenceWaitPolicy::Adaptive(200000));
+		RunTimedWaits(slow, 1000000, 16);
+		HEADLESS_CHECK(slow.GetWaitPolicy().mSpinNs == 0 && slow.GetStats().mBlockingWaits == 16);
+
+		// A timeline that slows down drops its budget to 0 once most recent stalls are long.
+		RunTimedWaits(fast, 1000000, 200);
+		HEADLESS_CHECK(fast.GetWaitPolicy().mSpinNs == 0);
+	}
+
+	void TestDeferredReleaseQueue()
+	{
+		FFakeFence fence;
+		CDeferredReleaseQueue<std::shared_ptr<int>> queue;
+		std::shared_ptr<int> objects[6];
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			objects[i] = std::make_shared<int>(i);
+		}
+
+		// Batches stay sorted by value: a late retire of an older value lands in front, and a
+		// repeated value joins its batch.
+		queue.Defer(objects[0], 2);
+		queue.Defer(objects[1], 4);
+		queue.Defer(objects[2], 1);
+		queue.Defer(objects[3], 2);
+		HEADLESS_CHECK(queue.GetBatchCount() == 3 && queue.GetObjectCount() == 4);
+		HEADLESS_CHECK(queue.GetOldestFenceValue() == 1);
+
+		// Nothing goes before its value completes.
+		HEADLESS_CHECK(queue.Collect(fence.GetCompletedValue()) == 0);
+		fence.mCompleted = 2;
+		HEADLESS_CHECK(queue.Collect(fence.GetCompletedValue()) == 3);
+		HEADLESS_CHECK(objects[0].use_count() == 1 && objects[2].use_count() == 1 && objects[3].use_count() == 1);
+		HEADLESS_CHECK(objects[1].use_count() == 2 && queue.GetOldestFenceValue() == 4);
+
+		// Objects deferred to the next signal wait for OnSignal, then for that value.
+		queue.DeferToNextSignal(objects[4]);
+		queue.DeferToNextSignal(objects[5]);
+		fence.mCompleted = 5;
+		HEADLESS_CHECK(queue.Collect(fence.GetCompletedValue()) == 1);
+		HEADLESS_CHECK(objects[4].use_count() == 2 && queue.GetObjectCount() == 2);
+		queue.OnSignal(6);
+		HEADLESS_CHECK(queue.GetOldestFenceValue() == 6 && queue.Collect(fence.GetCompletedValue()) == 0);
+		fence.WaitForValue(6);
+		HEADLESS_CHECK(queue.Collect(fence.GetCompletedValue()) == 2 && objects[5].use_count() == 1);
+		HEADLESS_CHECK(queue.GetObjectCount() == 0 && queue.GetReleasedCount() == 6);
+		HEADLESS_CHECK(queue.GetOldestFenceValue() == 0);
+
+		// Once the lists have grown, a frame's retire-and-collect cycle reuses them.
+		for (uint64_t value = 7; value < 10; ++value)
+		{
+			queue.DeferToNextSignal(objects[0]);
+			queue.Defer(objects[1], value);
+			queue.OnSignal(value);
+			queue.Collect(value);
+		}
+		uint64_t allocations = GetHeapAllocationCount();
+		for (uint64_t value = 10; value < 20; ++value)
+		{
+			queue.DeferToNextSignal(objects[0]);
+			queue.Defer(objects[1], value);
+			queue.OnSignal(value);
+			fence.mCompleted = value - 1;
+			queue.Collect(fence.GetCompletedValue());
+		}
+		HEADLESS_CHECK(GetHeapAllocationCount() == allocations);
+
+		// Teardown drops the rest, including anything still waiting for a signal.
+		queue.DeferToNextSignal(objects[2]);
+		queue.ReleaseAll();
+		HEADLESS_CHECK(queue.GetObjectCount() == 0 && queue.GetBatchCount() == 0);
+		HEADLESS_CHECK(objects[0].use_count() == 1 && objects[1].use_count() == 1 && objects[2].use_count() == 1);
+	}
+
+	// The box filter straight from its definition, one texel at a time.
+	uint8_t BoxTexel(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+		uint32_t x, uint32_t y, uint32_t channel)
+	{
+		uint32_t x0 = x * 2;
+		uint32_t y0 = y * 2;
+		uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+		uint32_t y1 = std::min(y0 + 1, srcHeight - 1);
+		uint32_t sum = src[y0 * srcRowPitch + x0 * 4 + channel] + src[y0 * srcRowPitch + x1 * 4 + channel] +
+			src[y1 * srcRowPitch + x0 * 4 + channel] + src[y1 * srcRowPitch + x1 * 4 + channel];
+		return static_cast<uint8_t>((sum + 2) / 4);
+	}
+
+	void TestMipChain()
+	{
+		// Sizes that exercise the four-texel SIMD blocks, the scalar tail after them, odd edges
+		// and one-texel edges.
+		const uint32_t sizes[][2] = { { 64, 64 }, { 37, 23 }, { 9, 8 }, { 8, 9 }, { 1, 17 }, { 33, 1 }, { 255, 130 } };
+		uint32_t random = 12345;
+		uint32_t mismatches = 0;
+		for (const uint32_t* size : sizes)
+		{
+			uint32_t width = size[0];
+			uint32_t height = size[1];
+			// A row pitch with padding, so the filters must not assume packed rows.
+			uint32_t rowPitch = width * 4 + 12;
+			std::vector<uint8_t> image(static_cast<size_t>(rowPitch) * height);
+			for (uint8_t& byte : image)
+			{
+				random ^= random << 13;
+				random ^= random >> 17;
+				random ^= random << 5;
+				// Extremes included: 255s are where a 16-bit sum or the pack could go wrong.
+				byte = (random & 7) == 0 ? 255 : static_cast<uint8_t>(random >> 8);
+			}
+
+			uint32_t dstWidth = std::max(width / 2, 1u);
+			uint32_t dstHeight = std::max(height / 2, 1u);
+			std::vector<uint8_t> simd(dstWidth * 4 * dstHeight);
+			std::vector<uint8_t> scalar(simd.size());
+			DownsampleBoxRGBA8(image.data(), width, height, rowPitch, simd.data(), dstWidth * 4, 0, dstHeight);
+			DownsampleBoxRGBA8Scalar(image.data(), width, height, rowPitch, scalar.data(), dstWidth * 4, 0, dstHeight);
+			mismatches += simd != scalar;
+
+			for (uint32_t y = 0; y < dstHeight; ++y)
+			{
+				for (uint32_t x = 0; x < dstWidth; ++x)
+				{
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						mismatches += scalar[(y * dstWidth + x) * 4 + c] != BoxTexel(image.data(), width, height, rowPitch, x, y, c);
+					}
+				}
+			}
+
+			// The whole chain: D3D12's level sizes, each level from the one above, and the
+			// same bytes whether or not the rows are spread over threads.
+			FMipChain chain;
+			GenerateMipChainRGBA8(image.data(), width, height, rowPitch, nullptr, chain);
+			HEADLESS_CHECK(chain.mLevels.size() == GetMipLevelCount(width, height));
+			const FMipLevel& last = chain.mLevels.back();
+			HEADLESS_CHECK(last.mWidth == 1 && last.mHeight == 1);
+			HEADLESS_CHECK(std::memcmp(chain.mData.data() + chain.mLevels[1].mOffset, simd.data(), simd.size()) == 0);
+
+			CJobSystem jobs(2);
+			FMipChain threaded;
+			GenerateMipChainRGBA8(image.data(), width, height, rowPitch, &jobs, threaded);
+			HEADLESS_CHECK(threaded.mData == chain.mData);
+		}
+		HEADLESS_CHECK(mismatches == 0);
+	}
+
+	void TestProceduralTexture()
+	{
+		const EProceduralPattern patterns[] =
+		{
+			EProceduralPattern::Solid, EProceduralPattern::Checker, EProceduralPattern::HorizontalGradient,
+			EProceduralPattern::VerticalGradient, EProceduralPattern::RadialGradient,
+			EProceduralPattern::ValueNoise, EProceduralPattern::PerlinNoise,
+		};
+		const ERenderFormat formats[] = { ERenderFormat::RGBA8Unorm, ERenderFormat::RGBA32Float };
+		// Widths that are whole SIMD blocks, leave a scalar tail, or are all tail.
+		const uint32_t sizes[][2] = { { 64, 16 }, { 37, 9 }, { 3, 5 }, { 131, 2 } };
+		// Cell sizes and octaves from one-texel lattices (every texel its own cell) to coarse ones.
+		const uint32_t noise[][3] = { { 32, 4, 0 }, { 1, 1, 7 }, { 5, 8, 0xdeadbeef }, { 256, 2, 42 } };
+
+		uint32_t mismatches = 0;
+		uint32_t uniformNoise = 0;
+		for (EProceduralPattern pattern : patterns)
+		{
+			for (ERenderFormat format : formats)
+			{
+				for (const uint32_t* size : sizes)
+				{
+					for (const uint32_t* settings : noise)
+					{
+						FProceduralTextureDesc desc;
+						desc.mPattern = pattern;
+						desc.mFormat = format;
+						desc.mWidth = size[0];
+						desc.mHeight = size[1];
+						desc.mColor0[0] = 0.1f;
+						desc.mColor0[1] = 0.9f;
+						desc.mColor1[2] = 0.25f;
+						desc.mColor1[3] = 0.5f;
+						desc.mCellSize = settings[0];
+						desc.mOctaves = settings[1];
+						desc.mSeed = settings[2];
+
+						// A padded pitch, so neither path may assume packed rows.
+						uint32_t rowPitch = desc.mWidth * GetProceduralTexelSize(format) + 8;
+						std::vector<uint8_t> simd(static_cast<size_t>(rowPitch) * desc.mHeight, 0xcd);
+						std::vector<uint8_t> scalar(simd.size(), 0xcd);
+						GenerateProceduralRows(desc, simd.data(), rowPitch, 0, desc.mHeight);
+						GenerateProceduralRowsScalar(desc, scalar.data(), rowPitch, 0, desc.mHeight);
+						mismatches += simd != scalar;
+
+						// Noise that came out flat would compare equal without testing anything. Inside
+						// one cell corner it may be flat once quantized, so only images spanning a cell.
+						if ((pattern == EProceduralPattern::ValueNoise || pattern == EProceduralPattern::PerlinNoise) &&
+							desc.mCellSize < desc.mWidth)
+						{
+							uint32_t texelSize = GetProceduralTexelSize(format);
+							bool uniform = true;
+							for (uint32_t y = 0; y < desc.mHeight; ++y)
+							{
+								for (uint32_t x = 0; x < desc.mWidth; ++x)
+								{
+									uniform &= std::memcmp(scalar.data(), scalar.data() + y * rowPitch + x * texelSize, texelSize) == 0;
+								}
+							}
+							uniformNoise += uniform;
+						}
+					}
+				}
+			}
+		}
+		HEADLESS_CHECK(mismatches == 0);
+		HEADLESS_CHECK(uniformNoise == 0);
+
+		// Rows spread over threads land in the same bytes.
+		FProceduralTextureDesc desc;
+		desc.mPattern = EProceduralPattern::PerlinNoise;
+		desc.mWidth = 99;
+		desc.mHeight = 70;
+		std::vector<uint8_t> single(desc.mWidth * 4 * desc.mHeight);
+		std::vector<uint8_t> threaded(single.size());
+		GenerateProceduralRowsScalar(desc, single.data(), desc.mWidth * 4, 0, desc.mHeight);
+		CJobSystem jobs(2);
+		GenerateProceduralTexture(desc, threaded.data(), desc.mWidth * 4, &jobs);
+		HEADLESS_CHECK(threaded == single);
+	}
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// Copies layout from random source bytes into two destinations filled alike, with
+	// CopySubresource and with the row loop, and compares them whole, so bytes written between
+	// rows or slices or past the end count as well. dstMisalign shifts the destination off a
+	// 16-byte boundary, where streaming stores need a head.
+	bool CopiesMatch(FSubresourceCopy layout, ESubresourceCopyTarget target, CJobSystem* jobs,
+		size_t dstMisalign, uint32_t& random)
+	{
+		size_t lastSlice = layout.mNumSlices - 1;
+		size_t srcSize = layout.mSrcSlicePitch * lastSlice + layout.mSrcRowPitch * (layout.mNumRows - 1) + layout.mRowSize;
+		size_t dstSize = layout.mDstSlicePitch * lastSlice + layout.mDstRowPitch * (layout.mNumRows - 1) + layout.mRowSize;
+		std::vector<uint8_t> src(srcSize);
+		for (uint8_t& byte : src)
+		{
+			byte = static_cast<uint8_t>(NextRandom(random) >> 8);
+		}
+		const size_t guard = 64;
+		std::vector<uint8_t> expected(dstSize + dstMisalign + guard, 0xcd);
+		std::vector<uint8_t> copied(expected);
+
+		layout.mSrc = src.data();
+		layout.mDst = expected.data() + dstMisalign;
+		CopySubresourceRows(layout);
+		layout.mDst = copied.data() + dstMisalign;
+		CopySubresource(layout, target, jobs);
+		return copied == expected;
+	}
+
+	FSubresourceCopy MakeCopyLayout(size_t rowSize, uint32_t numRows, uint32_t numSlices, size_t rowPadding, size_t slicePadding)
+	{
+		FSubresourceCopy layout;
+		layout.mSrc = nullptr;
+		layout.mDst = nullptr;
+		layout.mRowSize = rowSize;
+		layout.mNumRows = numRows;
+		layout.mNumSlices = numSlices;
+		layout.mSrcRowPitch = rowSize + rowPadding;
+		layout.mSrcSlicePitch = layout.mSrcRowPitch * numRows + slicePadding;
+		layout.mDstRowPitch = layout.mSrcRowPitch;
+		layout.mDstSlicePitch = layout.mSrcSlicePitch;
+		return layout;
+	}
+
+	void TestSubresourceCopy()
+	{
+		CJobSystem jobs(2);
+		const ESubresourceCopyTarget targets[] = { ESubresourceCopyTarget::Cached, ESubresourceCopyTarget::WriteCombined };
+		uint32_t random = 2463534242u;
+
+		// Layouts that take each path for certain. Jobs only split copies of 512 KB and more.
+		struct FCase
+		{
+			size_t mRowSize;
+			uint32_t mNumRows;
+			uint32_t mNumSlices;
+			size_t mRowPadding;
+			size_t mSlicePadding;
+		};
+		const FCase cases[] =
+		{
+			{ 1000, 700, 1, 0, 0 },         // One span, split by byte ranges with a short last chunk.
+			{ 4096, 64, 3, 0, 0 },          // Packed slices merge into one span.
+			{ 4096, 16, 10, 0, 256 },       // One span per slice, several slices per job.
+			{ 3000, 100, 3, 0, 8 },         // One span per slice, each longer than a job's chunk.
+			{ 1000, 300, 3, 24, 0 },        // Padded rows: a span per row, across slice boundaries.
+			{ 1000, 300, 3, 24, 4096 },     // Padded rows and slices.
+			{ 255, 7, 5, 1, 3 },            // Small: below the split and the streaming threshold.
+			{ 300, 9, 2, 0, 0 },            // Small packed, streamed with a head and a tail.
+		};
+		uint32_t mismatches = 0;
+		for (const FCase& c : cases)
+		{
+			FSubresourceCopy layout = MakeCopyLayout(c.mRowSize, c.mNumRows, c.mNumSlices, c.mRowPadding, c.mSlicePadding);
+			for (ESubresourceCopyTarget target : targets)
+			{
+				for (size_t misalign : { 0, 5 })
+				{
+					mismatches += !CopiesMatch(layout, target, nullptr, misalign, random);
+					mismatches += !CopiesMatch(layout, target, &jobs, misalign, random);
+				}
+			}
+		}
+		HEADLESS_CHECK(mismatches == 0);
+
+		// Random layouts: packed or padded rows and slices, source and destination pitches that
+		// differ, one to eight slices, small copies and ones large enough to split.
+		mismatches = 0;
+		for (uint32_t i = 0; i < 200; ++i)
+		{
+			size_t rowSize = 1 + NextRandom(random) % ((NextRandom(random) & 3) == 0 ? 16384 : 512);
+			uint32_t numRows = 1 + NextRandom(random) % 96;
+			uint32_t numSlices = 1 + NextRandom(random) % 8;
+			bool packedRows = (NextRandom(random) & 1) != 0;
+			bool packedSlices = (NextRandom(random) & 1) != 0;
+			FSubresourceCopy layout = MakeCopyLayout(rowSize, numRows, numSlices,
+				packedRows ? 0 : NextRandom(random) % 300, packedSlices ? 0 : NextRandom(random) % 5000);
+			if ((NextRandom(random) & 3) == 0)
+			{
+				// D3D12 footprints pad the destination only.
+				layout.mDstRowPitch = (rowSize + 255) & ~static_cast<size_t>(255);
+				layout.mDstSlicePitch = layout.mDstRowPitch * numRows + (packedSlices ? 0 : 512);
+			}
+			ESubresourceCopyTarget target = targets[NextRandom(random) & 1];
+			CJobSystem* copyJobs = (NextRandom(random) & 1) != 0 ? &jobs : nullptr;
+			mismatches += !CopiesMatch(layout, target, copyJobs, NextRandom(random) % 16, random);
+		}
+		HEADLESS_CHECK(mismatches == 0);
+	}
+
+	// Peak signal-to-noise ratio of decoded against source over the first channelCount channels
+	// of every texel, in dB.
+	double GetPSNR(const std::vector<uint8_t>& source, const std::vector<uint8_t>& decoded, uint32_t channelCount)
+	{
+		double squaredError = 0.0;
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			if (i % 4 < channelCount)
+			{
+				double difference = static_cast<double>(source[i]) - decoded[i];
+				squaredError += difference * difference;
+			}
+		}
+		double meanSquaredError = squaredError / (source.size() / 4 * channelCount);
+		return meanSquaredError == 0.0 ? 999.0 : 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+	}
+
+	void TestBlockCompress()
+	{
+		const ERenderFormat formats[] = { ERenderFormat::BC1Unorm, ERenderFormat::BC3Unorm, ERenderFormat::BC7Unorm };
+		const EBlockCompressMode modes[] = { EBlockCompressMode::Fast, EBlockCompressMode::Quality };
+		// Sizes that are not whole blocks, so edge blocks repeat their last column and row.
+		const uint32_t sizes[][2] = { { 37, 21 }, { 5, 3 }, { 66, 17 } };
+		CJobSystem jobs(2);
+
+		for (const uint32_t* size : sizes)
+		{
+			const uint32_t width = size[0];
+			const uint32_t height = size[1];
+			FProceduralTextureDesc desc;
+			desc.mPattern = EProceduralPattern::PerlinNoise;
+			desc.mWidth = width;
+			desc.mHeight = height;
+			desc.mCellSize = 16;
+			desc.mSeed = width;
+			desc.mColor0[3] = 0.25f;
+			std::vector<uint8_t> translucent(width * height * 4);
+			GenerateProceduralTexture(desc, translucent.data(), width * 4, nullptr);
+			// BC1 would punch out texels under half alpha; give it the same colours, opaque.
+			std::vector<uint8_t> opaque = translucent;
+			for (size_t i = 3; i < opaque.size(); i += 4)
+			{
+				opaque[i] = 0xff;
+			}
+
+			for (ERenderFormat format : formats)
+			{
+				const std::vector<uint8_t>& image = format == ERenderFormat::BC1Unorm ? opaque : translucent;
+				const uint32_t dstRowPitch = static_cast<uint32_t>(GetFormatRowBytes(format, width));
+				const uint32_t blockRows = GetFormatRowCount(format, height);
+				for (EBlockCompressMode mode : modes)
+				{
+					// SIMD, scalar, threaded and single-threaded give the same blocks.
+					std::vector<uint8_t> simd(dstRowPitch * blockRows), scalar(simd.size());
+					std::vector<uint8_t> threaded(simd.size()), single(simd.size());
+					CompressTextureRows(format, mode, image.data(), width, height, width * 4, simd.data(), dstRowPitch, 0, blockRows);
+					CompressTextureRowsScalar(format, mode, image.data(), width, height, width * 4, scalar.data(), dstRowPitch,
+						0, blockRows);
+					CompressTexture(format, mode, image.data(), width, height, width * 4, threaded.data(), dstRowPitch, &jobs);
+					CompressTexture(format, mode, image.data(), width, height, width * 4, single.data(), dstRowPitch, nullptr);
+					HEADLESS_CHECK(simd == scalar && simd == threaded && simd == single);
+
+					std::vector<uint8_t> decoded(image.size());
+					DecompressTexture(format, simd.data(), dstRowPitch, width, height, decoded.data(), width * 4);
+					HEADLESS_CHECK(GetPSNR(image, decoded, 4) >= (format == ERenderFormat::BC7Unorm ? 45.0 : 33.0));
+				}
+			}
+		}
+
+		// A solid block decodes to exactly its colour, given one the format can hold: 565 for
+		// BC1's colour, and for BC7's mode 6 channels that share their lowest bit.
+		const uint8_t solidTexels[][4] = { { 0xff, 0x00, 0xff, 0xff }, { 0xff, 0x00, 0xff, 0x80 }, { 0x40, 0x86, 0xc2, 0x60 } };
+		for (uint32_t f = 0; f < 3; ++f)
+		{
+			const ERenderFormat format = formats[f];
+			const uint8_t* texel = solidTexels[f];
+			std::vector<uint8_t> solid(4 * 4 * 4), decoded(solid.size());
+			for (size_t i = 0; i < solid.size(); ++i)
+			{
+				solid[i] = texel[i % 4];
+			}
+			for (EBlockCompressMode mode : modes)
+			{
+				uint8_t block[16] = {};
+				CompressTexture(format, mode, solid.data(), 4, 4, 16, block, 16, nullptr);
+				DecompressTexture(format, block, 16, 4, 4, decoded.data(), 16);
+				HEADLESS_CHECK(decoded == solid);
+			}
+		}
+	}
+
+	// The sample files in TestData fill each subresource with the byte 1 + its index, so its
+	// first and last bytes show whether ParseDDS found it where the file has it.
+	bool CheckDDSSubresources(const CMappedFile& file, const FDDSTexture& texture)
+	{
+		bool found = texture.mSubresources.size() == texture.mMipLevels * texture.mArraySize;
+		for (size_t i = 0; i < texture.mSubresources.size(); ++i)
+		{
+			const FDDSSubresource& subresource = texture.mSubresources[i];
+			const uint8_t fill = static_cast<uint8_t>(1 + i);
+			found &= subresource.mSlicePitch == static_cast<uint64_t>(subresource.mRowPitch) * subresource.mNumRows;
+			found &= file.GetData()[subresource.mOffset] == fill &&
+				file.GetData()[subresource.mOffset + subresource.mSlicePitch - 1] == fill;
+		}
+		const FDDSSubresource& last = texture.mSubresources.back();
+		return found && last.mOffset + last.mSlicePitch == file.GetSize();
+	}
+
+	// What ParseDDS throws for data, empty when it parses.
+	std::string GetDDSError(const std::vector<uint8_t>& data)
+	{
+		try
+		{
+			FDDSTexture texture;
+			ParseDDS(data.data(), data.size(), texture);
+		}
+		catch (const std::runtime_error& error)
+		{
+			return error.what();
+		}
+		return std::string();
+	}
+
+	// A copy of data with the 32-bit field at offset set to value.
+	std::vector<uint8_t> PatchDDS(const std::vector<uint8_t>& data, size_t offset, uint32_t value)
+	{
+		std::vector<uint8_t> patched = data;
+		memcpy(&patched[offset], &value, sizeof(value));
+		return patched;
+	}
+
+	// Reads the files in TestData, so -selftest has to run from the repository root.
+	void TestDDSTexture()
+	{
+		// Legacy DXT1 header, sizes that are not whole blocks down to 1x1.
+		CMappedFile bc1File("TestData/bc1_mips.dds");
+		FDDSTexture bc1;
+		ParseDDS(bc1File.GetData(), bc1File.GetSize(), bc1);
+		HEADLESS_CHECK(bc1.mFormat == ERenderFormat::BC1Unorm && bc1.mWidth == 12 && bc1.mHeight == 20);
+		HEADLESS_CHECK(bc1.mMipLevels == 5 && bc1.mArraySize == 1 && !bc1.mCubeMap);
+		HEADLESS_CHECK(CheckDDSSubresources(bc1File, bc1));
+		const FDDSSubresource& bc1Mip2 = bc1.mSubresources[2];
+		HEADLESS_CHECK(bc1Mip2.mOffset == 296 && bc1Mip2.mWidth == 3 && bc1Mip2.mHeight == 5);
+		HEADLESS_CHECK(bc1Mip2.mRowPitch == 8 && bc1Mip2.mNumRows == 2);
+
+		// In an upload buffer the same levels take whole blocks, 256-byte rows and 512-byte
+		// aligned starts, and the total stops at the end of the last row.
+		FTextureFootprint footprints[5];
+		HEADLESS_CHECK(GetTextureFootprints(bc1.mFormat, bc1.mWidth, bc1.mHeight, bc1.mMipLevels, 0, 5, footprints) == 3592);
+		HEADLESS_CHECK(footprints[1].mOffset == 1536 && footprints[2].mOffset == 2560 && footprints[4].mOffset == 3584);
+		HEADLESS_CHECK(footprints[2].mWidth == 4 && footprints[2].mHeight == 8 && footprints[2].mNumRows == 2);
+		HEADLESS_CHECK(footprints[2].mRowPitch == 256 && footprints[2].mRowSize == 8);
+
+		// DX10 header with an array: each slice has its whole chain before the next.
+		CMappedFile bc3File("TestData/bc3_array.dds");
+		FDDSTexture bc3;
+		ParseDDS(bc3File.GetData(), bc3File.GetSize(), bc3);
+		HEADLESS_CHECK(bc3.mFormat == ERenderFormat::BC3Unorm && bc3.mWidth == 8 && bc3.mHeight == 8);
+		HEADLESS_CHECK(bc3.mMipLevels == 4 && bc3.mArraySize == 3 && !bc3.mCubeMap);
+		HEADLESS_CHECK(CheckDDSSubresources(bc3File, bc3));
+		HEADLESS_CHECK(bc3.mSubresources[4].mOffset == 148 + 112 && bc3.mSubresources[4].mWidth == 8);
+
+		// A cube map array counts six slices per cube. Footprints of a later slice restart
+		// its chain.
+		CMappedFile bc7File("TestData/bc7_cubearray.dds");
+		FDDSTexture bc7;
+		ParseDDS(bc7File.GetData(), bc7File.GetSize(), bc7);
+		HEADLESS_CHECK(bc7.mFormat == ERenderFormat::BC7UnormSrgb && bc7.mWidth == 16 && bc7.mHeight == 16);
+		HEADLESS_CHECK(bc7.mMipLevels == 5 && bc7.mArraySize == 12 && bc7.mCubeMap);
+		HEADLESS_CHECK(CheckDDSSubresources(bc7File, bc7));
+		const FDDSSubresource& bc7Face7Mip1 = bc7.mSubresources[1 + 7 * 5];
+		HEADLESS_CHECK(bc7Face7Mip1.mOffset == 148 + 7 * 368 + 256 && bc7Face7Mip1.mRowPitch == 32 &&
+			bc7Face7Mip1.mNumRows == 2);
+		HEADLESS_CHECK(GetTextureFootprints(bc7.mFormat, bc7.mWidth, bc7.mHeight, bc7.mMipLevels, 36, 2, footprints) ==
+			512 + 16);
+		HEADLESS_CHECK(footprints[0].mWidth == 8 && footprints[1].mWidth == 4 && footprints[1].mOffset == 512);
+
+		// A file one byte short of its last subresource.
+		CMappedFile truncatedFile("TestData/bc3_truncated.dds");
+		const std::vector<uint8_t> truncated(truncatedFile.GetData(), truncatedFile.GetData() + truncatedFile.GetSize());
+		HEADLESS_CHECK(GetDDSError(truncated) == "DDS file truncated");
+
+		// Headers that do not hold up, made from the good files.
+		const std::vector<uint8_t> dx10(bc3File.GetData(), bc3File.GetData() + bc3File.GetSize());
+		const std::vector<uint8_t> legacy(bc1File.GetData(), bc1File.GetData() + bc1File.GetSize());
+		HEADLESS_CHECK(GetDDSError(dx10).empty() && GetDDSError(legacy).empty());
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 0, 0x20534443)) == "Not a DDS file");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 4, 120)) == "Not a DDS file");
+		HEADLESS_CHECK(GetDDSError(std::vector<uint8_t>(dx10.begin(), dx10.begin() + 127)) == "Not a DDS file");
+		HEADLESS_CHECK(GetDDSError(std::vector<uint8_t>(dx10.begin(), dx10.begin() + 140)) == "DDS file truncated");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 128, 2)) == "DDS format not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 128, 76)) == "DDS format not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 132, 4)) == "DDS volume textures are not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 140, 0)) == "DDS size not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 16, 0)) == "DDS size not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 12, 16385)) == "DDS size not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(dx10, 28, 5)) == "DDS has more mip levels than its size allows");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(legacy, 112, 0x200000)) == "DDS volume textures are not supported");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(legacy, 112, 0x200 | 0x400)) == "DDS cube map without all six faces");
+		HEADLESS_CHECK(GetDDSError(PatchDDS(legacy, 84, 0x31545844 + 0x100)) == "DDS format not supported");
+	}
+
+	// Timeline whose values complete when the test says so.
+	struct FFakeTimeline
+	{
+		uint64_t mCompleted = 0;
+
+		bool IsComplete(uint64_t value) const
+		{
+			return value <= mCompleted;
+		}
+	};
+
+	uint64_t RecordDraws(IRenderCommandList* list, IRenderCommandAllocator* allocator, uint32_t draws)
+	{
+		list->Reset(allocator, nullptr);
+		for (uint32_t i = 0; i < draws; ++i)
+		{
+			list->DrawIndexed(3, 1, 0, 0);
+		}
+		list->Close();
+		return allocator->GetCommandCount();
+	}
+
+	void TestCommandAllocatorPool()
+	{
+		typedef CCommandAllocatorPool<FRenderAllocatorBackend, FFakeTimeline> CPool;
+
+		CNullRenderDevice device;
+		FFakeTimeline timeline;
+		CPool pool(100, 1);
+		pool.GetBackend().mDevice = &device;
+
+		// The usage released with an allocator is what its lists recorded, across lists and
+		// until the allocator is reset.
+		CPool::FHandle handle = pool.Acquire(ERenderQueueType::Direct);
+		std::unique_ptr<IRenderCommandList> list = device.CreateCommandList(ERenderQueueType::Direct, handle.mAllocator.get(), nullptr);
+		HEADLESS_CHECK(RecordDraws(list.get(), handle.mAllocator.get(), 30) == 30);
+		HEADLESS_CHECK(RecordDraws(list.get(), handle.mAllocator.get(), 20) == 50);
+		pool.Release(handle, timeline, 1, handle.mAllocator->GetCommandCount());
+		HEADLESS_CHECK(pool.GetStats().mHighWater == 50 && pool.GetStats().mRetainedHighWater == 50);
+
+		// Not retired yet: a second allocator. Retired: the first one, reset.
+		CPool::FHandle other = pool.Acquire(ERenderQueueType::Direct);
+		HEADLESS_CHECK(pool.GetStats().mCreated == 2);
+		timeline.mCompleted = 1;
+		handle = pool.Acquire(ERenderQueueType::Direct);
+		HEADLESS_CHECK(pool.GetStats().mReused == 1 && handle.mHighWater == 50);
+		HEADLESS_CHECK(handle.mAllocator->GetCommandCount() == 0);
+
+		// A burst past the threshold: the allocator is dropped once retired rather than kept
+		// at its grown size.
+		uint64_t commands = RecordDraws(list.get(), handle.mAllocator.get(), 150);
+		pool.Release(handle, timeline, 2, commands);
+		pool.Release(other, timeline, 2, 0);
+		HEADLESS_CHECK(pool.GetStats().mHighWater == 150);
+		pool.Trim();
+		HEADLESS_CHECK(pool.GetStats().mTrimmed == 0);
+		timeline.mCompleted = 2;
+		pool.Trim();
+		HEADLESS_CHECK(pool.GetStats().mTrimmed == 1 && pool.GetStats().mLive == 1);
+		HEADLESS_CHECK(pool.GetStats().mRetainedHighWater == 0);
+
+		// Retired allocators past MaxIdle go too.
+		CPool::FHandle handles[3];
+		for (CPool::FHandle& h : handles)
+		{
+			h = pool.Acquire(ERenderQueueType::Direct);
+		}
+		for (CPool::FHandle& h : handles)
+		{
+			pool.Release(h, timeline, 2, 10);
+		}
+		pool.Trim();
+		HEADLESS_CHECK(pool.GetStats().mLive == 1 && pool.GetStats().mTrimmed == 3);
+		HEADLESS_CHECK(device.GetStats().mAllocatorsCreated == pool.GetStats().mCreated);
+		pool.Clear();
+	}
+
+	// Display with a fixed refresh that shows each present at the first vblank it can: one at
+	// least syncInterval vblanks after the previous, or at once (torn) for interval 0. The CPU
+	// starts the next frame when the present is shown, as it would with a one-deep flip queue.
+	struct FFakeDisplay
+	{
+		int64_t mRefreshPeriodNs;
+		int64_t mTimeNs = 0;
+		uint32_t mLastVBlank = 0;
+		FRenderPresentStats mStats = {};
+
+		explicit FFakeDisplay(int64_t refreshPeriodNs) :
+			mRefreshPeriodNs(refreshPeriodNs)
+		{
+		}
+
+		const FRenderPresentStats& Present(int64_t frameTimeNs, uint32_t syncInterval)
+		{
+			int64_t readyNs = mTimeNs + frameTimeNs;
+			uint32_t vblank = static_cast<uint32_t>((readyNs + mRefreshPeriodNs - 1) / mRefreshPeriodNs);
+			if (syncInterval > 0)
+			{
+				vblank = std::max(vblank, mLastVBlank + syncInterval);
+				mTimeNs = vblank * mRefreshPeriodNs;
+			}
+			else
+			{
+				mTimeNs = readyNs;
+			}
+			mLastVBlank = vblank;
+
+			++mStats.mPresentCount;
+			mStats.mDisplayedPresentCount = mStats.mPresentCount;
+			mStats.mPresentRefreshCount = vblank;
+			mStats.mSyncRefreshCount = vblank;
+			mStats.mSyncTimeNs = vblank * mRefreshPeriodNs;
+			return mStats;
+		}
+	};
+
+	// Runs frames of a fixed cost through the controller; display may be null for a swap chain
+	// without statistics.
+	EPresentMode RunPresentedFrames(CPresentController& controller, FFakeDisplay* display,
+		int64_t frameTimeNs, uint32_t frames)
+	{
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			const FRenderPresentStats* stats = display ? &display->Present(frameTimeNs, controller.GetSyncInterval()) : nullptr;
+			controller.OnFramePresented(frameTimeNs, stats);
+		}
+		return controller.GetMode();
+	}
+
+	void TestPresentController()
+	{
+		// A 75Hz display, where the controller assumes 60Hz until it has measured.
+		const int64_t refresh = 13333333;
+		FPresentControllerConfig config;
+		config.mTearingSupported = true;
+		config.mWindowFrames = 10;
+		config.mDwellFrames = 20;
+		config.mMaxDwellFrames = 80;
+
+		// Frames that fit stay on vsync without a miss, and the period is measured.
+		{
+			CPresentController controller(config);
+			FFakeDisplay display(refresh);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh / 2, 100) == EPresentMode::VSync);
+			HEADLESS_CHECK(controller.GetStats().mMissedVBlanks == 0 && controller.GetStats().mModeSwitches == 0);
+			HEADLESS_CHECK(std::abs(controller.GetRefreshPeriodNs() - refresh) < refresh / 100);
+		}
+
+		// Just over a refresh: tear if the swap chain can, else half rate. Well over, half rate
+		// either way since it fits.
+		{
+			CPresentController controller(config);
+			FFakeDisplay display(refresh);
+			RunPresentedFrames(controller, &display, refresh / 2, 20);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh * 12 / 10, 10) == EPresentMode::Tearing);
+			HEADLESS_CHECK(controller.GetSyncInterval() == 0 && controller.GetStats().mMissedVBlanks > 2);
+		}
+		{
+			FPresentControllerConfig noTearing = config;
+			noTearing.mTearingSupported = false;
+			CPresentController controller(noTearing);
+			FFakeDisplay display(refresh);
+			RunPresentedFrames(controller, &display, refresh / 2, 20);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh * 12 / 10, 10) == EPresentMode::HalfRate);
+			HEADLESS_CHECK(controller.GetSyncInterval() == 2);
+		}
+		{
+			CPresentController controller(config);
+			FFakeDisplay display(refresh);
+			RunPresentedFrames(controller, &display, refresh / 2, 20);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh * 155 / 100, 10) == EPresentMode::HalfRate);
+
+			// Half rate that misses too falls back to tearing.
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh * 25 / 10, 10) == EPresentMode::Tearing);
+		}
+
+		// Back to vsync only after the dwell, and a vsync that fails again within the next
+		// dwell doubles it.
+		{
+			CPresentController controller(config);
+			FFakeDisplay display(refresh);
+			RunPresentedFrames(controller, &display, refresh / 2, 20);
+			RunPresentedFrames(controller, &display, refresh * 12 / 10, 10);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh / 2, 10) == EPresentMode::Tearing);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh / 2, 10) == EPresentMode::VSync);
+			HEADLESS_CHECK(controller.GetDwellFrames() == 20);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh * 12 / 10, 10) == EPresentMode::Tearing);
+			HEADLESS_CHECK(controller.GetDwellFrames() == 40);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh / 2, 30) == EPresentMode::Tearing);
+			HEADLESS_CHECK(RunPresentedFrames(controller, &display, refresh / 2, 10) == EPresentMode::VSync);
+
+			// Holding vsync for the longest dwell earns the short one back.
+			RunPresentedFrames(controller, &display, refresh / 2, 80);
+			HEADLESS_CHECK(controller.GetDwellFrames() == 20);
+		}
+
+		// Without statistics, frames longer than a refresh count as misses.
+		{
+			CPresentController controller(config);
+			HEADLESS_CHECK(RunPresentedFrames(controller, nullptr, 10000000, 10) == EPresentMode::VSync);
+			HEADLESS_CHECK(RunPresentedFrames(controller, nullptr, 20000000, 10) == EPresentMode::Tearing);
+			HEADLESS_CHECK(controller.GetStats().mMissedVBlanks == 10);
+		}
+	}
+
+	void TestBuddyAllocator()
+	{
+		const uint64_t capacity = 1024 * 1024;
+		const uint64_t minBlock = 4096;
+		CBuddyAllocator allocator;
+		allocator.Initialize(capacity, minBlock);
+
+		// The first small block splits the range all the way down: one free block of each
+		// size from the minimum to half the range remains.
+		uint64_t small = allocator.Allocate(100, 0);
+		HEADLESS_CHECK(small == 0);
+		HEADLESS_CHECK(allocator.GetStats().mAllocatedBytes == minBlock && allocator.GetStats().mRequestedBytes == 100);
+		HEADLESS_CHECK(allocator.GetStats().mFreeBytes == capacity - minBlock);
+		HEADLESS_CHECK(allocator.GetStats().mLargestFreeBlock == capacity / 2);
+
+		// Sizes round up to a power of two, and every block starts at a multiple of its size,
+		// which covers the alignment asked for.
+		uint64_t rounded = allocator.Allocate(5000, 0);
+		uint64_t aligned = allocator.Allocate(4096, 65536);
+		HEADLESS_CHECK(rounded == 8192 && aligned == 65536);
+		HEADLESS_CHECK(allocator.GetStats().mAllocatedBytes == minBlock + 8192 + 65536);
+		HEADLESS_CHECK(allocator.GetStats().GetInternalFragmentation() > 0.8);
+
+		// Freed blocks merge with their buddies back into the whole range.
+		allocator.Free(rounded);
+		allocator.Free(small);
+		HEADLESS_CHECK(allocator.GetStats().mLargestFreeBlock == capacity / 2);
+		allocator.Free(aligned);
+		HEADLESS_CHECK(allocator.IsEmpty() && allocator.GetStats().mLargestFreeBlock == capacity);
+		HEADLESS_CHECK(allocator.GetStats().mFreeBytes == capacity && allocator.GetStats().mAllocatedBytes == 0);
+
+		// Exhaustion: exactly capacity / block blocks fit, then requests fail without
+		// disturbing anything.
+		std::vector<uint64_t> offsets;
+		for (uint64_t offset = allocator.Allocate(minBlock, 0); offset != CBuddyAllocator::InvalidOffset;
+			offset = allocator.Allocate(minBlock, 0))
+		{
+			offsets.push_back(offset);
+		}
+		HEADLESS_CHECK(offsets.size() == capacity / minBlock);
+		HEADLESS_CHECK(allocator.GetStats().mFreeBytes == 0 && allocator.GetStats().mLargestFreeBlock == 0);
+		HEADLESS_CHECK(allocator.Allocate(capacity * 2, 0) == CBuddyAllocator::InvalidOffset);
+
+		// Every other block freed: half the range free, but no block larger than the minimum,
+		// so a two-block request still fails.
+		for (size_t i = 0; i < offsets.size(); i += 2)
+		{
+			allocator.Free(offsets[i]);
+		}
+		HEADLESS_CHECK(allocator.GetStats().mFreeBytes == capacity / 2 && allocator.GetStats().mLargestFreeBlock == minBlock);
+		HEADLESS_CHECK(allocator.GetStats().GetExternalFragmentation() > 0.99);
+		HEADLESS_CHECK(allocator.Allocate(2 * minBlock, 0) == CBuddyAllocator::InvalidOffset);
+
+		// Freeing a buddy makes the pair whole again.
+		allocator.Free(offsets[1]);
+		HEADLESS_CHECK(allocator.GetStats().mLargestFreeBlock == 2 * minBlock);
+		HEADLESS_CHECK(allocator.Allocate(2 * minBlock, 0) == 0);
+	}
+
+	// Heaps are just numbers; kinds are ints.
+	struct FFakeHeapBackend
+	{
+		typedef uint32_t Heap;
+		typedef int Kind;
+
+		uint32_t mNextHeap = 1;
+
+		Heap CreateHeap(const Kind&, uint64_t)
+		{
+			return mNextHeap++;
+		}
+	};
+
+	void TestGPUHeapAllocator()
+	{
+		const uint64_t heapSize = 1024 * 1024;
+		const uint64_t blockSize = 64 * 1024;
+		CGPUHeapAllocator<FFakeHeapBackend> allocator(FFakeHeapBackend(), heapSize, 4096);
+		typedef CGPUHeapAllocator<FFakeHeapBackend>::FAllocation FAllocation;
+
+		// Kinds never share a heap, and what does not fit a heap is refused.
+		FAllocation other = allocator.Allocate(1, blockSize, 0);
+		HEADLESS_CHECK(!allocator.Allocate(0, heapSize + 1, 0).IsValid());
+		HEADLESS_CHECK(allocator.GetStats().mHeaps == 1);
+
+		// Fill one heap so the next block opens a second.
+		FAllocation first[heapSize / blockSize];
+		for (FAllocation& allocation : first)
+		{
+			allocation = allocator.Allocate(0, blockSize, 0);
+		}
+		FAllocation second = allocator.Allocate(0, blockSize, 0);
+		HEADLESS_CHECK(first[0].mHeap != other.mHeap && first[0].mHeap->mHeap == 2);
+		HEADLESS_CHECK(second.IsValid() && second.mHeap != first[0].mHeap && allocator.GetStats().mHeaps == 3);
+
+		// A retired block is not handed out again, nor its heap released, until the frame it was
+		// retired in has completed.
+		FFakeFence fence;
+		allocator.Retire(second);
+		allocator.Retire(first[3]);
+		FAllocation reused = allocator.Allocate(0, blockSize, 0);
+		HEADLESS_CHECK(reused.mHeap == second.mHeap && reused.mOffset != second.mOffset);
+		allocator.Free(reused);
+		HEADLESS_CHECK(allocator.Collect(UINT64_MAX) == 0);
+		HEADLESS_CHECK(allocator.GetStats().mRetiredBlocks == 2 && allocator.GetStats().mHeaps == 3);
+
+		allocator.OnSignal(1);
+		HEADLESS_CHECK(allocator.Collect(fence.GetCompletedValue()) == 0);
+		fence.WaitForValue(1);
+		HEADLESS_CHECK(allocator.Collect(fence.GetCompletedValue()) == 2);
+		FGPUHeapAllocatorStats stats = allocator.GetStats();
+		HEADLESS_CHECK(stats.mRetiredBlocks == 0 && stats.mHeaps == 2 && stats.mHeapsReleased == 1);
+		HEADLESS_CHECK(stats.mBlocks.mAllocations == heapSize / blockSize);
+
+		// Its block is free again.
+		reused = allocator.Allocate(0, blockSize, 0);
+		HEADLESS_CHECK(reused.mHeap == first[3].mHeap && reused.mOffset == first[3].mOffset);
+
+		// Blocks still retired when the allocator goes are returned with it.
+		allocator.Retire(reused);
+		allocator.OnSignal(2);
+		HEADLESS_CHECK(allocator.GetStats().mRetiredBlocks == 1);
+	}
+
+	struct FHeadlessTest
+	{
+		const char* mName;
+		void (*mRun)();
+	};
+
+	const FHeadlessTest Tests[] =
+	{
+		{ "framering", TestFrameContextRing },
+		{ "fencetimeline", TestFenceTimeline },
+		{ "fencewait", TestFenceWaitPolicy },
+		{ "footprintcache", TestFootprintCache },
+		{ "deferredrelease", TestDeferredReleaseQueue },
+		{ "allocatorpool", TestCommandAllocatorPool },
+		{ "mipchain", TestMipChain },
+		{ "proceduraltexture", TestProceduralTexture },
+		{ "subresourcecopy", TestSubresourceCopy },
+		{ "blockcompress", TestBlockCompress },
+		{ "dds", TestDDSTexture },
+		{ "buddy", TestBuddyAllocator },
+		{ "gpuheap", TestGPUHeapAllocator },
+		{ "framepacer", TestFramePacer },
+		{ "latency", TestLatencyTracker },
+		{ "presentcontroller", TestPresentController },
+		{ "deque", TestWorkStealingDeque },
+		{ "jobs", TestJobSystem },
+		{ "uploadring", TestUploadRing },
+		{ "uploadtracker", TestUploadTracker },
+		{ "passschedule", TestPassSchedule },
+		{ "computepass", TestComputePass },
+		{ "commandstream", TestCommandStream },
+	};
+}
+
+uint32_t RunHeadlessTests(const char* filter)
+{
+	gChecks = 0;
+	gFailures = 0;
+	for (const FHeadlessTest& test : Tests)
+	{
+		if (filter && !strstr(test.mName, filter))
+		{
+			continue;
+		}
+
+		uint32_t checks = gChecks;
+		uint32_t failures = gFailures;
+		test.mRun();
+		printf("%s: %s (%u checks)\n", test.mName, gFailures == failures ? "ok" : "FAILED", gChecks - checks);
+	}
+	printf("%u checks, %u failed\n", gChecks, gFailures);
+	return gFailures;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Checks of the frame loop's CPU-side building blocks against fake fences, queues, clocks and
+// presenters, run by HeadlessHello -selftest. Runs the tests whose name contains filter (all
+// of them when it is null), prints one line per test and returns the number of failed checks.
+uint32_t RunHeadlessTests(const char* filter);
+
+// Allocations made through operator new so far, for checks that code allocates nothing. Defined
+// by the program the tests are linked into.
+uint64_t GetHeapAllocationCount();
@@ -0,0 +1,626 @@
+#include "HelloRenderer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <stdexcept>
+
+#include "DDSTexture.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "ProceduralTexture.h"
+
+struct Vertex
+{
+	float position[3];
+	float color[4];
+};
+
+// The number of swap chain back buffers. How many frames may be in flight is chosen
+// separately at startup (see FRendererConfig::mFramesInFlight).
+const uint8_t g_NumBackBuffers = 3;
+const uint32_t g_MaxFramesInFlight = 8;
+// Per-frame upload memory; the ring holds this much for each frame in flight.
+const uint64_t g_FrameUploadSize = 64 * 1024;
+
+// Number of draw items in the scene, split across the recording threads.
+const uint32_t g_SceneDrawCount = 1;
+
+inline int64_t GetTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Asset setup work that does not touch the device, run on the job system during LoadAssets.
+struct FShaderCompileJob
+{
+	IRenderDevice* mDevice;
+	std::wstring mPath;
+	const char* mTarget;
+	std::vector<uint8_t> mBytecode;
+	std::exception_ptr mError;
+
+	static void Run(void* data)
+	{
+		FShaderCompileJob* job = static_cast<FShaderCompileJob*>(data);
+		try
+		{
+			job->mBytecode = job->mDevice->CompileShader(job->mPath, job->mTarget);
+		}
+		catch (...)
+		{
+			job->mError = std::current_exception();
+		}
+	}
+};
+
+struct FTextureDataJob
+{
+	FProceduralTextureDesc mDesc;
+	// Spreads the rows over the other threads too.
+	CJobSystem* mJobSystem;
+	std::vector<uint8_t> mData;
+	std::exception_ptr mError;
+
+	static void Run(void* data)
+	{
+		FTextureDataJob* job = static_cast<FTextureDataJob*>(data);
+		try
+		{
+			const FProceduralTextureDesc& desc = job->mDesc;
+			uint32_t rowPitch = desc.mWidth * GetProceduralTexelSize(desc.mFormat);
+			job->mData.resize(static_cast<size_t>(rowPitch) * desc.mHeight);
+			GenerateProceduralTexture(desc, job->mData.data(), rowPitch, job->mJobSystem);
+		}
+		catch (...)
+		{
+			job->mError = std::current_exception();
+		}
+	}
+};
+
+CHelloRenderer::CHelloRenderer(IRenderDevice& device, const FRendererConfig& config) :
+	mDevice(device),
+	mConfig(config),
+	mFrame(nullptr),
+	mJobSystem(config.mWorkerThreads),
+	mCurrentBackBufferIndex(0),
+	mUploadCPU(nullptr),
+	mUploadGPU(0),
+	mSyncInterval(1),
+	mFrameWorkStartNs(0),
+	mLastUpdateNs(0),
+	mQuadMesh()
+{
+	mAllocatorPool.GetBackend().mDevice = &mDevice;
+
+	mCommandQueue = mDevice.CreateQueue(ERenderQueueType::Direct);
+	mComputeQueue = mDevice.CreateQueue(ERenderQueueType::Compute);
+}
+
+CHelloRenderer::~CHelloRenderer()
+{
+}
+
+void CHelloRenderer::CreateFrameContexts(uint32_t framesInFlight)
+{
+	mFrameRing.Initialize(std::min<uint32_t>(std::max<uint32_t>(framesInFlight, 1), g_MaxFramesInFlight));
+
+	// Upload buffers stay mapped for their whole lifetime. One frame may use more than its
+	// share while the others use less.
+	uint64_t uploadSize = g_FrameUploadSize * mFrameRing.GetDepth();
+	mUploadBuffer = mDevice.CreateUploadBuffer(uploadSize);
+	mUploadCPU = static_cast<uint8_t*>(mUploadBuffer->GetCPUAddress());
+	mUploadGPU = mUploadBuffer->GetGPUAddress();
+	// One region is closed per frame; the margin covers frames closed before the oldest is
+	// collected.
+	mUploadRing.Initialize(uploadSize, mFrameRing.GetDepth() + 2);
+}
+
+void CHelloRenderer::DeferRelease(std::shared_ptr<void> object)
+{
+	mDeferredRelease.DeferToNextSignal(std::move(object));
+}
+
+FTransientAllocation CHelloRenderer::AllocateTransient(uint64_t size, uint64_t alignment)
+{
+	assert(mFrame && "AllocateTransient called outside of a frame.");
+
+	uint64_t offset = mUploadRing.Allocate(size, alignment);
+	while (offset == CUploadRing::InvalidOffset)
+	{
+		// Only this frame holds ring memory: the request can never fit.
+		uint64_t oldestValue = mUploadRing.GetOldestFenceValue();
+		if (oldestValue == 0)
+		{
+			throw std::bad_alloc();
+		}
+		mFrameTimeline.WaitForValue(oldestValue);
+		mUploadRing.Retire(oldestValue);
+		offset = mUploadRing.Allocate(size, alignment);
+	}
+
+	FTransientAllocation allocation;
+	allocation.mCPU = mUploadCPU + offset;
+	allocation.mGPU = mUploadGPU + offset;
+	return allocation;
+}
+
+void CHelloRenderer::CreateGeometry()
+{
+	const float aspectRatio = static_cast<float>(mConfig.mWidth) / static_cast<float>(mConfig.mHeight);
+
+	Vertex quadVertices[] =
+	{
+		{ { -0.5f, 0.5f * aspectRatio, 0.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } },
+		{ { -0.5f, -0.5f * aspectRatio, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+		{ { 0.5f, -0.5f * aspectRatio, 0.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { 0.5f, 0.5f * aspectRatio, 0.0f }, { 1.0f, 0.0f, 1.0f, 1.0f } }
+	};
+	uint16_t quadIndices[] = { 1,0,2,2,0,3 };
+
+	// Every mesh of the scene goes into the merged buffers before the one upload.
+	mQuadMesh = mStaticGeometry.AddMesh(quadVertices, 4, sizeof(Vertex), quadIndices, 6);
+	mStaticGeometry.Upload(mDevice, *mUploadQueue);
+}
+
+void CHelloRenderer::UploadTexture(uint32_t width, uint32_t height, uint32_t levelCount, ERenderFormat format,
+	const FRenderSubresourceData* levels)
+{
+	// Replacing a texture that frames in flight may still sample.
+	if (mTexture)
+	{
+		DeferRelease(mTexture);
+	}
+
+	// RGBA8 levels are compressed first when the config asks for a block-compressed format.
+	bool compress = format == ERenderFormat::RGBA8Unorm && IsBlockCompressible(mConfig.mTextureFormat);
+	if (compress)
+	{
+		format = mConfig.mTextureFormat;
+	}
+
+	// D3D12 wants the top level of a block-compressed texture in whole blocks.
+	if (IsBlockCompressed(format) && (width % 4 != 0 || height % 4 != 0))
+	{
+		throw std::runtime_error("Block-compressed texture size is not a multiple of 4");
+	}
+
+	std::vector<uint8_t> compressed;
+	std::vector<FRenderSubresourceData> compressedLevels;
+	if (compress)
+	{
+		compressedLevels.resize(levelCount);
+		size_t size = 0;
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			uint32_t levelWidth = std::max(width >> i, 1u);
+			uint32_t levelHeight = std::max(height >> i, 1u);
+			compressedLevels[i].mRowPitch = static_cast<intptr_t>(GetFormatRowBytes(format, levelWidth));
+			compressedLevels[i].mSlicePitch = compressedLevels[i].mRowPitch * GetFormatRowCount(format, levelHeight);
+			size += static_cast<size_t>(compressedLevels[i].mSlicePitch);
+		}
+
+		compressed.resize(size);
+		size_t offset = 0;
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			CompressTexture(format, mConfig.mTextureCompression, static_cast<const uint8_t*>(levels[i].mData),
+				std::max(width >> i, 1u), std::max(height >> i, 1u), static_cast<uint32_t>(levels[i].mRowPitch),
+				&compressed[offset], static_cast<uint32_t>(compressedLevels[i].mRowPitch), &mJobSystem);
+			compressedLevels[i].mData = &compressed[offset];
+			offset += static_cast<size_t>(compressedLevels[i].mSlicePitch);
+		}
+		levels = compressedLevels.data();
+	}
+
+	// Created in Common: the copy queue promotes it to CopyDest, and after the copy it
+	// decays back to Common, from where the direct queue promotes it to a shader resource.
+	mTexture = mDevice.CreateTexture2D(width, height, levelCount, format);
+
+	// Every level in one upload.
+	mUploadQueue->UploadSubresources(mTexture.get(), 0, levelCount, levels);
+}
+
+void CHelloRenderer::CreateTexture(uint32_t textureWidth, uint32_t textureHeight, const std::vector<uint8_t>& texture)
+{
+	// The full chain, so minified sampling reads a level of matching size.
+	FMipChain mipChain;
+	GenerateMipChainRGBA8(&texture[0], textureWidth, textureHeight, textureWidth * 4, &mJobSystem, mipChain);
+	uint32_t levelCount = static_cast<uint32_t>(mipChain.mLevels.size());
+
+	std::vector<FRenderSubresourceData> textureData(levelCount);
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		const FMipLevel& level = mipChain.mLevels[i];
+		textureData[i].mData = &mipChain.mData[static_cast<size_t>(level.mOffset)];
+		textureData[i].mRowPitch = level.mRowPitch;
+		textureData[i].mSlicePitch = static_cast<intptr_t>(level.mRowPitch) * level.mHeight;
+	}
+	UploadTexture(textureWidth, textureHeight, levelCount, ERenderFormat::RGBA8Unorm, textureData.data());
+}
+
+void CHelloRenderer::LoadTexture(const std::string& path)
+{
+	CMappedFile file(path.c_str());
+	FDDSTexture dds;
+	ParseDDS(file.GetData(), file.GetSize(), dds);
+
+	// Straight from the mapping: the upload queue copies each level into staging memory
+	// before UploadSubresources returns, so the file is read once and never copied on the heap.
+	std::vector<FRenderSubresourceData> textureData(dds.mMipLevels);
+	for (uint32_t i = 0; i < dds.mMipLevels; ++i)
+	{
+		const FDDSSubresource& subresource = dds.mSubresources[i];
+		textureData[i].mData = file.GetData() + subresource.mOffset;
+		textureData[i].mRowPitch = static_cast<intptr_t>(subresource.mRowPitch);
+		textureData[i].mSlicePitch = static_cast<intptr_t>(subresource.mSlicePitch);
+	}
+	UploadTexture(dds.mWidth, dds.mHeight, dds.mMipLevels, dds.mFormat, textureData.data());
+}
+
+void CHelloRenderer::LoadAssets()
+{
+	// Shader compilation and texture generation run on the job system while the
+	// device objects are created here.
+	FShaderCompileJob vertexShader;
+	vertexShader.mDevice = &mDevice;
+	vertexShader.mPath = mConfig.mAssetPath + L"vs.shader";
+	vertexShader.mTarget = "vs_5_0";
+
+	FShaderCompileJob pixelShader;
+	pixelShader.mDevice = &mDevice;
+	pixelShader.mPath = mConfig.mAssetPath + L"ps.shader";
+	pixelShader.mTarget = "ps_5_0";
+
+	// Black and white checkerboard, eight cells across.
+	FTextureDataJob textureData;
+	textureData.mDesc.mPattern = EProceduralPattern::Checker;
+	textureData.mDesc.mWidth = mConfig.mTextureSize;
+	textureData.mDesc.mHeight = mConfig.mTextureSize;
+	textureData.mDesc.mFormat = ERenderFormat::RGBA8Unorm;
+	textureData.mDesc.mCellSize = std::max(mConfig.mTextureSize / 8, 1u);
+	textureData.mJobSystem = &mJobSystem;
+
+	// The texture job goes last, so it can be left out when the texture comes from a file.
+	FJob jobs[] =
+	{
+		{ &FShaderCompileJob::Run, &vertexShader, nullptr },
+		{ &FShaderCompileJob::Run, &pixelShader, nullptr },
+		{ &FTextureDataJob::Run, &textureData, nullptr },
+	};
+	uint32_t jobCount = sizeof(jobs) / sizeof(jobs[0]) - (mConfig.mTexturePath.empty() ? 0 : 1);
+	CJobCounter counter;
+	mJobSystem.Run(jobs, jobCount, counter);
+
+	CreateGeometry();
+
+	mJobSystem.Wait(counter);
+	for (const std::exception_ptr& error : { vertexShader.mError, pixelShader.mError, textureData.mError })
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	// Define the vertex input layout.
+	const FRenderVertexElement vertexElements[] =
+	{
+		{ "POSITION", ERenderFormat::RGB32Float, 0 },
+		{ "COLOR", ERenderFormat::RGBA32Float, 12 },
+	};
+
+	FRenderPipelineDesc pipelineDesc = {};
+	pipelineDesc.mVertexShader = &vertexShader.mBytecode;
+	pipelineDesc.mPixelShader = &pixelShader.mBytecode;
+	pipelineDesc.mVertexElements = vertexElements;
+	pipelineDesc.mVertexElementCount = sizeof(vertexElements) / sizeof(vertexElements[0]);
+	pipelineDesc.mRenderTargetFormat = ERenderFormat::RGBA8Unorm;
+	mPipelineState = mDevice.CreatePipeline(pipelineDesc);
+
+	if (mConfig.mTexturePath.empty())
+	{
+		CreateTexture(textureData.mDesc.mWidth, textureData.mDesc.mHeight, textureData.mData);
+	}
+	else
+	{
+		LoadTexture(mConfig.mTexturePath);
+	}
+}
+
+void CHelloRenderer::OnInit()
+{
+	mSwapChain = mDevice.CreateSwapChain(mCommandQueue.get(), mConfig.mWindow,
+		mConfig.mWidth, mConfig.mHeight, g_NumBackBuffers, mConfig.mLowLatency);
+
+	// Only the vsync pacing mode lets Present throttle the loop; the others pace on the CPU.
+	mSyncInterval = mConfig.mPacingMode == EFramePacingMode::VSync ? 1 : 0;
+	FPresentControllerConfig presentConfig;
+	presentConfig.mTearingSupported = mSwapChain->IsTearingSupported();
+	mPresentController = CPresentController(presentConfig);
+
+	mBackBuffers.resize(mSwapChain->GetBufferCount());
+	for (uint32_t i = 0; i < mSwapChain->GetBufferCount(); ++i)
+	{
+		mBackBuffers[i] = mSwapChain->GetBackBuffer(i);
+	}
+	mCurrentBackBufferIndex = mSwapChain->GetCurrentBackBufferIndex();
+
+	CreateFrameContexts(mConfig.mFramesInFlight);
+
+	mFrameTimeline.GetFence().Initialize(&mDevice, mCommandQueue.get());
+	mComputeTimeline.GetFence().Initialize(&mDevice, mComputeQueue.get());
+	mFrameTimeline.SetWaitPolicy(mConfig.mFenceWaitPolicy);
+	mComputeTimeline.SetWaitPolicy(mConfig.mFenceWaitPolicy);
+
+	//---------------create resources
+	mUploadQueue = mDevice.CreateUploadQueue(&mJobSystem);
+	LoadAssets();
+	mUploadQueue->Submit();
+
+	// The lists are created closed and are reset onto a pooled allocator every frame.
+	CRenderCommandAllocatorPool::FHandle directAllocator = mAllocatorPool.Acquire(ERenderQueueType::Direct);
+	CRenderCommandAllocatorPool::FHandle computeAllocator = mAllocatorPool.Acquire(ERenderQueueType::Compute);
+
+	mCommandList = mDevice.CreateCommandList(ERenderQueueType::Direct,
+		directAllocator.mAllocator.get(), mPipelineState.get());
+	mPostCommandList = mDevice.CreateCommandList(ERenderQueueType::Direct,
+		directAllocator.mAllocator.get(), nullptr);
+	mComputeCommandList = mDevice.CreateCommandList(ERenderQueueType::Compute,
+		computeAllocator.mAllocator.get(), nullptr);
+
+	// Nothing was recorded, so they are free again right away.
+	mAllocatorPool.Release(directAllocator, mFrameTimeline, 0, 0);
+	mAllocatorPool.Release(computeAllocator, mFrameTimeline, 0, 0);
+
+	mQueueBackend.mTimelines[static_cast<uint32_t>(EQueueType::Graphics)] = &mFrameTimeline;
+	mQueueBackend.mTimelines[static_cast<uint32_t>(EQueueType::Compute)] = &mComputeTimeline;
+
+	mRecordingBackend.mDevice = &mDevice;
+	mRecordingBackend.mQueue = mCommandQueue.get();
+	mRecordingBackend.mInitialState = mPipelineState.get();
+	mRecorder.reset(new CParallelCommandRecorder<FRenderRecordingBackend>(
+		mRecordingBackend, mJobSystem, mConfig.mRecordThreads, mFrameRing.GetDepth()));
+}
+
+void CHelloRenderer::RecordScene(IRenderCommandList* commandList, uint32_t threadIndex,
+	const FRenderViewport& viewport, const FRenderRect& scissorRect, IRenderResource* renderTarget)
+{
+	uint32_t begin, end;
+	mRecorder->GetThreadRange(threadIndex, g_SceneDrawCount, begin, end);
+	if (begin == end)
+	{
+		return;
+	}
+
+	commandList->SetPipeline(mPipelineState.get());
+	commandList->SetViewport(viewport);
+	commandList->SetScissor(scissorRect);
+	commandList->SetRenderTarget(renderTarget);
+	mStaticGeometry.Bind(commandList, mQuadMesh.mPool);
+
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		commandList->DrawIndexed(mQuadMesh.mIndexCount, 1, mQuadMesh.mFirstIndex, mQuadMesh.mBaseVertex);
+	}
+}
+
+IRenderCommandList* CHelloRenderer::BeginComputePass()
+{
+	if (!mFrame->mComputeAllocator.mValid)
+	{
+		mFrame->mComputeAllocator = mAllocatorPool.Acquire(ERenderQueueType::Compute);
+	}
+
+	mComputeCommandList->Reset(mFrame->mComputeAllocator.mAllocator.get(), nullptr);
+	return mComputeCommandList.get();
+}
+
+void CHelloRenderer::EndComputePass()
+{
+	mComputeCommandList->Close();
+
+	IRenderCommandList* const commandLists[] = { mComputeCommandList.get() };
+	mComputeQueue->Execute(commandLists, 1);
+}
+
+void CHelloRenderer::Simulate(FSceneState& scene, int64_t deltaNs)
+{
+	++scene.mStep;
+	scene.mTimeSeconds += deltaNs * 1e-9;
+}
+
+void CHelloRenderer::OnUpdate()
+{
+	int64_t now = GetTimeNs();
+	Simulate(mScene, mLastUpdateNs != 0 ? now - mLastUpdateNs : 0);
+	mLastUpdateNs = now;
+}
+
+// Once a second, logs frame rate, latency and fence stalls.
+void CHelloRenderer::UpdateStats()
+{
+	static uint64_t frameCounter = 0;
+	static double elapsedSeconds = 0.0;
+	static std::chrono::high_resolution_clock clock;
+	static auto t0 = clock.now();
+
+	frameCounter++;
+	auto t1 = clock.now();
+	auto deltaTime = t1 - t0;
+	t0 = t1;
+
+	elapsedSeconds += std::chrono::duration_cast<std::chrono::nanoseconds>(deltaTime).count() * 1e-9;
+	if (elapsedSeconds > 1.0)
+	{
+		if (mConfig.mLog)
+		{
+			char buffer[640];
+			auto fps = frameCounter / elapsedSeconds;
+			const FLatencyStats& latency = mLatency.GetStats();
+			const FFenceTimelineStats& fence = mFrameTimeline.GetStats();
+			const FPresentControllerStats& present = mPresentController.GetStats();
+			snprintf(buffer, sizeof(buffer), "FPS: %f, input->present: %.2fms (min %.2fms, max %.2fms), frame wait: %.2fms, "
+				"gpu stalls: %llu (%.2fms, p50 <%.3fms, p99 <%.3fms, spin/yield/block %llu/%llu/%llu, spin budget %.3fms), "
+				"present: interval %u (%s, %llu switches, %llu missed vblanks, refresh %.2fms)\n",
+				fps, latency.mMeanNs * 1e-6, latency.mMinNs * 1e-6, latency.mMaxNs * 1e-6, latency.mMeanWaitNs * 1e-6,
+				static_cast<unsigned long long>(fence.mWaitCount), fence.mStallNs * 1e-6,
+				fence.mStallHistogram.GetPercentileNs(0.5) * 1e-6, fence.mStallHistogram.GetPercentileNs(0.99) * 1e-6,
+				static_cast<unsigned long long>(fence.mSpinWaits), static_cast<unsigned long long>(fence.mYieldWaits),
+				static_cast<unsigned long long>(fence.mBlockingWaits), mFrameTimeline.GetWaitPolicy().mSpinNs * 1e-6,
+				mSyncInterval, GetPresentModeName(mPresentController.GetMode()),
+				static_cast<unsigned long long>(present.mModeSwitches), static_cast<unsigned long long>(present.mMissedVBlanks),
+				mPresentController.GetRefreshPeriodNs() * 1e-6);
+			mConfig.mLog(buffer);
+		}
+
+		mLatency.ResetStats();
+		mFrameTimeline.ResetStats();
+		frameCounter = 0;
+		elapsedSeconds = 0.0;
+	}
+}
+
+void CHelloRenderer::OnBeginFrame()
+{
+	int64_t waitStart = GetTimeNs();
+
+	mSwapChain->WaitForNextFrame();
+
+	// Wait until the GPU has retired the frame context we are about to reuse.
+	mFrame = &mFrameRing.BeginFrame(mFrameTimeline);
+	mDeferredRelease.Collect(mFrameTimeline.GetCompletedValue());
+	mUploadRing.Retire(mFrameTimeline.GetCompletedValue());
+	mFrame->mCommandAllocator = mAllocatorPool.Acquire(ERenderQueueType::Direct);
+	// Last frame's pass functions live in the frame arena.
+	mSchedule.Reset();
+	BeginFrameArenas();
+
+	// Input is sampled by OnUpdate right after this returns.
+	int64_t now = GetTimeNs();
+	mLatency.OnInputSampled(mFrameRing.GetFrameNumber(), now, now - waitStart);
+	mFrameWorkStartNs = now;
+}
+
+void CHelloRenderer::OnRender()
+{
+	OnRender(mScene);
+}
+
+void CHelloRenderer::OnRender(const FSceneState& scene)
+{
+	const FRenderViewport viewport = { 0.0f, 0.0f,
+		static_cast<float>(mConfig.mWidth), static_cast<float>(mConfig.mHeight) };
+	const FRenderRect scissorRect = { 0, 0,
+		static_cast<int32_t>(mConfig.mWidth), static_cast<int32_t>(mConfig.mHeight) };
+
+	assert(mFrame && "OnRender called without OnBeginFrame.");
+
+	// The pool only hands out allocators that have retired, already reset.
+	IRenderCommandAllocator* commandAllocator = mFrame->mCommandAllocator.mAllocator.get();
+	IRenderResource* backBuffer = mBackBuffers[mCurrentBackBufferIndex];
+
+	mCommandList->Reset(commandAllocator, mPipelineState.get());
+
+	uint32_t frameIndex = mFrameRing.GetCurrentIndex();
+
+	// Clear the render target, then record the scene on the recording threads.
+	{
+		mCommandList->Transition(backBuffer, ERenderResourceState::Present, ERenderResourceState::RenderTarget);
+
+		mCommandList->ClearRenderTarget(backBuffer, scene.mClearColor);
+		mCommandList->Close();
+
+		mRecorder->Record(frameIndex,
+			[&](uint32_t threadIndex, std::unique_ptr<IRenderCommandList>& commandList)
+			{
+				RecordScene(commandList.get(), threadIndex, viewport, scissorRect, backBuffer);
+			});
+	}
+
+	// Present
+	{
+		// The frame allocator is free again now that the clear list is closed.
+		mPostCommandList->Reset(commandAllocator, nullptr);
+		mPostCommandList->Transition(backBuffer, ERenderResourceState::RenderTarget, ERenderResourceState::Present);
+		mPostCommandList->Close();
+
+		// Clear, scene lists in thread order, then the transition to present, in one batch.
+		IRenderCommandList* const before[] = { mCommandList.get() };
+		IRenderCommandList* const after[] = { mPostCommandList.get() };
+
+		// Compute passes added since OnBeginFrame run first; the schedule makes the scene
+		// wait only for those it depends on and joins the rest before the frame fence.
+		mSchedule.AddPass("Scene", EQueueType::Graphics, { mTexture.get() }, { backBuffer },
+			[&]()
+			{
+				// Order the batch after any pending copy-queue upload of what the scene reads.
+				mUploadQueue->Submit();
+				mSceneResources.assign(mStaticGeometry.GetResources().begin(), mStaticGeometry.GetResources().end());
+				mSceneResources.push_back(mTexture.get());
+				mUploadQueue->WaitOnQueue(mCommandQueue.get(), mSceneResources.data(),
+					static_cast<uint32_t>(mSceneResources.size()));
+				mRecorder->Submit(frameIndex, before, 1, after, 1);
+			});
+		mSchedule.Execute(mQueueBackend);
+
+		int64_t frameTimeNs = GetTimeNs() - mFrameWorkStartNs;
+		mSwapChain->Present(mSyncInterval);
+		mLatency.OnPresented(mFrameRing.GetFrameNumber(), GetTimeNs());
+
+		if (mConfig.mPacingMode == EFramePacingMode::VSync && mConfig.mAdaptivePresent)
+		{
+			FRenderPresentStats presentStats;
+			bool hasStats = mSwapChain->GetPresentStats(presentStats);
+			mPresentController.OnFramePresented(frameTimeNs, hasStats ? &presentStats : nullptr);
+			mSyncInterval = mPresentController.GetSyncInterval();
+		}
+
+		uint64_t frameFenceValue = mFrameTimeline.Signal();
+		mFrameRing.EndFrame(frameFenceValue);
+		mUploadRing.CloseRegion(frameFenceValue);
+		mDeferredRelease.OnSignal(frameFenceValue);
+
+		mAllocatorPool.Release(mFrame->mCommandAllocator, mFrameTimeline, frameFenceValue,
+			mFrame->mCommandAllocator.mAllocator->GetCommandCount());
+		if (mFrame->mComputeAllocator.mValid)
+		{
+			mAllocatorPool.Release(mFrame->mComputeAllocator, mFrameTimeline, frameFenceValue,
+				mFrame->mComputeAllocator.mAllocator->GetCommandCount());
+		}
+		mAllocatorPool.Trim();
+		mFrame = nullptr;
+		mUploadQueue->Retire();
+
+		mCurrentBackBufferIndex = mSwapChain->GetCurrentBackBufferIndex();
+	}
+
+	UpdateStats();
+}
+
+void CHelloRenderer::OnDestroy()
+{
+	// Make sure every queue is done before anything is released, in a single wait.
+	IRenderFence* const fences[] =
+	{
+		mFrameTimeline.GetFence().mFence.get(),
+		mComputeTimeline.GetFence().mFence.get(),
+		mUploadQueue->GetFence(),
+	};
+	const uint64_t values[] =
+	{
+		mFrameTimeline.GetLastSignaledValue(),
+		mComputeTimeline.GetLastSignaledValue(),
+		mUploadQueue->GetLastSignaledValue(),
+	};
+	mDevice.WaitForFences(fences, values, sizeof(fences) / sizeof(fences[0]));
+	mUploadQueue->Retire();
+	mDeferredRelease.ReleaseAll();
+	mAllocatorPool.Clear();
+}
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "BlockCompress.h"
+#include "RenderFence.h"
+#include "RenderCommandAllocatorPool.h"
+#include "FrameContextRing.h"
+#include "FramePacer.h"
+#include "LatencyTracker.h"
+#include "ParallelCommandRecorder.h"
+#include "JobSystem.h"
+#include "PassSchedule.h"
+#include "DeferredReleaseQueue.h"
+#include "PresentController.h"
+#include "UploadRing.h"
+#include "StaticGeometry.h"
+
+// Everything a frame owns while it is in flight on the GPU.
+struct FFrameContext
+{
+	// Taken from the allocator pool for the frame and handed back with its fence value.
+	CRenderCommandAllocatorPool::FHandle mCommandAllocator;
+	// Compute passes, acquired on first use; the frame's compute work is joined into the
+	// direct queue's frame fence.
+	CRenderCommandAllocatorPool::FHandle mComputeAllocator;
+};
+
+struct FTransientAllocation
+{
+	void* mCPU;
+	uint64_t mGPU;
+};
+
+// Binds CParallelCommandRecorder to a render device and queue.
+struct FRenderRecordingBackend
+{
+	typedef std::shared_ptr<IRenderCommandAllocator> Allocator;
+	typedef std::unique_ptr<IRenderCommandList> CommandList;
+	typedef IRenderCommandList* SubmitHandle;
+
+	IRenderDevice* mDevice;
+	IRenderQueue* mQueue;
+	IRenderPipeline* mInitialState;
+
+	Allocator CreateAllocator()
+	{
+		return mDevice->CreateCommandAllocator(mQueue->GetType());
+	}
+
+	CommandList CreateCommandList(Allocator& allocator)
+	{
+		return mDevice->CreateCommandList(mQueue->GetType(), allocator.get(), mInitialState);
+	}
+
+	void Reset(Allocator& allocator, CommandList& list)
+	{
+		allocator->Reset();
+		list->Reset(allocator.get(), mInitialState);
+	}
+
+	void Close(CommandList& list)
+	{
+		list->Close();
+	}
+
+	SubmitHandle GetSubmitHandle(CommandList& list)
+	{
+		return list.get();
+	}
+
+	void Execute(const SubmitHandle* lists, uint32_t count)
+	{
+		mQueue->Execute(lists, count);
+	}
+};
+
+// Cross-queue signals and waits for CPassSchedule, on each queue's fence timeline. Pass
+// signals share the graphics timeline with the frame fence; values stay monotonic either way.
+struct FRenderQueueBackend
+{
+	CRenderFenceTimeline* mTimelines[QueueTypeCount];
+
+	uint64_t Signal(EQueueType queue)
+	{
+		return mTimelines[static_cast<uint32_t>(queue)]->Signal();
+	}
+
+	void Wait(EQueueType queue, EQueueType onQueue, uint64_t value)
+	{
+		FRenderFence& waiter = mTimelines[static_cast<uint32_t>(queue)]->GetFence();
+		FRenderFence& signaller = mTimelines[static_cast<uint32_t>(onQueue)]->GetFence();
+		waiter.mQueue->Wait(signaller.mFence.get(), value);
+	}
+};
+
+// What the simulation hands the renderer for a frame. Stepped by OnUpdate, or by a
+// CPipelinedFrameLoop on a thread of its own; read-only while the frame is recorded.
+struct FSceneState
+{
+	uint64_t mStep = 0;
+	double mTimeSeconds = 0.0;
+	float mClearColor[4] = { 0.4f, 0.6f, 0.9f, 1.0f };
+};
+
+struct FRendererConfig
+{
+	uint32_t mWidth = 600;
+	uint32_t mHeight = 600;
+	uint32_t mFramesInFlight = 3;
+	EFramePacingMode mPacingMode = EFramePacingMode::VSync;
+	// With vsync pacing, switch between vsync, tearing and half rate from how presents go
+	// (see CPresentController) rather than always presenting with vsync.
+	bool mAdaptivePresent = true;
+	bool mLowLatency = false;
+	uint32_t mRecordThreads = 1;
+	// Worker threads of the job system, 0 for one per hardware thread.
+	uint32_t mWorkerThreads = 0;
+	// How CPU waits on the frame and compute fences spend their time.
+	FFenceWaitPolicy mFenceWaitPolicy;
+	// Width and height of the generated texture.
+	uint32_t mTextureSize = 256;
+	// RGBA8Unorm, or BC1Unorm, BC3Unorm or BC7Unorm (or their sRGB variants) to compress the
+	// generated texture, and RGBA8 DDS files, on the CPU before upload; see CompressTexture.
+	ERenderFormat mTextureFormat = ERenderFormat::RGBA8Unorm;
+	EBlockCompressMode mTextureCompression = EBlockCompressMode::Fast;
+	// A DDS file to use instead of the generated texture, when not empty. Only its first
+	// array slice is used.
+	std::string mTexturePath;
+
+	// Native window handle for the swap chain, nullptr when running headless.
+	void* mWindow = nullptr;
+	// Prepended to asset names (shaders), including the trailing separator.
+	std::wstring mAssetPath;
+	// Receives the once-a-second stats line; dropped when empty.
+	std::function<void(const char*)> mLog;
+};
+
+// The sample's frame loop, written against IRenderDevice so the same code runs on D3D12
+// (CHelloDX12) or headless on the null device. The On* methods follow DXSample.
+class CHelloRenderer
+{
+	IRenderDevice& mDevice;
+	FRendererConfig mConfig;
+
+	std::vector<IRenderResource*> mBackBuffers;
+	CFrameContextRing<FFrameContext> mFrameRing;
+	FFrameContext* mFrame;
+
+	std::unique_ptr<IRenderQueue> mCommandQueue;
+	std::unique_ptr<IRenderQueue> mComputeQueue;
+	std::unique_ptr<IRenderSwapChain> mSwapChain;
+
+	std::unique_ptr<IRenderCommandList> mCommandList;
+	// Closes the frame after the parallel scene lists (transition back to Present).
+	std::unique_ptr<IRenderCommandList> mPostCommandList;
+	std::unique_ptr<IRenderCommandList> mComputeCommandList;
+
+	// Which passes run on which queue this frame, and the fence waits between them.
+	CPassSchedule mSchedule;
+	FRenderQueueBackend mQueueBackend;
+
+	// Worker threads for frame and asset work; the calling thread is worker 0.
+	CJobSystem mJobSystem;
+
+	// Command allocators for every queue, recycled once the fence of their last use passes.
+	CRenderCommandAllocatorPool mAllocatorPool;
+
+	// Asset uploads go through their own copy queue and are waited on by mCommandQueue.
+	std::unique_ptr<IRenderUploadQueue> mUploadQueue;
+
+	FRenderRecordingBackend mRecordingBackend;
+	std::unique_ptr<CParallelCommandRecorder<FRenderRecordingBackend>> mRecorder;
+
+	uint32_t mCurrentBackBufferIndex;
+
+	// Synchronization objects: the direct queue's timeline also retires frame contexts.
+	CRenderFenceTimeline mFrameTimeline;
+	CRenderFenceTimeline mComputeTimeline;
+
+	// Data that only lives for a frame: one persistently mapped upload buffer, a ring region
+	// per frame, reclaimed by the frame fence.
+	std::shared_ptr<IRenderResource> mUploadBuffer;
+	uint8_t* mUploadCPU;
+	uint64_t mUploadGPU;
+	CUploadRing mUploadRing;
+
+	// Objects the frames in flight may still use; released once the frame that last used them retires.
+	CDeferredReleaseQueue<std::shared_ptr<void>> mDeferredRelease;
+
+	// Sync interval of the next Present: 0 unless the pacing mode leaves pacing to Present,
+	// then 1 or whatever mPresentController picks.
+	uint32_t mSyncInterval;
+	CPresentController mPresentController;
+	// When the frame's own work started, after its waits.
+	int64_t mFrameWorkStartNs;
+
+	CLatencyTracker mLatency;
+
+	// Stepped by OnUpdate in the serial loop.
+	FSceneState mScene;
+	int64_t mLastUpdateNs;
+
+	std::unique_ptr<IRenderPipeline> mPipelineState;
+
+	CStaticGeometry mStaticGeometry;
+	FStaticMesh mQuadMesh;
+	std::shared_ptr<IRenderResource> mTexture;
+	// What the scene pass waits on the upload queue for, reused every frame.
+	std::vector<IRenderResource*> mSceneResources;
+
+	void CreateFrameContexts(uint32_t framesInFlight);
+	void CreateGeometry();
+	// Creates mTexture from the levels and uploads them.
+	void UploadTexture(uint32_t width, uint32_t height, uint32_t levelCount, ERenderFormat format,
+		const FRenderSubresourceData* levels);
+	void CreateTexture(uint32_t textureWidth, uint32_t textureHeight, const std::vector<uint8_t>& texture);
+	void LoadTexture(const std::string& path);
+	void LoadAssets();
+	void UpdateStats();
+
+	// Records this thread's share of the scene. Runs concurrently on every recording thread,
+	// so it may only read shared state.
+	void RecordScene(IRenderCommandList* commandList, uint32_t threadIndex,
+		const FRenderViewport& viewport, const FRenderRect& scissorRect, IRenderResource* renderTarget);
+
+	// Wrap a compute pass's recording: reset the compute list on the frame's allocator, then
+	// close and execute it.
+	IRenderCommandList* BeginComputePass();
+	void EndComputePass();
+
+public:
+	CHelloRenderer(IRenderDevice& device, const FRendererConfig& config);
+	~CHelloRenderer();
+
+	CHelloRenderer(const CHelloRenderer&) = delete;
+	CHelloRenderer& operator=(const CHelloRenderer&) = delete;
+
+	void OnInit();
+	// Blocks until the GPU can accept another frame; input is sampled right after it returns.
+	void OnBeginFrame();
+	// Steps the renderer's own scene state; OnRender() then records it.
+	void OnUpdate();
+	void OnRender();
+	// Records scene instead; for a simulation that runs apart from the renderer.
+	void OnRender(const FSceneState& scene);
+	void OnDestroy();
+
+	// Advances scene by one step. Touches nothing else, so it may run on any thread.
+	static void Simulate(FSceneState& scene, int64_t deltaNs);
+
+	// Releases object once every frame recorded so far has retired, without stalling.
+	void DeferRelease(std::shared_ptr<void> object);
+
+	// Sub-allocates memory that stays valid until the current frame retires on the GPU. The
+	// default alignment suits constant buffers. Waits for older frames when the ring is full.
+	FTransientAllocation AllocateTransient(uint64_t size, uint64_t alignment = 256);
+
+	// Schedules a pass on the compute queue for the current frame. reads and writes are the
+	// resources it touches, so graphics passes that depend on it wait for it (and vice versa).
+	// record is called as record(IRenderCommandList*) and is moved into the frame arena along
+	// with the pass, so adding passes allocates nothing.
+	template<typename TRecord>
+	void AddComputePass(const char* name,
+		std::initializer_list<const void*> reads, std::initializer_list<const void*> writes,
+		TRecord&& record)
+	{
+		mSchedule.AddPass(name, EQueueType::Compute, reads, writes,
+			[this, record = std::forward<TRecord>(record)]() mutable
+			{
+				IRenderCommandList* commandList = BeginComputePass();
+				record(commandList);
+				EndComputePass();
+			});
+	}
+
+	uint64_t GetFrameNumber() const                    { return mFrameRing.GetFrameNumber(); }
+	const CLatencyTracker& GetLatency() const          { return mLatency; }
+	const CPresentController& GetPresentController() const { return mPresentController; }
+	CRenderFenceTimeline& GetFrameTimeline()           { return mFrameTimeline; }
+	const FCommandAllocatorPoolStats& GetAllocatorStats() const { return mAllocatorPool.GetStats(); }
+	const FUploadRingStats& GetUploadRingStats() const { return mUploadRing.GetStats(); }
+};
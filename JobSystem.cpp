@@ -0,0 +1,371 @@
+#include "JobSystem.h"
+
+#include <cassert>
+#include <chrono>
+
+const uint32_t CJobSystem::MaxWorkers;
+const uint32_t CJobSystem::DequeCapacity;
+
+namespace
+{
+	// Which job system (if any) the current thread works for, and as which worker.
+	thread_local CJobSystem* tJobSystem = nullptr;
+	thread_local uint32_t tWorkerIndex = 0;
+
+	// Failed steal attempts before a worker goes to sleep.
+	const uint32_t SpinsBeforeSleep = 64;
+}
+
+//---------------------------------------------------------------------------------------------
+// CWorkStealingDeque
+// Memory orderings follow Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (PPoPP 2013).
+
+CWorkStealingDeque::CWorkStealingDeque(uint32_t capacity) :
+	mTop(0),
+	mBottom(0),
+	mBuffer(new std::atomic<FJob*>[capacity]),
+	mMask(static_cast<int64_t>(capacity) - 1)
+{
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+bool CWorkStealingDeque::Push(FJob* job)
+{
+	int64_t b = mBottom.load(std::memory_order_relaxed);
+	int64_t t = mTop.load(std::memory_order_acquire);
+	if (b - t > mMask)
+	{
+		return false;
+	}
+
+	mBuffer[b & mMask].store(job, std::memory_order_relaxed);
+	mBottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+FJob* CWorkStealingDeque::Pop()
+{
+	int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+	mBottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = mTop.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// Empty.
+		mBottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	FJob* job = mBuffer[b & mMask].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// Last element: race against thieves for it.
+		if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		mBottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+FJob* CWorkStealingDeque::Steal()
+{
+	int64_t t = mTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = mBottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+	{
+		return nullptr;
+	}
+
+	FJob* job = mBuffer[t & mMask].load(std::memory_order_relaxed);
+	if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return job;
+}
+
+//---------------------------------------------------------------------------------------------
+// CJobSystem
+
+CJobSystem::CJobSystem(uint32_t workerThreads) :
+	mQueuedJobs(0),
+	mSleepingWorkers(0),
+	mExit(false)
+{
+	if (workerThreads == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	workerThreads = std::min(workerThreads, MaxWorkers - 1);
+
+	mWorkers.resize(workerThreads + 1);
+	for (uint32_t i = 0; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i].mDeque.reset(new CWorkStealingDeque(DequeCapacity));
+		mWorkers[i].mRandomState = 0x9e3779b9u * (i + 1);
+	}
+
+	// The creating thread is worker 0.
+	assert(tJobSystem == nullptr && "Thread already belongs to a job system.");
+	tJobSystem = this;
+	tWorkerIndex = 0;
+
+	for (uint32_t i = 1; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i].mThread = std::thread(&CJobSystem::WorkerMain, this, i);
+	}
+}
+
+CJobSystem::~CJobSystem()
+{
+	mExit.store(true);
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWake.notify_all();
+
+	for (uint32_t i = 1; i < mWorkers.size(); ++i)
+	{
+		mWorkers[i].mThread.join();
+	}
+
+	if (tJobSystem == this)
+	{
+		tJobSystem = nullptr;
+	}
+}
+
+int32_t CJobSystem::GetCurrentWorkerIndex() const
+{
+	return tJobSystem == this ? static_cast<int32_t>(tWorkerIndex) : -1;
+}
+
+bool CJobSystem::Push(FJob* job)
+{
+	int32_t workerIndex = GetCurrentWorkerIndex();
+	if (workerIndex >= 0)
+	{
+		return mWorkers[workerIndex].mDeque->Push(job);
+	}
+
+	std::lock_guard<std::mutex> lock(mInjectionMutex);
+	mInjectionQueue.push_back(job);
+	return true;
+}
+
+void CJobSystem::Release(uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	mQueuedJobs.fetch_add(static_cast<int32_t>(count));
+	if (mSleepingWorkers.load() > 0)
+	{
+		// Taking the lock orders us against a worker that is about to sleep.
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+		}
+		if (count > 1)
+		{
+			mWake.notify_all();
+		}
+		else
+		{
+			mWake.notify_one();
+		}
+	}
+}
+
+void CJobSystem::Enqueue(FJob* jobs, uint32_t count)
+{
+	// Counted and woken for once the whole batch is queued.
+	uint32_t queued = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!Push(&jobs[i]))
+		{
+			// Deque full: run it right here rather than block, once the rest are on offer.
+			Release(queued);
+			queued = 0;
+			Execute(&jobs[i]);
+			continue;
+		}
+		++queued;
+	}
+	Release(queued);
+}
+
+void CJobSystem::Finish(CJobCounter* counter)
+{
+	// Any but the last decrement leaves the counter alone afterwards, so needs no lock.
+	uint32_t value = counter->mValue.load(std::memory_order_relaxed);
+	while (value > 1)
+	{
+		if (counter->mValue.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	// The last one happens under the counter's lock so that a waiter, which takes the same
+	// lock before returning, cannot destroy the counter while we are still touching it.
+	std::vector<FJob*> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->mMutex);
+		if (counter->mValue.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			// Reached zero: release anything that was waiting on it.
+			continuations.swap(counter->mContinuations);
+		}
+	}
+	for (FJob* job : continuations)
+	{
+		Enqueue(job, 1);
+	}
+}
+
+void CJobSystem::Execute(FJob* job)
+{
+	CJobCounter* counter = job->mCounter;
+	job->mFunction(job->mData);
+	Finish(counter);
+}
+
+FJob* CJobSystem::FindJob(uint32_t workerIndex)
+{
+	FWorker& self = mWorkers[workerIndex];
+
+	FJob* job = self.mDeque->Pop();
+	if (!job)
+	{
+		// Steal from a random victim first, then sweep the rest.
+		uint32_t workerCount = static_cast<uint32_t>(mWorkers.size());
+		self.mRandomState ^= self.mRandomState << 13;
+		self.mRandomState ^= self.mRandomState >> 17;
+		self.mRandomState ^= self.mRandomState << 5;
+		uint32_t start = self.mRandomState % workerCount;
+
+		for (uint32_t i = 0; i < workerCount && !job; ++i)
+		{
+			uint32_t victim = (start + i) % workerCount;
+			if (victim != workerIndex)
+			{
+				job = mWorkers[victim].mDeque->Steal();
+			}
+		}
+	}
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(mInjectionMutex);
+		if (!mInjectionQueue.empty())
+		{
+			job = mInjectionQueue.back();
+			mInjectionQueue.pop_back();
+		}
+	}
+
+	if (job)
+	{
+		mQueuedJobs.fetch_sub(1);
+	}
+	return job;
+}
+
+void CJobSystem::WorkerMain(uint32_t workerIndex)
+{
+	tJobSystem = this;
+	tWorkerIndex = workerIndex;
+
+	uint32_t idleSpins = 0;
+	while (!mExit.load(std::memory_order_relaxed))
+	{
+		FJob* job = FindJob(workerIndex);
+		if (job)
+		{
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < SpinsBeforeSleep)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mSleepingWorkers.fetch_add(1);
+		mWake.wait_for(lock, std::chrono::milliseconds(2),
+			[this] { return mExit.load() || mQueuedJobs.load() > 0; });
+		mSleepingWorkers.fetch_sub(1);
+		idleSpins = 0;
+	}
+
+	tJobSystem = nullptr;
+}
+
+void CJobSystem::Run(FJob* jobs, uint32_t count, CJobCounter& counter)
+{
+	counter.mValue.fetch_add(count, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		jobs[i].mCounter = &counter;
+	}
+	Enqueue(jobs, count);
+}
+
+void CJobSystem::RunAfter(CJobCounter& dependency, FJob* jobs, uint32_t count, CJobCounter& counter)
+{
+	counter.mValue.fetch_add(count, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		jobs[i].mCounter = &counter;
+	}
+
+	{
+		// Checked under the lock so we cannot miss the flush in Finish.
+		std::lock_guard<std::mutex> lock(dependency.mMutex);
+		if (!dependency.IsDone())
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				dependency.mContinuations.push_back(&jobs[i]);
+			}
+			return;
+		}
+	}
+
+	Enqueue(jobs, count);
+}
+
+void CJobSystem::Wait(CJobCounter& counter)
+{
+	int32_t workerIndex = GetCurrentWorkerIndex();
+
+	while (!counter.IsDone())
+	{
+		// Help out instead of blocking; non-worker threads can only yield.
+		FJob* job = workerIndex >= 0 ? FindJob(static_cast<uint32_t>(workerIndex)) : nullptr;
+		if (job)
+		{
+			Execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Pairs with the lock in Finish; afterwards the counter may be destroyed.
+	std::lock_guard<std::mutex> lock(counter.mMutex);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CJobSystem;
+class CJobCounter;
+
+// Job entry point. Jobs must not throw; catch inside and hand errors back through mData.
+typedef void (*JobFunction)(void* data);
+
+// A unit of work. The caller owns the storage and must keep it alive until the counter it
+// was submitted with reaches zero.
+struct FJob
+{
+	JobFunction mFunction;
+	void* mData;
+	CJobCounter* mCounter;
+};
+
+// Counts outstanding jobs. Jobs submitted with RunAfter are held back until it drops to zero,
+// which is how dependencies between batches are expressed.
+class CJobCounter
+{
+	friend class CJobSystem;
+
+	std::atomic<uint32_t> mValue;
+	std::mutex mMutex;
+	std::vector<FJob*> mContinuations;
+
+public:
+	CJobCounter() : mValue(0) {}
+
+	CJobCounter(const CJobCounter&) = delete;
+	CJobCounter& operator=(const CJobCounter&) = delete;
+
+	bool IsDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+	uint32_t GetValue() const { return mValue.load(std::memory_order_acquire); }
+};
+
+// Fixed-capacity Chase-Lev deque. The owning worker pushes and pops at the bottom,
+// other workers steal from the top.
+class CWorkStealingDeque
+{
+	std::atomic<int64_t> mTop;
+	std::atomic<int64_t> mBottom;
+	std::unique_ptr<std::atomic<FJob*>[]> mBuffer;
+	int64_t mMask;
+
+public:
+	explicit CWorkStealingDeque(uint32_t capacity);
+
+	// Owner only. Returns false when full.
+	bool Push(FJob* job);
+	// Owner only.
+	FJob* Pop();
+	// Any thread.
+	FJob* Steal();
+};
+
+// Work-stealing scheduler: one deque per worker thread, plus one for the thread that created
+// the system, which takes part in the work while it waits on a counter. Threads that are not
+// workers submit through a locked injection queue.
+class CJobSystem
+{
+public:
+	static const uint32_t MaxWorkers = 64;
+	static const uint32_t DequeCapacity = 4096;
+
+private:
+	struct FWorker
+	{
+		std::unique_ptr<CWorkStealingDeque> mDeque;
+		std::thread mThread;
+		uint32_t mRandomState;
+	};
+
+	std::vector<FWorker> mWorkers;   // [0] is the creating thread.
+	std::mutex mInjectionMutex;
+	std::vector<FJob*> mInjectionQueue;
+
+	std::atomic<int32_t> mQueuedJobs;
+	std::atomic<uint32_t> mSleepingWorkers;
+	std::atomic<bool> mExit;
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+
+	void WorkerMain(uint32_t workerIndex);
+	FJob* FindJob(uint32_t workerIndex);
+	bool Push(FJob* job);
+	void Release(uint32_t count);
+	void Enqueue(FJob* jobs, uint32_t count);
+	void Execute(FJob* job);
+	void Finish(CJobCounter* counter);
+	int32_t GetCurrentWorkerIndex() const;
+
+public:
+	// workerThreads additional threads are created; 0 picks hardware_concurrency - 1.
+	explicit CJobSystem(uint32_t workerThreads = 0);
+	~CJobSystem();
+
+	CJobSystem(const CJobSystem&) = delete;
+	CJobSystem& operator=(const CJobSystem&) = delete;
+
+	// Total threads executing jobs, including the creating thread.
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+	// Queues count jobs; counter is incremented by count and decremented as each finishes.
+	void Run(FJob* jobs, uint32_t count, CJobCounter& counter);
+
+	// Like Run, but the jobs are only queued once dependency reaches zero. Submit the jobs
+	// dependency counts first: a counter that is already zero releases them immediately.
+	void RunAfter(CJobCounter& dependency, FJob* jobs, uint32_t count, CJobCounter& counter);
+
+	// Executes queued jobs on the calling thread until counter reaches zero.
+	void Wait(CJobCounter& counter);
+
+	// Calls body(begin, end) over [0, count) in chunks of grain, spread over all threads,
+	// and returns when every chunk has run.
+	template<typename TBody>
+	void ParallelFor(uint32_t count, uint32_t grain, const TBody& body);
+};
+
+template<typename TBody>
+void CJobSystem::ParallelFor(uint32_t count, uint32_t grain, const TBody& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grain = std::max<uint32_t>(grain, 1);
+
+	struct FState
+	{
+		const TBody* mBody;
+		std::atomic<uint32_t> mNext;
+		uint32_t mCount;
+		uint32_t mGrain;
+
+		static void Run(void* data)
+		{
+			FState* state = static_cast<FState*>(data);
+			for (;;)
+			{
+				uint32_t begin = state->mNext.fetch_add(state->mGrain, std::memory_order_relaxed);
+				if (begin >= state->mCount)
+				{
+					break;
+				}
+				(*state->mBody)(begin, std::min(begin + state->mGrain, state->mCount));
+			}
+		}
+	};
+
+	FState state;
+	state.mBody = &body;
+	state.mNext.store(0, std::memory_order_relaxed);
+	state.mCount = count;
+	state.mGrain = grain;
+
+	// One job per thread that can usefully take part; each pulls chunks until none are left.
+	uint32_t chunks = (count + grain - 1) / grain;
+	uint32_t jobCount = std::min(chunks, GetThreadCount());
+
+	FJob jobs[MaxWorkers];
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		jobs[i].mFunction = &FState::Run;
+		jobs[i].mData = &state;
+	}
+
+	CJobCounter counter;
+	Run(jobs, jobCount, counter);
+	Wait(counter);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+struct FLatencyStats
+{
+	uint64_t mSamples = 0;
+	double mMeanNs = 0.0;
+	int64_t mMinNs = 0;
+	int64_t mMaxNs = 0;
+	// Mean time spent blocked before recording (frame latency waitable / frame ring).
+	double mMeanWaitNs = 0.0;
+};
+
+// Accounts input-to-present latency per frame. Timestamps come from the caller so the
+// same model can be driven by the renderer or by a simulated presenter.
+//
+// A frame is opened when its input is sampled and closed when it is handed to Present.
+// Several frames may be open at once (pipelined update/render), up to MaxFramesTracked.
+class CLatencyTracker
+{
+public:
+	static const uint32_t MaxFramesTracked = 16;
+
+private:
+	struct FRecord
+	{
+		uint64_t mFrameId;
+		int64_t mInputNs;
+		bool mOpen;
+	};
+
+	FRecord mRecords[MaxFramesTracked];
+	FLatencyStats mStats;
+	uint64_t mWaitSamples = 0;
+
+public:
+	CLatencyTracker()
+	{
+		for (FRecord& record : mRecords)
+		{
+			record.mOpen = false;
+		}
+	}
+
+	// waitNs is how long the frame blocked before it could sample input.
+	void OnInputSampled(uint64_t frameId, int64_t inputNs, int64_t waitNs)
+	{
+		FRecord& record = mRecords[frameId % MaxFramesTracked];
+		record.mFrameId = frameId;
+		record.mInputNs = inputNs;
+		record.mOpen = true;
+
+		uint64_t n = ++mWaitSamples;
+		mStats.mMeanWaitNs += (waitNs - mStats.mMeanWaitNs) / n;
+	}
+
+	// Returns the input-to-present latency of frameId, or -1 if it was never opened
+	// (or has been overwritten by a frame MaxFramesTracked later).
+	int64_t OnPresented(uint64_t frameId, int64_t presentNs)
+	{
+		FRecord& record = mRecords[frameId % MaxFramesTracked];
+		if (!record.mOpen || record.mFrameId != frameId)
+		{
+			return -1;
+		}
+		record.mOpen = false;
+
+		int64_t latency = presentNs - record.mInputNs;
+		uint64_t n = ++mStats.mSamples;
+		mStats.mMeanNs += (latency - mStats.mMeanNs) / n;
+		if (n == 1 || latency < mStats.mMinNs)
+		{
+			mStats.mMinNs = latency;
+		}
+		if (n == 1 || latency > mStats.mMaxNs)
+		{
+			mStats.mMaxNs = latency;
+		}
+		return latency;
+	}
+
+	const FLatencyStats& GetStats() const { return mStats; }
+
+	void ResetStats()
+	{
+		mStats = FLatencyStats();
+		mWaitSamples = 0;
+	}
+};
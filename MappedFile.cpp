@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+CMappedFile::CMappedFile(const char* path) :
+	mData(nullptr),
+	mSize(0),
+	mFile(INVALID_HANDLE_VALUE),
+	mMapping(nullptr)
+{
+	mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + path);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || static_cast<uint64_t>(size.QuadPart) > std::numeric_limits<size_t>::max())
+	{
+		CloseHandle(mFile);
+		throw std::runtime_error(std::string("Cannot map ") + path);
+	}
+	if (size.QuadPart == 0)
+	{
+		return;
+	}
+
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mMapping ? MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		if (mMapping)
+		{
+			CloseHandle(mMapping);
+		}
+		CloseHandle(mFile);
+		throw std::runtime_error(std::string("Cannot map ") + path);
+	}
+	mData = static_cast<const uint8_t*>(view);
+	mSize = static_cast<size_t>(size.QuadPart);
+}
+
+CMappedFile::~CMappedFile()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+	}
+	CloseHandle(mFile);
+}
+
+#else
+
+CMappedFile::CMappedFile(const char* path) :
+	mData(nullptr),
+	mSize(0)
+{
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + path);
+	}
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 ||
+		static_cast<uint64_t>(info.st_size) > std::numeric_limits<size_t>::max())
+	{
+		close(descriptor);
+		throw std::runtime_error(std::string("Cannot map ") + path);
+	}
+
+	if (info.st_size > 0)
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (data == MAP_FAILED)
+		{
+			close(descriptor);
+			throw std::runtime_error(std::string("Cannot map ") + path);
+		}
+		mData = static_cast<const uint8_t*>(data);
+		mSize = static_cast<size_t>(info.st_size);
+	}
+	// The mapping keeps the file referenced.
+	close(descriptor);
+}
+
+CMappedFile::~CMappedFile()
+{
+	if (mData)
+	{
+		munmap(const_cast<uint8_t*>(mData), mSize);
+	}
+}
+
+#endif
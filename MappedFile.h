@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A whole file mapped read-only into memory, so its contents can be copied straight to where
+// they are needed (e.g. staging memory) without a heap copy in between. Sizes are 64-bit on
+// 64-bit builds; a 32-bit build refuses files that do not fit its address space.
+class CMappedFile
+{
+	const uint8_t* mData;
+	size_t mSize;
+#if defined(_WIN32)
+	void* mFile;
+	void* mMapping;
+#endif
+
+public:
+	// Throws std::runtime_error if the file cannot be opened or mapped. An empty file maps to
+	// a null pointer and size 0.
+	explicit CMappedFile(const char* path);
+	~CMappedFile();
+
+	CMappedFile(const CMappedFile&) = delete;
+	CMappedFile& operator=(const CMappedFile&) = delete;
+
+	const uint8_t* GetData() const { return mData; }
+	size_t GetSize() const         { return mSize; }
+};
@@ -0,0 +1,163 @@
+#include "MipChain.h"
+
+#include <cstring>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Rows below this many texels are not worth a job each.
+	const uint32_t ParallelTexelsPerChunk = 16 * 1024;
+
+	void DownsampleRowScalar(const uint8_t* row0, const uint8_t* row1, uint32_t srcWidth,
+		uint8_t* dst, uint32_t xBegin, uint32_t xEnd)
+	{
+		for (uint32_t x = xBegin; x < xEnd; ++x)
+		{
+			uint32_t x0 = x * 2;
+			uint32_t x1 = x0 + 1 < srcWidth ? x0 + 1 : x0;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+				dst[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+
+#if MIP_CHAIN_SSE2
+	// Two destination texels from eight source bytes of each row, widened to 16 bits.
+	inline __m128i SumPairs(__m128i top, __m128i bottom)
+	{
+		__m128i sum = _mm_add_epi16(top, bottom);                // texel 0 | texel 1
+		return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));      // low half: texel 0 + texel 1
+	}
+
+	// Four destination texels from eight source texels of each row.
+	inline __m128i Downsample4(const uint8_t* row0, const uint8_t* row1)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(2);
+
+		__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+		__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 16));
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+		__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16));
+
+		__m128i t0 = SumPairs(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(a1, zero));
+		__m128i t1 = SumPairs(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(a1, zero));
+		__m128i t2 = SumPairs(_mm_unpacklo_epi8(b0, zero), _mm_unpacklo_epi8(b1, zero));
+		__m128i t3 = SumPairs(_mm_unpackhi_epi8(b0, zero), _mm_unpackhi_epi8(b1, zero));
+
+		__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(t0, t1), round), 2);
+		__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(t2, t3), round), 2);
+		return _mm_packus_epi16(lo, hi);
+	}
+#endif
+
+	void DownsampleRows(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+		uint8_t* dst, uint32_t dstRowPitch, uint32_t rowBegin, uint32_t rowEnd, bool simd)
+	{
+		uint32_t dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+		// Destination texels whose two source columns both exist.
+		uint32_t pairedWidth = srcWidth / 2;
+
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			uint32_t y0 = y * 2;
+			uint32_t y1 = y0 + 1 < srcHeight ? y0 + 1 : y0;
+			const uint8_t* row0 = src + static_cast<size_t>(y0) * srcRowPitch;
+			const uint8_t* row1 = src + static_cast<size_t>(y1) * srcRowPitch;
+			uint8_t* dstRow = dst + static_cast<size_t>(y) * dstRowPitch;
+
+			uint32_t x = 0;
+#if MIP_CHAIN_SSE2
+			if (simd)
+			{
+				for (; x + 4 <= pairedWidth; x += 4)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow + x * 4), Downsample4(row0 + x * 8, row1 + x * 8));
+				}
+			}
+#else
+			(void)simd;
+			(void)pairedWidth;
+#endif
+			DownsampleRowScalar(row0, row1, srcWidth, dstRow, x, dstWidth);
+		}
+	}
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t size = width > height ? width : height;
+	uint32_t count = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		++count;
+	}
+	return count;
+}
+
+void DownsampleBoxRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+	uint8_t* dst, uint32_t dstRowPitch, uint32_t rowBegin, uint32_t rowEnd)
+{
+	DownsampleRows(src, srcWidth, srcHeight, srcRowPitch, dst, dstRowPitch, rowBegin, rowEnd, true);
+}
+
+void DownsampleBoxRGBA8Scalar(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+	uint8_t* dst, uint32_t dstRowPitch, uint32_t rowBegin, uint32_t rowEnd)
+{
+	DownsampleRows(src, srcWidth, srcHeight, srcRowPitch, dst, dstRowPitch, rowBegin, rowEnd, false);
+}
+
+void GenerateMipChainRGBA8(const uint8_t* data, uint32_t width, uint32_t height, uint32_t rowPitch,
+	CJobSystem* jobs, FMipChain& chain)
+{
+	uint32_t levelCount = GetMipLevelCount(width, height);
+	chain.mLevels.resize(levelCount);
+
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		FMipLevel& level = chain.mLevels[i];
+		level.mWidth = width >> i ? width >> i : 1;
+		level.mHeight = height >> i ? height >> i : 1;
+		level.mRowPitch = level.mWidth * 4;
+		level.mOffset = size;
+		size += static_cast<uint64_t>(level.mRowPitch) * level.mHeight;
+	}
+	chain.mData.resize(static_cast<size_t>(size));
+
+	const FMipLevel& base = chain.mLevels[0];
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		memcpy(&chain.mData[static_cast<size_t>(base.mRowPitch) * y], data + static_cast<size_t>(rowPitch) * y, base.mRowPitch);
+	}
+
+	for (uint32_t i = 1; i < levelCount; ++i)
+	{
+		const FMipLevel& source = chain.mLevels[i - 1];
+		const FMipLevel& level = chain.mLevels[i];
+		const uint8_t* src = &chain.mData[static_cast<size_t>(source.mOffset)];
+		uint8_t* dst = &chain.mData[static_cast<size_t>(level.mOffset)];
+
+		uint32_t rowsPerChunk = ParallelTexelsPerChunk / level.mWidth;
+		if (!jobs || rowsPerChunk >= level.mHeight)
+		{
+			DownsampleBoxRGBA8(src, source.mWidth, source.mHeight, source.mRowPitch, dst, level.mRowPitch, 0, level.mHeight);
+			continue;
+		}
+
+		jobs->ParallelFor(level.mHeight, rowsPerChunk,
+			[&](uint32_t begin, uint32_t end)
+			{
+				DownsampleBoxRGBA8(src, source.mWidth, source.mHeight, source.mRowPitch, dst, level.mRowPitch, begin, end);
+			});
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class CJobSystem;
+
+struct FMipLevel
+{
+	uint64_t mOffset;       // Into FMipChain::mData.
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mRowPitch;     // Tightly packed: mWidth * 4.
+};
+
+// Every level of an RGBA8 texture, level 0 first, packed one after the other.
+struct FMipChain
+{
+	std::vector<uint8_t> mData;
+	std::vector<FMipLevel> mLevels;
+};
+
+// Levels down to 1x1: floor(log2(max(width, height))) + 1.
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// Box-filters rows [rowBegin, rowEnd) of the next level of src into dst. Each destination
+// texel is the rounded average (a + b + c + d + 2) / 4 of the 2x2 source texels under it.
+// Levels halve with rounding down, as D3D12 sizes them, so the last row or column of an odd
+// edge is left out, and an edge of one texel uses it twice. The SSE2 path and the scalar one
+// produce identical bytes.
+void DownsampleBoxRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+	uint8_t* dst, uint32_t dstRowPitch, uint32_t rowBegin, uint32_t rowEnd);
+
+// The same filter without SIMD; the reference DownsampleBoxRGBA8 is checked against.
+void DownsampleBoxRGBA8Scalar(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowPitch,
+	uint8_t* dst, uint32_t dstRowPitch, uint32_t rowBegin, uint32_t rowEnd);
+
+// Copies level 0 and box-filters the rest of the chain from it, each level from the one
+// above. With jobs, the rows of each level are spread over the job system's threads; levels
+// are still made one after the other. The result does not depend on the thread count.
+void GenerateMipChainRGBA8(const uint8_t* data, uint32_t width, uint32_t height, uint32_t rowPitch,
+	CJobSystem* jobs, FMipChain& chain);
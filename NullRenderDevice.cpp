@@ -0,0 +1,640 @@
+#include "NullRenderDevice.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "SubresourceCopy.h"
+#include "UploadRing.h"
+#include "UploadTracker.h"
+
+namespace
+{
+	// What a null command list remembers of each command.
+	enum class ENullCommandType : uint8_t
+	{
+		Transition,
+		ClearRenderTarget,
+		SetPipeline,
+		SetViewport,
+		SetScissor,
+		SetRenderTarget,
+		SetVertexBuffer,
+		SetIndexBuffer,
+		DrawIndexed,
+		Dispatch,
+	};
+
+	struct FNullCommand
+	{
+		ENullCommandType mType;
+		const void* mObject;
+	};
+
+	class CNullResource : public IRenderResource
+	{
+		std::vector<uint8_t> mMemory;   // Only for upload buffers.
+		uint64_t mGPUAddress;
+
+	public:
+		CNullResource(uint64_t cpuSize, uint64_t gpuAddress) :
+			mMemory(static_cast<size_t>(cpuSize)),
+			mGPUAddress(gpuAddress)
+		{
+		}
+
+		virtual void* GetCPUAddress()     { return mMemory.empty() ? nullptr : mMemory.data(); }
+		virtual uint64_t GetGPUAddress()  { return mGPUAddress; }
+	};
+
+	class CNullPipeline : public IRenderPipeline
+	{
+	};
+
+	class CNullCommandAllocator : public IRenderCommandAllocator
+	{
+	public:
+		ERenderQueueType mType;
+		// Lists recording into the allocator; it may not be reset under them.
+		uint32_t mOpenLists;
+		uint64_t mCommandCount;
+
+		explicit CNullCommandAllocator(ERenderQueueType type) :
+			mType(type),
+			mOpenLists(0),
+			mCommandCount(0)
+		{
+		}
+
+		virtual void Reset()
+		{
+			if (mOpenLists != 0)
+			{
+				throw std::logic_error("Command allocator reset while a list is recording into it.");
+			}
+			mCommandCount = 0;
+		}
+
+		virtual uint64_t GetCommandCount() const { return mCommandCount; }
+	};
+
+	class CNullCommandList : public IRenderCommandList
+	{
+		ERenderQueueType mType;
+		CNullCommandAllocator* mAllocator;
+		// Kept across resets so steady-state recording does not allocate.
+		std::vector<FNullCommand> mCommands;
+		uint32_t mDraws;
+		uint32_t mDispatches;
+		uint32_t mBarriers;
+
+		void Record(ENullCommandType type, const void* object)
+		{
+			if (!mAllocator)
+			{
+				throw std::logic_error("Recording into a closed command list.");
+			}
+
+			FNullCommand command = { type, object };
+			mCommands.push_back(command);
+			++mAllocator->mCommandCount;
+		}
+
+	public:
+		explicit CNullCommandList(ERenderQueueType type) :
+			mType(type),
+			mAllocator(nullptr),
+			mDraws(0),
+			mDispatches(0),
+			mBarriers(0)
+		{
+		}
+
+		bool IsOpen() const                              { return mAllocator != nullptr; }
+		const std::vector<FNullCommand>& GetCommands() const { return mCommands; }
+		uint32_t GetDrawCount() const                    { return mDraws; }
+		uint32_t GetDispatchCount() const                { return mDispatches; }
+		uint32_t GetBarrierCount() const                 { return mBarriers; }
+
+		virtual ERenderQueueType GetType() const { return mType; }
+
+		virtual void Reset(IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+		{
+			CNullCommandAllocator* nullAllocator = static_cast<CNullCommandAllocator*>(allocator);
+			if (mAllocator)
+			{
+				throw std::logic_error("Command list reset while still open.");
+			}
+			if (nullAllocator->mType != mType)
+			{
+				throw std::logic_error("Command list reset onto an allocator of another type.");
+			}
+
+			mAllocator = nullAllocator;
+			++mAllocator->mOpenLists;
+			mCommands.clear();
+			mDraws = 0;
+			mDispatches = 0;
+			mBarriers = 0;
+
+			if (pipeline)
+			{
+				Record(ENullCommandType::SetPipeline, pipeline);
+			}
+		}
+
+		virtual void Close()
+		{
+			if (!mAllocator)
+			{
+				throw std::logic_error("Command list closed twice.");
+			}
+
+			--mAllocator->mOpenLists;
+			mAllocator = nullptr;
+		}
+
+		virtual void Transition(IRenderResource* resource, ERenderResourceState before, ERenderResourceState after)
+		{
+			assert(before != after);
+			(void)before;
+			(void)after;
+			Record(ENullCommandType::Transition, resource);
+			++mBarriers;
+		}
+
+		virtual void ClearRenderTarget(IRenderResource* target, const float*)
+		{
+			Record(ENullCommandType::ClearRenderTarget, target);
+		}
+
+		virtual void SetPipeline(IRenderPipeline* pipeline)
+		{
+			Record(ENullCommandType::SetPipeline, pipeline);
+		}
+
+		virtual void SetViewport(const FRenderViewport&)
+		{
+			Record(ENullCommandType::SetViewport, nullptr);
+		}
+
+		virtual void SetScissor(const FRenderRect&)
+		{
+			Record(ENullCommandType::SetScissor, nullptr);
+		}
+
+		virtual void SetRenderTarget(IRenderResource* target)
+		{
+			Record(ENullCommandType::SetRenderTarget, target);
+		}
+
+		virtual void SetVertexBuffer(IRenderResource* buffer, uint32_t, uint32_t)
+		{
+			Record(ENullCommandType::SetVertexBuffer, buffer);
+		}
+
+		virtual void SetIndexBuffer(IRenderResource* buffer, ERenderFormat, uint32_t)
+		{
+			Record(ENullCommandType::SetIndexBuffer, buffer);
+		}
+
+		virtual void DrawIndexed(uint32_t, uint32_t, uint32_t, int32_t)
+		{
+			Record(ENullCommandType::DrawIndexed, nullptr);
+			++mDraws;
+		}
+
+		virtual void Dispatch(uint32_t, uint32_t, uint32_t)
+		{
+			if (mType == ERenderQueueType::Copy)
+			{
+				throw std::logic_error("Dispatch recorded on a copy list.");
+			}
+			Record(ENullCommandType::Dispatch, nullptr);
+			++mDispatches;
+		}
+	};
+
+	int64_t GetTimeNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Completes each signalled value once its simulated GPU latency has passed; immediately
+	// without one. Safe to poll from any thread.
+	class CNullFence : public IRenderFence
+	{
+		struct FPending
+		{
+			uint64_t mValue;
+			int64_t mDueNs;
+		};
+
+		std::mutex mMutex;
+		uint64_t mCompleted;
+		uint64_t mSignaled;
+		// [mPendingHead, end); a vector rather than a deque, which allocates as it moves along.
+		std::vector<FPending> mPending;
+		size_t mPendingHead;
+
+		bool HasPending() const { return mPendingHead < mPending.size(); }
+
+		void Retire(int64_t nowNs)
+		{
+			while (HasPending() && mPending[mPendingHead].mDueNs <= nowNs)
+			{
+				mCompleted = std::max(mCompleted, mPending[mPendingHead].mValue);
+				++mPendingHead;
+			}
+			if (mPendingHead == mPending.size() || mPendingHead >= 64)
+			{
+				mPending.erase(mPending.begin(), mPending.begin() + mPendingHead);
+				mPendingHead = 0;
+			}
+		}
+
+	public:
+		CNullFence() :
+			mCompleted(0),
+			mSignaled(0),
+			mPendingHead(0)
+		{
+		}
+
+		void Signal(uint64_t value, int64_t latencyNs)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mSignaled = std::max(mSignaled, value);
+			if (latencyNs <= 0 && !HasPending())
+			{
+				mCompleted = std::max(mCompleted, value);
+				return;
+			}
+			// Signals complete in order, like a queue's.
+			FPending pending = { value, GetTimeNs() + latencyNs };
+			mPending.push_back(pending);
+		}
+
+		uint64_t GetSignaledValue()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mSignaled;
+		}
+
+		virtual uint64_t GetCompletedValue()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			Retire(GetTimeNs());
+			return mCompleted;
+		}
+
+		virtual void WaitForValue(uint64_t value)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (mSignaled < value)
+			{
+				throw std::logic_error("CPU wait for a fence value that was never signalled.");
+			}
+
+			Retire(GetTimeNs());
+			while (mCompleted < value)
+			{
+				int64_t dueNs = mPending[mPendingHead].mDueNs;
+				lock.unlock();
+				std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - GetTimeNs()));
+				lock.lock();
+				Retire(GetTimeNs());
+			}
+		}
+	};
+
+	class CNullQueue : public IRenderQueue
+	{
+		ERenderQueueType mType;
+		FNullRenderStats& mStats;
+		const int64_t& mGPULatencyNs;
+
+	public:
+		CNullQueue(ERenderQueueType type, FNullRenderStats& stats, const int64_t& gpuLatencyNs) :
+			mType(type),
+			mStats(stats),
+			mGPULatencyNs(gpuLatencyNs)
+		{
+		}
+
+		virtual ERenderQueueType GetType() const { return mType; }
+
+		virtual void Execute(IRenderCommandList* const* lists, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				CNullCommandList* list = static_cast<CNullCommandList*>(lists[i]);
+				if (list->IsOpen())
+				{
+					throw std::logic_error("Executing a command list that was not closed.");
+				}
+				if (list->GetType() != mType)
+				{
+					throw std::logic_error("Command list executed on a queue of another type.");
+				}
+
+				++mStats.mListsExecuted;
+				mStats.mCommandsExecuted += list->GetCommands().size();
+				mStats.mDraws += list->GetDrawCount();
+				mStats.mDispatches += list->GetDispatchCount();
+				mStats.mBarriers += list->GetBarrierCount();
+			}
+		}
+
+		// Everything executed so far completes when the signal does, after the simulated latency.
+		virtual void Signal(IRenderFence* fence, uint64_t value)
+		{
+			static_cast<CNullFence*>(fence)->Signal(value, mGPULatencyNs);
+			++mStats.mSignals;
+		}
+
+		virtual void Wait(IRenderFence* fence, uint64_t value)
+		{
+			if (static_cast<CNullFence*>(fence)->GetSignaledValue() < value)
+			{
+				++mStats.mUnsignalledWaits;
+			}
+			++mStats.mWaits;
+		}
+	};
+
+	class CNullSwapChain : public IRenderSwapChain
+	{
+		std::vector<std::unique_ptr<CNullResource>> mBackBuffers;
+		uint32_t mCurrent;
+		FNullRenderStats& mStats;
+
+	public:
+		CNullSwapChain(uint32_t bufferCount, FNullRenderStats& stats) :
+			mCurrent(0),
+			mStats(stats)
+		{
+			for (uint32_t i = 0; i < bufferCount; ++i)
+			{
+				mBackBuffers.emplace_back(new CNullResource(0, 0));
+			}
+		}
+
+		virtual uint32_t GetBufferCount() const            { return static_cast<uint32_t>(mBackBuffers.size()); }
+		virtual uint32_t GetCurrentBackBufferIndex()       { return mCurrent; }
+		virtual IRenderResource* GetBackBuffer(uint32_t i) { return mBackBuffers[i].get(); }
+
+		virtual void WaitForNextFrame()
+		{
+		}
+
+		virtual void Present(uint32_t)
+		{
+			mCurrent = (mCurrent + 1) % GetBufferCount();
+			++mStats.mPresents;
+		}
+
+		// There is no display, so no statistics; every sync interval is accepted.
+		virtual bool IsTearingSupported() const          { return true; }
+		virtual bool GetPresentStats(FRenderPresentStats&) { return false; }
+	};
+
+	// Stages uploads in a CPU-memory ring like the D3D12 queue does, so the copies and the
+	// waits for staging memory cost what they would there.
+	class CNullUploadQueue : public IRenderUploadQueue
+	{
+		static const uint64_t StagingSize = 4 * 1024 * 1024;
+		static const uint64_t StagingAlignment = 512;
+		static const uint32_t StagingRegions = 64;
+
+		CNullFence mFence;
+		uint64_t mLastSignaled;
+		CUploadTracker mTracker;
+		std::vector<uint8_t> mStaging;
+		CUploadRing mStagingRing;
+		FNullRenderStats& mStats;
+		const int64_t& mGPULatencyNs;
+		CJobSystem* mCopyJobs;
+
+		uint64_t AllocateStaging(uint64_t size)
+		{
+			if (size > StagingSize)
+			{
+				return CUploadRing::InvalidOffset;
+			}
+
+			uint64_t offset = mStagingRing.Allocate(size, StagingAlignment);
+			while (offset == CUploadRing::InvalidOffset)
+			{
+				if (mStagingRing.GetOldestFenceValue() == 0)
+				{
+					Submit();
+				}
+				mFence.WaitForValue(mStagingRing.GetOldestFenceValue());
+				Retire();
+				offset = mStagingRing.Allocate(size, StagingAlignment);
+			}
+			return offset;
+		}
+
+	public:
+		CNullUploadQueue(FNullRenderStats& stats, const int64_t& gpuLatencyNs, CJobSystem* copyJobs) :
+			mLastSignaled(0),
+			mStaging(StagingSize),
+			mStats(stats),
+			mGPULatencyNs(gpuLatencyNs),
+			mCopyJobs(copyJobs)
+		{
+			mStagingRing.Initialize(StagingSize, StagingRegions);
+		}
+
+		virtual void UploadSubresources(IRenderResource* dest, uint32_t, uint32_t numSubresources,
+			const FRenderSubresourceData* data)
+		{
+			// Subresources placed one after the other, as GetCopyableFootprints would.
+			uint64_t size = 0;
+			for (uint32_t i = 0; i < numSubresources; ++i)
+			{
+				size = (size + StagingAlignment - 1) & ~(StagingAlignment - 1);
+				size += static_cast<uint64_t>(data[i].mSlicePitch);
+			}
+
+			// Oversized uploads would get staging of their own; here they are only counted.
+			uint64_t offset = AllocateStaging(size);
+			for (uint32_t i = 0; i < numSubresources && offset != CUploadRing::InvalidOffset; ++i)
+			{
+				offset = (offset + StagingAlignment - 1) & ~(StagingAlignment - 1);
+				size_t size = static_cast<size_t>(data[i].mSlicePitch);
+				FSubresourceCopy copy = { static_cast<const uint8_t*>(data[i].mData), size, size, &mStaging[offset], size, size, size, 1, 1 };
+				// Staging here is ordinary memory, which streaming stores would only slow down.
+				CopySubresource(copy, ESubresourceCopyTarget::Cached, mCopyJobs);
+				offset += static_cast<uint64_t>(data[i].mSlicePitch);
+			}
+			for (uint32_t i = 0; i < numSubresources; ++i)
+			{
+				mStats.mUploadBytes += static_cast<uint64_t>(data[i].mSlicePitch);
+			}
+			++mStats.mUploads;
+			mTracker.AddToBatch(dest);
+		}
+
+		virtual uint64_t Submit()
+		{
+			if (!mTracker.HasOpenBatch())
+			{
+				return mTracker.GetLastSubmittedValue();
+			}
+
+			mFence.Signal(++mLastSignaled, mGPULatencyNs);
+			++mStats.mSignals;
+			mStagingRing.CloseRegion(mLastSignaled);
+			mTracker.OnBatchSubmitted(mLastSignaled);
+			return mLastSignaled;
+		}
+
+		virtual void WaitOnQueue(IRenderQueue* consumer, IRenderResource* const* resources, uint32_t count)
+		{
+			uint64_t waitValue = mTracker.AcquireForConsumer(consumer, resources, count);
+			if (waitValue != 0)
+			{
+				consumer->Wait(&mFence, waitValue);
+			}
+		}
+
+		virtual void Retire()
+		{
+			uint64_t completedValue = mFence.GetCompletedValue();
+			mStagingRing.Retire(completedValue);
+			mTracker.Retire(completedValue);
+		}
+
+		virtual IRenderFence* GetFence()                 { return &mFence; }
+		virtual uint64_t GetLastSignaledValue()          { return mLastSignaled; }
+	};
+}
+
+CNullRenderDevice::CNullRenderDevice() :
+	mNextGPUAddress(0x10000),
+	mGPULatencyNs(0)
+{
+}
+
+CNullRenderDevice::~CNullRenderDevice()
+{
+}
+
+uint64_t CNullRenderDevice::AllocateGPUAddress(uint64_t size)
+{
+	// 64KB granularity, like committed resources.
+	uint64_t address = mNextGPUAddress;
+	mNextGPUAddress += (size + 0xffff) & ~0xffffull;
+	return address;
+}
+
+std::unique_ptr<IRenderQueue> CNullRenderDevice::CreateQueue(ERenderQueueType type)
+{
+	return std::unique_ptr<IRenderQueue>(new CNullQueue(type, mStats, mGPULatencyNs));
+}
+
+std::unique_ptr<IRenderFence> CNullRenderDevice::CreateFence()
+{
+	return std::unique_ptr<IRenderFence>(new CNullFence());
+}
+
+void CNullRenderDevice::WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		fences[i]->WaitForValue(values[i]);
+	}
+}
+
+std::shared_ptr<IRenderCommandAllocator> CNullRenderDevice::CreateCommandAllocator(ERenderQueueType type)
+{
+	++mStats.mAllocatorsCreated;
+	return std::make_shared<CNullCommandAllocator>(type);
+}
+
+std::unique_ptr<IRenderCommandList> CNullRenderDevice::CreateCommandList(ERenderQueueType type,
+	IRenderCommandAllocator* allocator, IRenderPipeline* pipeline)
+{
+	++mStats.mListsCreated;
+
+	// Created open on the allocator and closed again, as D3D12 lists are handed out here.
+	std::unique_ptr<CNullCommandList> list(new CNullCommandList(type));
+	list->Reset(allocator, pipeline);
+	list->Close();
+	return list;
+}
+
+std::shared_ptr<IRenderResource> CNullRenderDevice::CreateUploadBuffer(uint64_t size)
+{
+	++mStats.mResourcesCreated;
+	mStats.mResourceBytes += size;
+	return std::make_shared<CNullResource>(size, AllocateGPUAddress(size));
+}
+
+std::shared_ptr<IRenderResource> CNullRenderDevice::CreateBuffer(uint64_t size)
+{
+	++mStats.mResourcesCreated;
+	mStats.mResourceBytes += size;
+	return std::make_shared<CNullResource>(0, AllocateGPUAddress(size));
+}
+
+std::shared_ptr<IRenderResource> CNullRenderDevice::CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format)
+{
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < mipLevels; ++i)
+	{
+		uint32_t levelWidth = width >> i ? width >> i : 1;
+		uint32_t levelHeight = height >> i ? height >> i : 1;
+		size += GetFormatRowBytes(format, levelWidth) * GetFormatRowCount(format, levelHeight);
+	}
+
+	++mStats.mResourcesCreated;
+	mStats.mResourceBytes += size;
+	return std::make_shared<CNullResource>(0, AllocateGPUAddress(size));
+}
+
+std::shared_ptr<IRenderResource> CNullRenderDevice::CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format)
+{
+	return CreateTexture2D(width, height, 1, format);
+}
+
+std::vector<uint8_t> CNullRenderDevice::CompileShader(const std::wstring& path, const char* target)
+{
+	if (path.empty() || !target)
+	{
+		throw std::invalid_argument("CompileShader needs a path and a target.");
+	}
+	return std::vector<uint8_t>(target, target + strlen(target));
+}
+
+std::unique_ptr<IRenderPipeline> CNullRenderDevice::CreatePipeline(const FRenderPipelineDesc& desc)
+{
+	if (!desc.mVertexShader || desc.mVertexShader->empty() || !desc.mPixelShader || desc.mPixelShader->empty())
+	{
+		throw std::invalid_argument("Pipeline created without shader bytecode.");
+	}
+	return std::unique_ptr<IRenderPipeline>(new CNullPipeline());
+}
+
+std::unique_ptr<IRenderSwapChain> CNullRenderDevice::CreateSwapChain(IRenderQueue* presentQueue, void*,
+	uint32_t, uint32_t, uint32_t bufferCount, bool)
+{
+	if (presentQueue->GetType() != ERenderQueueType::Direct)
+	{
+		throw std::logic_error("Swap chains present from a direct queue.");
+	}
+	return std::unique_ptr<IRenderSwapChain>(new CNullSwapChain(bufferCount, mStats));
+}
+
+std::unique_ptr<IRenderUploadQueue> CNullRenderDevice::CreateUploadQueue(CJobSystem* copyJobs)
+{
+	return std::unique_ptr<IRenderUploadQueue>(new CNullUploadQueue(mStats, mGPULatencyNs, copyJobs));
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+
+struct FNullRenderStats
+{
+	uint64_t mListsExecuted = 0;
+	uint64_t mCommandsExecuted = 0;
+	uint64_t mDraws = 0;
+	uint64_t mDispatches = 0;
+	uint64_t mBarriers = 0;
+	uint64_t mSignals = 0;
+	uint64_t mWaits = 0;
+	// Queue waits for a value not signalled yet; a real GPU would stall the queue on those.
+	uint64_t mUnsignalledWaits = 0;
+	uint64_t mPresents = 0;
+	uint64_t mUploads = 0;
+	uint64_t mUploadBytes = 0;
+	uint64_t mAllocatorsCreated = 0;
+	uint64_t mListsCreated = 0;
+	uint64_t mResourcesCreated = 0;
+	uint64_t mResourceBytes = 0;
+};
+
+// Render device without a GPU. Command lists record their commands into memory and queues
+// "execute" them by accounting for them, so the frame loop runs at its full CPU cost with
+// nothing behind it: every submission completes as soon as it is issued (or a fixed simulated
+// GPU latency later, see SetGPULatency), and upload buffers are plain memory.
+//
+// Misuse that D3D12 would only report through the debug layer (executing or recording into a
+// closed list, resetting an open one, waiting on the CPU for a value nobody signalled) throws
+// std::logic_error, so headless runs double as a check of the frame's command list hygiene.
+//
+// Creation and recording follow the D3D12 threading rules; Execute, Signal and Present must
+// come from one thread at a time.
+class CNullRenderDevice : public IRenderDevice
+{
+	FNullRenderStats mStats;
+	uint64_t mNextGPUAddress;
+	int64_t mGPULatencyNs;
+
+public:
+	CNullRenderDevice();
+	virtual ~CNullRenderDevice();
+
+	virtual std::unique_ptr<IRenderQueue> CreateQueue(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderFence> CreateFence();
+	virtual void WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count);
+
+	virtual std::shared_ptr<IRenderCommandAllocator> CreateCommandAllocator(ERenderQueueType type);
+	virtual std::unique_ptr<IRenderCommandList> CreateCommandList(ERenderQueueType type,
+		IRenderCommandAllocator* allocator, IRenderPipeline* pipeline);
+
+	virtual std::shared_ptr<IRenderResource> CreateUploadBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateBuffer(uint64_t size);
+	virtual std::shared_ptr<IRenderResource> CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format);
+	virtual std::shared_ptr<IRenderResource> CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format);
+
+	// Does not read the file; returns a stand-in blob naming the target.
+	virtual std::vector<uint8_t> CompileShader(const std::wstring& path, const char* target);
+	virtual std::unique_ptr<IRenderPipeline> CreatePipeline(const FRenderPipelineDesc& desc);
+
+	virtual std::unique_ptr<IRenderSwapChain> CreateSwapChain(IRenderQueue* presentQueue, void* window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency);
+
+	virtual std::unique_ptr<IRenderUploadQueue> CreateUploadQueue(CJobSystem* copyJobs);
+
+	// Fake GPU virtual addresses, unique per buffer.
+	uint64_t AllocateGPUAddress(uint64_t size);
+
+	// Fence values complete latencyNs after they are signalled, so CPU waits on them stall
+	// like they would on a busy GPU. Applies to signals issued from then on; 0 by default.
+	void SetGPULatency(int64_t latencyNs) { mGPULatencyNs = latencyNs; }
+
+	FNullRenderStats& GetStats() { return mStats; }
+	void ResetStats()            { mStats = FNullRenderStats(); }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Records one frame's command lists on N threads (jobs on a CJobSystem) and submits them as a
+// single batch in thread order, so the GPU sees the same sequence regardless of which thread
+// finished first.
+//
+// Every (frame context, thread) pair owns its own allocator and list. An allocator is only
+// reset when its frame context comes round again, so callers must only pass a frame index
+// whose previous submission has retired (e.g. the current CFrameContextRing slot).
+//
+// TBackend abstracts the device so the recorder can run against D3D12 or a stand-in:
+//     typedef ... Allocator;
+//     typedef ... CommandList;
+//     typedef ... SubmitHandle;
+//     Allocator CreateAllocator();
+//     CommandList CreateCommandList(Allocator& allocator);        // returned closed
+//     void Reset(Allocator& allocator, CommandList& list);        // resets both, list opened
+//     void Close(CommandList& list);
+//     SubmitHandle GetSubmitHandle(CommandList& list);
+//     void Execute(const SubmitHandle* lists, uint32_t count);    // one ExecuteCommandLists
+template<typename TBackend>
+class CParallelCommandRecorder
+{
+public:
+	typedef typename TBackend::Allocator Allocator;
+	typedef typename TBackend::CommandList CommandList;
+	typedef typename TBackend::SubmitHandle SubmitHandle;
+
+private:
+	struct FSlot
+	{
+		Allocator mAllocator;
+		CommandList mList;
+	};
+
+	struct FRecordJob
+	{
+		CParallelCommandRecorder* mRecorder;
+		uint32_t mThreadIndex;
+		std::exception_ptr mError;
+	};
+
+	TBackend& mBackend;
+	CJobSystem& mJobSystem;
+	uint32_t mThreadCount;
+	uint32_t mFrameCount;
+	std::vector<FSlot> mSlots;                 // [frame * mThreadCount + thread]
+	std::vector<SubmitHandle> mBatch;          // Reused across frames.
+	std::vector<FRecordJob> mRecordJobs;
+	std::vector<FJob> mJobs;
+
+	uint32_t mActiveFrame;
+	const void* mActiveFunction;
+	void (*mActiveInvoke)(const void* function, uint32_t threadIndex, CommandList& list);
+
+	FSlot& GetSlot(uint32_t frameIndex, uint32_t threadIndex)
+	{
+		return mSlots[frameIndex * mThreadCount + threadIndex];
+	}
+
+	static void RecordJob(void* data)
+	{
+		FRecordJob* job = static_cast<FRecordJob*>(data);
+		CParallelCommandRecorder* recorder = job->mRecorder;
+
+		try
+		{
+			FSlot& slot = recorder->GetSlot(recorder->mActiveFrame, job->mThreadIndex);
+			recorder->mBackend.Reset(slot.mAllocator, slot.mList);
+			recorder->mActiveInvoke(recorder->mActiveFunction, job->mThreadIndex, slot.mList);
+			recorder->mBackend.Close(slot.mList);
+		}
+		catch (...)
+		{
+			job->mError = std::current_exception();
+		}
+	}
+
+public:
+	// threadCount is the number of lists recorded in parallel per frame; each is recorded by
+	// one job, and jobSystem decides which of its threads runs it.
+	CParallelCommandRecorder(TBackend& backend, CJobSystem& jobSystem, uint32_t threadCount, uint32_t frameCount) :
+		mBackend(backend),
+		mJobSystem(jobSystem),
+		mThreadCount(threadCount > 0 ? threadCount : 1),
+		mFrameCount(frameCount),
+		mActiveFrame(0),
+		mActiveFunction(nullptr),
+		mActiveInvoke(nullptr)
+	{
+		assert(frameCount > 0);
+
+		mSlots.resize(mThreadCount * mFrameCount);
+		for (FSlot& slot : mSlots)
+		{
+			slot.mAllocator = mBackend.CreateAllocator();
+			slot.mList = mBackend.CreateCommandList(slot.mAllocator);
+		}
+
+		mRecordJobs.resize(mThreadCount);
+		mJobs.resize(mThreadCount);
+		for (uint32_t i = 0; i < mThreadCount; ++i)
+		{
+			mRecordJobs[i].mRecorder = this;
+			mRecordJobs[i].mThreadIndex = i;
+			mJobs[i].mFunction = &RecordJob;
+			mJobs[i].mData = &mRecordJobs[i];
+		}
+	}
+
+	CParallelCommandRecorder(const CParallelCommandRecorder&) = delete;
+	CParallelCommandRecorder& operator=(const CParallelCommandRecorder&) = delete;
+
+	uint32_t GetThreadCount() const { return mThreadCount; }
+	uint32_t GetFrameCount() const  { return mFrameCount; }
+
+	// Runs recordFunction(threadIndex, list) once per list on the job system (the caller helps
+	// while it waits) and returns when every list of frameIndex has been closed. threadIndex is in
+	// [0, GetThreadCount()); the list is open on entry and closed by the recorder. Rethrows the
+	// exception of the lowest-numbered list that failed.
+	template<typename TFunction>
+	void Record(uint32_t frameIndex, const TFunction& recordFunction)
+	{
+		assert(frameIndex < mFrameCount);
+
+		mActiveFrame = frameIndex;
+		mActiveFunction = &recordFunction;
+		mActiveInvoke = [](const void* function, uint32_t threadIndex, CommandList& list)
+		{
+			(*static_cast<const TFunction*>(function))(threadIndex, list);
+		};
+		for (FRecordJob& job : mRecordJobs)
+		{
+			job.mError = nullptr;
+		}
+
+		CJobCounter counter;
+		mJobSystem.Run(mJobs.data(), mThreadCount, counter);
+		mJobSystem.Wait(counter);
+
+		mActiveFunction = nullptr;
+		for (FRecordJob& job : mRecordJobs)
+		{
+			if (job.mError)
+			{
+				std::rethrow_exception(job.mError);
+			}
+		}
+	}
+
+	// Submits [before..., thread 0 ... thread N-1, after...] in a single Execute call.
+	void Submit(uint32_t frameIndex,
+		const SubmitHandle* before, uint32_t beforeCount,
+		const SubmitHandle* after, uint32_t afterCount)
+	{
+		assert(frameIndex < mFrameCount);
+
+		mBatch.clear();
+		mBatch.insert(mBatch.end(), before, before + beforeCount);
+		for (uint32_t i = 0; i < mThreadCount; ++i)
+		{
+			mBatch.push_back(mBackend.GetSubmitHandle(GetSlot(frameIndex, i).mList));
+		}
+		mBatch.insert(mBatch.end(), after, after + afterCount);
+
+		mBackend.Execute(mBatch.data(), static_cast<uint32_t>(mBatch.size()));
+	}
+
+	// Splits [0, itemCount) evenly across threads; handy inside a RecordFunction.
+	void GetThreadRange(uint32_t threadIndex, uint32_t itemCount, uint32_t& begin, uint32_t& end) const
+	{
+		begin = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * threadIndex / mThreadCount);
+		end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (threadIndex + 1) / mThreadCount);
+	}
+};
@@ -0,0 +1,223 @@
+#include "PassSchedule.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+CPassSchedule::CPassSchedule() :
+	mWaitCount(0),
+	mCompiled(false)
+{
+	std::fill(mJoinBatch, mJoinBatch + QueueTypeCount, -1);
+}
+
+CPassSchedule::~CPassSchedule()
+{
+	DestroyFunctions();
+}
+
+void CPassSchedule::DestroyFunctions()
+{
+	for (FPass& pass : mPasses)
+	{
+		pass.mDestroy(pass.mFunction);
+	}
+}
+
+void CPassSchedule::Reset()
+{
+	DestroyFunctions();
+	mPasses.clear();
+	mAccesses.clear();
+	mBatches.clear();
+	mPassBatch.clear();
+	std::fill(mJoinBatch, mJoinBatch + QueueTypeCount, -1);
+	mWaitCount = 0;
+	mCompiled = false;
+}
+
+uint32_t CPassSchedule::AddPass(const char* name, EQueueType queue,
+	std::initializer_list<const void*> reads, std::initializer_list<const void*> writes,
+	void* function, void (*invoke)(void*), void (*destroy)(void*))
+{
+	FPass pass;
+	pass.mName = name;
+	pass.mQueue = queue;
+	pass.mFirstAccess = static_cast<uint32_t>(mAccesses.size());
+	pass.mAccessCount = static_cast<uint32_t>(reads.size() + writes.size());
+	pass.mFunction = function;
+	pass.mInvoke = invoke;
+	pass.mDestroy = destroy;
+
+	for (const void* resource : reads)
+	{
+		FAccess access = { resource, 0, false };
+		mAccesses.push_back(access);
+	}
+	for (const void* resource : writes)
+	{
+		FAccess access = { resource, 0, true };
+		mAccesses.push_back(access);
+	}
+
+	mPasses.push_back(pass);
+	mCompiled = false;
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void CPassSchedule::AddDependency(uint32_t pass, int32_t dependency, int32_t (&waits)[QueueTypeCount]) const
+{
+	if (dependency < 0)
+	{
+		return;
+	}
+
+	// Work on the same queue is ordered by submission already.
+	EQueueType queue = mPasses[dependency].mQueue;
+	if (queue == mPasses[pass].mQueue)
+	{
+		return;
+	}
+
+	int32_t& wait = waits[static_cast<uint32_t>(queue)];
+	wait = std::max(wait, static_cast<int32_t>(mPassBatch[dependency]));
+}
+
+void CPassSchedule::Compile()
+{
+	mBatches.clear();
+	mPassBatch.assign(mPasses.size(), 0);
+	std::fill(mJoinBatch, mJoinBatch + QueueTypeCount, -1);
+	mWaitCount = 0;
+
+	// Number this frame's resources. Sorting reuses the vectors' storage, where a map keyed by
+	// resource would allocate for each new one and keep the ones that have gone.
+	std::less<const void*> less;
+	mResourceKeys.clear();
+	for (const FAccess& access : mAccesses)
+	{
+		mResourceKeys.push_back(access.mResource);
+	}
+	std::sort(mResourceKeys.begin(), mResourceKeys.end(), less);
+	mResourceKeys.erase(std::unique(mResourceKeys.begin(), mResourceKeys.end()), mResourceKeys.end());
+	for (FAccess& access : mAccesses)
+	{
+		access.mResourceIndex = static_cast<uint32_t>(
+			std::lower_bound(mResourceKeys.begin(), mResourceKeys.end(), access.mResource, less) - mResourceKeys.begin());
+	}
+
+	const FResourceState initialState = { -1, -1 };
+	mResources.assign(mResourceKeys.size(), initialState);
+	mReaders.clear();
+
+	// waited[q][o]: latest batch on queue o that queue q has already waited for.
+	int32_t waited[QueueTypeCount][QueueTypeCount];
+	std::fill(&waited[0][0], &waited[0][0] + QueueTypeCount * QueueTypeCount, -1);
+
+	for (uint32_t p = 0; p < mPasses.size(); ++p)
+	{
+		const FPass& pass = mPasses[p];
+		const uint32_t queue = static_cast<uint32_t>(pass.mQueue);
+		const FAccess* accesses = mAccesses.data() + pass.mFirstAccess;
+
+		// Read after write, write after write and write after read.
+		int32_t waits[QueueTypeCount];
+		std::fill(waits, waits + QueueTypeCount, -1);
+		for (uint32_t a = 0; a < pass.mAccessCount; ++a)
+		{
+			const FResourceState& state = mResources[accesses[a].mResourceIndex];
+			AddDependency(p, state.mLastWriter, waits);
+			if (accesses[a].mWrite)
+			{
+				for (int32_t reader = state.mFirstReader; reader >= 0; reader = mReaders[reader].mNext)
+				{
+					AddDependency(p, static_cast<int32_t>(mReaders[reader].mPass), waits);
+				}
+			}
+		}
+
+		bool needsWait = false;
+		for (uint32_t q = 0; q < QueueTypeCount; ++q)
+		{
+			if (waits[q] <= waited[queue][q])
+			{
+				waits[q] = -1;
+			}
+			needsWait |= waits[q] >= 0;
+		}
+
+		if (mBatches.empty() || mBatches.back().mQueue != pass.mQueue || needsWait)
+		{
+			FBatch batch;
+			batch.mQueue = pass.mQueue;
+			batch.mFirstPass = p;
+			batch.mPassCount = 0;
+			std::fill(batch.mWaitBatch, batch.mWaitBatch + QueueTypeCount, -1);
+			batch.mSignal = false;
+			mBatches.push_back(batch);
+		}
+
+		FBatch& batch = mBatches.back();
+		for (uint32_t q = 0; q < QueueTypeCount; ++q)
+		{
+			if (waits[q] >= 0)
+			{
+				batch.mWaitBatch[q] = waits[q];
+				waited[queue][q] = waits[q];
+				mBatches[waits[q]].mSignal = true;
+				++mWaitCount;
+			}
+		}
+		++batch.mPassCount;
+		mPassBatch[p] = static_cast<uint32_t>(mBatches.size() - 1);
+
+		// A resource both read and written by the pass counts as written.
+		for (uint32_t a = 0; a < pass.mAccessCount; ++a)
+		{
+			FResourceState& state = mResources[accesses[a].mResourceIndex];
+			if (accesses[a].mWrite)
+			{
+				state.mLastWriter = static_cast<int32_t>(p);
+				state.mFirstReader = -1;
+			}
+		}
+		for (uint32_t a = 0; a < pass.mAccessCount; ++a)
+		{
+			FResourceState& state = mResources[accesses[a].mResourceIndex];
+			if (!accesses[a].mWrite && state.mLastWriter != static_cast<int32_t>(p))
+			{
+				FReader reader = { p, state.mFirstReader };
+				state.mFirstReader = static_cast<int32_t>(mReaders.size());
+				mReaders.push_back(reader);
+			}
+		}
+	}
+
+	// Join everything into the graphics queue so one fence there retires the frame.
+	const uint32_t graphics = static_cast<uint32_t>(EQueueType::Graphics);
+	for (uint32_t q = 0; q < QueueTypeCount; ++q)
+	{
+		if (q == graphics)
+		{
+			continue;
+		}
+
+		int32_t last = -1;
+		for (uint32_t b = 0; b < mBatches.size(); ++b)
+		{
+			if (static_cast<uint32_t>(mBatches[b].mQueue) == q)
+			{
+				last = static_cast<int32_t>(b);
+			}
+		}
+
+		if (last > waited[graphics][q])
+		{
+			mJoinBatch[q] = last;
+			mBatches[last].mSignal = true;
+			++mWaitCount;
+		}
+	}
+
+	mCompiled = true;
+}
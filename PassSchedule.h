@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "FrameArena.h"
+
+enum class EQueueType : uint8_t
+{
+	Graphics,
+	Compute,
+};
+
+const uint32_t QueueTypeCount = 2;
+
+// One frame's passes, each bound to a queue, and the cross-queue fence waits needed to run
+// them in declaration order without hazards.
+//
+// Passes declare the resources they read and write (opaque keys). Compile() groups passes
+// into batches of consecutive work on the same queue; a batch that touches something an
+// earlier batch on another queue wrote (or reads something it is about to overwrite) GPU-waits
+// on that batch's fence value first. Work on the same queue is already ordered. A new batch is
+// started whenever a pass needs a wait the current batch does not have, so earlier passes are
+// never held back by a later pass's dependency.
+//
+// At the end of the frame the graphics queue waits on whatever other queues did, so a single
+// fence signalled on the graphics queue covers the whole frame.
+//
+// Pass functions are copied into the calling thread's frame arena rather than the heap, so a
+// schedule rebuilt every frame allocates nothing once its vectors have grown. Reset it before
+// BeginFrameArenas. Resource state only lives for a Compile, so the schedule keeps nothing
+// about resources from one frame to the next.
+//
+// Execution is driven through TBackend:
+//     uint64_t Signal(EQueueType queue);                                  // returns the value
+//     void Wait(EQueueType queue, EQueueType onQueue, uint64_t value);    // GPU-side wait
+class CPassSchedule
+{
+public:
+	struct FBatch
+	{
+		EQueueType mQueue;
+		uint32_t mFirstPass;
+		uint32_t mPassCount;
+		int32_t mWaitBatch[QueueTypeCount];   // Batch to wait on per queue, -1 for none.
+		bool mSignal;                         // Someone waits on this batch.
+	};
+
+private:
+	struct FAccess
+	{
+		const void* mResource;
+		uint32_t mResourceIndex;              // Into mResourceKeys, set by Compile.
+		bool mWrite;
+	};
+
+	struct FPass
+	{
+		const char* mName;
+		EQueueType mQueue;
+		uint32_t mFirstAccess;
+		uint32_t mAccessCount;
+		void* mFunction;                      // In the frame arena.
+		void (*mInvoke)(void* function);
+		void (*mDestroy)(void* function);
+	};
+
+	template<typename TFunction>
+	static void InvokeFunction(void* function)  { (*static_cast<TFunction*>(function))(); }
+	template<typename TFunction>
+	static void DestroyFunction(void* function) { static_cast<TFunction*>(function)->~TFunction(); }
+
+	struct FResourceState
+	{
+		int32_t mLastWriter;
+		int32_t mFirstReader;                 // Into mReaders; passes that read since the last write.
+	};
+
+	struct FReader
+	{
+		uint32_t mPass;
+		int32_t mNext;
+	};
+
+	std::vector<FPass> mPasses;
+	std::vector<FAccess> mAccesses;
+	std::vector<FBatch> mBatches;
+	std::vector<uint32_t> mPassBatch;         // Pass index -> batch index.
+	// Rebuilt by Compile from this frame's accesses: the distinct resources, sorted, and the
+	// state of each.
+	std::vector<const void*> mResourceKeys;
+	std::vector<FResourceState> mResources;
+	std::vector<FReader> mReaders;
+
+	int32_t mJoinBatch[QueueTypeCount];       // Last batch per queue the graphics queue still has to wait on.
+	std::vector<uint64_t> mSignalValues;      // Per batch, filled in by Execute.
+	uint32_t mWaitCount;
+	bool mCompiled;
+
+	void AddDependency(uint32_t pass, int32_t dependency, int32_t (&waits)[QueueTypeCount]) const;
+	uint32_t AddPass(const char* name, EQueueType queue,
+		std::initializer_list<const void*> reads, std::initializer_list<const void*> writes,
+		void* function, void (*invoke)(void*), void (*destroy)(void*));
+	void DestroyFunctions();
+
+public:
+	CPassSchedule();
+	~CPassSchedule();
+
+	CPassSchedule(const CPassSchedule&) = delete;
+	CPassSchedule& operator=(const CPassSchedule&) = delete;
+
+	// Drops every pass but keeps the storage, for rebuilding the schedule each frame.
+	void Reset();
+
+	// function records and submits the pass's work to its queue; it is called as function().
+	template<typename TFunction>
+	uint32_t AddPass(const char* name, EQueueType queue,
+		std::initializer_list<const void*> reads, std::initializer_list<const void*> writes,
+		TFunction&& function)
+	{
+		typedef typename std::decay<TFunction>::type FFunction;
+		void* storage = GetFrameArena().Allocate(sizeof(FFunction), alignof(FFunction));
+		FFunction* copy = new (storage) FFunction(std::forward<TFunction>(function));
+		return AddPass(name, queue, reads, writes, copy, &InvokeFunction<FFunction>, &DestroyFunction<FFunction>);
+	}
+
+	void Compile();
+
+	template<typename TBackend>
+	void Execute(TBackend& backend)
+	{
+		if (!mCompiled)
+		{
+			Compile();
+		}
+
+		mSignalValues.assign(mBatches.size(), 0);
+		for (uint32_t b = 0; b < mBatches.size(); ++b)
+		{
+			const FBatch& batch = mBatches[b];
+			for (uint32_t q = 0; q < QueueTypeCount; ++q)
+			{
+				if (batch.mWaitBatch[q] >= 0)
+				{
+					backend.Wait(batch.mQueue, static_cast<EQueueType>(q), mSignalValues[batch.mWaitBatch[q]]);
+				}
+			}
+
+			for (uint32_t p = batch.mFirstPass; p < batch.mFirstPass + batch.mPassCount; ++p)
+			{
+				mPasses[p].mInvoke(mPasses[p].mFunction);
+			}
+
+			if (batch.mSignal)
+			{
+				mSignalValues[b] = backend.Signal(batch.mQueue);
+			}
+		}
+
+		for (uint32_t q = 0; q < QueueTypeCount; ++q)
+		{
+			if (mJoinBatch[q] >= 0)
+			{
+				backend.Wait(EQueueType::Graphics, static_cast<EQueueType>(q), mSignalValues[mJoinBatch[q]]);
+			}
+		}
+	}
+
+	uint32_t GetPassCount() const                 { return static_cast<uint32_t>(mPasses.size()); }
+	const char* GetPassName(uint32_t pass) const  { return mPasses[pass].mName; }
+	const std::vector<FBatch>& GetBatches() const { return mBatches; }
+	uint32_t GetBatchOfPass(uint32_t pass) const  { return mPassBatch[pass]; }
+	int32_t GetJoinBatch(EQueueType queue) const  { return mJoinBatch[static_cast<uint32_t>(queue)]; }
+
+	// Cross-queue waits per frame, including the end-of-frame join.
+	uint32_t GetWaitCount() const                 { return mWaitCount; }
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "TripleBuffer.h"
+
+struct FPipelinedFrameLoopStats
+{
+	uint64_t mSteps = 0;
+	// Time each side spent blocked on the other.
+	int64_t mSimulationWaitNs = 0;
+	int64_t mRenderWaitNs = 0;
+};
+
+// Runs the simulation on a thread of its own, pipelined with rendering: while the render
+// thread records frame N from an immutable snapshot, the simulation thread steps frame N+1.
+//
+// The simulation thread steps a private copy of the state and publishes a snapshot of every
+// step through a CTripleBuffer. It runs at most one step ahead of what the renderer has picked
+// up, and the renderer waits for each step, so every step is rendered exactly once, in order,
+// just as in the serial loop; only the overlap differs. Waits spin briefly, then sleep.
+//
+// TState is copied once per step and should be a plain value type.
+template<typename TState>
+class CPipelinedFrameLoop
+{
+public:
+	// Advances state by one step; deltaNs is the wall time since the previous step.
+	typedef std::function<void(TState& state, int64_t deltaNs)> StepFunction;
+
+private:
+	static const uint32_t SpinsBeforeSleep = 64;
+
+	CTripleBuffer<TState> mBuffer;
+	TState mState;
+	StepFunction mStep;
+
+	std::thread mThread;
+	std::atomic<bool> mExit;
+	std::exception_ptr mError;
+
+	// Only for sleeping; the handoff itself does not lock.
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+	std::atomic<uint32_t> mSleepers;
+
+	FPipelinedFrameLoopStats mStats;
+	std::atomic<int64_t> mSimulationWaitNs;
+
+	static int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Blocks until done() or Stop; returns false on Stop.
+	template<typename TDone>
+	bool WaitUntil(const TDone& done)
+	{
+		for (uint32_t spins = 0; spins < SpinsBeforeSleep; ++spins)
+		{
+			if (done())
+			{
+				return true;
+			}
+			if (mExit.load())
+			{
+				return false;
+			}
+			std::this_thread::yield();
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		++mSleepers;
+		while (!done() && !mExit.load())
+		{
+			mWake.wait(lock);
+		}
+		--mSleepers;
+		return done();
+	}
+
+	void WakeOther()
+	{
+		if (mSleepers.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mWake.notify_all();
+		}
+	}
+
+	void SimulationMain()
+	{
+		try
+		{
+			int64_t lastNs = NowNs();
+			for (;;)
+			{
+				int64_t nowNs = NowNs();
+				mStep(mState, nowNs - lastNs);
+				lastNs = nowNs;
+				mBuffer.GetWriteSlot() = mState;
+
+				// Stay one step ahead: the previous step must have been picked up first.
+				int64_t waitStart = NowNs();
+				if (!WaitUntil([this]() { return !mBuffer.HasFresh(); }))
+				{
+					break;
+				}
+				mSimulationWaitNs.fetch_add(NowNs() - waitStart, std::memory_order_relaxed);
+
+				mBuffer.Publish();
+				WakeOther();
+			}
+		}
+		catch (...)
+		{
+			mError = std::current_exception();
+			mExit.store(true);
+			WakeOther();
+		}
+	}
+
+public:
+	CPipelinedFrameLoop() :
+		mExit(false),
+		mSleepers(0),
+		mSimulationWaitNs(0)
+	{
+	}
+
+	~CPipelinedFrameLoop()
+	{
+		Stop();
+	}
+
+	CPipelinedFrameLoop(const CPipelinedFrameLoop&) = delete;
+	CPipelinedFrameLoop& operator=(const CPipelinedFrameLoop&) = delete;
+
+	// Starts stepping from initial on the simulation thread.
+	void Start(const TState& initial, StepFunction step)
+	{
+		Stop();
+		mState = initial;
+		mStep = std::move(step);
+		mError = nullptr;
+		mExit.store(false);
+		mThread = std::thread(&CPipelinedFrameLoop::SimulationMain, this);
+	}
+
+	// Render thread: blocks until the next step is published and returns its snapshot, which
+	// stays valid and unchanged until the next call. Rethrows what the step function threw.
+	const TState& AcquireNext()
+	{
+		int64_t waitStart = NowNs();
+		if (!WaitUntil([this]() { return mBuffer.HasFresh(); }))
+		{
+			if (mError)
+			{
+				std::rethrow_exception(mError);
+			}
+			throw std::logic_error("AcquireNext called on a stopped frame loop.");
+		}
+		mStats.mRenderWaitNs += NowNs() - waitStart;
+
+		mBuffer.Acquire();
+		WakeOther();
+		++mStats.mSteps;
+		return mBuffer.GetReadSlot();
+	}
+
+	// Stops and joins the simulation thread; the step in progress is dropped.
+	void Stop()
+	{
+		if (!mThread.joinable())
+		{
+			return;
+		}
+		mExit.store(true);
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mWake.notify_all();
+		}
+		mThread.join();
+	}
+
+	bool IsRunning() const { return mThread.joinable(); }
+
+	// Render thread.
+	FPipelinedFrameLoopStats GetStats() const
+	{
+		FPipelinedFrameLoopStats stats = mStats;
+		stats.mSimulationWaitNs = mSimulationWaitNs.load(std::memory_order_relaxed);
+		return stats;
+	}
+};
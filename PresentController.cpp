@@ -0,0 +1,194 @@
+#include "PresentController.h"
+
+#include <algorithm>
+
+const uint32_t CPresentController::MaxWindowFrames;
+
+namespace
+{
+	// Measured periods outside this range are glitches (or a display asleep), not refresh rates.
+	const int64_t MinRefreshPeriodNs = 1000000;
+	const int64_t MaxRefreshPeriodNs = 200000000;
+}
+
+const char* GetPresentModeName(EPresentMode mode)
+{
+	switch (mode)
+	{
+	case EPresentMode::VSync:    return "vsync";
+	case EPresentMode::Tearing:  return "tearing";
+	case EPresentMode::HalfRate: return "half rate";
+	}
+	return "unknown";
+}
+
+CPresentController::CPresentController(const FPresentControllerConfig& config) :
+	mConfig(config),
+	mMode(EPresentMode::VSync),
+	mFramesInMode(0),
+	mDwellFrames(config.mDwellFrames),
+	mUpgraded(false),
+	mWindowCount(0),
+	mWindowMissed(0),
+	mRefreshPeriodNs(config.mDefaultRefreshPeriodNs),
+	mLastStats(),
+	mHasLastStats(false),
+	mSwitchPresentCount(0)
+{
+	mConfig.mWindowFrames = std::min(std::max<uint32_t>(mConfig.mWindowFrames, 1), MaxWindowFrames);
+}
+
+uint32_t CPresentController::GetSyncInterval() const
+{
+	switch (mMode)
+	{
+	case EPresentMode::Tearing:  return 0;
+	case EPresentMode::HalfRate: return 2;
+	default:                     return 1;
+	}
+}
+
+uint32_t CPresentController::CountMissed(const FRenderPresentStats& stats)
+{
+	// Until the presents of the previous mode are on screen, the counts mix both intervals.
+	if (static_cast<int32_t>(stats.mDisplayedPresentCount - mSwitchPresentCount) <= 0)
+	{
+		mHasLastStats = false;
+		return 0;
+	}
+	if (!mHasLastStats)
+	{
+		mLastStats = stats;
+		mHasLastStats = true;
+		return 0;
+	}
+
+	// Counters wrap, so only their differences are used.
+	uint32_t syncRefreshes = stats.mSyncRefreshCount - mLastStats.mSyncRefreshCount;
+	if (syncRefreshes > 0 && stats.mSyncTimeNs > mLastStats.mSyncTimeNs)
+	{
+		int64_t period = (stats.mSyncTimeNs - mLastStats.mSyncTimeNs) / syncRefreshes;
+		if (period >= MinRefreshPeriodNs && period <= MaxRefreshPeriodNs)
+		{
+			mRefreshPeriodNs += (period - mRefreshPeriodNs) / 8;
+		}
+	}
+
+	// Presents displayed since the last sample should have taken interval vblanks each.
+	uint32_t presents = stats.mDisplayedPresentCount - mLastStats.mDisplayedPresentCount;
+	uint32_t refreshes = stats.mPresentRefreshCount - mLastStats.mPresentRefreshCount;
+	uint32_t expected = presents * GetSyncInterval();
+	mLastStats = stats;
+	return presents > 0 && refreshes > expected ? refreshes - expected : 0;
+}
+
+EPresentMode CPresentController::Decide(double ratio) const
+{
+	bool missing = mWindowMissed > mConfig.mMaxMissedPerWindow;
+	bool fitsHalfRate = ratio <= 2.0 * mConfig.mUpgradeHeadroom;
+
+	switch (mMode)
+	{
+	case EPresentMode::VSync:
+		if (missing || ratio > 1.0)
+		{
+			// Tearing shows a frame that just missed its vblank a fraction of a refresh late
+			// rather than a whole one; half rate is smoother once frames need most of two.
+			bool tear = ratio < mConfig.mMaxTearingRatio || !fitsHalfRate;
+			return mConfig.mTearingSupported && tear ? EPresentMode::Tearing : EPresentMode::HalfRate;
+		}
+		break;
+
+	case EPresentMode::Tearing:
+		if (ratio <= mConfig.mUpgradeHeadroom && mFramesInMode >= mDwellFrames)
+		{
+			return EPresentMode::VSync;
+		}
+		if (ratio >= mConfig.mMaxTearingRatio && fitsHalfRate)
+		{
+			return EPresentMode::HalfRate;
+		}
+		break;
+
+	case EPresentMode::HalfRate:
+		if (ratio <= mConfig.mUpgradeHeadroom && mFramesInMode >= mDwellFrames)
+		{
+			return EPresentMode::VSync;
+		}
+		if (missing && mConfig.mTearingSupported)
+		{
+			return EPresentMode::Tearing;
+		}
+		break;
+	}
+	return mMode;
+}
+
+void CPresentController::Switch(EPresentMode mode)
+{
+	if (mMode == EPresentMode::VSync)
+	{
+		// Vsync did not hold for the dwell after the last upgrade: wait longer next time.
+		if (mUpgraded && mFramesInMode < mDwellFrames)
+		{
+			mDwellFrames = std::min(mDwellFrames * 2, mConfig.mMaxDwellFrames);
+		}
+		mUpgraded = false;
+	}
+	else if (mode == EPresentMode::VSync)
+	{
+		mUpgraded = true;
+	}
+
+	mMode = mode;
+	mFramesInMode = 0;
+	++mStats.mModeSwitches;
+
+	mSwitchPresentCount = mLastStats.mPresentCount;
+	mHasLastStats = false;
+}
+
+EPresentMode CPresentController::OnFramePresented(int64_t frameTimeNs, const FRenderPresentStats* stats)
+{
+	uint32_t missed = 0;
+	if (stats)
+	{
+		missed = CountMissed(*stats);
+		mLastStats.mPresentCount = stats->mPresentCount;
+	}
+	else if (mMode != EPresentMode::Tearing && frameTimeNs > mRefreshPeriodNs * GetSyncInterval())
+	{
+		missed = 1;
+	}
+
+	++mStats.mFrames;
+	++mStats.mFramesInMode[static_cast<uint32_t>(mMode)];
+	mStats.mMissedVBlanks += missed;
+	++mFramesInMode;
+
+	// Vsync that has held for the longest dwell has earned the short one back.
+	if (mMode == EPresentMode::VSync && mFramesInMode >= mConfig.mMaxDwellFrames)
+	{
+		mDwellFrames = mConfig.mDwellFrames;
+	}
+
+	mWindow[mWindowCount++] = frameTimeNs;
+	mWindowMissed += missed;
+	if (mWindowCount < mConfig.mWindowFrames)
+	{
+		return mMode;
+	}
+
+	uint32_t p90 = mWindowCount * 9 / 10;
+	std::nth_element(mWindow, mWindow + p90, mWindow + mWindowCount);
+	double ratio = static_cast<double>(mWindow[p90]) / mRefreshPeriodNs;
+
+	EPresentMode next = Decide(ratio);
+	if (next != mMode)
+	{
+		Switch(next);
+	}
+	mWindowCount = 0;
+	mWindowMissed = 0;
+	return mMode;
+}
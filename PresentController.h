@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+#include "RenderDevice.h"
+
+enum class EPresentMode
+{
+	VSync,      // Sync interval 1: no tearing, one frame per refresh.
+	Tearing,    // Sync interval 0: a late frame is shown at once, torn, instead of a refresh later.
+	HalfRate,   // Sync interval 2: an even half refresh rate for frames that do not fit one.
+};
+
+const char* GetPresentModeName(EPresentMode mode);
+
+struct FPresentControllerConfig
+{
+	bool mTearingSupported = false;
+	// Refresh period assumed until the present statistics measure one.
+	int64_t mDefaultRefreshPeriodNs = 16666667;
+	// Frames per decision, at most CPresentController::MaxWindowFrames.
+	uint32_t mWindowFrames = 60;
+	// Frames a slower mode is kept before going back to vsync. Doubles, up to mMaxDwellFrames,
+	// each time vsync has to be left again within the dwell, so a borderline load settles.
+	uint32_t mDwellFrames = 120;
+	uint32_t mMaxDwellFrames = 1920;
+	// Vsync is left when a window misses more vblanks than this...
+	uint32_t mMaxMissedPerWindow = 2;
+	// ...and returned to once the window's p90 frame time fits in this fraction of a refresh.
+	double mUpgradeHeadroom = 0.8;
+	// Frames of up to this many refreshes tear; longer ones run at half rate when they fit it.
+	double mMaxTearingRatio = 1.5;
+};
+
+struct FPresentControllerStats
+{
+	uint64_t mFrames = 0;
+	uint64_t mMissedVBlanks = 0;
+	uint64_t mModeSwitches = 0;
+	uint64_t mFramesInMode[3] = {};
+};
+
+// Picks the sync interval of the next present from how the last ones went. Fed once per frame
+// with the frame's own time (waits excluded) and the swap chain's present statistics, it
+// counts vblanks the presents missed and, once per window of frames, compares the p90 frame
+// time with the measured refresh period:
+//
+//   VSync    -> Tearing   vblanks missed or p90 over a refresh; frames under mMaxTearingRatio
+//                         refreshes (or over two) tear when the swap chain can
+//            -> HalfRate  otherwise
+//   Tearing  -> VSync     p90 within mUpgradeHeadroom of a refresh, after the dwell
+//            -> HalfRate  p90 between mMaxTearingRatio refreshes and the half-rate headroom
+//   HalfRate -> VSync     as from Tearing
+//            -> Tearing   half rate misses vblanks too
+//
+// Without statistics (the null device, or none from the OS yet) a frame longer than its sync
+// interval's refreshes counts as a miss. Pure state, no clock or device: drive it from a
+// renderer or from a recorded or simulated feed.
+class CPresentController
+{
+public:
+	static const uint32_t MaxWindowFrames = 256;
+
+private:
+	FPresentControllerConfig mConfig;
+	EPresentMode mMode;
+	uint64_t mFramesInMode;
+	uint32_t mDwellFrames;
+	// Whether vsync was last entered from a slower mode, for the backoff.
+	bool mUpgraded;
+
+	int64_t mWindow[MaxWindowFrames];
+	uint32_t mWindowCount;
+	uint32_t mWindowMissed;
+
+	int64_t mRefreshPeriodNs;
+	FRenderPresentStats mLastStats;
+	bool mHasLastStats;
+	// Presents up to this one went out with the previous sync interval.
+	uint32_t mSwitchPresentCount;
+
+	FPresentControllerStats mStats;
+
+	uint32_t CountMissed(const FRenderPresentStats& stats);
+	EPresentMode Decide(double ratio) const;
+	void Switch(EPresentMode mode);
+
+public:
+	explicit CPresentController(const FPresentControllerConfig& config = FPresentControllerConfig());
+
+	// Call after each Present. frameTimeNs is the CPU time the frame took, waits excluded;
+	// stats is nullptr when the swap chain had none. Returns the mode for the next frame.
+	EPresentMode OnFramePresented(int64_t frameTimeNs, const FRenderPresentStats* stats);
+
+	EPresentMode GetMode() const                    { return mMode; }
+	uint32_t GetSyncInterval() const;
+	int64_t GetRefreshPeriodNs() const              { return mRefreshPeriodNs; }
+	uint32_t GetDwellFrames() const                 { return mDwellFrames; }
+	const FPresentControllerStats& GetStats() const { return mStats; }
+};
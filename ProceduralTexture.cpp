@@ -0,0 +1,594 @@
+#include "ProceduralTexture.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROCEDURAL_TEXTURE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define PROCEDURAL_TEXTURE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Rows below this many texels are not worth a job each.
+	const uint32_t ParallelTexelsPerChunk = 64 * 1024;
+
+	// Everything the row kernels need, derived once from the desc.
+	struct FRowSetup
+	{
+		const FProceduralTextureDesc* mDesc;
+		bool mFloat;
+		// RGBA8: both colours as texels, and the lerp as colour0 * 255 + (colour1 - colour0) * 255 * t.
+		uint32_t mTexel0;
+		uint32_t mTexel1;
+		float mScaled0[4];
+		float mScaledDelta[4];
+		// RGBA32Float: colour0 + (colour1 - colour0) * t.
+		float mDelta[4];
+	};
+
+	uint8_t ToUnorm8(float value)
+	{
+		value = value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+		// Round half to even, as _mm_cvtps_epi32 does in the default rounding mode.
+		return static_cast<uint8_t>(std::nearbyint(value));
+	}
+
+	uint32_t PackTexel(const float color[4])
+	{
+		uint32_t texel = 0;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			texel |= static_cast<uint32_t>(ToUnorm8(color[c] * 255.0f)) << (c * 8);
+		}
+		return texel;
+	}
+
+	FRowSetup MakeRowSetup(const FProceduralTextureDesc& desc)
+	{
+		FRowSetup setup;
+		setup.mDesc = &desc;
+		setup.mFloat = desc.mFormat == ERenderFormat::RGBA32Float;
+		setup.mTexel0 = PackTexel(desc.mColor0);
+		setup.mTexel1 = PackTexel(desc.mColor1);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			setup.mDelta[c] = desc.mColor1[c] - desc.mColor0[c];
+			setup.mScaled0[c] = desc.mColor0[c] * 255.0f;
+			setup.mScaledDelta[c] = setup.mDelta[c] * 255.0f;
+		}
+		return setup;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Interpolants. Computed the same way for both kernel sets, so they cannot diverge.
+
+	const uint32_t HashX = 0x8da6b343u;
+	const uint32_t HashY = 0xd8163841u;
+	const uint32_t HashSeed = 0xcb1ab31fu;
+	const uint32_t HashMix = 0x85ebca6bu;
+
+	uint32_t Hash(int32_t x, int32_t y, uint32_t seed)
+	{
+		uint32_t h = static_cast<uint32_t>(x) * HashX ^ static_cast<uint32_t>(y) * HashY ^ seed * HashSeed;
+		h ^= h >> 13;
+		h *= HashMix;
+		h ^= h >> 16;
+		return h;
+	}
+
+	// std::floor is a library call without SSE4.1.
+	int32_t FloorToInt(float value)
+	{
+		int32_t truncated = static_cast<int32_t>(value);
+		return truncated - (static_cast<float>(truncated) > value ? 1 : 0);
+	}
+
+	float ValueNoise(float x, float y, uint32_t seed)
+	{
+		int32_t ix = FloorToInt(x);
+		int32_t iy = FloorToInt(y);
+		float tx = x - static_cast<float>(ix);
+		float ty = y - static_cast<float>(iy);
+		float u = tx * tx * (3.0f - 2.0f * tx);
+		float v = ty * ty * (3.0f - 2.0f * ty);
+
+		const float scale = 1.0f / 16777216.0f;
+		float v00 = (Hash(ix, iy, seed) >> 8) * scale;
+		float v10 = (Hash(ix + 1, iy, seed) >> 8) * scale;
+		float v01 = (Hash(ix, iy + 1, seed) >> 8) * scale;
+		float v11 = (Hash(ix + 1, iy + 1, seed) >> 8) * scale;
+
+		float top = v00 + (v10 - v00) * u;
+		float bottom = v01 + (v11 - v01) * u;
+		return top + (bottom - top) * v;
+	}
+
+	float Gradient(uint32_t hash, float x, float y)
+	{
+		switch (hash & 7)
+		{
+		case 0:  return x + y;
+		case 1:  return -x + y;
+		case 2:  return x - y;
+		case 3:  return -x - y;
+		case 4:  return x;
+		case 5:  return -x;
+		case 6:  return y;
+		default: return -y;
+		}
+	}
+
+	// In [0, 1].
+	float PerlinNoise(float x, float y, uint32_t seed)
+	{
+		int32_t ix = FloorToInt(x);
+		int32_t iy = FloorToInt(y);
+		float tx = x - static_cast<float>(ix);
+		float ty = y - static_cast<float>(iy);
+		float u = tx * tx * tx * (tx * (tx * 6.0f - 15.0f) + 10.0f);
+		float v = ty * ty * ty * (ty * (ty * 6.0f - 15.0f) + 10.0f);
+
+		float n00 = Gradient(Hash(ix, iy, seed), tx, ty);
+		float n10 = Gradient(Hash(ix + 1, iy, seed), tx - 1.0f, ty);
+		float n01 = Gradient(Hash(ix, iy + 1, seed), tx, ty - 1.0f);
+		float n11 = Gradient(Hash(ix + 1, iy + 1, seed), tx - 1.0f, ty - 1.0f);
+
+		float top = n00 + (n10 - n00) * u;
+		float bottom = n01 + (n11 - n01) * u;
+		float n = 0.5f + 0.5f * (top + (bottom - top) * v);
+		return n < 0.0f ? 0.0f : (n > 1.0f ? 1.0f : n);
+	}
+
+	float GetNoiseBaseFrequency(const FProceduralTextureDesc& desc)
+	{
+		return 1.0f / static_cast<float>(desc.mCellSize ? desc.mCellSize : 1);
+	}
+
+	uint32_t GetNoiseOctaves(const FProceduralTextureDesc& desc)
+	{
+		return desc.mOctaves ? desc.mOctaves : 1;
+	}
+
+	void ComputeNoiseRowScalar(const FProceduralTextureDesc& desc, uint32_t y, float* t, uint32_t begin, uint32_t end)
+	{
+		bool perlin = desc.mPattern == EProceduralPattern::PerlinNoise;
+		uint32_t octaves = GetNoiseOctaves(desc);
+		float baseFrequency = GetNoiseBaseFrequency(desc);
+		float py = static_cast<float>(y) + 0.5f;
+
+		for (uint32_t x = begin; x < end; ++x)
+		{
+			float px = static_cast<float>(x) + 0.5f;
+			float frequency = baseFrequency;
+			float amplitude = 1.0f;
+			float sum = 0.0f;
+			float total = 0.0f;
+			for (uint32_t octave = 0; octave < octaves; ++octave)
+			{
+				uint32_t seed = desc.mSeed + octave;
+				float n = perlin ? PerlinNoise(px * frequency, py * frequency, seed) : ValueNoise(px * frequency, py * frequency, seed);
+				sum += n * amplitude;
+				total += amplitude;
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+			t[x] = sum / total;
+		}
+	}
+
+	void ComputeHorizontalRow(const FProceduralTextureDesc& desc, float* t)
+	{
+		float scale = desc.mWidth > 1 ? 1.0f / static_cast<float>(desc.mWidth - 1) : 0.0f;
+		for (uint32_t x = 0; x < desc.mWidth; ++x)
+		{
+			t[x] = static_cast<float>(x) * scale;
+		}
+	}
+
+	void ComputeRadialRow(const FProceduralTextureDesc& desc, uint32_t y, float* t)
+	{
+		float centerX = static_cast<float>(desc.mWidth) * 0.5f;
+		float centerY = static_cast<float>(desc.mHeight) * 0.5f;
+		float radius = centerX < centerY ? centerX : centerY;
+		float dy = static_cast<float>(y) + 0.5f - centerY;
+		for (uint32_t x = 0; x < desc.mWidth; ++x)
+		{
+			float dx = static_cast<float>(x) + 0.5f - centerX;
+			float distance = std::sqrt(dx * dx + dy * dy) / radius;
+			t[x] = distance < 1.0f ? distance : 1.0f;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Scalar kernels.
+
+	void FillScalar(const FRowSetup& setup, uint8_t* row, uint32_t begin, uint32_t end, bool second)
+	{
+		if (setup.mFloat)
+		{
+			const float* color = second ? setup.mDesc->mColor1 : setup.mDesc->mColor0;
+			float* texels = reinterpret_cast<float*>(row);
+			for (uint32_t x = begin; x < end; ++x)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					texels[x * 4 + c] = color[c];
+				}
+			}
+			return;
+		}
+
+		uint32_t texel = second ? setup.mTexel1 : setup.mTexel0;
+		for (uint32_t x = begin; x < end; ++x)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				row[x * 4 + c] = static_cast<uint8_t>(texel >> (c * 8));
+			}
+		}
+	}
+
+	void LerpScalar(const FRowSetup& setup, uint8_t* row, const float* t, uint32_t begin, uint32_t end)
+	{
+		if (setup.mFloat)
+		{
+			const float* color = setup.mDesc->mColor0;
+			float* texels = reinterpret_cast<float*>(row);
+			for (uint32_t x = begin; x < end; ++x)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					texels[x * 4 + c] = color[c] + setup.mDelta[c] * t[x];
+				}
+			}
+			return;
+		}
+
+		for (uint32_t x = begin; x < end; ++x)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				row[x * 4 + c] = ToUnorm8(setup.mScaled0[c] + setup.mScaledDelta[c] * t[x]);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SIMD kernels; each finishes the tail of its span with the scalar one.
+
+	void FillSimd(const FRowSetup& setup, uint8_t* row, uint32_t begin, uint32_t end, bool second)
+	{
+		uint32_t x = begin;
+		if (setup.mFloat)
+		{
+			const float* color = second ? setup.mDesc->mColor1 : setup.mDesc->mColor0;
+			float* texels = reinterpret_cast<float*>(row);
+#if PROCEDURAL_TEXTURE_AVX2
+			__m256 pair = _mm256_setr_ps(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+			for (; x + 2 <= end; x += 2)
+			{
+				_mm256_storeu_ps(texels + x * 4, pair);
+			}
+#elif PROCEDURAL_TEXTURE_SSE2
+			__m128 value = _mm_loadu_ps(color);
+			for (; x < end; ++x)
+			{
+				_mm_storeu_ps(texels + x * 4, value);
+			}
+#endif
+		}
+		else
+		{
+			uint32_t texel = second ? setup.mTexel1 : setup.mTexel0;
+#if PROCEDURAL_TEXTURE_AVX2
+			__m256i value = _mm256_set1_epi32(static_cast<int>(texel));
+			for (; x + 8 <= end; x += 8)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x * 4), value);
+			}
+#endif
+#if PROCEDURAL_TEXTURE_SSE2
+			__m128i value4 = _mm_set1_epi32(static_cast<int>(texel));
+			for (; x + 4 <= end; x += 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), value4);
+			}
+#endif
+		}
+		FillScalar(setup, row, x, end, second);
+	}
+
+#if PROCEDURAL_TEXTURE_SSE2
+	// 32-bit multiply, low half; _mm_mullo_epi32 needs SSE4.1.
+	__m128i MulLo32(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	// Hash's final mix, on the XOR of its x, y and seed terms.
+	__m128i MixHash(__m128i h)
+	{
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+		h = MulLo32(h, _mm_set1_epi32(static_cast<int>(HashMix)));
+		return _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+	}
+
+	__m128i FloorToInt(__m128 value)
+	{
+		__m128i truncated = _mm_cvttps_epi32(value);
+		// The mask is -1 where truncation rounded up.
+		return _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value)));
+	}
+
+	// Gradient, with the switch as sign flips: for hash & 7 under 4, +-x +-y; above, +-x or +-y.
+	__m128 Gradient(__m128i hash, __m128 x, __m128 y)
+	{
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i two = _mm_set1_epi32(2);
+		__m128 negateX = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(hash, one), 31));
+		__m128 negateY = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(hash, two), 30));
+		__m128 sum = _mm_add_ps(_mm_xor_ps(x, negateX), _mm_xor_ps(y, negateY));
+
+		__m128 useY = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(hash, two), two));
+		__m128 single = _mm_xor_ps(_mm_or_ps(_mm_and_ps(useY, y), _mm_andnot_ps(useY, x)), negateX);
+
+		__m128 isSingle = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(hash, _mm_set1_epi32(4)), _mm_set1_epi32(4)));
+		return _mm_or_ps(_mm_and_ps(isSingle, single), _mm_andnot_ps(isSingle, sum));
+	}
+
+	// ComputeNoiseRowScalar four texels at a time, each step as the scalar code does it so the
+	// results match bit for bit. y is the same for the whole row, so its lattice row, fade and
+	// hash terms are worked out once per octave in scalar code.
+	void ComputeNoiseRowSimd(const FProceduralTextureDesc& desc, uint32_t y, float* t)
+	{
+		const bool perlin = desc.mPattern == EProceduralPattern::PerlinNoise;
+		const uint32_t octaves = GetNoiseOctaves(desc);
+		const float baseFrequency = GetNoiseBaseFrequency(desc);
+		const float py = static_cast<float>(y) + 0.5f;
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 three = _mm_set1_ps(3.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 six = _mm_set1_ps(6.0f);
+		const __m128 fifteen = _mm_set1_ps(15.0f);
+		const __m128 ten = _mm_set1_ps(10.0f);
+		const __m128 valueScale = _mm_set1_ps(1.0f / 16777216.0f);
+		const __m128i hashX = _mm_set1_epi32(static_cast<int>(HashX));
+
+		uint32_t x = 0;
+		for (; x + 4 <= desc.mWidth; x += 4)
+		{
+			const __m128 px = _mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3)), half);
+			float frequency = baseFrequency;
+			float amplitude = 1.0f;
+			__m128 sum = zero;
+			float total = 0.0f;
+			for (uint32_t octave = 0; octave < octaves; ++octave)
+			{
+				const uint32_t seed = desc.mSeed + octave;
+				const float fy = py * frequency;
+				const int32_t iy = ::FloorToInt(fy);
+				const float ty = fy - static_cast<float>(iy);
+				const uint32_t seedTerm = seed * HashSeed;
+				const __m128i row0 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(iy) * HashY ^ seedTerm));
+				const __m128i row1 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(iy + 1) * HashY ^ seedTerm));
+
+				const __m128 fx = _mm_mul_ps(px, _mm_set1_ps(frequency));
+				const __m128i ix = FloorToInt(fx);
+				const __m128 tx = _mm_sub_ps(fx, _mm_cvtepi32_ps(ix));
+				const __m128i column0 = MulLo32(ix, hashX);
+				const __m128i column1 = _mm_add_epi32(column0, hashX);
+				const __m128i h00 = MixHash(_mm_xor_si128(column0, row0));
+				const __m128i h10 = MixHash(_mm_xor_si128(column1, row0));
+				const __m128i h01 = MixHash(_mm_xor_si128(column0, row1));
+				const __m128i h11 = MixHash(_mm_xor_si128(column1, row1));
+
+				__m128 n;
+				if (perlin)
+				{
+					const float v = ty * ty * ty * (ty * (ty * 6.0f - 15.0f) + 10.0f);
+					const __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(tx, tx), tx),
+						_mm_add_ps(_mm_mul_ps(tx, _mm_sub_ps(_mm_mul_ps(tx, six), fifteen)), ten));
+					const __m128 tx1 = _mm_sub_ps(tx, one);
+					const __m128 ty0 = _mm_set1_ps(ty);
+					const __m128 ty1 = _mm_set1_ps(ty - 1.0f);
+					const __m128 n00 = Gradient(h00, tx, ty0);
+					const __m128 n10 = Gradient(h10, tx1, ty0);
+					const __m128 n01 = Gradient(h01, tx, ty1);
+					const __m128 n11 = Gradient(h11, tx1, ty1);
+					const __m128 top = _mm_add_ps(n00, _mm_mul_ps(_mm_sub_ps(n10, n00), u));
+					const __m128 bottom = _mm_add_ps(n01, _mm_mul_ps(_mm_sub_ps(n11, n01), u));
+					n = _mm_add_ps(half, _mm_mul_ps(half, _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(v)))));
+					// n < 0 ? 0 : (n > 1 ? 1 : n), operand order included.
+					n = _mm_min_ps(one, _mm_max_ps(zero, n));
+				}
+				else
+				{
+					const float v = ty * ty * (3.0f - 2.0f * ty);
+					const __m128 u = _mm_mul_ps(_mm_mul_ps(tx, tx), _mm_sub_ps(three, _mm_mul_ps(two, tx)));
+					const __m128 v00 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h00, 8)), valueScale);
+					const __m128 v10 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h10, 8)), valueScale);
+					const __m128 v01 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h01, 8)), valueScale);
+					const __m128 v11 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h11, 8)), valueScale);
+					const __m128 top = _mm_add_ps(v00, _mm_mul_ps(_mm_sub_ps(v10, v00), u));
+					const __m128 bottom = _mm_add_ps(v01, _mm_mul_ps(_mm_sub_ps(v11, v01), u));
+					n = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(v)));
+				}
+
+				sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+				total += amplitude;
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+			_mm_storeu_ps(t + x, _mm_div_ps(sum, _mm_set1_ps(total)));
+		}
+		ComputeNoiseRowScalar(desc, y, t, x, desc.mWidth);
+	}
+#endif
+
+	void LerpSimd(const FRowSetup& setup, uint8_t* row, const float* t, uint32_t begin, uint32_t end)
+	{
+		uint32_t x = begin;
+#if PROCEDURAL_TEXTURE_SSE2
+		if (setup.mFloat)
+		{
+			__m128 color0 = _mm_loadu_ps(setup.mDesc->mColor0);
+			__m128 delta = _mm_loadu_ps(setup.mDelta);
+			float* texels = reinterpret_cast<float*>(row);
+			for (; x < end; ++x)
+			{
+				_mm_storeu_ps(texels + x * 4, _mm_add_ps(color0, _mm_mul_ps(delta, _mm_set1_ps(t[x]))));
+			}
+		}
+		else
+		{
+			__m128 scaled0 = _mm_loadu_ps(setup.mScaled0);
+			__m128 scaledDelta = _mm_loadu_ps(setup.mScaledDelta);
+			__m128 zero = _mm_setzero_ps();
+			__m128 maximum = _mm_set1_ps(255.0f);
+			for (; x + 4 <= end; x += 4)
+			{
+				__m128i texel[4];
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					__m128 value = _mm_add_ps(scaled0, _mm_mul_ps(scaledDelta, _mm_set1_ps(t[x + i])));
+					texel[i] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(value, zero), maximum));
+				}
+				__m128i packed = _mm_packus_epi16(_mm_packs_epi32(texel[0], texel[1]), _mm_packs_epi32(texel[2], texel[3]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), packed);
+			}
+		}
+#endif
+		LerpScalar(setup, row, t, x, end);
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	void GenerateRows(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+		uint32_t rowBegin, uint32_t rowEnd, bool simd)
+	{
+		FRowSetup setup = MakeRowSetup(desc);
+		auto fill = simd ? &FillSimd : &FillScalar;
+		auto lerp = simd ? &LerpSimd : &LerpScalar;
+
+		std::vector<float> t;
+		if (desc.mPattern != EProceduralPattern::Solid && desc.mPattern != EProceduralPattern::Checker)
+		{
+			t.resize(desc.mWidth);
+		}
+		if (desc.mPattern == EProceduralPattern::HorizontalGradient)
+		{
+			ComputeHorizontalRow(desc, t.data());
+		}
+		float verticalScale = desc.mHeight > 1 ? 1.0f / static_cast<float>(desc.mHeight - 1) : 0.0f;
+		uint32_t cellSize = desc.mCellSize ? desc.mCellSize : 1;
+
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			uint8_t* row = dst + static_cast<size_t>(y) * rowPitch;
+			switch (desc.mPattern)
+			{
+			case EProceduralPattern::Solid:
+				fill(setup, row, 0, desc.mWidth, false);
+				break;
+
+			case EProceduralPattern::Checker:
+			{
+				// Whole cells are spans of one colour.
+				bool oddRow = (y / cellSize) % 2 != 0;
+				for (uint32_t x = 0; x < desc.mWidth; x += cellSize)
+				{
+					bool oddColumn = (x / cellSize) % 2 != 0;
+					uint32_t end = x + cellSize < desc.mWidth ? x + cellSize : desc.mWidth;
+					fill(setup, row, x, end, oddRow != oddColumn);
+				}
+				break;
+			}
+
+			case EProceduralPattern::VerticalGradient:
+				t.assign(desc.mWidth, static_cast<float>(y) * verticalScale);
+				lerp(setup, row, t.data(), 0, desc.mWidth);
+				break;
+
+			case EProceduralPattern::RadialGradient:
+				ComputeRadialRow(desc, y, t.data());
+				lerp(setup, row, t.data(), 0, desc.mWidth);
+				break;
+
+			case EProceduralPattern::ValueNoise:
+			case EProceduralPattern::PerlinNoise:
+#if PROCEDURAL_TEXTURE_SSE2
+				if (simd)
+				{
+					ComputeNoiseRowSimd(desc, y, t.data());
+				}
+				else
+#endif
+				{
+					ComputeNoiseRowScalar(desc, y, t.data(), 0, desc.mWidth);
+				}
+				lerp(setup, row, t.data(), 0, desc.mWidth);
+				break;
+
+			default:
+				lerp(setup, row, t.data(), 0, desc.mWidth);
+				break;
+			}
+		}
+	}
+}
+
+uint32_t GetProceduralTexelSize(ERenderFormat format)
+{
+	switch (format)
+	{
+	case ERenderFormat::RGBA8Unorm:   return 4;
+	case ERenderFormat::RGBA32Float:  return 16;
+	default:                          return 0;
+	}
+}
+
+void GenerateProceduralRows(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	GenerateRows(desc, dst, rowPitch, rowBegin, rowEnd, true);
+}
+
+void GenerateProceduralRowsScalar(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	GenerateRows(desc, dst, rowPitch, rowBegin, rowEnd, false);
+}
+
+void GenerateProceduralTexture(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	CJobSystem* jobs)
+{
+	if (GetProceduralTexelSize(desc.mFormat) == 0 || desc.mWidth == 0 || desc.mHeight == 0)
+	{
+		throw std::invalid_argument("GenerateProceduralTexture needs a non-empty RGBA8Unorm or RGBA32Float texture.");
+	}
+
+	uint32_t rowsPerChunk = ParallelTexelsPerChunk / desc.mWidth;
+	if (!jobs || rowsPerChunk >= desc.mHeight)
+	{
+		GenerateProceduralRows(desc, dst, rowPitch, 0, desc.mHeight);
+		return;
+	}
+
+	jobs->ParallelFor(desc.mHeight, rowsPerChunk,
+		[&](uint32_t begin, uint32_t end)
+		{
+			GenerateProceduralRows(desc, dst, rowPitch, begin, end);
+		});
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "RenderDevice.h"
+
+class CJobSystem;
+
+enum class EProceduralPattern : uint8_t
+{
+	Solid,                  // mColor0
+	Checker,                // mCellSize squares, mColor0 where the cell row and column parity match
+	HorizontalGradient,     // mColor0 at the left edge to mColor1 at the right
+	VerticalGradient,       // top to bottom
+	RadialGradient,         // mColor0 in the centre to mColor1 at the nearest edge and beyond
+	ValueNoise,             // between mColor0 and mColor1; lattice every mCellSize texels
+	PerlinNoise,
+};
+
+struct FProceduralTextureDesc
+{
+	EProceduralPattern mPattern = EProceduralPattern::Checker;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	ERenderFormat mFormat = ERenderFormat::RGBA8Unorm;   // RGBA8Unorm or RGBA32Float
+	float mColor0[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float mColor1[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	uint32_t mCellSize = 32;
+	uint32_t mSeed = 0;
+	uint32_t mOctaves = 4;                              // Noise; each halves the cell size.
+};
+
+// Bytes per texel of the formats the generator writes, 0 for any other.
+uint32_t GetProceduralTexelSize(ERenderFormat format);
+
+// Writes rows [rowBegin, rowEnd) of the texture to dst, rowPitch bytes apart; dst may be
+// mapped upload memory. Row kernels, noise included, are SSE2 (AVX2 for fills when the build
+// targets it) with a scalar fallback; the two produce identical bytes.
+void GenerateProceduralRows(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	uint32_t rowBegin, uint32_t rowEnd);
+
+// The same rows through the scalar kernels only; the reference the SIMD ones are checked against.
+void GenerateProceduralRowsScalar(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	uint32_t rowBegin, uint32_t rowEnd);
+
+// Writes the whole texture, with the rows spread over the job system's threads when jobs is
+// not null. Throws std::invalid_argument for an unsupported format or a zero size.
+void GenerateProceduralTexture(const FProceduralTextureDesc& desc, uint8_t* dst, uint32_t rowPitch,
+	CJobSystem* jobs);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+
+#include "RenderDevice.h"
+#include "RenderFence.h"
+#include "CommandAllocatorPool.h"
+
+struct FRenderAllocatorBackend
+{
+	typedef std::shared_ptr<IRenderCommandAllocator> Allocator;
+	typedef ERenderQueueType ListType;
+
+	IRenderDevice* mDevice = nullptr;
+
+	Allocator Create(ListType type)
+	{
+		return mDevice->CreateCommandAllocator(type);
+	}
+
+	void Reset(Allocator& allocator)
+	{
+		allocator->Reset();
+	}
+};
+
+typedef CCommandAllocatorPool<FRenderAllocatorBackend, CRenderFenceTimeline> CRenderCommandAllocatorPool;
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CJobSystem;
+
+// Thin rendering-device layer: just what the sample's frame loop uses (device, queues, lists,
+// fences, buffers and textures, pipeline, swap chain, uploads). CD3D12RenderDevice maps it onto
+// D3D12; CNullRenderDevice records everything and runs without a window or GPU, so the frame
+// loop can be driven and timed headless.
+//
+// Objects the GPU may still reference (resources, allocators) are shared_ptr so they can sit in
+// a CDeferredReleaseQueue; the rest are owned by whoever created them. Unless noted otherwise
+// the interface is as thread-safe as D3D12: one thread per command list, device creation
+// methods from any thread.
+
+enum class ERenderQueueType : uint8_t
+{
+	Direct,
+	Compute,
+	Copy,
+};
+
+enum class ERenderResourceState : uint8_t
+{
+	Common,
+	Present,
+	RenderTarget,
+	PixelShaderResource,
+	CopyDest,
+	GenericRead,
+};
+
+enum class ERenderFormat : uint8_t
+{
+	Unknown,
+	RGBA8Unorm,
+	RGB32Float,
+	RGBA32Float,
+	R16Uint,
+	RGBA8UnormSrgb,
+	// Block-compressed: 4x4 texel blocks of 8 (BC1, BC4) or 16 bytes.
+	BC1Unorm,
+	BC1UnormSrgb,
+	BC2Unorm,
+	BC2UnormSrgb,
+	BC3Unorm,
+	BC3UnormSrgb,
+	BC4Unorm,
+	BC4Snorm,
+	BC5Unorm,
+	BC5Snorm,
+	BC6HUfloat,
+	BC6HSfloat,
+	BC7Unorm,
+	BC7UnormSrgb,
+};
+
+inline bool IsBlockCompressed(ERenderFormat format)
+{
+	return format >= ERenderFormat::BC1Unorm && format <= ERenderFormat::BC7UnormSrgb;
+}
+
+// Bytes per texel, or per 4x4 block of a block-compressed format; 0 for Unknown.
+inline uint32_t GetFormatBlockBytes(ERenderFormat format)
+{
+	switch (format)
+	{
+	case ERenderFormat::RGBA8Unorm:
+	case ERenderFormat::RGBA8UnormSrgb:  return 4;
+	case ERenderFormat::RGB32Float:      return 12;
+	case ERenderFormat::RGBA32Float:     return 16;
+	case ERenderFormat::R16Uint:         return 2;
+	case ERenderFormat::BC1Unorm:
+	case ERenderFormat::BC1UnormSrgb:
+	case ERenderFormat::BC4Unorm:
+	case ERenderFormat::BC4Snorm:        return 8;
+	case ERenderFormat::Unknown:         return 0;
+	default:                             return 16;
+	}
+}
+
+// Bytes of one row of texels (of blocks, when block-compressed) and the number of such rows.
+inline uint64_t GetFormatRowBytes(ERenderFormat format, uint32_t width)
+{
+	uint32_t columns = IsBlockCompressed(format) ? (width + 3) / 4 : width;
+	return static_cast<uint64_t>(columns) * GetFormatBlockBytes(format);
+}
+
+inline uint32_t GetFormatRowCount(ERenderFormat format, uint32_t height)
+{
+	return IsBlockCompressed(format) ? (height + 3) / 4 : height;
+}
+
+struct FRenderViewport
+{
+	float mX;
+	float mY;
+	float mWidth;
+	float mHeight;
+};
+
+struct FRenderRect
+{
+	int32_t mLeft;
+	int32_t mTop;
+	int32_t mRight;
+	int32_t mBottom;
+};
+
+// Same layout as D3D12_SUBRESOURCE_DATA.
+struct FRenderSubresourceData
+{
+	const void* mData;
+	intptr_t mRowPitch;
+	intptr_t mSlicePitch;
+};
+
+struct FRenderVertexElement
+{
+	const char* mSemantic;
+	ERenderFormat mFormat;
+	uint32_t mOffset;
+};
+
+struct FRenderPipelineDesc
+{
+	const std::vector<uint8_t>* mVertexShader;
+	const std::vector<uint8_t>* mPixelShader;
+	const FRenderVertexElement* mVertexElements;
+	uint32_t mVertexElementCount;
+	ERenderFormat mRenderTargetFormat;
+};
+
+class IRenderResource
+{
+public:
+	virtual ~IRenderResource() {}
+
+	// Persistently mapped pointer for upload buffers, nullptr for GPU-only resources.
+	virtual void* GetCPUAddress() = 0;
+	virtual uint64_t GetGPUAddress() = 0;
+};
+
+class IRenderPipeline
+{
+public:
+	virtual ~IRenderPipeline() {}
+};
+
+class IRenderCommandAllocator
+{
+public:
+	virtual ~IRenderCommandAllocator() {}
+
+	// Only once the GPU is done with everything recorded into it.
+	virtual void Reset() = 0;
+
+	// Commands recorded into it since the last Reset, by every list that used it. Allocators
+	// grow with what is recorded and D3D12 does not report their size, so this stands in for it.
+	virtual uint64_t GetCommandCount() const = 0;
+};
+
+class IRenderCommandList
+{
+public:
+	virtual ~IRenderCommandList() {}
+
+	virtual ERenderQueueType GetType() const = 0;
+
+	// Lists are created closed. pipeline may be nullptr.
+	virtual void Reset(IRenderCommandAllocator* allocator, IRenderPipeline* pipeline) = 0;
+	virtual void Close() = 0;
+
+	virtual void Transition(IRenderResource* resource, ERenderResourceState before, ERenderResourceState after) = 0;
+	virtual void ClearRenderTarget(IRenderResource* target, const float color[4]) = 0;
+
+	virtual void SetPipeline(IRenderPipeline* pipeline) = 0;
+	virtual void SetViewport(const FRenderViewport& viewport) = 0;
+	virtual void SetScissor(const FRenderRect& rect) = 0;
+	virtual void SetRenderTarget(IRenderResource* target) = 0;
+	virtual void SetVertexBuffer(IRenderResource* buffer, uint32_t stride, uint32_t size) = 0;
+	virtual void SetIndexBuffer(IRenderResource* buffer, ERenderFormat format, uint32_t size) = 0;
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex) = 0;
+	virtual void Dispatch(uint32_t x, uint32_t y, uint32_t z) = 0;
+};
+
+class IRenderFence
+{
+public:
+	virtual ~IRenderFence() {}
+
+	virtual uint64_t GetCompletedValue() = 0;
+
+	// Blocks the calling thread until the fence reaches value.
+	virtual void WaitForValue(uint64_t value) = 0;
+};
+
+class IRenderQueue
+{
+public:
+	virtual ~IRenderQueue() {}
+
+	virtual ERenderQueueType GetType() const = 0;
+
+	virtual void Execute(IRenderCommandList* const* lists, uint32_t count) = 0;
+	virtual void Signal(IRenderFence* fence, uint64_t value) = 0;
+
+	// GPU-side wait; work submitted afterwards starts once fence reaches value.
+	virtual void Wait(IRenderFence* fence, uint64_t value) = 0;
+};
+
+// What the display has done with a swap chain's presents (DXGI_FRAME_STATISTICS). Refresh
+// counts are vblank numbers; a present displayed later than its sync interval asked for
+// missed a vblank.
+struct FRenderPresentStats
+{
+	uint32_t mPresentCount;          // Presents issued so far.
+	uint32_t mDisplayedPresentCount; // Of those, the last one that reached the screen...
+	uint32_t mPresentRefreshCount;   // ...and the vblank it was displayed at.
+	uint32_t mSyncRefreshCount;      // A vblank and the time it happened, to measure the
+	int64_t mSyncTimeNs;             // refresh period with.
+};
+
+class IRenderSwapChain
+{
+public:
+	virtual ~IRenderSwapChain() {}
+
+	virtual uint32_t GetBufferCount() const = 0;
+	virtual uint32_t GetCurrentBackBufferIndex() = 0;
+	virtual IRenderResource* GetBackBuffer(uint32_t index) = 0;
+
+	// Low-latency swap chains block here until they can take another frame; others return.
+	virtual void WaitForNextFrame() = 0;
+
+	// 0 presents at once, tearing where supported; N waits for the Nth vblank.
+	virtual void Present(uint32_t syncInterval) = 0;
+	virtual bool IsTearingSupported() const = 0;
+
+	// False when the OS has no statistics to give, e.g. before the first vblank or while the
+	// window is composed without them.
+	virtual bool GetPresentStats(FRenderPresentStats& stats) = 0;
+};
+
+// Uploads on a queue of their own; see CUploadQueue.
+class IRenderUploadQueue
+{
+public:
+	virtual ~IRenderUploadQueue() {}
+
+	virtual void UploadSubresources(IRenderResource* dest, uint32_t firstSubresource, uint32_t numSubresources,
+		const FRenderSubresourceData* data) = 0;
+	virtual uint64_t Submit() = 0;
+	virtual void WaitOnQueue(IRenderQueue* consumer, IRenderResource* const* resources, uint32_t count) = 0;
+	virtual void Retire() = 0;
+
+	virtual IRenderFence* GetFence() = 0;
+	virtual uint64_t GetLastSignaledValue() = 0;
+};
+
+class IRenderDevice
+{
+public:
+	virtual ~IRenderDevice() {}
+
+	virtual std::unique_ptr<IRenderQueue> CreateQueue(ERenderQueueType type) = 0;
+	virtual std::unique_ptr<IRenderFence> CreateFence() = 0;
+
+	// One blocking wait until every fence has reached its value.
+	virtual void WaitForFences(IRenderFence* const* fences, const uint64_t* values, uint32_t count) = 0;
+
+	virtual std::shared_ptr<IRenderCommandAllocator> CreateCommandAllocator(ERenderQueueType type) = 0;
+	virtual std::unique_ptr<IRenderCommandList> CreateCommandList(ERenderQueueType type,
+		IRenderCommandAllocator* allocator, IRenderPipeline* pipeline) = 0;
+
+	// CPU-writable, persistently mapped, in GenericRead.
+	virtual std::shared_ptr<IRenderResource> CreateUploadBuffer(uint64_t size) = 0;
+	// GPU-only, in Common; filled through an upload queue.
+	virtual std::shared_ptr<IRenderResource> CreateBuffer(uint64_t size) = 0;
+	// GPU-only, in Common, so any queue can promote it. Subresource i is mip level i.
+	virtual std::shared_ptr<IRenderResource> CreateTexture2D(uint32_t width, uint32_t height, uint32_t mipLevels, ERenderFormat format) = 0;
+	// GPU-only, in Common, usable with ClearRenderTarget and SetRenderTarget.
+	virtual std::shared_ptr<IRenderResource> CreateRenderTarget2D(uint32_t width, uint32_t height, ERenderFormat format) = 0;
+
+	// Compiles the shader's "main"; throws on failure. Safe to call from worker threads.
+	virtual std::vector<uint8_t> CompileShader(const std::wstring& path, const char* target) = 0;
+	// Pipelines share one layout: a pixel-shader SRV table and a static point sampler.
+	virtual std::unique_ptr<IRenderPipeline> CreatePipeline(const FRenderPipelineDesc& desc) = 0;
+
+	// window is the native window handle (an HWND for D3D12), ignored where there is none.
+	virtual std::unique_ptr<IRenderSwapChain> CreateSwapChain(IRenderQueue* presentQueue, void* window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool lowLatency) = 0;
+
+	// With copyJobs, large copies into staging memory are spread over its threads.
+	virtual std::unique_ptr<IRenderUploadQueue> CreateUploadQueue(CJobSystem* copyJobs) = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+
+#include "RenderDevice.h"
+#include "FenceTimeline.h"
+
+// IRenderFence signalled from one IRenderQueue. Used as the fence of a CFenceTimeline, the
+// device-neutral counterpart of FD3D12Fence.
+struct FRenderFence
+{
+	std::unique_ptr<IRenderFence> mFence;
+	IRenderQueue* mQueue = nullptr;
+	IRenderDevice* mDevice = nullptr;
+
+	FRenderFence() {}
+	FRenderFence(const FRenderFence&) = delete;
+	FRenderFence& operator=(const FRenderFence&) = delete;
+
+	void Initialize(IRenderDevice* device, IRenderQueue* queue)
+	{
+		mFence = device->CreateFence();
+		mQueue = queue;
+		mDevice = device;
+	}
+
+	uint64_t GetCompletedValue()
+	{
+		return mFence->GetCompletedValue();
+	}
+
+	void Signal(uint64_t value)
+	{
+		mQueue->Signal(mFence.get(), value);
+	}
+
+	void WaitForValue(uint64_t value)
+	{
+		mFence->WaitForValue(value);
+	}
+
+	// One blocking call for several fences; they must all come from the same device.
+	static void WaitForValues(FRenderFence* const* fences, const uint64_t* values, uint32_t count)
+	{
+		IRenderFence* renderFences[MaxTimelinesPerWait];
+		assert(count <= MaxTimelinesPerWait);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			assert(fences[i]->mDevice == fences[0]->mDevice);
+			renderFences[i] = fences[i]->mFence.get();
+		}
+		fences[0]->mDevice->WaitForFences(renderFences, values, count);
+	}
+};
+
+typedef CFenceTimeline<FRenderFence> CRenderFenceTimeline;
@@ -0,0 +1,101 @@
+#include "StaticGeometry.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+uint32_t CStaticGeometry::FindPool(uint32_t stride)
+{
+	for (uint32_t i = 0; i < mPools.size(); ++i)
+	{
+		if (mPools[i].mStride == stride)
+		{
+			return i;
+		}
+	}
+
+	FPool pool;
+	pool.mStride = stride;
+	pool.mVertexCount = 0;
+	pool.mVertexBufferSize = 0;
+	pool.mIndexBufferSize = 0;
+	mPools.push_back(pool);
+	++mStats.mPools;
+	return static_cast<uint32_t>(mPools.size() - 1);
+}
+
+FStaticMesh CStaticGeometry::AddMesh(const void* vertices, uint32_t vertexCount, uint32_t stride,
+	const uint16_t* indices, uint32_t indexCount)
+{
+	assert(!mUploaded && "AddMesh called after Upload.");
+	assert(stride != 0);
+
+	uint32_t poolIndex = FindPool(stride);
+	FPool& pool = mPools[poolIndex];
+
+	const uint8_t* vertexBytes = static_cast<const uint8_t*>(vertices);
+	pool.mVertices.insert(pool.mVertices.end(), vertexBytes, vertexBytes + static_cast<size_t>(vertexCount) * stride);
+	if (pool.mVertices.size() > UINT32_MAX)
+	{
+		throw std::length_error("Static geometry pool is larger than a vertex buffer view can address.");
+	}
+
+	FStaticMesh mesh;
+	mesh.mPool = poolIndex;
+	mesh.mIndexCount = indexCount;
+	mesh.mFirstIndex = static_cast<uint32_t>(pool.mIndices.size());
+	mesh.mBaseVertex = static_cast<int32_t>(pool.mVertexCount);
+
+	pool.mIndices.insert(pool.mIndices.end(), indices, indices + indexCount);
+	pool.mVertexCount += vertexCount;
+
+	++mStats.mMeshes;
+	mStats.mVertexBytes += static_cast<uint64_t>(vertexCount) * stride;
+	mStats.mIndexBytes += static_cast<uint64_t>(indexCount) * sizeof(uint16_t);
+	return mesh;
+}
+
+void CStaticGeometry::Upload(IRenderDevice& device, IRenderUploadQueue& uploadQueue)
+{
+	assert(!mUploaded && "Static geometry is uploaded once.");
+
+	for (FPool& pool : mPools)
+	{
+		pool.mVertexBufferSize = static_cast<uint32_t>(pool.mVertices.size());
+		pool.mIndexBufferSize = static_cast<uint32_t>(pool.mIndices.size() * sizeof(uint16_t));
+		pool.mVertexBuffer = device.CreateBuffer(pool.mVertexBufferSize);
+		pool.mIndexBuffer = device.CreateBuffer(pool.mIndexBufferSize);
+
+		// Buffers are one subresource whose pitches are its size.
+		FRenderSubresourceData vertexData = {};
+		vertexData.mData = pool.mVertices.data();
+		vertexData.mRowPitch = pool.mVertexBufferSize;
+		vertexData.mSlicePitch = pool.mVertexBufferSize;
+		uploadQueue.UploadSubresources(pool.mVertexBuffer.get(), 0, 1, &vertexData);
+
+		FRenderSubresourceData indexData = {};
+		indexData.mData = pool.mIndices.data();
+		indexData.mRowPitch = pool.mIndexBufferSize;
+		indexData.mSlicePitch = pool.mIndexBufferSize;
+		uploadQueue.UploadSubresources(pool.mIndexBuffer.get(), 0, 1, &indexData);
+		mStats.mUploads += 2;
+
+		// The upload queue copied them into its staging memory.
+		std::vector<uint8_t>().swap(pool.mVertices);
+		std::vector<uint16_t>().swap(pool.mIndices);
+
+		mResources.push_back(pool.mVertexBuffer.get());
+		mResources.push_back(pool.mIndexBuffer.get());
+	}
+
+	mUploaded = true;
+}
+
+void CStaticGeometry::Bind(IRenderCommandList* commandList, uint32_t pool) const
+{
+	assert(mUploaded && pool < mPools.size());
+
+	const FPool& source = mPools[pool];
+	commandList->SetVertexBuffer(source.mVertexBuffer.get(), source.mStride, source.mVertexBufferSize);
+	commandList->SetIndexBuffer(source.mIndexBuffer.get(), ERenderFormat::R16Uint, source.mIndexBufferSize);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "RenderDevice.h"
+
+// Where a mesh ended up in the merged buffers: bind the pool, then DrawIndexed(mIndexCount, n,
+// mFirstIndex, mBaseVertex).
+struct FStaticMesh
+{
+	uint32_t mPool;
+	uint32_t mIndexCount;
+	uint32_t mFirstIndex;
+	int32_t mBaseVertex;
+};
+
+struct FStaticGeometryStats
+{
+	uint32_t mMeshes = 0;
+	uint32_t mPools = 0;
+	uint32_t mUploads = 0;          // UploadSubresources calls, two per pool.
+	uint64_t mVertexBytes = 0;
+	uint64_t mIndexBytes = 0;
+};
+
+// Geometry that never changes after load, merged into a few large GPU-only buffers.
+//
+// Meshes are appended on the CPU: all meshes with the same vertex stride share one pool, i.e.
+// one vertex buffer and one 16-bit index buffer. Indices stay relative to their mesh; the
+// base vertex is applied by the draw, so a pool may hold more than 65536 vertices. Upload()
+// creates each pool's buffers and stages both through the upload queue in one batch, after
+// which the CPU copies are dropped and the buffers are bound with Bind().
+//
+// The buffers are created in Common and read in place once the consumer queue has waited on
+// the upload queue (see IRenderUploadQueue::WaitOnQueue and GetResources).
+class CStaticGeometry
+{
+	struct FPool
+	{
+		uint32_t mStride;
+		uint32_t mVertexCount;
+		std::vector<uint8_t> mVertices;
+		std::vector<uint16_t> mIndices;
+		std::shared_ptr<IRenderResource> mVertexBuffer;
+		std::shared_ptr<IRenderResource> mIndexBuffer;
+		uint32_t mVertexBufferSize;
+		uint32_t mIndexBufferSize;
+	};
+
+	std::vector<FPool> mPools;
+	std::vector<IRenderResource*> mResources;
+	FStaticGeometryStats mStats;
+	bool mUploaded = false;
+
+	uint32_t FindPool(uint32_t stride);
+
+public:
+	// Copies the mesh; only valid before Upload().
+	FStaticMesh AddMesh(const void* vertices, uint32_t vertexCount, uint32_t stride,
+		const uint16_t* indices, uint32_t indexCount);
+
+	// Records every pending pool's copies into the upload queue's open batch; the caller
+	// submits it.
+	void Upload(IRenderDevice& device, IRenderUploadQueue& uploadQueue);
+
+	// Sets the pool's vertex and index buffers on the list.
+	void Bind(IRenderCommandList* commandList, uint32_t pool) const;
+
+	// Every buffer created by Upload(), for upload waits and pass declarations.
+	const std::vector<IRenderResource*>& GetResources() const { return mResources; }
+	const FStaticGeometryStats& GetStats() const               { return mStats; }
+	bool IsUploaded() const                                    { return mUploaded; }
+};
@@ -0,0 +1,175 @@
+#include "SubresourceCopy.h"
+
+#include <cstring>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SUBRESOURCE_COPY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Work per job when a copy is split; copies under two of these stay on the calling thread.
+	const size_t ParallelChunkBytes = 256 * 1024;
+	// Spans shorter than this are not worth aligning for streaming stores.
+	const size_t StreamMinBytes = 256;
+
+	// The copy as spanCount spans of spanSize bytes: spansPerSlice rows of each slice, or
+	// a whole slice, or everything, depending on which pitches are packed.
+	struct FSpanLayout
+	{
+		size_t mSpanSize;
+		uint32_t mSpansPerSlice;
+		uint32_t mSliceCount;
+		size_t mSrcSpanPitch;
+		size_t mDstSpanPitch;
+	};
+
+	FSpanLayout GetSpanLayout(const FSubresourceCopy& copy)
+	{
+		FSpanLayout layout;
+		layout.mSpanSize = copy.mRowSize;
+		layout.mSpansPerSlice = copy.mNumRows;
+		layout.mSliceCount = copy.mNumSlices;
+		layout.mSrcSpanPitch = copy.mSrcRowPitch;
+		layout.mDstSpanPitch = copy.mDstRowPitch;
+
+		if (copy.mSrcRowPitch == copy.mRowSize && copy.mDstRowPitch == copy.mRowSize)
+		{
+			layout.mSpanSize = copy.mRowSize * copy.mNumRows;
+			layout.mSpansPerSlice = 1;
+			if (copy.mNumSlices == 1 || (copy.mSrcSlicePitch == layout.mSpanSize && copy.mDstSlicePitch == layout.mSpanSize))
+			{
+				layout.mSpanSize *= copy.mNumSlices;
+				layout.mSliceCount = 1;
+			}
+		}
+		return layout;
+	}
+
+	void StreamCopy(uint8_t* dst, const uint8_t* src, size_t size)
+	{
+#if SUBRESOURCE_COPY_SSE2
+		if (size >= StreamMinBytes)
+		{
+			size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+			memcpy(dst, src, head);
+			dst += head;
+			src += head;
+			size -= head;
+
+			for (; size >= 64; size -= 64, dst += 64, src += 64)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+				__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+			}
+			for (; size >= 16; size -= 16, dst += 16, src += 16)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			}
+		}
+#endif
+		memcpy(dst, src, size);
+	}
+
+	void CopySpan(uint8_t* dst, const uint8_t* src, size_t size, ESubresourceCopyTarget target)
+	{
+		if (target == ESubresourceCopyTarget::WriteCombined)
+		{
+			StreamCopy(dst, src, size);
+		}
+		else
+		{
+			memcpy(dst, src, size);
+		}
+	}
+
+	// Streaming stores are weakly ordered: each thread that made some fences them before the
+	// copy is reported done.
+	void FenceStreamingStores(ESubresourceCopyTarget target)
+	{
+#if SUBRESOURCE_COPY_SSE2
+		if (target == ESubresourceCopyTarget::WriteCombined)
+		{
+			_mm_sfence();
+		}
+#else
+		(void)target;
+#endif
+	}
+
+	void CopySpans(const FSubresourceCopy& copy, const FSpanLayout& layout, ESubresourceCopyTarget target,
+		uint32_t spanBegin, uint32_t spanEnd)
+	{
+		for (uint32_t span = spanBegin; span < spanEnd; ++span)
+		{
+			uint32_t slice = span / layout.mSpansPerSlice;
+			uint32_t row = span - slice * layout.mSpansPerSlice;
+			CopySpan(copy.mDst + copy.mDstSlicePitch * slice + layout.mDstSpanPitch * row,
+				copy.mSrc + copy.mSrcSlicePitch * slice + layout.mSrcSpanPitch * row,
+				layout.mSpanSize, target);
+		}
+	}
+}
+
+void CopySubresource(const FSubresourceCopy& copy, ESubresourceCopyTarget target, CJobSystem* jobs)
+{
+	FSpanLayout layout = GetSpanLayout(copy);
+	uint32_t spanCount = layout.mSpansPerSlice * layout.mSliceCount;
+	size_t totalBytes = layout.mSpanSize * spanCount;
+
+	if (!jobs || jobs->GetThreadCount() == 1 || totalBytes < ParallelChunkBytes * 2)
+	{
+		CopySpans(copy, layout, target, 0, spanCount);
+		FenceStreamingStores(target);
+		return;
+	}
+
+	if (spanCount == 1)
+	{
+		// One long span: split it by byte ranges, which stay 64-byte multiples apart.
+		uint32_t chunkCount = static_cast<uint32_t>((layout.mSpanSize + ParallelChunkBytes - 1) / ParallelChunkBytes);
+		jobs->ParallelFor(chunkCount, 1,
+			[&](uint32_t begin, uint32_t end)
+			{
+				size_t offset = ParallelChunkBytes * begin;
+				size_t endOffset = ParallelChunkBytes * end;
+				if (endOffset > layout.mSpanSize)
+				{
+					endOffset = layout.mSpanSize;
+				}
+				CopySpan(copy.mDst + offset, copy.mSrc + offset, endOffset - offset, target);
+				FenceStreamingStores(target);
+			});
+		return;
+	}
+
+	uint32_t spansPerChunk = static_cast<uint32_t>(ParallelChunkBytes / layout.mSpanSize);
+	jobs->ParallelFor(spanCount, spansPerChunk,
+		[&](uint32_t begin, uint32_t end)
+		{
+			CopySpans(copy, layout, target, begin, end);
+			FenceStreamingStores(target);
+		});
+}
+
+void CopySubresourceRows(const FSubresourceCopy& copy)
+{
+	for (uint32_t z = 0; z < copy.mNumSlices; ++z)
+	{
+		uint8_t* dstSlice = copy.mDst + copy.mDstSlicePitch * z;
+		const uint8_t* srcSlice = copy.mSrc + copy.mSrcSlicePitch * z;
+		for (uint32_t y = 0; y < copy.mNumRows; ++y)
+		{
+			memcpy(dstSlice + copy.mDstRowPitch * y, srcSlice + copy.mSrcRowPitch * y, copy.mRowSize);
+		}
+	}
+}
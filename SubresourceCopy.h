@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class CJobSystem;
+
+// What the destination of a copy is, which decides how it is written.
+enum class ESubresourceCopyTarget : uint8_t
+{
+	Cached,             // Ordinary memory that may be read back soon: plain memcpy.
+	WriteCombined,      // Mapped upload memory the CPU never reads: non-temporal stores.
+};
+
+// NumSlices slices of NumRows rows of RowSize bytes, as MemcpySubresource takes them.
+struct FSubresourceCopy
+{
+	const uint8_t* mSrc;
+	size_t mSrcRowPitch;
+	size_t mSrcSlicePitch;
+	uint8_t* mDst;
+	size_t mDstRowPitch;
+	size_t mDstSlicePitch;
+	size_t mRowSize;
+	uint32_t mNumRows;
+	uint32_t mNumSlices;
+};
+
+// Replaces MemcpySubresource. Rows whose pitches equal the row size on both sides are copied
+// as one span per slice, and slices as one span when they are packed too. WriteCombined
+// targets are written with SSE2 streaming stores and fenced before returning. With jobs, copies
+// of at least a few hundred KB are split over the job system's threads, by spans or, for one
+// long span, by byte ranges.
+void CopySubresource(const FSubresourceCopy& copy, ESubresourceCopyTarget target, CJobSystem* jobs);
+
+// One memcpy per row, like MemcpySubresource; the baseline CopySubresource is measured against.
+void CopySubresourceRows(const FSubresourceCopy& copy);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of values from one producer thread to one consumer thread. Each side owns
+// a slot of its own; the third sits between them and is swapped in with a single atomic
+// exchange, so neither side ever waits for the other or sees a half-written value. A value
+// published before the consumer picked up the previous one replaces it.
+template<typename T>
+class CTripleBuffer
+{
+	static const uint32_t IndexMask = 3;
+	// Set on the middle slot by Publish, cleared by Acquire.
+	static const uint32_t FreshBit = 4;
+
+	T mSlots[3];
+	// Keeps the shared index off the cache lines of the slots either side writes.
+	char mPadBefore[64];
+	std::atomic<uint32_t> mMiddle;
+	char mPadAfter[64];
+
+	uint32_t mWriteIndex;   // Producer only.
+	uint32_t mReadIndex;    // Consumer only.
+
+public:
+	CTripleBuffer() :
+		mMiddle(1),
+		mWriteIndex(0),
+		mReadIndex(2)
+	{
+	}
+
+	CTripleBuffer(const CTripleBuffer&) = delete;
+	CTripleBuffer& operator=(const CTripleBuffer&) = delete;
+
+	// Producer: the slot to fill before Publish.
+	T& GetWriteSlot() { return mSlots[mWriteIndex]; }
+
+	// Producer: hands the write slot to the consumer and takes the middle one back.
+	void Publish()
+	{
+		uint32_t previous = mMiddle.exchange(mWriteIndex | FreshBit);
+		mWriteIndex = previous & IndexMask;
+	}
+
+	// Either side: whether a published value has not been acquired yet.
+	bool HasFresh() const
+	{
+		return (mMiddle.load() & FreshBit) != 0;
+	}
+
+	// Consumer: swaps in the latest published value; false (and the read slot unchanged) if
+	// nothing was published since the last call.
+	bool Acquire()
+	{
+		if (!HasFresh())
+		{
+			return false;
+		}
+		uint32_t previous = mMiddle.exchange(mReadIndex);
+		mReadIndex = previous & IndexMask;
+		return true;
+	}
+
+	// Consumer: the last acquired value, unchanged until the next successful Acquire.
+	const T& GetReadSlot() const { return mSlots[mReadIndex]; }
+};
@@ -0,0 +1,221 @@
+#include <windows.h>
+
+#include <wrl.h>
+#include "UploadQueue.h"
+#include "SubresourceCopy.h"
+
+const UINT64 CUploadQueue::DefaultStagingSize;
+const UINT CUploadQueue::StagingRegions;
+
+CUploadQueue::CUploadQueue() :
+	mAllocatorPool(nullptr),
+	mBatchCommandCount(0),
+	mStagingCPU(nullptr),
+	mCopyJobs(nullptr),
+	mFootprintCache(nullptr)
+{
+}
+
+void CUploadQueue::Initialize(ComPtr<ID3D12Device2> device, CD3D12CommandAllocatorPool& allocatorPool,
+	CD3D12FootprintCache& footprintCache, CJobSystem* copyJobs, UINT64 stagingSize)
+{
+	mDevice = device;
+	mAllocatorPool = &allocatorPool;
+	mFootprintCache = &footprintCache;
+	mCopyJobs = copyJobs;
+
+	D3D12_COMMAND_QUEUE_DESC desc = {};
+	desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	desc.NodeMask = 0;
+	ThrowIfFailed(mDevice->CreateCommandQueue(&desc, IID_PPV_ARGS(&mQueue)));
+	NAME_D3D12_OBJECT(mQueue);
+
+	mTimeline.GetFence().Initialize(mDevice.Get(), mQueue.Get());
+
+	CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(stagingSize);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mStagingBuffer)));
+	NAME_D3D12_OBJECT(mStagingBuffer);
+
+	// Mapped for good; the CPU never reads it.
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(mStagingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mStagingCPU)));
+	mStagingRing.Initialize(stagingSize, StagingRegions);
+}
+
+void CUploadQueue::OpenBatch()
+{
+	if (mAllocator.mValid)
+	{
+		return;
+	}
+
+	mAllocator = mAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_COPY);
+	mBatchCommandCount = 0;
+	ID3D12CommandAllocator* allocator = mAllocator.mAllocator.Get();
+
+	if (!mCommandList)
+	{
+		ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator, nullptr, IID_PPV_ARGS(&mCommandList)));
+		NAME_D3D12_OBJECT(mCommandList);
+	}
+	else
+	{
+		ThrowIfFailed(mCommandList->Reset(allocator, nullptr));
+	}
+}
+
+UINT64 CUploadQueue::AllocateStaging(UINT64 size)
+{
+	if (size > mStagingRing.GetCapacity())
+	{
+		return CUploadRing::InvalidOffset;
+	}
+
+	UINT64 offset = mStagingRing.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	while (offset == CUploadRing::InvalidOffset)
+	{
+		// Only the open batch holds staging memory: send it so it can retire.
+		if (mStagingRing.GetOldestFenceValue() == 0)
+		{
+			Submit();
+		}
+		mTimeline.WaitForValue(mStagingRing.GetOldestFenceValue());
+		Retire();
+		offset = mStagingRing.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	}
+	return offset;
+}
+
+void CUploadQueue::UploadSubresources(ID3D12Resource* dest, UINT firstSubresource, UINT numSubresources,
+	const D3D12_SUBRESOURCE_DATA* data)
+{
+	const D3D12_RESOURCE_DESC destDesc = dest->GetDesc();
+
+	const CD3D12FootprintCache::FFootprints& footprints = mFootprintCache->Get(destDesc, firstSubresource, numSubresources);
+	const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts = footprints.mLayouts.data();
+	const UINT* numRows = footprints.mNumRows.data();
+	const UINT64* rowSizes = footprints.mRowSizes.data();
+	UINT64 stagingSize = footprints.mTotalSize;
+	// What either path records: one buffer copy, or one copy per subresource.
+	const UINT copyCount = destDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? 1 : numSubresources;
+
+	// Before OpenBatch: a full ring may have to submit the open batch first.
+	UINT64 stagingOffset = AllocateStaging(stagingSize);
+	OpenBatch();
+
+	if (stagingOffset == CUploadRing::InvalidOffset)
+	{
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(stagingSize);
+
+		ComPtr<ID3D12Resource> staging;
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&staging)));
+
+		if (UpdateSubresources(mCommandList.Get(), dest, staging.Get(), firstSubresource, numSubresources,
+			stagingSize, layouts, numRows, rowSizes, data) == 0)
+		{
+			ThrowIfFailed(E_FAIL);
+		}
+
+		mStagingRelease.DeferToNextSignal(staging);
+		mBatchCommandCount += copyCount;
+		mTracker.AddToBatch(dest);
+		return;
+	}
+
+	// Straight into the mapped ring, which is write-combined, with the copies UpdateSubresources
+	// would record.
+	for (UINT i = 0; i < numSubresources; ++i)
+	{
+		FSubresourceCopy copy;
+		copy.mSrc = static_cast<const uint8_t*>(data[i].pData);
+		copy.mSrcRowPitch = static_cast<size_t>(data[i].RowPitch);
+		copy.mSrcSlicePitch = static_cast<size_t>(data[i].SlicePitch);
+		copy.mDst = mStagingCPU + stagingOffset + layouts[i].Offset;
+		copy.mDstRowPitch = layouts[i].Footprint.RowPitch;
+		copy.mDstSlicePitch = SIZE_T(layouts[i].Footprint.RowPitch) * SIZE_T(numRows[i]);
+		copy.mRowSize = static_cast<size_t>(rowSizes[i]);
+		copy.mNumRows = numRows[i];
+		copy.mNumSlices = layouts[i].Footprint.Depth;
+		CopySubresource(copy, ESubresourceCopyTarget::WriteCombined, mCopyJobs);
+	}
+
+	if (destDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		mCommandList->CopyBufferRegion(dest, 0, mStagingBuffer.Get(), stagingOffset + layouts[0].Offset, layouts[0].Footprint.Width);
+	}
+	else
+	{
+		for (UINT i = 0; i < numSubresources; ++i)
+		{
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = layouts[i];
+			layout.Offset += stagingOffset;
+			CD3DX12_TEXTURE_COPY_LOCATION dst(dest, i + firstSubresource);
+			CD3DX12_TEXTURE_COPY_LOCATION src(mStagingBuffer.Get(), layout);
+			mCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+	}
+
+	mBatchCommandCount += copyCount;
+	mTracker.AddToBatch(dest);
+}
+
+uint64_t CUploadQueue::Submit()
+{
+	if (!mAllocator.mValid)
+	{
+		return mTracker.GetLastSubmittedValue();
+	}
+
+	ThrowIfFailed(mCommandList->Close());
+
+	ID3D12CommandList* const commandLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+	uint64_t fenceValue = mTimeline.Signal();
+
+	mAllocatorPool->Release(mAllocator, mTimeline, fenceValue, mBatchCommandCount);
+
+	mStagingRing.CloseRegion(fenceValue);
+	mStagingRelease.OnSignal(fenceValue);
+	mTracker.OnBatchSubmitted(fenceValue);
+	return fenceValue;
+}
+
+void CUploadQueue::WaitOnQueue(ID3D12CommandQueue* consumer, ID3D12Resource* const* resources, UINT count)
+{
+	uint64_t waitValue = mTracker.AcquireForConsumer(consumer, resources, count);
+	if (waitValue != 0)
+	{
+		ThrowIfFailed(consumer->Wait(mTimeline.GetFence().mFence.Get(), waitValue));
+	}
+}
+
+void CUploadQueue::Retire()
+{
+	uint64_t completedValue = mTimeline.Poll();
+	mStagingRing.Retire(completedValue);
+	mStagingRelease.Collect(completedValue);
+	mTracker.Retire(completedValue);
+}
+
+void CUploadQueue::WaitIdle()
+{
+	mTimeline.WaitIdle();
+	Retire();
+}
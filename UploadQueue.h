@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#include "DXSampleHelper.h"
+#include "D3D12CommandAllocatorPool.h"
+#include "D3D12Fence.h"
+#include "D3D12FootprintCache.h"
+#include "DeferredReleaseQueue.h"
+#include "UploadRing.h"
+#include "UploadTracker.h"
+
+class CJobSystem;
+
+// Uploads through a dedicated D3D12_COMMAND_LIST_TYPE_COPY queue. Copies are recorded into an
+// open batch and go out together on Submit; a consumer queue then GPU-waits on the copy fence
+// (WaitOnQueue) before using anything from the batch, so uploads never serialize with rendering.
+//
+// Destination resources should be created in D3D12_RESOURCE_STATE_COMMON: the copy queue
+// promotes them to COPY_DEST, and they decay back to COMMON when the batch completes, from
+// where the direct queue can promote them to a read-only state without a barrier.
+//
+// Staging memory comes from one persistently mapped ring, a region per batch, reclaimed by the
+// copy fence; only uploads larger than the whole ring get a staging buffer of their own.
+class CUploadQueue
+{
+public:
+	static const UINT64 DefaultStagingSize = 4 * 1024 * 1024;
+	// Submitted batches whose staging memory can be pending separately; more share a region.
+	static const UINT StagingRegions = 64;
+
+private:
+	ComPtr<ID3D12Device2> mDevice;
+	ComPtr<ID3D12CommandQueue> mQueue;
+	ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	CD3D12FenceTimeline mTimeline;
+
+	CD3D12CommandAllocatorPool* mAllocatorPool;
+	CD3D12CommandAllocatorPool::FHandle mAllocator;   // Valid while a batch is open.
+	UINT64 mBatchCommandCount;                         // Copies recorded into the open batch.
+
+	ComPtr<ID3D12Resource> mStagingBuffer;
+	UINT8* mStagingCPU;
+	CUploadRing mStagingRing;
+	CJobSystem* mCopyJobs;   // Spreads large copies into the ring; may be null.
+	// Oversized uploads' own staging buffers, released once their batch has executed.
+	CDeferredReleaseQueue<ComPtr<ID3D12Resource>> mStagingRelease;
+
+	CD3D12FootprintCache* mFootprintCache;
+
+	CUploadTracker mTracker;
+
+	void OpenBatch();
+	// Offset of size bytes of staging in the ring, waiting for old batches (and submitting the
+	// open one) when it is full; InvalidOffset if it can never fit.
+	UINT64 AllocateStaging(UINT64 size);
+
+public:
+	CUploadQueue();
+
+	// Batches record into COPY allocators taken from allocatorPool; footprints of destinations
+	// come from footprintCache, which may be shared with other queues.
+	void Initialize(ComPtr<ID3D12Device2> device, CD3D12CommandAllocatorPool& allocatorPool,
+		CD3D12FootprintCache& footprintCache, CJobSystem* copyJobs, UINT64 stagingSize = DefaultStagingSize);
+
+	// Records a copy of the given subresources into dest through staging memory, which stays
+	// reserved until the batch has executed.
+	void UploadSubresources(ID3D12Resource* dest, UINT firstSubresource, UINT numSubresources,
+		const D3D12_SUBRESOURCE_DATA* data);
+
+	// Closes and executes the open batch, if any. Returns the copy fence value it signals.
+	uint64_t Submit();
+
+	// Makes consumer GPU-wait for the uploads of the given resources, if it is not already
+	// ordered after them. Must be called before consumer executes work that uses them.
+	void WaitOnQueue(ID3D12CommandQueue* consumer, ID3D12Resource* const* resources, UINT count);
+
+	// Releases staging memory of batches that have completed.
+	void Retire();
+
+	// Blocks until every submitted batch has completed.
+	void WaitIdle();
+
+	ID3D12CommandQueue* GetQueue() const { return mQueue.Get(); }
+	CD3D12FenceTimeline& GetTimeline()   { return mTimeline; }
+	const FUploadRingStats& GetStagingStats() const { return mStagingRing.GetStats(); }
+};
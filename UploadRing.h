@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+struct FUploadRingStats
+{
+	uint64_t mAllocations = 0;
+	uint64_t mBytesAllocated = 0;
+	// Bytes skipped at the end of the buffer so an allocation would not straddle it.
+	uint64_t mBytesWrapped = 0;
+	uint64_t mHighWater = 0;
+	// Allocations that found the ring full.
+	uint64_t mFullCount = 0;
+	// Regions folded into the newest one because every region slot was taken.
+	uint64_t mMergedRegions = 0;
+};
+
+// Ring allocator over one large, persistently mapped upload buffer. Allocations are handed out
+// in order and grouped into regions; each region is closed with the fence value that is
+// signalled after the GPU work reading it, and its memory comes back once that value has
+// completed. Regions retire in order, so a fence timeline that only moves forward drives it.
+//
+// Only offsets are handed out, so the same logic backs a mapped GPU buffer or plain CPU memory.
+// An allocation never straddles the end of the buffer: it starts over at offset 0 instead.
+//
+// Pending regions live in a fixed ring sized by Initialize, so the ring never allocates after
+// it. Closing a region with every slot taken folds it into the newest one, which then retires
+// with the later fence value.
+class CUploadRing
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+private:
+	struct FRegion
+	{
+		uint64_t mSize;         // Bytes it holds, wrap padding included.
+		uint64_t mFenceValue;
+	};
+
+	uint64_t mCapacity = 0;
+	uint64_t mHead = 0;         // Next free byte; the mUsed bytes before it (wrapping) are in use.
+	uint64_t mUsed = 0;
+	uint64_t mOpenSize = 0;     // Bytes allocated since the last CloseRegion.
+	std::vector<FRegion> mRegions;
+	uint32_t mFirstRegion = 0;  // Oldest pending region in mRegions, which wraps.
+	uint32_t mRegionCount = 0;
+	FUploadRingStats mStats;
+
+	FRegion& GetRegion(uint32_t index)
+	{
+		return mRegions[(mFirstRegion + index) % mRegions.size()];
+	}
+
+public:
+	// maxRegions is how many closed regions may be pending at once, e.g. the frames in flight
+	// plus a margin when one region is closed per frame.
+	void Initialize(uint64_t capacity, uint32_t maxRegions)
+	{
+		assert(maxRegions != 0);
+		mCapacity = capacity;
+		mHead = 0;
+		mUsed = 0;
+		mOpenSize = 0;
+		mRegions.assign(maxRegions, FRegion());
+		mFirstRegion = 0;
+		mRegionCount = 0;
+		mStats = FUploadRingStats();
+	}
+
+	// Returns InvalidOffset when the free space cannot hold the request; retire regions (or
+	// wait for GetOldestFenceValue) and try again. alignment must be a power of two.
+	uint64_t Allocate(uint64_t size, uint64_t alignment)
+	{
+		assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+		// Nothing in use: start over at the beginning for the largest contiguous space.
+		if (mUsed == 0)
+		{
+			mHead = 0;
+		}
+
+		uint64_t offset = (mHead + alignment - 1) & ~(alignment - 1);
+		uint64_t wrapped = 0;
+		if (offset + size > mCapacity)
+		{
+			wrapped = mCapacity - mHead;
+			offset = 0;
+		}
+
+		uint64_t needed = offset + size - mHead + (wrapped != 0 ? mCapacity : 0);
+		if (size > mCapacity || needed > mCapacity - mUsed)
+		{
+			++mStats.mFullCount;
+			return InvalidOffset;
+		}
+
+		mHead = offset + size;
+		mUsed += needed;
+		mOpenSize += needed;
+
+		++mStats.mAllocations;
+		mStats.mBytesAllocated += size;
+		mStats.mBytesWrapped += wrapped;
+		if (mUsed > mStats.mHighWater)
+		{
+			mStats.mHighWater = mUsed;
+		}
+		return offset;
+	}
+
+	// Everything allocated since the last call retires once fenceValue has completed.
+	void CloseRegion(uint64_t fenceValue)
+	{
+		if (mOpenSize == 0)
+		{
+			return;
+		}
+
+		assert((mRegionCount == 0 || fenceValue >= GetRegion(mRegionCount - 1).mFenceValue) &&
+			"Regions must be closed with increasing fence values.");
+		if (mRegionCount == mRegions.size())
+		{
+			FRegion& newest = GetRegion(mRegionCount - 1);
+			newest.mSize += mOpenSize;
+			newest.mFenceValue = fenceValue;
+			++mStats.mMergedRegions;
+		}
+		else
+		{
+			FRegion& region = GetRegion(mRegionCount++);
+			region.mSize = mOpenSize;
+			region.mFenceValue = fenceValue;
+		}
+		mOpenSize = 0;
+	}
+
+	void Retire(uint64_t completedValue)
+	{
+		while (mRegionCount != 0 && mRegions[mFirstRegion].mFenceValue <= completedValue)
+		{
+			mUsed -= mRegions[mFirstRegion].mSize;
+			mFirstRegion = (mFirstRegion + 1) % static_cast<uint32_t>(mRegions.size());
+			--mRegionCount;
+		}
+	}
+
+	// Fence value that frees the oldest closed region, 0 when none is pending.
+	uint64_t GetOldestFenceValue() const
+	{
+		return mRegionCount == 0 ? 0 : mRegions[mFirstRegion].mFenceValue;
+	}
+
+	uint32_t GetPendingRegionCount() const    { return mRegionCount; }
+
+	uint64_t GetCapacity() const              { return mCapacity; }
+	uint64_t GetUsed() const                  { return mUsed; }
+	const FUploadRingStats& GetStats() const  { return mStats; }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Cross-queue bookkeeping for uploads done on a copy queue and consumed on another queue.
+//
+// Resources are added to the open batch as their copies are recorded. When the batch is
+// submitted the copy queue signals a fence value, which becomes the value a consumer queue has
+// to GPU-wait on before it may touch any resource in that batch. Waits are issued once per
+// value and consumer queue: a queue that waited for value N is ordered after every batch <= N,
+// but another queue is not.
+//
+// Resources and consumer queues are opaque keys, so the tracker can be exercised with a fake
+// queue and fence.
+class CUploadTracker
+{
+	std::unordered_map<const void*, uint64_t> mPending;   // resource -> copy fence value
+	std::vector<const void*> mOpenBatch;
+	uint64_t mLastSubmitted = 0;
+	uint64_t mRetired = 0;
+
+	// What each consumer queue has waited for; there are only ever a few.
+	struct FConsumer
+	{
+		const void* mQueue;
+		uint64_t mWaited;
+	};
+	std::vector<FConsumer> mConsumers;
+
+	uint64_t& GetConsumerWaited(const void* queue)
+	{
+		for (FConsumer& consumer : mConsumers)
+		{
+			if (consumer.mQueue == queue)
+			{
+				return consumer.mWaited;
+			}
+		}
+		mConsumers.push_back(FConsumer{ queue, mRetired });
+		return mConsumers.back().mWaited;
+	}
+
+public:
+	void AddToBatch(const void* resource)
+	{
+		mOpenBatch.push_back(resource);
+	}
+
+	bool HasOpenBatch() const { return !mOpenBatch.empty(); }
+	uint64_t GetLastSubmittedValue() const { return mLastSubmitted; }
+
+	// fenceValue is what the copy queue signals right after executing the batch.
+	void OnBatchSubmitted(uint64_t fenceValue)
+	{
+		assert(fenceValue > mLastSubmitted);
+
+		for (const void* resource : mOpenBatch)
+		{
+			mPending[resource] = fenceValue;
+		}
+		mOpenBatch.clear();
+		mLastSubmitted = fenceValue;
+	}
+
+	// Returns the copy fence value the consumer queue must wait on before using these
+	// resources, or 0 if it is already ordered after their uploads. The returned wait is
+	// assumed to be issued on consumer.
+	template<typename TResource>
+	uint64_t AcquireForConsumer(const void* consumer, TResource* const* resources, uint32_t count)
+	{
+		uint64_t& waited = GetConsumerWaited(consumer);
+		uint64_t waitValue = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const void* key = resources[i];
+			assert(std::find(mOpenBatch.begin(), mOpenBatch.end(), key) == mOpenBatch.end() &&
+				"Resource used before its upload batch was submitted.");
+
+			auto it = mPending.find(key);
+			if (it != mPending.end() && it->second > waited)
+			{
+				waitValue = std::max(waitValue, it->second);
+			}
+		}
+
+		if (waitValue != 0)
+		{
+			waited = waitValue;
+		}
+		return waitValue;
+	}
+
+	// Forgets uploads the copy queue has finished; no GPU wait is needed for those any more.
+	void Retire(uint64_t completedValue)
+	{
+		for (auto it = mPending.begin(); it != mPending.end();)
+		{
+			if (it->second <= completedValue)
+			{
+				it = mPending.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		mRetired = std::max(mRetired, completedValue);
+		for (FConsumer& consumer : mConsumers)
+		{
+			consumer.mWaited = std::max(consumer.mWaited, completedValue);
+		}
+	}
+};
@@ -16,6 +16,72 @@
 
 HWND Win32Application::m_hwnd = nullptr;
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Frame clock backed by QueryPerformanceCounter. Sleeps use a high-resolution waitable
+// timer where the OS supports one, which wakes within ~0.5ms instead of a full scheduler tick.
+class Win32FrameClock : public IFrameClock
+{
+public:
+    Win32FrameClock()
+    {
+        QueryPerformanceFrequency(&m_frequency);
+
+        m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (!m_timer)
+        {
+            m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+    }
+
+    virtual ~Win32FrameClock()
+    {
+        if (m_timer)
+        {
+            CloseHandle(m_timer);
+        }
+    }
+
+    virtual int64_t NowNs()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+
+        // Split to avoid overflowing 64 bits for long uptimes.
+        int64_t seconds = counter.QuadPart / m_frequency.QuadPart;
+        int64_t remainder = counter.QuadPart % m_frequency.QuadPart;
+        return seconds * 1000000000ll + remainder * 1000000000ll / m_frequency.QuadPart;
+    }
+
+    virtual void SleepNs(int64_t ns)
+    {
+        if (!m_timer)
+        {
+            Sleep(static_cast<DWORD>(ns / 1000000));
+            return;
+        }
+
+        // Negative due time is relative, in 100ns units.
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -(ns / 100);
+        if (SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+        {
+            WaitForSingleObject(m_timer, INFINITE);
+        }
+    }
+
+    virtual void Spin()
+    {
+        YieldProcessor();
+    }
+
+private:
+    LARGE_INTEGER m_frequency;
+    HANDLE m_timer;
+};
+
 int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
 {
     // Parse the command line parameters
@@ -56,16 +122,36 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
 
     ShowWindow(m_hwnd, nCmdShow);
 
+    Win32FrameClock clock;
+    CFramePacer pacer(clock);
+    pacer.SetMode(pSample->GetPacingMode(), pSample->GetTargetFrameRate());
+
     // Main sample loop.
     MSG msg = {};
     while (msg.message != WM_QUIT)
     {
-        // Process any messages in the queue.
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        // Drain every pending message before running a frame.
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
         {
             TranslateMessage(&msg);
             DispatchMessage(&msg);
+
+            if (msg.message == WM_QUIT)
+            {
+                break;
+            }
         }
+
+        if (msg.message == WM_QUIT)
+        {
+            break;
+        }
+
+        pacer.WaitForNextFrame();
+
+        pSample->OnBeginFrame();
+        pSample->OnUpdate();
+        pSample->OnRender();
     }
 
     pSample->OnDestroy();
@@ -104,11 +190,9 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
         return 0;
 
     case WM_PAINT:
-        if (pSample)
-        {
-            pSample->OnUpdate();
-            pSample->OnRender();
-        }
+        // Frames are driven by the loop in Run; just validate the window so the OS
+        // stops generating WM_PAINT for it.
+        ValidateRect(hWnd, nullptr);
         return 0;
 
     case WM_DESTROY:
@@ -11,16 +11,12 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <string>
+#include <stdexcept>
 
-using namespace Microsoft::WRL;
+#include "D3D12Fence.h"
 
-inline void ThrowIfFailed(HRESULT hr)
-{
-	if (FAILED(hr))
-	{
-		throw std::exception();
-	}
-}
+using namespace Microsoft::WRL;
 
 
 // Use WARP adapter
@@ -55,10 +51,7 @@ UINT g_RTVDescriptorSize;
 UINT g_CurrentBackBufferIndex;
 
 // Synchronization objects
-ComPtr<ID3D12Fence> g_Fence;
-uint64_t g_FenceValue = 0;
-
-HANDLE g_FenceEvent;
+CD3D12FenceTimeline g_FrameTimeline;
 
 // By default, enable V-Sync.
 // Can be toggled with the V key.
@@ -393,52 +386,6 @@ ComPtr<ID3D12GraphicsCommandList> CreateCommandList(ComPtr<ID3D12Device2> device
 	return commandList;
 }
 
-ComPtr<ID3D12Fence> CreateFence(ComPtr<ID3D12Device2> device)
-{
-	ComPtr<ID3D12Fence> fence;
-
-	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
-
-	return fence;
-}
-
-uint64_t Signal(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence,
-	uint64_t& fenceValue)
-{
-	uint64_t fenceValueForSignal = ++fenceValue;
-	ThrowIfFailed(commandQueue->Signal(fence.Get(), fenceValueForSignal));
-
-	return fenceValueForSignal;
-}
-
-void WaitForFenceValue(ComPtr<ID3D12Fence> fence, uint64_t fenceValue, HANDLE fenceEvent)
-{
-	if (fence->GetCompletedValue() < fenceValue)
-	{
-		ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, fenceEvent));
-		::WaitForSingleObject(fenceEvent, 5000);
-	}
-}
-
-//һflush
-void Flush(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence,
-	uint64_t& fenceValue, HANDLE fenceEvent)
-{
-	//execute
-	uint64_t fenceValueForSignal = Signal(commandQueue, fence, fenceValue);
-	WaitForFenceValue(fence, fenceValueForSignal, fenceEvent);
-}
-
-HANDLE CreateEventHandle()
-{
-	HANDLE fenceEvent;
-
-	fenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(fenceEvent && "Failed to create fence event.");
-
-	return fenceEvent;
-}
-
 void Update()
 {
 	static uint64_t frameCounter = 0;
@@ -504,10 +451,10 @@ void Render()
 		UINT presentFlags = g_TearingSupported && !g_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
 		ThrowIfFailed(g_SwapChain->Present(syncInterval, presentFlags));
 
-		g_FrameFenceValues[g_CurrentBackBufferIndex] = Signal(g_CommandQueue, g_Fence, g_FenceValue);
+		g_FrameFenceValues[g_CurrentBackBufferIndex] = g_FrameTimeline.Signal();
 
 		g_CurrentBackBufferIndex = g_SwapChain->GetCurrentBackBufferIndex();
-		WaitForFenceValue(g_Fence, g_FrameFenceValues[g_CurrentBackBufferIndex], g_FenceEvent);
+		g_FrameTimeline.WaitForValue(g_FrameFenceValues[g_CurrentBackBufferIndex]);
 
 	}
 }
@@ -559,8 +506,7 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
 
 	g_CommandList = CreateCommandList(g_Device,g_CommandAllocators[g_CurrentBackBufferIndex], D3D12_COMMAND_LIST_TYPE_DIRECT);
 
-	g_Fence = CreateFence(g_Device);
-	g_FenceEvent = CreateEventHandle();
+	g_FrameTimeline.GetFence().Initialize(g_Device.Get(), g_CommandQueue.Get());
 
 	g_IsInitialized = true;
 
@@ -580,9 +526,7 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
 	}
 
 	// Make sure the command queue has finished all commands before closing.
-	Flush(g_CommandQueue, g_Fence, g_FenceValue, g_FenceEvent);
-
-	::CloseHandle(g_FenceEvent);
+	g_FrameTimeline.WaitIdle();
 
 	return 0;
 }